@@ -16,10 +16,12 @@
  *
  */
 
+#include <cstdlib>
 #include <string>
 
 #include <gtest/gtest.h>
 #include "asylo/bazel/test_shim_enclave.pb.h"
+#include "absl/strings/str_cat.h"
 #include "gflags/gflags.h"
 #include "asylo/test/util/enclave_test_application.h"
 #include "asylo/test/util/test_flags.h"
@@ -56,6 +58,9 @@ class TestShimEnclave : public EnclaveTestCase {
   }
 
   Status Run(const EnclaveInput &input, EnclaveOutput *output) override {
+    if (input.HasExtension(test_shim_enclave_input)) {
+      return RunTestShard(input.GetExtension(test_shim_enclave_input), output);
+    }
     if (!test_in_initialize_) {
       EnclaveRunAllTests();
     }
@@ -63,6 +68,54 @@ class TestShimEnclave : public EnclaveTestCase {
   }
 
  private:
+  // Runs a single shard of the test suite. Unlike EnclaveRunAllTests, test
+  // failures are reported to the caller rather than aborting the enclave, so
+  // the enclave can be reused to run further shards.
+  Status RunTestShard(const TestShimEnclaveInput &shard,
+                      EnclaveOutput *output) {
+    if (shard.total_shards() > 0) {
+      setenv("GTEST_TOTAL_SHARDS", absl::StrCat(shard.total_shards()).c_str(),
+             /*overwrite=*/1);
+      setenv("GTEST_SHARD_INDEX", absl::StrCat(shard.shard_index()).c_str(),
+             /*overwrite=*/1);
+    }
+    if (shard.has_output_file()) {
+      ::testing::GTEST_FLAG(output) = shard.output_file().c_str();
+    }
+
+    int argc = 1;
+    char argv0[] = "placeholder";
+    char *argv[] = {argv0, nullptr};
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+
+    const ::testing::UnitTest *unit_test = ::testing::UnitTest::GetInstance();
+    if (output) {
+      TestShimEnclaveOutput *summary =
+          output->MutableExtension(test_shim_enclave_output);
+      summary->set_tests_run(unit_test->test_to_run_count());
+      summary->set_tests_failed(unit_test->failed_test_count());
+      for (int i = 0; i < unit_test->total_test_case_count(); ++i) {
+        const ::testing::TestCase *test_case = unit_test->GetTestCase(i);
+        for (int j = 0; j < test_case->total_test_count(); ++j) {
+          const ::testing::TestInfo *info = test_case->GetTestInfo(j);
+          if (info->should_run() && info->result()->Failed()) {
+            summary->add_failed_tests(
+                absl::StrCat(test_case->name(), ".", info->name()));
+          }
+        }
+      }
+    }
+
+    if (result != 0) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat(unit_test->failed_test_count(),
+                                 " test(s) failed in shard ",
+                                 shard.shard_index()));
+    }
+    return Status::OkStatus();
+  }
+
   void EnclaveRunAllTests() {
     int argc = 1;
     char argv0[] = "placeholder";
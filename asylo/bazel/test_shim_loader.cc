@@ -17,10 +17,17 @@
  */
 
 #include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
 
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "asylo/bazel/test_shim_enclave.pb.h"
 #include "asylo/client.h"
 #include "gflags/gflags.h"
+#include "google/protobuf/text_format.h"
+#include "asylo/test/util/enclave_test_launcher_pool.h"
 #include "asylo/util/logging.h"
 #include "asylo/test/util/test_flags.h"
 
@@ -28,11 +35,85 @@ DEFINE_string(enclave_path, "", "Path to enclave to load");
 DEFINE_bool(test_in_initialize, false,
             "Run tests in Initialize, rather than Run");
 DEFINE_int32(v, 0, "Logging verbosity level");
+DEFINE_int32(enclave_pool_size, 1,
+             "Number of test enclaves to load and run shards across. Values "
+             "greater than 1 enable the pooled launcher");
+DEFINE_int32(test_shards, 0,
+             "Number of shards to split the test suite into when running with "
+             "the pooled launcher. Defaults to --enclave_pool_size");
+DEFINE_string(test_report_path, "",
+              "If set, the path to write an EnclaveTestPoolReport text proto "
+              "to when running with the pooled launcher");
 
 namespace {
 
 constexpr char kEnclaveName[] = "/test_shim_enclave";
 
+// Runs the test suite in shards across a pool of enclaves loaded from
+// |FLAGS_enclave_path|, and returns the process exit code.
+int RunPooled(const asylo::EnclaveConfig &config, const char *output_file) {
+  asylo::EnclaveTestLauncherPool pool(
+      []() -> asylo::StatusOr<std::unique_ptr<asylo::EnclaveLoader>> {
+        return std::unique_ptr<asylo::EnclaveLoader>(
+            absl::make_unique<asylo::SgxLoader>(FLAGS_enclave_path,
+                                                /*debug=*/true));
+      },
+      FLAGS_enclave_pool_size);
+  asylo::Status status = pool.SetUp(config, kEnclaveName);
+  if (!status.ok()) {
+    LOG(QFATAL) << "SetUp returned status: " << status;
+  }
+
+  int total_shards =
+      FLAGS_test_shards > 0 ? FLAGS_test_shards : FLAGS_enclave_pool_size;
+  std::vector<asylo::EnclaveInput> shards(total_shards);
+  for (int i = 0; i < total_shards; ++i) {
+    asylo::TestShimEnclaveInput *shard_input =
+        shards[i].MutableExtension(asylo::test_shim_enclave_input);
+    shard_input->set_shard_index(i);
+    shard_input->set_total_shards(total_shards);
+    if (output_file != nullptr && output_file[0] != '\0') {
+      shard_input->set_output_file(
+          absl::StrCat(output_file, ".shard-", i, "-of-", total_shards));
+    }
+  }
+
+  auto report_result = pool.RunShards(shards);
+  if (!report_result.ok()) {
+    LOG(QFATAL) << "RunShards returned status: " << report_result.status();
+  }
+  const asylo::EnclaveTestPoolReport &report = report_result.ValueOrDie();
+
+  if (!FLAGS_test_report_path.empty()) {
+    std::string text;
+    google::protobuf::TextFormat::PrintToString(report, &text);
+    std::ofstream(FLAGS_test_report_path) << text;
+  }
+
+  int failed_shards = 0;
+  for (const asylo::EnclaveTestShardResult &result : report.shard()) {
+    asylo::Status shard_status;
+    shard_status.RestoreFrom(result.status());
+    if (!shard_status.ok()) {
+      ++failed_shards;
+      LOG(ERROR) << "Shard " << result.shard_index() << " failed on enclave "
+                 << result.enclave_index() << ": " << shard_status;
+      for (const std::string &test : result.output()
+                                         .GetExtension(
+                                             asylo::test_shim_enclave_output)
+                                         .failed_tests()) {
+        LOG(ERROR) << "  FAILED: " << test;
+      }
+    }
+  }
+
+  status = pool.TearDown(asylo::EnclaveFinal());
+  if (!status.ok()) {
+    LOG(QFATAL) << "TearDown returned status: " << status;
+  }
+  return failed_shards == 0 ? 0 : 1;
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
@@ -60,6 +141,13 @@ int main(int argc, char *argv[]) {
       config.MutableExtension(asylo::test_shim_enclave_config);
   shim_config->set_test_in_initialize(FLAGS_test_in_initialize);
 
+  if (FLAGS_enclave_pool_size > 1 || FLAGS_test_shards > 1) {
+    if (FLAGS_test_in_initialize) {
+      LOG(QFATAL) << "--test_in_initialize cannot be used with pooled enclaves";
+    }
+    return RunPooled(config, output_file);
+  }
+
   // Load the enclave
   asylo::EnclaveManager::Configure(asylo::EnclaveManagerOptions());
   auto manager_result = asylo::EnclaveManager::Instance();
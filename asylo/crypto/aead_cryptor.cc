@@ -21,6 +21,7 @@
 #include <memory>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "asylo/crypto/random_nonce_generator.h"
 #include "asylo/util/status_macros.h"
 
@@ -38,25 +39,58 @@ constexpr size_t kAesGcmMaxMessageSize = static_cast<size_t>(1) << 25;
 constexpr uint64_t kAesGcmSivMaxSealedMessages = UINT64_C(1) << 48;
 constexpr size_t kAesGcmSivMaxMessageSize = static_cast<size_t>(1) << 25;
 
+// The nonce size of both AES-GCM and AES-GCM-SIV.
+constexpr size_t kAesGcmNonceSize = 12;
+
+Status CheckNonceGenerator(const NonceGeneratorInterface *nonce_generator) {
+  if (!nonce_generator) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Nonce generator must not be null");
+  }
+  if (nonce_generator->NonceSize() != kAesGcmNonceSize) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Nonce generator generates ",
+                               nonce_generator->NonceSize(),
+                               "-byte nonces (must be ", kAesGcmNonceSize,
+                               ")"));
+  }
+  return Status::OkStatus();
+}
+
 }  // namespace
 
 StatusOr<std::unique_ptr<AeadCryptor>> AeadCryptor::CreateAesGcmCryptor(
     ByteContainerView key) {
+  return CreateAesGcmCryptor(
+      key, RandomNonceGenerator::CreateAesGcmNonceGenerator());
+}
+
+StatusOr<std::unique_ptr<AeadCryptor>> AeadCryptor::CreateAesGcmCryptor(
+    ByteContainerView key,
+    std::unique_ptr<NonceGeneratorInterface> nonce_generator) {
+  ASYLO_RETURN_IF_ERROR(CheckNonceGenerator(nonce_generator.get()));
   std::unique_ptr<AeadKey> aead_key;
   ASYLO_ASSIGN_OR_RETURN(aead_key, AeadKey::CreateAesGcmKey(key));
   return absl::WrapUnique<AeadCryptor>(new AeadCryptor(
       std::move(aead_key), kAesGcmMaxMessageSize, kAesGcmMaxSealedMessages,
-      RandomNonceGenerator::CreateAesGcmNonceGenerator()));
+      std::move(nonce_generator)));
 }
 
 StatusOr<std::unique_ptr<AeadCryptor>> AeadCryptor::CreateAesGcmSivCryptor(
     ByteContainerView key) {
+  return CreateAesGcmSivCryptor(
+      key, RandomNonceGenerator::CreateAesGcmNonceGenerator());
+}
+
+StatusOr<std::unique_ptr<AeadCryptor>> AeadCryptor::CreateAesGcmSivCryptor(
+    ByteContainerView key,
+    std::unique_ptr<NonceGeneratorInterface> nonce_generator) {
+  ASYLO_RETURN_IF_ERROR(CheckNonceGenerator(nonce_generator.get()));
   std::unique_ptr<AeadKey> aead_key;
   ASYLO_ASSIGN_OR_RETURN(aead_key, AeadKey::CreateAesGcmSivKey(key));
   return absl::WrapUnique<AeadCryptor>(
       new AeadCryptor(std::move(aead_key), kAesGcmSivMaxMessageSize,
-                      kAesGcmSivMaxSealedMessages,
-                      RandomNonceGenerator::CreateAesGcmNonceGenerator()));
+                      kAesGcmSivMaxSealedMessages, std::move(nonce_generator)));
 }
 
 StatusOr<size_t> AeadCryptor::MaxMessageSize(AeadScheme scheme) {
@@ -111,7 +145,7 @@ Status AeadCryptor::Seal(ByteContainerView plaintext,
                   absl::StrCat("Reached maximum number of sealed messages (",
                                max_sealed_messages_, ")"));
   }
-  nonce_generator_->NextNonce(nonce);
+  ASYLO_RETURN_IF_ERROR(nonce_generator_->NextNonce(nonce));
   ASYLO_RETURN_IF_ERROR(key_->Seal(plaintext, associated_data, nonce,
                                    ciphertext, ciphertext_size));
   number_of_sealed_messages_++;
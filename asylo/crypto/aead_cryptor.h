@@ -48,6 +48,17 @@ class AeadCryptor {
   static StatusOr<std::unique_ptr<AeadCryptor>> CreateAesGcmCryptor(
       ByteContainerView key);
 
+  /// Creates a cryptor that uses AES-GCM for Seal() and Open(), and generates
+  /// nonces for use in Seal() with `nonce_generator`.
+  ///
+  /// \param key The underlying key used for encryption and decryption.
+  /// \param nonce_generator A generator of 96-bit nonces.
+  /// \return A pointer to the created cryptor, or a non-OK Status if creation
+  ///         failed.
+  static StatusOr<std::unique_ptr<AeadCryptor>> CreateAesGcmCryptor(
+      ByteContainerView key,
+      std::unique_ptr<NonceGeneratorInterface> nonce_generator);
+
   /// Creates a cryptor that uses AES-GCM-SIV for Seal() and Open(), and
   /// generates random 96-bit nonces for use in Seal().
   ///
@@ -57,6 +68,17 @@ class AeadCryptor {
   static StatusOr<std::unique_ptr<AeadCryptor>> CreateAesGcmSivCryptor(
       ByteContainerView key);
 
+  /// Creates a cryptor that uses AES-GCM-SIV for Seal() and Open(), and
+  /// generates nonces for use in Seal() with `nonce_generator`.
+  ///
+  /// \param key The underlying key used for encryption and decryption.
+  /// \param nonce_generator A generator of 96-bit nonces.
+  /// \return A pointer to the created cryptor, or a non-OK Status if creation
+  ///         failed.
+  static StatusOr<std::unique_ptr<AeadCryptor>> CreateAesGcmSivCryptor(
+      ByteContainerView key,
+      std::unique_ptr<NonceGeneratorInterface> nonce_generator);
+
   /// Gets the maximum size of a message that may be sealed successfully with a
   /// cryptor that uses `scheme`.
   ///
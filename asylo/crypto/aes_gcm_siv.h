@@ -143,8 +143,8 @@ class AesGcmSivCryptor {
     UnsafeBytes<kAesGcmSivNonceSize> nonce_copy;
     std::vector<uint8_t> key_id(SHA256_DIGEST_LENGTH);
     if (nonce_generator_->uses_key_id()) {
-      SHA256(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
-             key_id.data());
+      ::SHA256(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+               key_id.data());
     }
     ASYLO_RETURN_IF_ERROR(nonce_generator_->NextNonce(key_id, &nonce_copy));
     nonce->resize(nonce_copy.size());
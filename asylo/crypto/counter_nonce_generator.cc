@@ -0,0 +1,229 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/counter_nonce_generator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <openssl/rand.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+constexpr size_t kAesGcmNonceSize = 12;
+
+// Largest number of digits in a stored epoch, plus a newline.
+constexpr size_t kMaxEpochFileSize = 16;
+
+// Source of CounterNonceGenerator::generator_id_. Never reused, unlike the
+// address of a generator.
+std::atomic<uint64_t> next_generator_id(1);
+
+// The block of counters the calling thread generates nonces from.
+struct CounterBlock {
+  // The generator the block was reserved from, or zero if there is none.
+  uint64_t generator_id;
+
+  // The next counter to use, and one past the last counter in the block.
+  uint64_t next;
+  uint64_t end;
+};
+
+thread_local CounterBlock counter_block = {0, 0, 0};
+
+void StoreBigEndian64(uint64_t value, uint8_t *out) {
+  for (int i = 7; i >= 0; --i) {
+    out[i] = static_cast<uint8_t>(value);
+    value >>= 8;
+  }
+}
+
+Status PosixErrorStatus(absl::string_view operation, const std::string &path) {
+  return Status(static_cast<error::PosixError>(errno),
+                absl::StrCat(operation, " failed on ", path));
+}
+
+}  // namespace
+
+constexpr uint32_t CounterNonceGenerator::kBlockSize;
+
+StatusOr<uint32_t> InMemoryNonceEpochStore::NextEpoch() {
+  absl::MutexLock lock(&mu_);
+  if (last_epoch_ == std::numeric_limits<uint32_t>::max()) {
+    return Status(error::GoogleError::RESOURCE_EXHAUSTED,
+                  "Nonce epochs are exhausted");
+  }
+  return ++last_epoch_;
+}
+
+FileNonceEpochStore::FileNonceEpochStore(std::string path)
+    : path_(std::move(path)) {}
+
+StatusOr<uint32_t> FileNonceEpochStore::NextEpoch() {
+  absl::MutexLock lock(&mu_);
+
+  // A missing file means no epoch was reserved yet.
+  uint32_t last_epoch = 0;
+  int fd = open(path_.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    char buffer[kMaxEpochFileSize + 1];
+    ssize_t size = read(fd, buffer, kMaxEpochFileSize);
+    close(fd);
+    if (size < 0) {
+      return PosixErrorStatus("read", path_);
+    }
+    if (!absl::SimpleAtoi(absl::string_view(buffer, size), &last_epoch)) {
+      return Status(error::GoogleError::DATA_LOSS,
+                    absl::StrCat("Malformed nonce epoch in ", path_));
+    }
+  } else if (errno != ENOENT) {
+    return PosixErrorStatus("open", path_);
+  }
+
+  if (last_epoch == std::numeric_limits<uint32_t>::max()) {
+    return Status(error::GoogleError::RESOURCE_EXHAUSTED,
+                  "Nonce epochs are exhausted");
+  }
+  uint32_t epoch = last_epoch + 1;
+
+  std::string temp_path = absl::StrCat(path_, ".tmp");
+  fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    return PosixErrorStatus("open", temp_path);
+  }
+  std::string contents = absl::StrCat(epoch, "\n");
+  bool written =
+      write(fd, contents.data(), contents.size()) ==
+          static_cast<ssize_t>(contents.size()) &&
+      fsync(fd) == 0;
+  int saved_errno = errno;
+  close(fd);
+  if (!written) {
+    errno = saved_errno;
+    return PosixErrorStatus("write", temp_path);
+  }
+  if (rename(temp_path.c_str(), path_.c_str()) != 0) {
+    return PosixErrorStatus("rename", temp_path);
+  }
+
+  // The new epoch only survives a crash once the directory entry does. If it
+  // does not, the epoch is not returned, so an epoch that may be lost is never
+  // used.
+  size_t separator = path_.find_last_of('/');
+  std::string directory = separator == std::string::npos
+                              ? "."
+                              : path_.substr(0, std::max<size_t>(separator, 1));
+  ASYLO_RETURN_IF_ERROR(SyncDirectory(directory));
+  return epoch;
+}
+
+Status FileNonceEpochStore::SyncDirectory(const std::string &directory) {
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return PosixErrorStatus("open", directory);
+  }
+  bool synced = fsync(fd) == 0;
+  int saved_errno = errno;
+  close(fd);
+  if (!synced) {
+    errno = saved_errno;
+    return PosixErrorStatus("fsync", directory);
+  }
+  return Status::OkStatus();
+}
+
+StatusOr<std::unique_ptr<CounterNonceGenerator>>
+CounterNonceGenerator::CreateAesGcmNonceGenerator(
+    std::unique_ptr<NonceEpochStore> epoch_store) {
+  uint32_t instance_id;
+  if (RAND_bytes(reinterpret_cast<uint8_t *>(&instance_id),
+                 sizeof(instance_id)) != 1) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("RAND_bytes failed: ", BsslLastErrorString()));
+  }
+  uint32_t epoch;
+  ASYLO_ASSIGN_OR_RETURN(epoch, epoch_store->NextEpoch());
+  return absl::WrapUnique<CounterNonceGenerator>(
+      new CounterNonceGenerator(std::move(epoch_store), instance_id, epoch));
+}
+
+size_t CounterNonceGenerator::NonceSize() const { return kAesGcmNonceSize; }
+
+Status CounterNonceGenerator::NextNonce(absl::Span<uint8_t> nonce) {
+  if (nonce.size() < kAesGcmNonceSize) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Invalid vector parameter size: ", nonce.size(),
+                               " (vector size must be >= ", kAesGcmNonceSize,
+                               ")"));
+  }
+  return WriteNextNonce(nonce.data());
+}
+
+Status CounterNonceGenerator::NextNonce(const std::vector<uint8_t> &key_id,
+                                        UnsafeBytes<12> *nonce) {
+  return WriteNextNonce(nonce->data());
+}
+
+CounterNonceGenerator::CounterNonceGenerator(
+    std::unique_ptr<NonceEpochStore> epoch_store, uint32_t instance_id,
+    uint32_t epoch)
+    : epoch_store_(std::move(epoch_store)),
+      generator_id_(next_generator_id.fetch_add(1, std::memory_order_relaxed)),
+      instance_id_(instance_id),
+      epoch_(epoch),
+      next_counter_(static_cast<uint64_t>(epoch) << 32) {}
+
+StatusOr<uint64_t> CounterNonceGenerator::ReserveBlock() {
+  absl::MutexLock lock(&mu_);
+  if ((next_counter_ >> 32) != epoch_) {
+    // The counters of the current epoch are used up.
+    ASYLO_ASSIGN_OR_RETURN(epoch_, epoch_store_->NextEpoch());
+    next_counter_ = static_cast<uint64_t>(epoch_) << 32;
+  }
+  uint64_t start = next_counter_;
+  next_counter_ += kBlockSize;
+  return start;
+}
+
+Status CounterNonceGenerator::WriteNextNonce(uint8_t *nonce) {
+  CounterBlock &block = counter_block;
+  if (block.generator_id != generator_id_ || block.next == block.end) {
+    uint64_t start;
+    ASYLO_ASSIGN_OR_RETURN(start, ReserveBlock());
+    block = {generator_id_, start, start + kBlockSize};
+  }
+  memcpy(nonce, &instance_id_, sizeof(instance_id_));
+  StoreBigEndian64(block.next++, nonce + sizeof(instance_id_));
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
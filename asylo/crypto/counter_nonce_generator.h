@@ -0,0 +1,145 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_CRYPTO_COUNTER_NONCE_GENERATOR_H_
+#define ASYLO_CRYPTO_COUNTER_NONCE_GENERATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/nonce_generator.h"
+#include "asylo/crypto/nonce_generator_interface.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// A source of epochs for a CounterNonceGenerator. Each call to NextEpoch()
+// returns an epoch larger than any it returned before, including in earlier
+// runs of the program if the store is persistent. Implementations must be
+// thread-safe.
+class NonceEpochStore {
+ public:
+  virtual ~NonceEpochStore() = default;
+
+  // Reserves and returns a new epoch. The epoch must be durable before it is
+  // returned.
+  virtual StatusOr<uint32_t> NextEpoch() = 0;
+};
+
+// A NonceEpochStore that keeps the last epoch in memory. It does not protect
+// against nonce reuse across restarts, and is only suitable for keys that do
+// not outlive the process.
+class InMemoryNonceEpochStore : public NonceEpochStore {
+ public:
+  StatusOr<uint32_t> NextEpoch() override;
+
+ private:
+  absl::Mutex mu_;
+  uint32_t last_epoch_ GUARDED_BY(mu_) = 0;
+};
+
+// A NonceEpochStore that keeps the last epoch in a file. A new epoch is
+// written to a temporary file, synced, and renamed over the old one, and the
+// directory holding the file is synced before the epoch is returned. The file
+// is not authenticated, so a host that can roll it back can cause epochs to
+// repeat; the random instance id of CounterNonceGenerator still makes nonce
+// reuse unlikely in that case.
+class FileNonceEpochStore : public NonceEpochStore {
+ public:
+  explicit FileNonceEpochStore(std::string path);
+
+  StatusOr<uint32_t> NextEpoch() override;
+
+ protected:
+  // Makes the renaming of the epoch file in |directory| durable. Virtual so
+  // that tests can make it fail.
+  virtual Status SyncDirectory(const std::string &directory);
+
+ private:
+  const std::string path_;
+  absl::Mutex mu_;
+};
+
+// CounterNonceGenerator generates 96-bit AES-GCM nonces from counters instead
+// of drawing each one from the random number generator. A nonce is a random
+// 32-bit instance id, chosen when the generator is created, followed by a
+// 32-bit epoch from a NonceEpochStore and a 32-bit counter, all big-endian.
+//
+// Each thread reserves a block of counters at a time under a lock and then
+// generates nonces from it without synchronization. When an epoch runs out of
+// counters, the generator reserves the next epoch. Counters left over in a
+// thread's block when it switches to another generator are skipped, so nonces
+// are unique but not consecutive.
+//
+// The generator implements both nonce generator interfaces, so it can be used
+// with AeadCryptor and with AesGcmSivCryptor.
+class CounterNonceGenerator : public NonceGeneratorInterface,
+                              public NonceGenerator<12> {
+ public:
+  // Number of counters a thread reserves at a time.
+  static constexpr uint32_t kBlockSize = 1 << 12;
+
+  // Creates a generator that reserves epochs from |epoch_store|. Fails if no
+  // epoch could be reserved.
+  static StatusOr<std::unique_ptr<CounterNonceGenerator>>
+  CreateAesGcmNonceGenerator(std::unique_ptr<NonceEpochStore> epoch_store);
+
+  // From NonceGeneratorInterface.
+
+  size_t NonceSize() const override;
+
+  Status NextNonce(absl::Span<uint8_t> nonce) override;
+
+  // From NonceGenerator<12>. |key_id| is ignored.
+
+  Status NextNonce(const std::vector<uint8_t> &key_id,
+                   UnsafeBytes<12> *nonce) override;
+
+ private:
+  CounterNonceGenerator(std::unique_ptr<NonceEpochStore> epoch_store,
+                        uint32_t instance_id, uint32_t epoch);
+
+  // Reserves a block of kBlockSize counters, each of which is the epoch in the
+  // upper 32 bits and the counter in the lower 32 bits, and returns the first.
+  StatusOr<uint64_t> ReserveBlock();
+
+  // Writes the next nonce to |nonce|, which holds at least 12 bytes.
+  Status WriteNextNonce(uint8_t *nonce);
+
+  const std::unique_ptr<NonceEpochStore> epoch_store_;
+
+  // Identifies this generator in the thread-local blocks of counters.
+  const uint64_t generator_id_;
+
+  // The random bytes that prefix every nonce.
+  const uint32_t instance_id_;
+
+  absl::Mutex mu_;
+  uint32_t epoch_ GUARDED_BY(mu_);
+  uint64_t next_counter_ GUARDED_BY(mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_CRYPTO_COUNTER_NONCE_GENERATOR_H_
@@ -0,0 +1,322 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/counter_nonce_generator.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/aes_gcm_siv.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Gt;
+
+constexpr size_t kAesGcmNonceSize = 12;
+constexpr size_t kBadNonceSize = 11;
+constexpr int kNumThreads = 8;
+constexpr int kNoncesPerThread = 3 * CounterNonceGenerator::kBlockSize;
+
+constexpr char kKey[] = "0123456789abcdef";
+constexpr char kPlaintext[] = "Nonces must never repeat under one key";
+constexpr char kAssociatedData[] = "header";
+
+// A NonceEpochStore that starts at a given epoch and fails once it runs out of
+// epochs.
+class FakeNonceEpochStore : public NonceEpochStore {
+ public:
+  FakeNonceEpochStore(uint32_t first_epoch, int epochs)
+      : next_epoch_(first_epoch), epochs_left_(epochs) {}
+
+  StatusOr<uint32_t> NextEpoch() override {
+    if (epochs_left_ == 0) {
+      return Status(error::GoogleError::RESOURCE_EXHAUSTED, "No more epochs");
+    }
+    --epochs_left_;
+    return next_epoch_++;
+  }
+
+ private:
+  uint32_t next_epoch_;
+  int epochs_left_;
+};
+
+// Returns the epoch and counter of |nonce| as a single big-endian number.
+uint64_t EpochAndCounter(const std::vector<uint8_t> &nonce) {
+  uint64_t value = 0;
+  for (size_t i = 4; i < kAesGcmNonceSize; ++i) {
+    value = (value << 8) | nonce[i];
+  }
+  return value;
+}
+
+// Tests that NonceSize() returns the AES-GCM nonce size.
+TEST(CounterNonceGeneratorTest, NonceSize) {
+  std::unique_ptr<CounterNonceGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                     absl::make_unique<InMemoryNonceEpochStore>()));
+  EXPECT_EQ(generator->NonceSize(), kAesGcmNonceSize);
+}
+
+// Tests that NextNonce() returns a non-OK Status if it is given a nonce with
+// an invalid size.
+TEST(CounterNonceGeneratorTest, IncorrectNonceSize) {
+  std::unique_ptr<CounterNonceGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                     absl::make_unique<InMemoryNonceEpochStore>()));
+  std::vector<uint8_t> nonce(kBadNonceSize);
+  EXPECT_THAT(generator->NextNonce(absl::MakeSpan(nonce)),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+// Tests that creation fails if the epoch store cannot reserve an epoch.
+TEST(CounterNonceGeneratorTest, CreationFailsWithoutEpoch) {
+  EXPECT_THAT(CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                  absl::make_unique<FakeNonceEpochStore>(1, 0))
+                  .status(),
+              StatusIs(error::GoogleError::RESOURCE_EXHAUSTED));
+}
+
+// Tests that every nonce of a generator starts with the same instance id and
+// that the rest of the nonce increases within a thread.
+TEST(CounterNonceGeneratorTest, NoncesShareInstanceIdAndIncrease) {
+  std::unique_ptr<CounterNonceGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                     absl::make_unique<InMemoryNonceEpochStore>()));
+  std::vector<uint8_t> first(kAesGcmNonceSize);
+  ASYLO_ASSERT_OK(generator->NextNonce(absl::MakeSpan(first)));
+  std::vector<uint8_t> previous = first;
+  for (int i = 0; i < kNoncesPerThread; ++i) {
+    std::vector<uint8_t> nonce(kAesGcmNonceSize);
+    ASYLO_ASSERT_OK(generator->NextNonce(absl::MakeSpan(nonce)));
+    ASSERT_THAT(memcmp(nonce.data(), first.data(), 4), Eq(0));
+    ASSERT_THAT(EpochAndCounter(nonce), Gt(EpochAndCounter(previous)));
+    previous = nonce;
+  }
+}
+
+// Tests that nonces generated concurrently by many threads are unique.
+TEST(CounterNonceGeneratorTest, NoCollisionsAcrossThreads) {
+  std::unique_ptr<CounterNonceGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                     absl::make_unique<InMemoryNonceEpochStore>()));
+  std::vector<std::vector<std::string>> nonces(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&generator, &nonces, i] {
+      std::vector<uint8_t> nonce(kAesGcmNonceSize);
+      for (int j = 0; j < kNoncesPerThread; ++j) {
+        ASYLO_EXPECT_OK(generator->NextNonce(absl::MakeSpan(nonce)));
+        nonces[i].emplace_back(nonce.begin(), nonce.end());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  absl::flat_hash_set<std::string> unique_nonces;
+  for (const auto &thread_nonces : nonces) {
+    for (const auto &nonce : thread_nonces) {
+      EXPECT_TRUE(unique_nonces.insert(nonce).second);
+    }
+  }
+  EXPECT_EQ(unique_nonces.size(), size_t{kNumThreads} * kNoncesPerThread);
+}
+
+// Tests that a thread alternating between two generators never repeats a
+// nonce of either.
+TEST(CounterNonceGeneratorTest, AlternatingGeneratorsDoNotRepeat) {
+  std::unique_ptr<CounterNonceGenerator> generator1;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator1, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                      absl::make_unique<InMemoryNonceEpochStore>()));
+  std::unique_ptr<CounterNonceGenerator> generator2;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator2, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                      absl::make_unique<InMemoryNonceEpochStore>()));
+  absl::flat_hash_set<std::string> nonces1;
+  absl::flat_hash_set<std::string> nonces2;
+  std::vector<uint8_t> nonce(kAesGcmNonceSize);
+  for (int i = 0; i < 64; ++i) {
+    ASYLO_ASSERT_OK(generator1->NextNonce(absl::MakeSpan(nonce)));
+    EXPECT_TRUE(nonces1.emplace(nonce.begin(), nonce.end()).second);
+    ASYLO_ASSERT_OK(generator2->NextNonce(absl::MakeSpan(nonce)));
+    EXPECT_TRUE(nonces2.emplace(nonce.begin(), nonce.end()).second);
+  }
+}
+
+// Tests that nonces carry the epoch reserved from the store, starting from the
+// first counter.
+TEST(CounterNonceGeneratorTest, NoncesCarryReservedEpoch) {
+  std::unique_ptr<CounterNonceGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                     absl::make_unique<FakeNonceEpochStore>(7, 1)));
+  std::vector<uint8_t> nonce(kAesGcmNonceSize);
+  ASYLO_ASSERT_OK(generator->NextNonce(absl::MakeSpan(nonce)));
+  EXPECT_EQ(EpochAndCounter(nonce), uint64_t{7} << 32);
+}
+
+// Tests that FileNonceEpochStore returns increasing epochs across instances
+// that share a file.
+TEST(FileNonceEpochStoreTest, EpochsIncreaseAcrossInstances) {
+  std::string path =
+      absl::StrCat(FLAGS_test_tmpdir, "/counter_nonce_generator_epoch");
+  unlink(path.c_str());
+
+  uint32_t last_epoch = 0;
+  for (int i = 0; i < 3; ++i) {
+    FileNonceEpochStore store(path);
+    for (int j = 0; j < 2; ++j) {
+      uint32_t epoch;
+      ASYLO_ASSERT_OK_AND_ASSIGN(epoch, store.NextEpoch());
+      EXPECT_THAT(epoch, Gt(last_epoch));
+      last_epoch = epoch;
+    }
+  }
+}
+
+// Tests that FileNonceEpochStore rejects a file it did not write.
+TEST(FileNonceEpochStoreTest, MalformedFile) {
+  std::string path =
+      absl::StrCat(FLAGS_test_tmpdir, "/counter_nonce_generator_malformed");
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "epoch", 5), 5);
+  close(fd);
+
+  FileNonceEpochStore store(path);
+  EXPECT_THAT(store.NextEpoch().status(),
+              StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+// A FileNonceEpochStore whose directory syncs fail.
+class DirectorySyncFailingEpochStore : public FileNonceEpochStore {
+ public:
+  using FileNonceEpochStore::FileNonceEpochStore;
+
+ protected:
+  Status SyncDirectory(const std::string &directory) override {
+    return Status(error::PosixError::P_EIO,
+                  absl::StrCat("fsync failed on ", directory));
+  }
+};
+
+// Tests that FileNonceEpochStore does not return an epoch whose file could not
+// be made durable, and that a later store does not reuse it.
+TEST(FileNonceEpochStoreTest, DirectorySyncFailure) {
+  std::string path =
+      absl::StrCat(FLAGS_test_tmpdir, "/counter_nonce_generator_dir_sync");
+  unlink(path.c_str());
+
+  DirectorySyncFailingEpochStore failing_store(path);
+  EXPECT_THAT(failing_store.NextEpoch().status(),
+              StatusIs(error::PosixError::P_EIO));
+
+  FileNonceEpochStore store(path);
+  uint32_t epoch;
+  ASYLO_ASSERT_OK_AND_ASSIGN(epoch, store.NextEpoch());
+  EXPECT_THAT(epoch, Gt(1));
+}
+
+// Tests that an AeadCryptor using the generator seals messages that it can
+// open.
+TEST(CounterNonceGeneratorTest, SealsWithAeadCryptor) {
+  std::unique_ptr<CounterNonceGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                     absl::make_unique<InMemoryNonceEpochStore>()));
+  std::unique_ptr<experimental::AeadCryptor> cryptor;
+  ASYLO_ASSERT_OK_AND_ASSIGN(cryptor,
+                             experimental::AeadCryptor::CreateAesGcmCryptor(
+                                 kKey, std::move(generator)));
+
+  std::string plaintext = kPlaintext;
+  std::vector<uint8_t> nonce(cryptor->NonceSize());
+  std::vector<uint8_t> ciphertext(plaintext.size() +
+                                  cryptor->MaxSealOverhead());
+  size_t ciphertext_size;
+  ASYLO_ASSERT_OK(cryptor->Seal(plaintext, kAssociatedData,
+                                absl::MakeSpan(nonce),
+                                absl::MakeSpan(ciphertext), &ciphertext_size));
+  ciphertext.resize(ciphertext_size);
+
+  std::vector<uint8_t> opened(ciphertext.size());
+  size_t opened_size;
+  ASYLO_ASSERT_OK(cryptor->Open(ciphertext, kAssociatedData, nonce,
+                                absl::MakeSpan(opened), &opened_size));
+  EXPECT_EQ(std::string(opened.begin(), opened.begin() + opened_size),
+            plaintext);
+}
+
+// Tests that an AesGcmSivCryptor using the generator seals messages that it
+// can open.
+TEST(CounterNonceGeneratorTest, SealsWithAesGcmSivCryptor) {
+  std::unique_ptr<CounterNonceGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      generator, CounterNonceGenerator::CreateAesGcmNonceGenerator(
+                     absl::make_unique<InMemoryNonceEpochStore>()));
+  AesGcmSivCryptor cryptor(/*message_size_limit=*/1024, generator.release());
+  std::string key = kKey;
+  std::string plaintext = kPlaintext;
+  std::string associated_data = kAssociatedData;
+  std::vector<uint8_t> nonce;
+  std::vector<uint8_t> ciphertext;
+  ASYLO_ASSERT_OK(
+      cryptor.Seal(key, associated_data, plaintext, &nonce, &ciphertext));
+
+  CleansingVector<uint8_t> opened;
+  ASYLO_ASSERT_OK(
+      cryptor.Open(key, associated_data, ciphertext, nonce, &opened));
+  EXPECT_EQ(std::string(opened.begin(), opened.end()), plaintext);
+}
+
+// Tests that AeadCryptor rejects a missing nonce generator.
+TEST(CounterNonceGeneratorTest, AeadCryptorRejectsNullGenerator) {
+  EXPECT_THAT(
+      experimental::AeadCryptor::CreateAesGcmCryptor(kKey, nullptr).status(),
+      StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,104 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the throughput of ECDSA P-256 signing and verification.
+
+#include <openssl/rand.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
+#include "asylo/crypto/signing_key.h"
+#include "asylo/util/status.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(duration_ms, 500, "Duration of each measurement");
+DEFINE_int32(message_size, 256, "Size of each signed message in bytes");
+
+namespace asylo {
+namespace {
+
+template <typename T>
+T CheckOk(StatusOr<T> result) {
+  if (!result.ok()) {
+    std::cerr << result.status() << std::endl;
+    exit(1);
+  }
+  return std::move(result).ValueOrDie();
+}
+
+void CheckOk(const Status &status) {
+  if (!status.ok()) {
+    std::cerr << status << std::endl;
+    exit(1);
+  }
+}
+
+// Runs |operation| repeatedly for FLAGS_duration_ms and prints the number of
+// operations per second.
+void Measure(const std::string &name,
+             const std::function<Status()> &operation) {
+  auto start = std::chrono::steady_clock::now();
+  auto end = start + std::chrono::milliseconds(FLAGS_duration_ms);
+  uint64_t operations = 0;
+  std::chrono::steady_clock::time_point now;
+  do {
+    CheckOk(operation());
+    ++operations;
+    now = std::chrono::steady_clock::now();
+  } while (now < end);
+  double seconds = std::chrono::duration<double>(now - start).count();
+  std::cout << absl::StrFormat("%-24s %10.0f /s\n", name,
+                               operations / seconds);
+}
+
+void Run() {
+  std::unique_ptr<EcdsaP256Sha256SigningKey> signing_key =
+      CheckOk(EcdsaP256Sha256SigningKey::Create());
+  std::string serialized_key =
+      CheckOk(CheckOk(signing_key->GetVerifyingKey())->SerializeToDer());
+  std::unique_ptr<EcdsaP256Sha256VerifyingKey> verifying_key =
+      CheckOk(EcdsaP256Sha256VerifyingKey::CreateFromDer(serialized_key));
+
+  std::vector<uint8_t> message(FLAGS_message_size);
+  RAND_bytes(message.data(), message.size());
+  std::vector<uint8_t> signature;
+  CheckOk(signing_key->Sign(message, &signature));
+
+  std::vector<uint8_t> new_signature;
+  Measure("sign", [&] { return signing_key->Sign(message, &new_signature); });
+  Measure("verify", [&] { return verifying_key->Verify(message, signature); });
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Run();
+  return 0;
+}
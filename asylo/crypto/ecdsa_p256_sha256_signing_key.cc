@@ -25,6 +25,7 @@
 #include <openssl/mem.h>
 #include <openssl/nid.h>
 #include <openssl/pem.h>
+#include <openssl/sha.h>
 #include <openssl/x509.h>
 
 #include <cstdint>
@@ -253,15 +254,12 @@ EcdsaP256Sha256SigningKey::GetVerifyingKey() const {
 
 Status EcdsaP256Sha256SigningKey::Sign(ByteContainerView message,
                                        std::vector<uint8_t> *signature) const {
-  Sha256Hash hasher;
-  hasher.Init();
-  hasher.Update(message);
-  std::vector<uint8_t> digest;
-  ASYLO_RETURN_IF_ERROR(hasher.CumulativeHash(&digest));
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  ::SHA256(message.data(), message.size(), digest);
 
-  signature->resize(ECDSA_size(private_key_.get()));
+  signature->resize(max_signature_size_);
   uint32_t signature_size = 0;
-  if (!ECDSA_sign(/*type=*/0, digest.data(), digest.size(), signature->data(),
+  if (!ECDSA_sign(/*type=*/0, digest, sizeof(digest), signature->data(),
                   &signature_size, private_key_.get())) {
     return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
   }
@@ -272,6 +270,7 @@ Status EcdsaP256Sha256SigningKey::Sign(ByteContainerView message,
 EcdsaP256Sha256SigningKey::EcdsaP256Sha256SigningKey(
     bssl::UniquePtr<EC_KEY> private_key, bssl::UniquePtr<EC_KEY> public_key)
     : private_key_(std::move(private_key)),
-      public_key_(std::move(public_key)) {}
+      public_key_(std::move(public_key)),
+      max_signature_size_(ECDSA_size(private_key_.get())) {}
 
 }  // namespace asylo
@@ -109,6 +109,9 @@ class EcdsaP256Sha256SigningKey : public SigningKey {
   // An ECDSA P256 public key that can verify signatures produced by
   // private_key_.
   bssl::UniquePtr<EC_KEY> public_key_;
+
+  // The largest DER-encoded signature private_key_ can produce.
+  const size_t max_signature_size_;
 };
 
 }  // namespace asylo
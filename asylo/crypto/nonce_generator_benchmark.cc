@@ -0,0 +1,172 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Compares RandomNonceGenerator, which draws every nonce from the random number
+// generator, with CounterNonceGenerator, which draws a random instance id once
+// and then hands out counters. For 1 to --max_threads threads, the benchmark
+// reports the rate at which each generator produces nonces on its own, and the
+// rate at which an AES-GCM AeadCryptor using it seals --message_size-byte
+// messages.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/counter_nonce_generator.h"
+#include "asylo/crypto/nonce_generator_interface.h"
+#include "asylo/crypto/random_nonce_generator.h"
+#include "asylo/util/status.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(max_threads, 8, "Largest number of concurrent threads");
+DEFINE_int32(duration_ms, 500, "Duration of each measurement");
+DEFINE_int32(message_size, 64, "Size of each sealed message in bytes");
+
+namespace asylo {
+namespace {
+
+constexpr char kKey[] = "0123456789abcdef0123456789abcdef";
+
+using GeneratorFactory =
+    std::function<std::unique_ptr<NonceGeneratorInterface>()>;
+
+std::unique_ptr<NonceGeneratorInterface> CreateRandomGenerator() {
+  return RandomNonceGenerator::CreateAesGcmNonceGenerator();
+}
+
+std::unique_ptr<NonceGeneratorInterface> CreateCounterGenerator() {
+  auto generator_result = CounterNonceGenerator::CreateAesGcmNonceGenerator(
+      absl::make_unique<InMemoryNonceEpochStore>());
+  if (!generator_result.ok()) {
+    std::cerr << generator_result.status() << std::endl;
+    exit(1);
+  }
+  return std::move(generator_result).ValueOrDie();
+}
+
+using Operation = std::function<Status()>;
+
+// Runs an operation created by |create_operation| on each of |threads| threads
+// for FLAGS_duration_ms and returns the total number of operations completed
+// per second.
+double Measure(int threads,
+               const std::function<Operation()> &create_operation) {
+  std::atomic<bool> start(false);
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> total(0);
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      Operation operation = create_operation();
+      uint64_t count = 0;
+      while (!start.load(std::memory_order_acquire)) {
+      }
+      while (!stop.load(std::memory_order_relaxed)) {
+        Status status = operation();
+        if (!status.ok()) {
+          std::cerr << status << std::endl;
+          exit(1);
+        }
+        ++count;
+      }
+      total.fetch_add(count, std::memory_order_relaxed);
+    });
+  }
+
+  start.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_duration_ms));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return total.load() * 1000.0 / FLAGS_duration_ms;
+}
+
+void MeasureNonces(const char *name, const GeneratorFactory &factory,
+                   int threads) {
+  // Generators are thread-safe, so all threads share one.
+  std::shared_ptr<NonceGeneratorInterface> generator = factory();
+  double rate = Measure(threads, [&generator]() -> Operation {
+    return [generator] {
+      uint8_t nonce[12];
+      return generator->NextNonce(absl::MakeSpan(nonce));
+    };
+  });
+  std::cout << absl::StrFormat("%-8s %3d threads %10.2f Mnonces/s\n", name,
+                               threads, rate / 1e6);
+}
+
+void MeasureSeals(const char *name, const GeneratorFactory &factory,
+                  int threads) {
+  // Cryptors are not thread-safe, so each thread seals with its own.
+  double rate = Measure(threads, [&factory]() -> Operation {
+    auto cryptor_result =
+        experimental::AeadCryptor::CreateAesGcmCryptor(kKey, factory());
+    if (!cryptor_result.ok()) {
+      std::cerr << cryptor_result.status() << std::endl;
+      exit(1);
+    }
+    std::shared_ptr<experimental::AeadCryptor> cryptor =
+        std::move(cryptor_result).ValueOrDie();
+    auto plaintext = std::make_shared<std::string>(FLAGS_message_size, 'a');
+    auto nonce = std::make_shared<std::vector<uint8_t>>(cryptor->NonceSize());
+    auto ciphertext = std::make_shared<std::vector<uint8_t>>(
+        plaintext->size() + cryptor->MaxSealOverhead());
+    return [cryptor, plaintext, nonce, ciphertext] {
+      size_t ciphertext_size;
+      return cryptor->Seal(*plaintext, /*associated_data=*/"",
+                           absl::MakeSpan(*nonce), absl::MakeSpan(*ciphertext),
+                           &ciphertext_size);
+    };
+  });
+  std::cout << absl::StrFormat("%-8s %3d threads %10.2f Mseals/s\n", name,
+                               threads, rate / 1e6);
+}
+
+void Run() {
+  for (int threads = 1; threads <= FLAGS_max_threads; threads *= 2) {
+    MeasureNonces("random", CreateRandomGenerator, threads);
+    MeasureNonces("counter", CreateCounterGenerator, threads);
+  }
+  for (int threads = 1; threads <= FLAGS_max_threads; threads *= 2) {
+    MeasureSeals("random", CreateRandomGenerator, threads);
+    MeasureSeals("counter", CreateCounterGenerator, threads);
+  }
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Run();
+  return 0;
+}
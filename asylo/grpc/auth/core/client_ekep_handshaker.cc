@@ -320,18 +320,13 @@ Status ClientEkepHandshaker::HandleServerId(const google::protobuf::Message &mes
                   "Server did not provide all expected assertions");
   }
 
-  std::vector<uint8_t> server_public_key;
-  std::copy(server_id.dh_public_key().cbegin(),
-            server_id.dh_public_key().cend(),
-            std::back_inserter(server_public_key));
-
   // Derive EKEP Master and Authenticator secrets using the current transcript
   // and the server's public key.
   std::string transcript_hash;
   ASYLO_RETURN_IF_ERROR(GetTranscriptHash(&transcript_hash));
   return DeriveSecrets(selected_cipher_suite_, transcript_hash,
-                       server_public_key, dh_private_key_, &master_secret_,
-                       &authenticator_secret_);
+                       server_id.dh_public_key(), dh_private_key_,
+                       &master_secret_, &authenticator_secret_);
 }
 
 Status ClientEkepHandshaker::HandleServerFinish(const google::protobuf::Message &message,
@@ -344,11 +339,6 @@ Status ClientEkepHandshaker::HandleServerFinish(const google::protobuf::Message
   }
   const ServerFinish &server_finish = *server_finish_ptr;
 
-  CleansingVector<uint8_t> actual_server_handshake_authenticator;
-  std::copy(server_finish.handshake_authenticator().cbegin(),
-            server_finish.handshake_authenticator().cend(),
-            std::back_inserter(actual_server_handshake_authenticator));
-
   // Compute the server handshake authenticator.
   CleansingVector<uint8_t> expected_server_handshake_authenticator;
   ASYLO_RETURN_IF_ERROR(ComputeServerHandshakeAuthenticator(
@@ -357,7 +347,7 @@ Status ClientEkepHandshaker::HandleServerFinish(const google::protobuf::Message
 
   // Validate the server's handshake authenticator value.
   if (!CheckMacEquality(expected_server_handshake_authenticator,
-                        actual_server_handshake_authenticator)) {
+                        server_finish.handshake_authenticator())) {
     return Status(Abort_ErrorCode_BAD_AUTHENTICATOR,
                   "Server handshake authenticator value is incorrect");
   }
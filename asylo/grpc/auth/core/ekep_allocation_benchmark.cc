@@ -0,0 +1,216 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Counts the heap allocations made by EKEP. The benchmark replaces the global
+// allocation functions with ones that count their calls, runs --handshakes
+// complete handshakes between a client and a server handshaker that use null
+// assertions, and reports the average number of allocations and allocated
+// bytes per handshake. It reports the same counts for the derivation of the
+// EKEP secrets alone, which is where most short-lived secrets of a handshake
+// are created.
+
+#include <openssl/curve25519.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/grpc/auth/core/client_ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_crypto.h"
+#include "asylo/grpc/auth/core/ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/grpc/auth/core/server_ekep_handshaker.h"
+#include "asylo/identity/descriptions.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/util/cleansing_types.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(handshakes, 1000, "Number of handshakes to measure");
+
+namespace {
+
+std::atomic<uint64_t> allocation_count(0);
+std::atomic<uint64_t> allocated_bytes(0);
+
+}  // namespace
+
+void *operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t size) noexcept { std::free(ptr); }
+
+namespace asylo {
+namespace {
+
+// Allocation counts of a measured operation.
+struct AllocationCounts {
+  uint64_t allocations;
+  uint64_t bytes;
+};
+
+AllocationCounts CurrentCounts() {
+  return {allocation_count.load(std::memory_order_relaxed),
+          allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+// Prints the allocations made since |start| averaged over |operations|
+// operations of |elapsed| total duration.
+void Report(const char *name, const AllocationCounts &start, int operations,
+            std::chrono::nanoseconds elapsed) {
+  AllocationCounts end = CurrentCounts();
+  std::cout << absl::StrFormat(
+      "%-16s %10.1f allocations %10.1f bytes %10.2f us per operation\n", name,
+      static_cast<double>(end.allocations - start.allocations) / operations,
+      static_cast<double>(end.bytes - start.bytes) / operations,
+      elapsed.count() / 1e3 / operations);
+}
+
+// Delivers the frame in |frame|, if any, to |handshaker| and returns the
+// result of the handshake step. The handshaker's response is written to
+// |response|.
+EkepHandshaker::Result Deliver(EkepHandshaker *handshaker, std::string *frame,
+                               std::string *response) {
+  std::string incoming;
+  incoming.swap(*frame);
+  return handshaker->NextHandshakeStep(incoming.data(), incoming.size(),
+                                       response);
+}
+
+// Runs a complete handshake between a client and a server configured with
+// |options|. Returns false if the handshake does not complete.
+bool RunHandshake(const EkepHandshakerOptions &options) {
+  std::unique_ptr<EkepHandshaker> client =
+      ClientEkepHandshaker::Create(options);
+  std::unique_ptr<EkepHandshaker> server =
+      ServerEkepHandshaker::Create(options);
+  if (!client || !server) {
+    return false;
+  }
+
+  std::string to_server;
+  std::string to_client;
+  EkepHandshaker::Result client_result =
+      client->NextHandshakeStep(nullptr, 0, &to_server);
+  EkepHandshaker::Result server_result = EkepHandshaker::Result::IN_PROGRESS;
+  while (client_result != EkepHandshaker::Result::COMPLETED ||
+         server_result != EkepHandshaker::Result::COMPLETED) {
+    if (client_result == EkepHandshaker::Result::ABORTED ||
+        server_result == EkepHandshaker::Result::ABORTED) {
+      return false;
+    }
+    if (!to_server.empty()) {
+      server_result = Deliver(server.get(), &to_server, &to_client);
+    } else if (!to_client.empty()) {
+      client_result = Deliver(client.get(), &to_client, &to_server);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int Run() {
+  std::vector<EnclaveAssertionAuthorityConfig> authority_configs = {
+      GetNullAssertionAuthorityTestConfig()};
+  if (!InitializeEnclaveAssertionAuthorities(authority_configs.cbegin(),
+                                             authority_configs.cend())
+           .ok()) {
+    std::cerr << "Failed to initialize assertion authorities" << std::endl;
+    return 1;
+  }
+
+  EkepHandshakerOptions options;
+  AssertionDescription description;
+  SetNullAssertionDescription(&description);
+  options.self_assertions.push_back(description);
+  options.accepted_peer_assertions.push_back(description);
+
+  // Warm up any lazily-initialized state before counting.
+  if (!RunHandshake(options)) {
+    std::cerr << "Handshake failed" << std::endl;
+    return 1;
+  }
+
+  AllocationCounts start = CurrentCounts();
+  auto start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_handshakes; ++i) {
+    if (!RunHandshake(options)) {
+      std::cerr << "Handshake failed" << std::endl;
+      return 1;
+    }
+  }
+  Report("handshake", start, FLAGS_handshakes,
+         std::chrono::steady_clock::now() - start_time);
+
+  uint8_t client_public_key[X25519_PUBLIC_VALUE_LEN];
+  uint8_t client_private_key[X25519_PRIVATE_KEY_LEN];
+  uint8_t server_public_key[X25519_PUBLIC_VALUE_LEN];
+  uint8_t server_private_key[X25519_PRIVATE_KEY_LEN];
+  X25519_keypair(client_public_key, client_private_key);
+  X25519_keypair(server_public_key, server_private_key);
+  std::string transcript_hash(32, 'T');
+
+  start = CurrentCounts();
+  start_time = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_handshakes; ++i) {
+    CleansingVector<uint8_t> master_secret;
+    CleansingVector<uint8_t> authenticator_secret;
+    if (!DeriveSecrets(CURVE25519_SHA256, transcript_hash,
+                       ByteContainerView(server_public_key,
+                                         sizeof(server_public_key)),
+                       ByteContainerView(client_private_key,
+                                         sizeof(client_private_key)),
+                       &master_secret, &authenticator_secret)
+             .ok()) {
+      std::cerr << "Secret derivation failed" << std::endl;
+      return 1;
+    }
+  }
+  Report("derive secrets", start, FLAGS_handshakes,
+         std::chrono::steady_clock::now() - start_time);
+  return 0;
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  return asylo::Run();
+}
@@ -30,10 +30,13 @@
 #include <memory>
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "asylo/crypto/util/bssl_util.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/util/logging.h"
 #include "asylo/grpc/auth/core/ekep_error_space.h"
+#include "asylo/util/cleansing_arena.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
@@ -42,6 +45,10 @@ namespace {
 constexpr size_t kEkepSecretSize =
     (kEkepMasterSecretSize + kEkepAuthenticatorSecretSize);
 
+// Size of the stack region holding the temporary secrets of DeriveSecrets().
+constexpr size_t kEkepDerivationRegionSize =
+    X25519_SHARED_KEY_LEN + kEkepSecretSize;
+
 constexpr char kEkepHkdfSalt[] = "EKEP Handshake v1";
 constexpr char kEkepHkdfSaltRecordProtocol[] = "EKEP Record Protocol v1";
 constexpr char kServerAuthenticatedText[] = "EKEP Handshake v1: Server Finish";
@@ -85,8 +92,14 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
                      ByteContainerView self_dh_private_key,
                      CleansingVector<uint8_t> *master_secret,
                      CleansingVector<uint8_t> *authenticator_secret) {
+  // The shared secret and the HKDF output only live for the duration of this
+  // call, so they are allocated on the stack and cleansed together.
+  uint8_t region[kEkepDerivationRegionSize];
+  CleansingArena arena(absl::MakeSpan(region));
+  CleansingArenaAllocator<uint8_t> allocator(&arena);
+
   const EVP_MD *digest = nullptr;
-  CleansingVector<uint8_t> shared_secret;
+  CleansingArenaVector<uint8_t> shared_secret(allocator);
 
   // Generate the shared secret and initialize a hash function for HKDF based on
   // the ciphersuite.
@@ -122,9 +135,8 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
   }
 
   // Derive the master and authenticator secrets using HKDF.
-  std::string salt(kEkepHkdfSalt);
-  CleansingVector<uint8_t> output_key;
-  output_key.resize(kEkepSecretSize);
+  absl::string_view salt(kEkepHkdfSalt);
+  CleansingArenaVector<uint8_t> output_key(kEkepSecretSize, allocator);
   if (!HKDF(output_key.data(), kEkepSecretSize, digest, shared_secret.data(),
             shared_secret.size(),
             reinterpret_cast<const uint8_t *>(salt.data()), salt.size(),
@@ -134,12 +146,13 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
   }
 
   // Copy the master secret.
-  std::copy(output_key.cbegin(), output_key.cbegin() + kEkepMasterSecretSize,
-            std::back_inserter(*master_secret));
+  master_secret->insert(master_secret->end(), output_key.cbegin(),
+                        output_key.cbegin() + kEkepMasterSecretSize);
 
   // Copy the authenticator secret.
-  std::copy(output_key.cbegin() + kEkepMasterSecretSize, output_key.cend(),
-            std::back_inserter(*authenticator_secret));
+  authenticator_secret->insert(authenticator_secret->end(),
+                               output_key.cbegin() + kEkepMasterSecretSize,
+                               output_key.cend());
 
   return Status::OkStatus();
 }
@@ -181,7 +194,7 @@ Status DeriveRecordProtocolKey(const HandshakeCipher &ciphersuite,
                         RecordProtocol_Name(record_protocol));
   }
 
-  std::string salt(kEkepHkdfSaltRecordProtocol);
+  absl::string_view salt(kEkepHkdfSaltRecordProtocol);
   if (!HKDF(record_protocol_key->data(), record_protocol_key->size(), digest,
             master_secret.data(), master_secret.size(),
             reinterpret_cast<const uint8_t *>(salt.data()), salt.size(),
@@ -195,19 +208,18 @@ Status DeriveRecordProtocolKey(const HandshakeCipher &ciphersuite,
 Status ComputeClientHandshakeAuthenticator(
     const HandshakeCipher &ciphersuite, ByteContainerView authenticator_secret,
     CleansingVector<uint8_t> *authenticator) {
-  std::string input(kClientAuthenticatedText);
-  return Hmac(ciphersuite, authenticator_secret, input, authenticator);
+  return Hmac(ciphersuite, authenticator_secret, kClientAuthenticatedText,
+              authenticator);
 }
 
 Status ComputeServerHandshakeAuthenticator(
     const HandshakeCipher &ciphersuite, ByteContainerView authenticator_secret,
     CleansingVector<uint8_t> *authenticator) {
-  std::string input(kServerAuthenticatedText);
-  return Hmac(ciphersuite, authenticator_secret, input, authenticator);
+  return Hmac(ciphersuite, authenticator_secret, kServerAuthenticatedText,
+              authenticator);
 }
 
-bool CheckMacEquality(CleansingVector<uint8_t> mac1,
-                      CleansingVector<uint8_t> mac2) {
+bool CheckMacEquality(ByteContainerView mac1, ByteContainerView mac2) {
   if (mac1.size() != mac2.size()) {
     return false;
   }
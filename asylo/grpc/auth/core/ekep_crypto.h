@@ -93,8 +93,7 @@ Status ComputeServerHandshakeAuthenticator(
     CleansingVector<uint8_t> *authenticator);
 
 // Performs a constant-time equality comparison of |mac1| and |mac2|.
-bool CheckMacEquality(CleansingVector<uint8_t> mac1,
-                      CleansingVector<uint8_t> mac2);
+bool CheckMacEquality(ByteContainerView mac1, ByteContainerView mac2);
 
 }  // namespace asylo
 
@@ -321,9 +321,8 @@ Status ServerEkepHandshaker::HandleClientId(const google::protobuf::Message &mes
                   "Client did not provide all expected assertions");
   }
 
-  std::copy(client_id.dh_public_key().cbegin(),
-            client_id.dh_public_key().cend(),
-            std::back_inserter(client_public_key_));
+  client_public_key_.assign(client_id.dh_public_key().cbegin(),
+                            client_id.dh_public_key().cend());
 
   return WriteServerId(output);
 }
@@ -338,11 +337,6 @@ Status ServerEkepHandshaker::HandleClientFinish(
   }
   const ClientFinish &client_finish = *client_finish_ptr;
 
-  CleansingVector<uint8_t> actual_client_handshake_authenticator;
-  std::copy(client_finish.handshake_authenticator().cbegin(),
-            client_finish.handshake_authenticator().cend(),
-            std::back_inserter(actual_client_handshake_authenticator));
-
   // Compute the client handshake authenticator.
   CleansingVector<uint8_t> expected_client_handshake_authenticator;
   ASYLO_RETURN_IF_ERROR(ComputeClientHandshakeAuthenticator(
@@ -351,7 +345,7 @@ Status ServerEkepHandshaker::HandleClientFinish(
 
   // Validate the client's handshake authenticator value.
   if (!CheckMacEquality(expected_client_handshake_authenticator,
-                        actual_client_handshake_authenticator)) {
+                        client_finish.handshake_authenticator())) {
     return Status(Abort_ErrorCode_BAD_AUTHENTICATOR,
                   "Client handshake authenticator value is incorrect");
   }
@@ -18,15 +18,21 @@
 
 #include "asylo/identity/sgx/fake_enclave.h"
 
+#include <openssl/cipher.h>
 #include <openssl/cmac.h>
 #include <openssl/rand.h>
 
 #include <cstddef>
 #include <cstdlib>
 #include <iostream>
+#include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/crypto/util/bssl_util.h"
 #include "asylo/crypto/util/bytes.h"
 #include "asylo/crypto/util/trivial_object_util.h"
@@ -68,7 +74,64 @@ std::string FormatAttributeSet(const SecsAttributeSet &set) {
 
 FakeEnclave *FakeEnclave::current_ = nullptr;
 
-FakeEnclave::FakeEnclave() {
+class FakeEnclave::KeyCache {
+ public:
+  // Maximum number of cached keys. The cache is flushed when it fills up, which
+  // bounds its memory use in tests that derive keys from random inputs.
+  static constexpr size_t kMaxEntries = 4096;
+
+  // Returns the process-wide cache.
+  static KeyCache *GetInstance() {
+    static KeyCache *instance = new KeyCache();
+    return instance;
+  }
+
+  // Looks up the key derived from |dependencies| under |root_key|. Returns true
+  // and writes the key to |key| on a hit.
+  bool Lookup(const SafeBytes<SHA256_DIGEST_LENGTH> &root_key,
+              const KeyDependenciesBase &dependencies, HardwareKey *key) {
+    std::string cache_key = MakeCacheKey(root_key, dependencies);
+    absl::MutexLock lock(&mu_);
+    auto it = keys_.find(cache_key);
+    if (it == keys_.end()) {
+      return false;
+    }
+    *key = it->second;
+    return true;
+  }
+
+  // Records that |key| was derived from |dependencies| under |root_key|.
+  void Insert(const SafeBytes<SHA256_DIGEST_LENGTH> &root_key,
+              const KeyDependenciesBase &dependencies,
+              const HardwareKey &key) {
+    std::string cache_key = MakeCacheKey(root_key, dependencies);
+    absl::MutexLock lock(&mu_);
+    if (keys_.size() >= kMaxEntries) {
+      keys_.clear();
+    }
+    keys_.emplace(std::move(cache_key), key);
+  }
+
+ private:
+  KeyCache() = default;
+
+  static std::string MakeCacheKey(
+      const SafeBytes<SHA256_DIGEST_LENGTH> &root_key,
+      const KeyDependenciesBase &dependencies) {
+    return absl::StrCat(
+        absl::string_view(reinterpret_cast<const char *>(root_key.data()),
+                          root_key.size()),
+        absl::string_view(reinterpret_cast<const char *>(&dependencies),
+                          sizeof(dependencies)));
+  }
+
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::string, HardwareKey> keys_ GUARDED_BY(mu_);
+};
+
+constexpr size_t FakeEnclave::KeyCache::kMaxEntries;
+
+FakeEnclave::FakeEnclave() : key_derivation_cache_enabled_(true) {
   GetAllSecsAttributes(&valid_attributes_);
   remove_valid_attribute(SecsAttributeBit::KSS);
   GetMustBeSetSecsAttributes(&required_attributes_);
@@ -357,6 +420,74 @@ Status FakeEnclave::GetHardwareReport(const Targetinfo &tinfo,
     LOG(FATAL) << "Parameters are not correctly aligned";
   }
 
+  KeyDependencies key_dependencies;
+  PrepareReportKeyDependencies(tinfo, &key_dependencies);
+
+  PopulateReportBody(report);
+  report->reportdata = reportdata;
+
+  SafeBytes<kHardwareKeySize> report_key;
+  ASYLO_RETURN_IF_ERROR(DeriveKey(key_dependencies, &report_key));
+
+  // Compute the report MAC. SGX uses CMAC to MAC the contents of the report.
+  // The last two fields (KEYID and MAC) from the REPORT struct are not
+  // included in the MAC computation.
+  if (report->mac.size() != AES_BLOCK_SIZE) {
+    return Status(
+        SGX_ERROR_INVALID_PARAMETER,
+        "Size of the mac field in the REPORT structure is incorrect.");
+  }
+
+  if (AES_CMAC(report->mac.data(), report_key.data(), report_key.size(),
+               reinterpret_cast<uint8_t *>(report),
+               offsetof(Report, keyid)) != 1) {
+    // Clear-out any leftover state from the output.
+    report->mac.Cleanse();
+    return Status(SGX_ERROR_UNEXPECTED, BsslLastErrorString());
+  }
+  return Status::OkStatus();
+}
+
+Status FakeEnclave::GetHardwareReports(
+    const Targetinfo &tinfo, const std::vector<Reportdata> &reportdata,
+    std::vector<Report> *reports) const {
+  KeyDependencies key_dependencies;
+  PrepareReportKeyDependencies(tinfo, &key_dependencies);
+
+  SafeBytes<kHardwareKeySize> report_key;
+  ASYLO_RETURN_IF_ERROR(DeriveKey(key_dependencies, &report_key));
+
+  // Every report in the batch shares the same body and report key, so the body
+  // is populated once and the CMAC key schedule is set up once.
+  Report body;
+  PopulateReportBody(&body);
+
+  bssl::UniquePtr<CMAC_CTX> cmac(CMAC_CTX_new());
+  if (!cmac || CMAC_Init(cmac.get(), report_key.data(), report_key.size(),
+                         EVP_aes_128_cbc(), /*engine=*/nullptr) != 1) {
+    return Status(SGX_ERROR_UNEXPECTED, BsslLastErrorString());
+  }
+
+  reports->assign(reportdata.size(), body);
+  for (size_t i = 0; i < reportdata.size(); ++i) {
+    Report *report = &(*reports)[i];
+    report->reportdata = reportdata[i];
+
+    // The MAC covers every field preceding KEYID, as in GetHardwareReport.
+    size_t mac_size = report->mac.size();
+    if (CMAC_Reset(cmac.get()) != 1 ||
+        CMAC_Update(cmac.get(), reinterpret_cast<uint8_t *>(report),
+                    offsetof(Report, keyid)) != 1 ||
+        CMAC_Final(cmac.get(), report->mac.data(), &mac_size) != 1) {
+      reports->clear();
+      return Status(SGX_ERROR_UNEXPECTED, BsslLastErrorString());
+    }
+  }
+  return Status::OkStatus();
+}
+
+void FakeEnclave::PrepareReportKeyDependencies(
+    const Targetinfo &tinfo, KeyDependencies *key_dependencies) const {
   // Make sure that the reserved fields/bits in TARGETINFO
   // are set to zero. The Intel SDM is not clear on the hardware behavior
   // if these fields are not zero. Lacking sufficient information,
@@ -374,30 +505,10 @@ Status FakeEnclave::GetHardwareReport(const Targetinfo &tinfo,
     LOG(FATAL) << "Reserved fields/bits in input parameters are not zeroed.";
   }
 
-  report->cpusvn = cpusvn_;
-  report->miscselect = miscselect_;
-  report->reserved1.fill(0);
-  report->isvextprodid = isvextprodid_;
-  report->attributes = attributes_;
-  report->mrenclave = mrenclave_;
-  report->reserved2.fill(0);
-  report->mrsigner = mrsigner_;
-  report->reserved3.fill(0);
-  report->configid = configid_;
-  report->isvprodid = isvprodid_;
-  report->isvsvn = isvsvn_;
-  report->configsvn = configsvn_;
-  report->reserved4.fill(0);
-  report->isvfamilyid = isvfamilyid_;
-  report->reportdata = reportdata;
-  report->keyid = report_keyid_;
-
   // Prepare a KeyDependencies struct to generate the appropriate report key.
   // This code is pretty much directly taken from the EREPORT instruction
   // description in the Intel SDM.
-  KeyDependencies key_dependencies;
-  KeyDependenciesBase *dependencies = &key_dependencies.dependencies;
-
+  KeyDependenciesBase *dependencies = &key_dependencies->dependencies;
   dependencies->keyname = KeyrequestKeyname::REPORT_KEY;
   dependencies->isvfamilyid.fill(0);
   dependencies->isvextprodid.fill(0);
@@ -418,27 +529,25 @@ Status FakeEnclave::GetHardwareReport(const Targetinfo &tinfo,
   dependencies->keypolicy = 0;
   dependencies->configid = tinfo.configid;
   dependencies->configsvn = tinfo.configsvn;
+}
 
-  SafeBytes<kHardwareKeySize> report_key;
-  ASYLO_RETURN_IF_ERROR(DeriveKey(key_dependencies, &report_key));
-
-  // Compute the report MAC. SGX uses CMAC to MAC the contents of the report.
-  // The last two fields (KEYID and MAC) from the REPORT struct are not
-  // included in the MAC computation.
-  if (report->mac.size() != AES_BLOCK_SIZE) {
-    return Status(
-        SGX_ERROR_INVALID_PARAMETER,
-        "Size of the mac field in the REPORT structure is incorrect.");
-  }
-
-  if (AES_CMAC(report->mac.data(), report_key.data(), report_key.size(),
-               reinterpret_cast<uint8_t *>(report),
-               offsetof(Report, keyid)) != 1) {
-    // Clear-out any leftover state from the output.
-    report->mac.Cleanse();
-    return Status(SGX_ERROR_UNEXPECTED, BsslLastErrorString());
-  }
-  return Status::OkStatus();
+void FakeEnclave::PopulateReportBody(Report *report) const {
+  report->cpusvn = cpusvn_;
+  report->miscselect = miscselect_;
+  report->reserved1.fill(0);
+  report->isvextprodid = isvextprodid_;
+  report->attributes = attributes_;
+  report->mrenclave = mrenclave_;
+  report->reserved2.fill(0);
+  report->mrsigner = mrsigner_;
+  report->reserved3.fill(0);
+  report->configid = configid_;
+  report->isvprodid = isvprodid_;
+  report->isvsvn = isvsvn_;
+  report->configsvn = configsvn_;
+  report->reserved4.fill(0);
+  report->isvfamilyid = isvfamilyid_;
+  report->keyid = report_keyid_;
 }
 
 Status FakeEnclave::DeriveKey(const KeyDependencies &key_dependencies,
@@ -446,6 +555,12 @@ Status FakeEnclave::DeriveKey(const KeyDependencies &key_dependencies,
   static_assert(HardwareKey::size() == AES_BLOCK_SIZE,
                 "Mismatch between kHardwareKeySize and AES_BLOCK_SIZE");
 
+  KeyCache *cache =
+      key_derivation_cache_enabled_ ? KeyCache::GetInstance() : nullptr;
+  if (cache && cache->Lookup(root_key_, key_dependencies.dependencies, key)) {
+    return Status::OkStatus();
+  }
+
   if (AES_CMAC(key->data(), root_key_.data(), root_key_.size(),
                reinterpret_cast<const uint8_t *>(&key_dependencies),
                sizeof(key_dependencies)) != 1) {
@@ -453,6 +568,10 @@ Status FakeEnclave::DeriveKey(const KeyDependencies &key_dependencies,
     key->Cleanse();
     return Status(SGX_ERROR_UNEXPECTED, BsslLastErrorString());
   }
+
+  if (cache) {
+    cache->Insert(root_key_, key_dependencies.dependencies, *key);
+  }
   return Status::OkStatus();
 }
 
@@ -230,6 +230,26 @@ class FakeEnclave {
   Status GetHardwareReport(const Targetinfo &tinfo,
                            const Reportdata &reportdata, Report *report) const;
 
+  // Batched variant of GetHardwareReport. Generates one REPORT targeted at
+  // |tinfo| for each element of |reportdata| and writes them to |reports|, in
+  // order. The TARGETINFO is validated and the report key is derived only once
+  // for the whole batch, which makes this considerably faster than calling
+  // GetHardwareReport in a loop. The resulting reports are identical to those
+  // returned by GetHardwareReport. Since SGX has no batched counterpart to
+  // EREPORT, the alignment of the individual elements is not enforced.
+  Status GetHardwareReports(const Targetinfo &tinfo,
+                            const std::vector<Reportdata> &reportdata,
+                            std::vector<Report> *reports) const;
+
+  // Enables or disables the key-derivation cache. When enabled (the default),
+  // keys derived by GetHardwareKey and GetHardwareReport are memoized in a
+  // process-wide cache, so repeated requests with the same KEYREQUEST fields
+  // skip the AES-CMAC computation. The setting is carried over by copies of
+  // this object, including the copy made by EnterEnclave.
+  void set_key_derivation_cache_enabled(bool enabled) {
+    key_derivation_cache_enabled_ = enabled;
+  }
+
  private:
   // The Intel SDM (Software Developer's Manual) refers to a structure
   // called the Key Dependencies structure that the CPU uses for deriving
@@ -310,6 +330,21 @@ class FakeEnclave {
   Status DeriveKey(const KeyDependencies &key_dependencies,
                    HardwareKey *key) const;
 
+  // Validates |tinfo| and populates |key_dependencies| with the inputs for the
+  // key used to MAC reports targeted at |tinfo|.
+  void PrepareReportKeyDependencies(const Targetinfo &tinfo,
+                                    KeyDependencies *key_dependencies) const;
+
+  // Populates every field of |report| except REPORTDATA and MAC from this
+  // enclave's identity.
+  void PopulateReportBody(Report *report) const;
+
+  // Memoizes the results of DeriveKey. Since a derived key is a function of
+  // only the root key and the KeyDependencies, which capture every KEYREQUEST
+  // field and identity value that contributes to the key, the cache remains
+  // valid across identity changes and is shared by all FakeEnclave instances.
+  class KeyCache;
+
   // SGX-defined MRENCLAVE value of this fake enclave.
   UnsafeBytes<SHA256_DIGEST_LENGTH> mrenclave_;
 
@@ -367,6 +402,9 @@ class FakeEnclave {
   // valid enclave.
   SecsAttributeSet required_attributes_;
 
+  // Whether DeriveKey consults the process-wide KeyCache.
+  bool key_derivation_cache_enabled_;
+
   // Current fake enclave.
   static FakeEnclave *current_;
 };
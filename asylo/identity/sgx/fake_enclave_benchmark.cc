@@ -0,0 +1,124 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the throughput of the FakeEnclave hardware model. Reports the number
+// of keys and reports generated per second with and without the key-derivation
+// cache, and for batched report generation.
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/crypto/util/trivial_object_util.h"
+#include "asylo/identity/sgx/fake_enclave.h"
+#include "asylo/identity/sgx/hardware_interface.h"
+#include "asylo/identity/sgx/identity_key_management_structs.h"
+#include "gflags/gflags.h"
+#include "asylo/util/logging.h"
+
+DEFINE_int32(iterations, 100000, "Number of keys or reports to generate");
+DEFINE_int32(batch_size, 64, "Number of reports per GetHardwareReports call");
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+void PrintRate(const char *name, int64_t count, absl::Duration elapsed) {
+  std::cout << absl::StrFormat("%-32s %12.0f per second\n", name,
+                               count / absl::ToDoubleSeconds(elapsed));
+}
+
+void BenchmarkKeys(FakeEnclave *enclave, const char *name) {
+  AlignedKeyrequestPtr request;
+  *request = TrivialZeroObject<Keyrequest>();
+  request->keyname = KeyrequestKeyname::SEAL_KEY;
+  request->keypolicy = kKeypolicyMrenclaveBitMask | kKeypolicyMrsignerBitMask;
+  request->cpusvn = enclave->get_cpusvn();
+  request->isvsvn = enclave->get_isvsvn();
+
+  AlignedHardwareKeyPtr key;
+  absl::Time start = absl::Now();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    CHECK(enclave->GetHardwareKey(*request, key.get()).ok());
+  }
+  PrintRate(name, FLAGS_iterations, absl::Now() - start);
+}
+
+Targetinfo MakeTargetinfo(const FakeEnclave &target) {
+  Targetinfo tinfo = TrivialZeroObject<Targetinfo>();
+  tinfo.measurement = target.get_mrenclave();
+  tinfo.attributes = target.get_attributes();
+  tinfo.miscselect = target.get_miscselect();
+  return tinfo;
+}
+
+void BenchmarkReports(FakeEnclave *enclave, const char *name) {
+  AlignedTargetinfoPtr tinfo;
+  *tinfo = MakeTargetinfo(*enclave);
+  AlignedReportdataPtr reportdata;
+  *reportdata = TrivialRandomObject<Reportdata>();
+
+  AlignedReportPtr report;
+  absl::Time start = absl::Now();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    CHECK(enclave->GetHardwareReport(*tinfo, *reportdata, report.get()).ok());
+  }
+  PrintRate(name, FLAGS_iterations, absl::Now() - start);
+}
+
+void BenchmarkBatchedReports(FakeEnclave *enclave, const char *name) {
+  AlignedTargetinfoPtr tinfo;
+  *tinfo = MakeTargetinfo(*enclave);
+  std::vector<Reportdata> reportdata(FLAGS_batch_size);
+  for (Reportdata &data : reportdata) {
+    data = TrivialRandomObject<Reportdata>();
+  }
+
+  std::vector<Report> reports;
+  int64_t count = 0;
+  absl::Time start = absl::Now();
+  while (count < FLAGS_iterations) {
+    CHECK(enclave->GetHardwareReports(*tinfo, reportdata, &reports).ok());
+    count += reports.size();
+  }
+  PrintRate(name, count, absl::Now() - start);
+}
+
+}  // namespace
+}  // namespace sgx
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  asylo::sgx::FakeEnclave enclave;
+  enclave.SetRandomIdentity();
+
+  enclave.set_key_derivation_cache_enabled(false);
+  asylo::sgx::BenchmarkKeys(&enclave, "keys (uncached)");
+  asylo::sgx::BenchmarkReports(&enclave, "reports (uncached)");
+
+  enclave.set_key_derivation_cache_enabled(true);
+  asylo::sgx::BenchmarkKeys(&enclave, "keys (cached)");
+  asylo::sgx::BenchmarkReports(&enclave, "reports (cached)");
+  asylo::sgx::BenchmarkBatchedReports(&enclave, "reports (batched, cached)");
+  return 0;
+}
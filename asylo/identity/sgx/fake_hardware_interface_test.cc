@@ -709,6 +709,74 @@ TEST_F(FakeEnclaveTest, Report) {
   }
 }
 
+// Verify that the key-derivation cache does not change the derived keys, both
+// for fresh requests and for repeated ones.
+TEST_F(FakeEnclaveTest, KeyDerivationCacheMatchesUncachedDerivation) {
+  FakeEnclave uncached = enclave_;
+  uncached.set_key_derivation_cache_enabled(false);
+
+  for (int i = 0; i < 100; i++) {
+    AlignedKeyrequestPtr request;
+    *request = *seal_key_request_;
+    request->cpusvn = enclave_.get_cpusvn();
+    request->keypolicy = GenerateRandomKeypolicy(enclave_.get_attributes()) |
+                         kKeypolicyMrenclaveBitMask;
+    request->keyid = TrivialRandomObject<Keyid>();
+
+    AlignedHardwareKeyPtr expected_key;
+    ASYLO_ASSERT_OK(uncached.GetHardwareKey(*request, expected_key.get()));
+
+    for (int j = 0; j < 2; j++) {
+      AlignedHardwareKeyPtr key;
+      ASYLO_ASSERT_OK(enclave_.GetHardwareKey(*request, key.get()));
+      EXPECT_EQ(*key, *expected_key);
+    }
+
+    // Changing the identity must not return a stale cached key.
+    FakeEnclave other = enclave_;
+    other.set_mrenclave(TrivialRandomObject<Measurement>());
+    AlignedHardwareKeyPtr other_key;
+    ASYLO_ASSERT_OK(other.GetHardwareKey(*request, other_key.get()));
+    EXPECT_NE(*other_key, *expected_key);
+  }
+}
+
+// Verify that GetHardwareReports produces the same reports as individual
+// GetHardwareReport calls.
+TEST_F(FakeEnclaveTest, BatchedReportsMatchIndividualReports) {
+  constexpr int kBatchSize = 16;
+
+  FakeEnclave target = enclave_;
+  target.SetRandomIdentity();
+
+  AlignedTargetinfoPtr tinfo;
+  *tinfo = TrivialZeroObject<Targetinfo>();
+  tinfo->measurement = target.get_mrenclave();
+  tinfo->attributes = target.get_attributes();
+  tinfo->miscselect = target.get_miscselect();
+  tinfo->configid = target.get_configid();
+  tinfo->configsvn = target.get_configsvn();
+
+  std::vector<Reportdata> reportdata(kBatchSize);
+  for (Reportdata &data : reportdata) {
+    data = TrivialRandomObject<Reportdata>();
+  }
+
+  std::vector<Report> reports;
+  ASYLO_ASSERT_OK(enclave_.GetHardwareReports(*tinfo, reportdata, &reports));
+  ASSERT_EQ(reports.size(), kBatchSize);
+
+  for (int i = 0; i < kBatchSize; i++) {
+    AlignedReportdataPtr single_reportdata;
+    *single_reportdata = reportdata[i];
+    AlignedReportPtr report;
+    ASYLO_ASSERT_OK(
+        enclave_.GetHardwareReport(*tinfo, *single_reportdata, report.get()));
+    EXPECT_EQ(ConvertTrivialObjectToHexString(reports[i]),
+              ConvertTrivialObjectToHexString(*report));
+  }
+}
+
 }  // namespace
 }  // namespace sgx
 }  // namespace asylo
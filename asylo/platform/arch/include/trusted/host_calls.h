@@ -61,10 +61,13 @@ void *enc_untrusted_realloc(void *ptr, size_t size);
 // Releases memory on the untrusted heap.
 void enc_untrusted_free(void *ptr);
 
-// Allocates |count| buffers of size |size| on the untrusted heap, returning a
-// pointer to an array of buffer pointers.
-void **enc_untrusted_allocate_buffers(
-    size_t count, size_t size);
+// Maps a slab of |count| untrusted buffers of at least |size| bytes each,
+// returning the base of the slab and storing the distance between consecutive
+// buffers in |stride|. Buffer i starts at base + i * |stride|.
+void *enc_untrusted_allocate_slab(size_t count, size_t size, size_t *stride);
+
+// Unmaps a slab returned by enc_untrusted_allocate_slab.
+void enc_untrusted_deallocate_slab(void *base, size_t count, size_t stride);
 
 // Releases memory on the untrusted heap pointed to by buffer pointers stored in
 // |free_list|.
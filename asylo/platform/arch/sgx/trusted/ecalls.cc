@@ -29,6 +29,7 @@
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/arch/sgx/trusted/generated_bridge_t.h"
 #include "asylo/platform/common/bridge_types.h"
+#include "asylo/platform/common/cpu_time.h"
 #include "asylo/platform/core/entry_points.h"
 #include "asylo/platform/primitives/sgx/trusted_sgx.h"
 #include "asylo/util/posix_error_space.h"
@@ -113,7 +114,11 @@ int ecall_transfer_secure_snapshot_key(const char *input,
 }
 
 // Invokes the trusted entry point designated by |selector|. Returns a
-// non-zero error code on failure.
+// non-zero error code on failure. The time the calling thread spends in the
+// enclave is charged to its CPU-time clocks. Signal handling and snapshot
+// entries are not charged, since the first charge allocates memory, which is
+// not safe in those contexts.
 int ecall_dispatch_trusted_call(uint64_t selector, void *buffer) {
+  asylo::ScopedTrustedExecution trusted_execution;
   return asylo::primitives::asylo_enclave_call(selector, buffer);
 }
@@ -49,6 +49,7 @@
 #include "asylo/platform/common/bridge_functions.h"
 #include "asylo/platform/common/bridge_proto_serializer.h"
 #include "asylo/platform/common/bridge_types.h"
+#include "asylo/platform/common/enclave_exits.h"
 #include "asylo/platform/common/memory.h"
 #include "asylo/platform/primitives/sgx/sgx_error_space.h"
 #include "asylo/platform/primitives/util/trusted_memory.h"
@@ -60,7 +61,11 @@ namespace {
 
 #define CHECK_OCALL(status_)                                                 \
   do {                                                                       \
-    sgx_status_t status##__COUNTER__ = status_;                              \
+    sgx_status_t status##__COUNTER__;                                        \
+    {                                                                        \
+      asylo::ScopedEnclaveExit enclave_exit;                                 \
+      status##__COUNTER__ = status_;                                         \
+    }                                                                        \
     if (status##__COUNTER__ != SGX_SUCCESS) {                                \
       enc_untrusted_puts(                                                    \
           absl::StrCat(                                                      \
@@ -98,16 +103,26 @@ void *enc_untrusted_malloc(size_t size) {
   return result;
 }
 
-void **enc_untrusted_allocate_buffers(size_t count, size_t size) {
-  void **buffers;
-  CHECK_OCALL(ocall_enc_untrusted_allocate_buffers(
-      &buffers,
-      static_cast<bridge_size_t>(count),
-      static_cast<bridge_size_t>(size)));
-  if (!buffers || !sgx_is_outside_enclave(buffers, size)) {
+void *enc_untrusted_allocate_slab(size_t count, size_t size, size_t *stride) {
+  void *slab;
+  bridge_size_t slab_stride = 0;
+  CHECK_OCALL(ocall_enc_untrusted_allocate_slab(
+      &slab, static_cast<bridge_size_t>(count),
+      static_cast<bridge_size_t>(size), &slab_stride));
+  // The host chooses the stride, so check that the buffers do not overlap and
+  // that their total size does not overflow before trusting the layout.
+  if (!slab || slab_stride < size ||
+      (slab_stride != 0 && count > SIZE_MAX / slab_stride)) {
     abort();
   }
-  return buffers;
+  *stride = static_cast<size_t>(slab_stride);
+  return slab;
+}
+
+void enc_untrusted_deallocate_slab(void *base, size_t count, size_t stride) {
+  CHECK_OCALL(ocall_enc_untrusted_deallocate_slab(
+      base, static_cast<bridge_size_t>(count),
+      static_cast<bridge_size_t>(stride)));
 }
 
 void enc_untrusted_deallocate_free_list(void **free_list, size_t count) {
@@ -397,7 +412,7 @@ int enc_untrusted_getaddrinfo(const char *node, const char *service,
   char tmp_serialized_res[tmp_serialized_res_len];
   memcpy(tmp_serialized_res, tmp_serialized_res_start,
          static_cast<size_t>(tmp_serialized_res_len));
-  enc_untrusted_free(tmp_serialized_res_start);
+  untrusted_cache_free(tmp_serialized_res_start);
 
   std::string serialized_res(tmp_serialized_res,
                              static_cast<size_t>(tmp_serialized_res_len));
@@ -1030,9 +1045,13 @@ void enc_untrusted__exit(int rc) { ocall_enc_untrusted__exit(rc); }
 pid_t enc_untrusted_fork(const char *enclave_name, const char *config,
                          size_t config_len, bool restore_snapshot) {
   pid_t ret;
-  sgx_status_t status = ocall_enc_untrusted_fork(
-      &ret, enclave_name, config, static_cast<bridge_size_t>(config_len),
-      restore_snapshot);
+  sgx_status_t status;
+  {
+    asylo::ScopedEnclaveExit enclave_exit;
+    status = ocall_enc_untrusted_fork(&ret, enclave_name, config,
+                                      static_cast<bridge_size_t>(config_len),
+                                      restore_snapshot);
+  }
   if (status != SGX_SUCCESS) {
     errno = EINTR;
     return -1;
@@ -62,6 +62,7 @@
 #include "asylo/platform/common/bridge_types.h"
 #include "asylo/platform/common/debug_strings.h"
 #include "asylo/platform/common/memory.h"
+#include "asylo/platform/common/untrusted_slab.h"
 #include "asylo/platform/core/enclave_manager.h"
 #include "asylo/platform/core/shared_name.h"
 #include "asylo/platform/storage/utils/fd_closer.h"
@@ -183,14 +184,21 @@ void *ocall_enc_untrusted_malloc(bridge_size_t size) {
   return ret;
 }
 
-void **ocall_enc_untrusted_allocate_buffers(bridge_size_t count,
-                                            bridge_size_t size) {
-  void **buffers = reinterpret_cast<void **>(
-      malloc(static_cast<size_t>(count) * sizeof(void*)));
-  for (int i = 0; i < count; i++) {
-    buffers[i] = malloc(size);
-  }
-  return buffers;
+void *ocall_enc_untrusted_allocate_slab(bridge_size_t count,
+                                        bridge_size_t size,
+                                        bridge_size_t *stride) {
+  size_t slab_stride = 0;
+  void *slab = asylo::AllocateUntrustedSlab(static_cast<size_t>(count),
+                                            static_cast<size_t>(size),
+                                            &slab_stride);
+  *stride = static_cast<bridge_size_t>(slab_stride);
+  return slab;
+}
+
+void ocall_enc_untrusted_deallocate_slab(void *base, bridge_size_t count,
+                                         bridge_size_t stride) {
+  asylo::DeallocateUntrustedSlab(base, static_cast<size_t>(count),
+                                 static_cast<size_t>(stride));
 }
 
 void ocall_enc_untrusted_deallocate_free_list(void **free_list,
@@ -279,13 +279,19 @@ Status SgxClient::EnterAndInitialize(const EnclaveConfig &config) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "Failed to serialize EnclaveConfig");
   }
+  return EnterAndInitializeSerialized(config, buf);
+}
 
+Status SgxClient::EnterAndInitializeSerialized(
+    const EnclaveConfig &config, const std::string &serialized_config) {
   char *output = nullptr;
   size_t output_len = 0;
   std::string enclave_name = get_name();
-  ASYLO_RETURN_IF_ERROR(
-      Initialize(enclave_name.c_str(), enclave_name.size() + 1, buf.data(),
-                 buf.size(), &output, &output_len));
+  ASYLO_RETURN_IF_ERROR(Initialize(enclave_name.c_str(),
+                                   enclave_name.size() + 1,
+                                   serialized_config.data(),
+                                   serialized_config.size(), &output,
+                                   &output_len));
 
   // Enclave entry-point was successfully invoked. |output| is guaranteed to
   // have a value.
@@ -71,6 +71,9 @@ class SgxClient : public EnclaveClient {
   friend class SgxEmbeddedLoader;
 
   Status EnterAndInitialize(const EnclaveConfig &config) override;
+  Status EnterAndInitializeSerialized(
+      const EnclaveConfig &config,
+      const std::string &serialized_config) override;
   Status EnterAndFinalize(const EnclaveFinal &final_input) override;
   Status EnterAndDonateThread() override;
   Status EnterAndHandleSignal(const EnclaveSignal &signal) override;
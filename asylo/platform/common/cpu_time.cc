@@ -0,0 +1,198 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/cpu_time.h"
+
+#include <time.h>
+#include <atomic>
+
+#include "absl/base/attributes.h"
+#include "asylo/platform/common/time_util.h"
+
+namespace asylo {
+namespace {
+
+// Value of Account::running_since while accounting is suspended.
+constexpr int64_t kSuspended = -1;
+
+// The time charged to one thread. Only the owning thread updates it, but any
+// thread may read it, so updates are published with a sequence lock.
+struct Account {
+  // Odd while an update is in progress.
+  std::atomic<uint32_t> sequence{0};
+
+  // Time charged up to the last suspension.
+  std::atomic<int64_t> total{0};
+
+  // Time of the last resumption, or kSuspended.
+  std::atomic<int64_t> running_since{kSuspended};
+
+  // Next account in the list of all accounts. Accounts are never freed.
+  Account *next = nullptr;
+};
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+std::atomic<CpuTimeClock> clock_source{&MonotonicClock};
+std::atomic<Account *> accounts{nullptr};
+
+ABSL_CONST_INIT thread_local Account *thread_account = nullptr;
+
+// True while the calling thread reads the clock or creates its account. Doing
+// so may leave the enclave the first time, and the exit must not be accounted
+// while accounting is being updated.
+ABSL_CONST_INIT thread_local bool busy = false;
+
+// Returns the time on the accounting clock.
+int64_t Now() {
+  bool was_busy = busy;
+  busy = true;
+  int64_t now = clock_source.load(std::memory_order_relaxed)();
+  busy = was_busy;
+  return now;
+}
+
+Account *GetThreadAccount() {
+  if (!thread_account) {
+    Account *account = new Account;
+    Account *head = accounts.load(std::memory_order_relaxed);
+    do {
+      account->next = head;
+    } while (!accounts.compare_exchange_weak(head, account,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+    thread_account = account;
+  }
+  return thread_account;
+}
+
+// Starts an update of |account| and returns the sequence number to pass to
+// EndUpdate(). Must only be called by the owning thread.
+//
+// The update is started before the owning thread reads the clock for it.
+// Readers retry while the update is in progress, so a reader never counts the
+// thread as running past the time at which it was suspended: either the reader
+// saw the account before the update started, and so read its own clock
+// earlier, or it waits for the update.
+uint32_t BeginUpdate(Account *account) {
+  uint32_t sequence = account->sequence.load(std::memory_order_relaxed);
+  account->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return sequence;
+}
+
+// Stores |total| and |running_since| into |account| and ends the update
+// started by BeginUpdate().
+void EndUpdate(Account *account, uint32_t sequence, int64_t total,
+               int64_t running_since) {
+  account->total.store(total, std::memory_order_relaxed);
+  account->running_since.store(running_since, std::memory_order_relaxed);
+  account->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Returns the time charged to |account| as of |now|. If |account| is owned by
+// another thread, |now| must be read from the clock before a ReaderFence().
+int64_t Read(const Account *account, int64_t now) {
+  int64_t total;
+  int64_t running_since;
+  uint32_t sequence;
+  do {
+    sequence = account->sequence.load(std::memory_order_acquire);
+    total = account->total.load(std::memory_order_relaxed);
+    running_since = account->running_since.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) != 0 ||
+           sequence != account->sequence.load(std::memory_order_relaxed));
+  if (running_since != kSuspended && now > running_since) {
+    total += now - running_since;
+  }
+  return total;
+}
+
+// Orders a clock reading before the accounts read after it. Pairs with the
+// fence in BeginUpdate().
+void ReaderFence() { std::atomic_thread_fence(std::memory_order_seq_cst); }
+
+}  // namespace
+
+bool ResumeCpuTimeAccounting() {
+  if (busy) {
+    return false;
+  }
+  busy = true;
+  Account *account = GetThreadAccount();
+  bool resumed = false;
+  if (account->running_since.load(std::memory_order_relaxed) == kSuspended) {
+    uint32_t sequence = BeginUpdate(account);
+    int64_t now = Now();
+    EndUpdate(account, sequence,
+              account->total.load(std::memory_order_relaxed), now);
+    resumed = true;
+  }
+  busy = false;
+  return resumed;
+}
+
+bool SuspendCpuTimeAccounting() {
+  if (busy || !thread_account) {
+    return false;
+  }
+  int64_t running_since =
+      thread_account->running_since.load(std::memory_order_relaxed);
+  if (running_since == kSuspended) {
+    return false;
+  }
+  busy = true;
+  uint32_t sequence = BeginUpdate(thread_account);
+  int64_t now = Now();
+  int64_t total = thread_account->total.load(std::memory_order_relaxed);
+  if (now > running_since) {
+    total += now - running_since;
+  }
+  EndUpdate(thread_account, sequence, total, kSuspended);
+  busy = false;
+  return true;
+}
+
+int64_t ThreadCpuTimeNanoseconds() {
+  if (!thread_account) {
+    return 0;
+  }
+  return Read(thread_account, Now());
+}
+
+int64_t ProcessCpuTimeNanoseconds() {
+  int64_t now = Now();
+  ReaderFence();
+  int64_t total = 0;
+  for (const Account *account = accounts.load(std::memory_order_acquire);
+       account; account = account->next) {
+    total += Read(account, now);
+  }
+  return total;
+}
+
+CpuTimeClock SetCpuTimeClock(CpuTimeClock clock) {
+  return clock_source.exchange(clock);
+}
+
+}  // namespace asylo
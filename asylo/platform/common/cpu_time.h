@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_CPU_TIME_H_
+#define ASYLO_PLATFORM_COMMON_CPU_TIME_H_
+
+#include <cstdint>
+
+// Accounting of the CPU time that threads spend running trusted code.
+//
+// The enclave runtime resumes accounting for a thread whenever it starts
+// running trusted code, on enclave entry and on return from an exit, and
+// suspends it whenever it stops, on enclave exit and at the start of an exit.
+// The time in between is charged to the thread. Time a thread spends outside
+// the enclave, including time blocked in the host, is not charged. This serves
+// CLOCK_THREAD_CPUTIME_ID and CLOCK_PROCESS_CPUTIME_ID without leaving the
+// enclave.
+
+namespace asylo {
+
+// Starts charging time to the calling thread. Returns false, and does nothing,
+// if accounting is already running for the thread.
+bool ResumeCpuTimeAccounting();
+
+// Stops charging time to the calling thread. Returns false, and does nothing,
+// if accounting is already suspended for the thread.
+bool SuspendCpuTimeAccounting();
+
+// Returns the time, in nanoseconds, charged to the calling thread.
+int64_t ThreadCpuTimeNanoseconds();
+
+// Returns the time, in nanoseconds, charged to all threads, including the time
+// of threads that are currently running.
+int64_t ProcessCpuTimeNanoseconds();
+
+// Sets the clock, returning nanoseconds on a monotonic timeline, that time is
+// measured with and returns the previous one. The default clock is
+// CLOCK_MONOTONIC. Meant for tests, which may go back in time by changing the
+// clock.
+using CpuTimeClock = int64_t (*)();
+CpuTimeClock SetCpuTimeClock(CpuTimeClock clock);
+
+// Charges the time the calling thread spends in the scope of an instance.
+class ScopedTrustedExecution {
+ public:
+  ScopedTrustedExecution() : resumed_(ResumeCpuTimeAccounting()) {}
+  ~ScopedTrustedExecution() {
+    if (resumed_) {
+      SuspendCpuTimeAccounting();
+    }
+  }
+
+  ScopedTrustedExecution(const ScopedTrustedExecution &other) = delete;
+  ScopedTrustedExecution &operator=(const ScopedTrustedExecution &other) =
+      delete;
+
+ private:
+  const bool resumed_;
+};
+
+// Does not charge the time the calling thread spends in the scope of an
+// instance.
+class ScopedUntrustedExecution {
+ public:
+  ScopedUntrustedExecution() : suspended_(SuspendCpuTimeAccounting()) {}
+  ~ScopedUntrustedExecution() {
+    if (suspended_) {
+      ResumeCpuTimeAccounting();
+    }
+  }
+
+  ScopedUntrustedExecution(const ScopedUntrustedExecution &other) = delete;
+  ScopedUntrustedExecution &operator=(const ScopedUntrustedExecution &other) =
+      delete;
+
+ private:
+  const bool suspended_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_CPU_TIME_H_
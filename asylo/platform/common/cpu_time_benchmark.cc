@@ -0,0 +1,105 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Reports the per-call latency of reading the in-enclave CPU clocks and of
+// accounting one enclave transition, next to the latency of the host calls
+// that served the same clocks before, which an enclave pays on top of the cost
+// of an exit.
+
+#include <sys/resource.h>
+#include <sys/times.h>
+#include <time.h>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/platform/common/cpu_time.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(iterations, 1000000, "Number of calls to measure");
+DEFINE_int32(threads, 16,
+             "Number of threads with an account, which ProcessCpuTime sums");
+
+namespace asylo {
+namespace {
+
+volatile int64_t sink;
+
+template <typename Function>
+void Measure(const char *name, Function function) {
+  absl::Time start = absl::Now();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    function();
+  }
+  absl::Duration elapsed = absl::Now() - start;
+  std::cout << absl::StrFormat(
+      "%-40s %10.1f ns per call\n", name,
+      absl::ToDoubleNanoseconds(elapsed) / FLAGS_iterations);
+}
+
+void Run() {
+  std::vector<std::thread> threads;
+  for (int i = 1; i < FLAGS_threads; ++i) {
+    threads.emplace_back([] {
+      ResumeCpuTimeAccounting();
+      SuspendCpuTimeAccounting();
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  ResumeCpuTimeAccounting();
+  Measure("ThreadCpuTimeNanoseconds",
+          [] { sink = ThreadCpuTimeNanoseconds(); });
+  Measure("ProcessCpuTimeNanoseconds",
+          [] { sink = ProcessCpuTimeNanoseconds(); });
+  Measure("suspend and resume accounting", [] {
+    SuspendCpuTimeAccounting();
+    ResumeCpuTimeAccounting();
+  });
+  SuspendCpuTimeAccounting();
+
+  Measure("host clock_gettime(THREAD_CPUTIME)", [] {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    sink = ts.tv_nsec;
+  });
+  Measure("host getrusage(RUSAGE_SELF)", [] {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    sink = usage.ru_utime.tv_usec;
+  });
+  Measure("host times", [] {
+    struct tms buf;
+    sink = times(&buf);
+  });
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Run();
+  return 0;
+}
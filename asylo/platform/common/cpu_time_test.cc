@@ -0,0 +1,250 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/cpu_time.h"
+
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/common/time_util.h"
+
+namespace asylo {
+namespace {
+
+std::atomic<int64_t> fake_now{1000};
+
+constexpr int64_t kBusyNanoseconds = 20000000;
+
+int64_t FakeClock() { return fake_now.load(); }
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+// Accounts are kept per thread for the lifetime of the process, so each test
+// runs its accounting on fresh threads.
+class CpuTimeTest : public ::testing::Test {
+ protected:
+  void SetUp() override { previous_clock_ = SetCpuTimeClock(&FakeClock); }
+  void TearDown() override { SetCpuTimeClock(previous_clock_); }
+
+  CpuTimeClock previous_clock_;
+};
+
+TEST_F(CpuTimeTest, ChargesOnlyTimeWhileRunning) {
+  std::thread([] {
+    EXPECT_EQ(ThreadCpuTimeNanoseconds(), 0);
+    fake_now += 100;
+    EXPECT_TRUE(ResumeCpuTimeAccounting());
+    fake_now += 50;
+    EXPECT_EQ(ThreadCpuTimeNanoseconds(), 50);
+    EXPECT_TRUE(SuspendCpuTimeAccounting());
+    fake_now += 1000;
+    EXPECT_EQ(ThreadCpuTimeNanoseconds(), 50);
+    EXPECT_TRUE(ResumeCpuTimeAccounting());
+    fake_now += 25;
+    EXPECT_TRUE(SuspendCpuTimeAccounting());
+    EXPECT_EQ(ThreadCpuTimeNanoseconds(), 75);
+  }).join();
+}
+
+TEST_F(CpuTimeTest, RepeatedTransitionsAreIgnored) {
+  std::thread([] {
+    EXPECT_FALSE(SuspendCpuTimeAccounting());
+    EXPECT_TRUE(ResumeCpuTimeAccounting());
+    fake_now += 10;
+    EXPECT_FALSE(ResumeCpuTimeAccounting());
+    fake_now += 10;
+    EXPECT_TRUE(SuspendCpuTimeAccounting());
+    EXPECT_FALSE(SuspendCpuTimeAccounting());
+    EXPECT_EQ(ThreadCpuTimeNanoseconds(), 20);
+  }).join();
+}
+
+// An exit that enters the enclave again, for instance to handle a signal,
+// charges only the time spent in trusted code.
+TEST_F(CpuTimeTest, NestedEntryDuringExit) {
+  std::thread([] {
+    ScopedTrustedExecution outer_entry;
+    fake_now += 10;
+    {
+      ScopedUntrustedExecution exit;
+      fake_now += 100;
+      {
+        ScopedTrustedExecution nested_entry;
+        fake_now += 5;
+      }
+      fake_now += 100;
+    }
+    fake_now += 10;
+    EXPECT_EQ(ThreadCpuTimeNanoseconds(), 25);
+  }).join();
+}
+
+// An exit made while accounting is suspended does not start accounting when it
+// returns.
+TEST_F(CpuTimeTest, ExitWhileSuspended) {
+  std::thread([] {
+    { ScopedUntrustedExecution exit; }
+    fake_now += 100;
+    EXPECT_EQ(ThreadCpuTimeNanoseconds(), 0);
+  }).join();
+}
+
+TEST_F(CpuTimeTest, ThreadsAreChargedSeparately) {
+  std::atomic<int> step{0};
+  auto wait_for = [&step](int value) {
+    while (step.load() != value) {
+      std::this_thread::yield();
+    }
+  };
+  int64_t first_time = 0;
+  int64_t second_time = 0;
+  int64_t process_start = ProcessCpuTimeNanoseconds();
+
+  std::thread first([&] {
+    ResumeCpuTimeAccounting();
+    step = 1;
+    wait_for(2);
+    SuspendCpuTimeAccounting();
+    first_time = ThreadCpuTimeNanoseconds();
+    step = 3;
+  });
+  std::thread second([&] {
+    wait_for(1);
+    fake_now += 30;
+    ResumeCpuTimeAccounting();
+    fake_now += 70;
+    // Both threads are running, and the process is charged for both.
+    EXPECT_EQ(ProcessCpuTimeNanoseconds() - process_start, 170);
+    step = 2;
+    wait_for(3);
+    fake_now += 5;
+    SuspendCpuTimeAccounting();
+    second_time = ThreadCpuTimeNanoseconds();
+  });
+  first.join();
+  second.join();
+
+  EXPECT_EQ(first_time, 100);
+  EXPECT_EQ(second_time, 75);
+  EXPECT_EQ(ProcessCpuTimeNanoseconds() - process_start, 175);
+}
+
+// Set on a thread whose next clock reading stalls until a reader has started
+// to read the process time, letting the reader see the thread mid-suspension.
+thread_local bool stall_clock = false;
+std::atomic<bool> clock_stalled{false};
+std::atomic<bool> reader_started{false};
+
+int64_t StallingClock() {
+  int64_t now = fake_now.load();
+  if (stall_clock) {
+    stall_clock = false;
+    clock_stalled = true;
+    while (!reader_started.load()) {
+      std::this_thread::yield();
+    }
+    // Give the reader time to read the account.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  return now;
+}
+
+// A reader that reads the clock after a thread has started to suspend its
+// accounting must not charge the thread past its suspension, or a later read
+// would go back in time.
+TEST_F(CpuTimeTest, ReadDuringSuspensionDoesNotOvercount) {
+  clock_stalled = false;
+  reader_started = false;
+  SetCpuTimeClock(&StallingClock);
+  int64_t process_start = ProcessCpuTimeNanoseconds();
+  std::thread suspending([] {
+    ResumeCpuTimeAccounting();
+    fake_now += 100;
+    stall_clock = true;
+    SuspendCpuTimeAccounting();
+  });
+  while (!clock_stalled.load()) {
+    std::this_thread::yield();
+  }
+  fake_now += 50;
+  reader_started = true;
+  int64_t during = ProcessCpuTimeNanoseconds() - process_start;
+  suspending.join();
+  int64_t after = ProcessCpuTimeNanoseconds() - process_start;
+
+  EXPECT_EQ(after, 100);
+  EXPECT_LE(during, after);
+}
+
+TEST(CpuTimeAccuracyTest, MatchesBusyLoopOnMonotonicClock) {
+  std::thread([] {
+    int64_t before = MonotonicClock();
+    ResumeCpuTimeAccounting();
+    int64_t start = MonotonicClock();
+    while (MonotonicClock() - start < kBusyNanoseconds) {
+    }
+    SuspendCpuTimeAccounting();
+    int64_t end = MonotonicClock();
+
+    // Time blocked outside of trusted code is not charged.
+    struct timespec sleep_time = {0, kBusyNanoseconds};
+    nanosleep(&sleep_time, nullptr);
+
+    int64_t charged = ThreadCpuTimeNanoseconds();
+    EXPECT_GE(charged, kBusyNanoseconds);
+    EXPECT_LE(charged, end - before);
+  }).join();
+}
+
+TEST(CpuTimeAccuracyTest, ProcessTimeIsMonotonic) {
+  constexpr int kThreads = 4;
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&done] {
+      while (!done.load()) {
+        ScopedTrustedExecution entry;
+        ScopedUntrustedExecution exit;
+      }
+    });
+  }
+
+  int64_t start = MonotonicClock();
+  int64_t last = ProcessCpuTimeNanoseconds();
+  while (MonotonicClock() - start < 100000000) {
+    int64_t current = ProcessCpuTimeNanoseconds();
+    ASSERT_GE(current, last);
+    last = current;
+  }
+  done = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+}  // namespace asylo
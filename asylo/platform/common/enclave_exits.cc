@@ -0,0 +1,39 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/common/enclave_exits.h"
+
+#include <atomic>
+
+namespace asylo {
+namespace {
+
+std::atomic<int64_t> exit_count{0};
+
+}  // namespace
+
+int64_t EnclaveExitCount() {
+  return exit_count.load(std::memory_order_relaxed);
+}
+
+ScopedEnclaveExit::ScopedEnclaveExit() {
+  exit_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace asylo
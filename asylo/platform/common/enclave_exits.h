@@ -0,0 +1,54 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_COMMON_ENCLAVE_EXITS_H_
+#define ASYLO_PLATFORM_COMMON_ENCLAVE_EXITS_H_
+
+#include <cstdint>
+
+#include "asylo/platform/common/cpu_time.h"
+
+// Counting of the exits an enclave makes to the host.
+//
+// The count is kept by the trusted runtime, which every enclave links in, so
+// each enclave counts its own exits, made by any of its threads.
+
+namespace asylo {
+
+// Returns the number of exits the enclave has made.
+int64_t EnclaveExitCount();
+
+// Marks the scope of an exit to the host. Counts the exit and does not charge
+// the time the calling thread spends in the scope to its CPU-time clocks.
+// Every path by which trusted code calls the host, including the generated
+// host calls, opens one around the transition.
+class ScopedEnclaveExit {
+ public:
+  ScopedEnclaveExit();
+
+  ScopedEnclaveExit(const ScopedEnclaveExit &other) = delete;
+  ScopedEnclaveExit &operator=(const ScopedEnclaveExit &other) = delete;
+
+ private:
+  ScopedUntrustedExecution untrusted_execution_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_ENCLAVE_EXITS_H_
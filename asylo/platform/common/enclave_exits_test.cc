@@ -0,0 +1,54 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/common/enclave_exits.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+#include "asylo/platform/common/cpu_time.h"
+
+namespace asylo {
+namespace {
+
+TEST(EnclaveExitsTest, CountsExitsOfAllThreads) {
+  int64_t before = EnclaveExitCount();
+  std::thread([] {
+    ScopedTrustedExecution entry;
+    { ScopedEnclaveExit exit; }
+    { ScopedEnclaveExit exit; }
+  }).join();
+  { ScopedEnclaveExit exit; }
+  EXPECT_EQ(EnclaveExitCount() - before, 3);
+}
+
+// Time spent in an exit is not charged to the thread.
+TEST(EnclaveExitsTest, ExitSuspendsCpuTimeAccounting) {
+  std::thread([] {
+    ScopedTrustedExecution entry;
+    {
+      ScopedEnclaveExit exit;
+      EXPECT_FALSE(SuspendCpuTimeAccounting());
+    }
+    EXPECT_TRUE(SuspendCpuTimeAccounting());
+  }).join();
+}
+
+}  // namespace
+}  // namespace asylo
@@ -42,6 +42,14 @@ void sys_futex_wait(int32_t *futex, int32_t expected) {
   sys_futex(futex, FUTEX_WAIT, expected, nullptr, nullptr, 0);
 }
 
+void sys_futex_timed_wait(int32_t *futex, int32_t expected,
+                          int64_t timeout_ns) {
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ns / 1000000000;
+  timeout.tv_nsec = timeout_ns % 1000000000;
+  sys_futex(futex, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
 void sys_futex_wake(int32_t *futex) {
   sys_futex(futex, FUTEX_WAKE, 0, nullptr, nullptr, 0);
 }
@@ -28,6 +28,10 @@ extern "C" {
 // `futex_wake`. Otherwise returns immediately.
 void sys_futex_wait(int32_t *futex, int32_t expected);
 
+// Like `sys_futex_wait`, but returns after at most `timeout_ns` nanoseconds.
+void sys_futex_timed_wait(int32_t *futex, int32_t expected,
+                          int64_t timeout_ns);
+
 // Wakes at most one of the threads waiting on `futex`.
 void sys_futex_wake(int32_t *futex);
 
@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/host_info_util.h"
+
+#include "asylo/platform/common/bridge_functions.h"
+
+namespace asylo {
+
+void UtsNameToHostInfo(const struct utsname &utsname, HostInfo *info) {
+  HostInfo::UtsName *proto = info->mutable_utsname();
+  proto->set_sysname(utsname.sysname);
+  proto->set_nodename(utsname.nodename);
+  proto->set_release(utsname.release);
+  proto->set_version(utsname.version);
+  proto->set_machine(utsname.machine);
+  proto->set_domainname(utsname.domainname);
+}
+
+bool HostInfoToUtsName(const HostInfo &info, struct utsname *utsname) {
+  if (!info.has_utsname()) {
+    return false;
+  }
+  const HostInfo::UtsName &proto = info.utsname();
+  return CStringCopy(proto.sysname().c_str(), utsname->sysname,
+                     sizeof(utsname->sysname)) &&
+         CStringCopy(proto.nodename().c_str(), utsname->nodename,
+                     sizeof(utsname->nodename)) &&
+         CStringCopy(proto.release().c_str(), utsname->release,
+                     sizeof(utsname->release)) &&
+         CStringCopy(proto.version().c_str(), utsname->version,
+                     sizeof(utsname->version)) &&
+         CStringCopy(proto.machine().c_str(), utsname->machine,
+                     sizeof(utsname->machine)) &&
+         CStringCopy(proto.domainname().c_str(), utsname->domainname,
+                     sizeof(utsname->domainname));
+}
+
+void PasswdToHostInfo(const struct passwd &passwd, HostInfo *info) {
+  HostInfo::Passwd *proto = info->mutable_passwd();
+  proto->set_name(passwd.pw_name ? passwd.pw_name : "");
+  proto->set_passwd(passwd.pw_passwd ? passwd.pw_passwd : "");
+  proto->set_uid(passwd.pw_uid);
+  proto->set_gid(passwd.pw_gid);
+  proto->set_gecos(passwd.pw_gecos ? passwd.pw_gecos : "");
+  proto->set_dir(passwd.pw_dir ? passwd.pw_dir : "");
+  proto->set_shell(passwd.pw_shell ? passwd.pw_shell : "");
+}
+
+bool HostInfoToPasswd(const HostInfo &info, struct passwd *passwd) {
+  if (!info.has_passwd()) {
+    return false;
+  }
+  // struct passwd has non-const strings, but callers must not modify them.
+  const HostInfo::Passwd &proto = info.passwd();
+  passwd->pw_name = const_cast<char *>(proto.name().c_str());
+  passwd->pw_passwd = const_cast<char *>(proto.passwd().c_str());
+  passwd->pw_uid = proto.uid();
+  passwd->pw_gid = proto.gid();
+  passwd->pw_gecos = const_cast<char *>(proto.gecos().c_str());
+  passwd->pw_dir = const_cast<char *>(proto.dir().c_str());
+  passwd->pw_shell = const_cast<char *>(proto.shell().c_str());
+  return true;
+}
+
+void CpuSetToHostInfo(const cpu_set_t &cpuset, HostInfo *info) {
+  // The enclave's CPU_ISSET does not accept a const set.
+  cpu_set_t copy = cpuset;
+  info->clear_cpu_affinity();
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &copy)) {
+      info->add_cpu_affinity(cpu);
+    }
+  }
+}
+
+bool HostInfoToCpuSet(const HostInfo &info, cpu_set_t *cpuset) {
+  if (info.cpu_affinity_size() == 0) {
+    return false;
+  }
+  CPU_ZERO(cpuset);
+  for (int cpu : info.cpu_affinity()) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, cpuset);
+  }
+  return true;
+}
+
+}  // namespace asylo
@@ -0,0 +1,57 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_HOST_INFO_UTIL_H_
+#define ASYLO_PLATFORM_COMMON_HOST_INFO_UTIL_H_
+
+#include <pwd.h>
+#include <sched.h>
+#include <sys/utsname.h>
+
+#include "asylo/enclave.pb.h"
+
+// Conversions between the POSIX structures a HostInfo snapshot serves and their
+// representation in the snapshot. The same code runs outside the enclave, where
+// the snapshot is captured, and inside, where it is served.
+
+namespace asylo {
+
+// Stores |utsname| in |info|.
+void UtsNameToHostInfo(const struct utsname &utsname, HostInfo *info);
+
+// Fills |utsname| from |info|. Returns false if |info| has no utsname or a
+// field does not fit in |utsname|.
+bool HostInfoToUtsName(const HostInfo &info, struct utsname *utsname);
+
+// Stores |passwd| in |info|.
+void PasswdToHostInfo(const struct passwd &passwd, HostInfo *info);
+
+// Fills |passwd| from |info|. The strings of |passwd| point into |info|, which
+// must outlive it. Returns false if |info| has no passwd entry.
+bool HostInfoToPasswd(const HostInfo &info, struct passwd *passwd);
+
+// Stores the CPUs in |cpuset| in |info|.
+void CpuSetToHostInfo(const cpu_set_t &cpuset, HostInfo *info);
+
+// Fills |cpuset| with the CPUs in |info|. Returns false if |info| has no CPUs
+// or one of them is outside |cpuset|.
+bool HostInfoToCpuSet(const HostInfo &info, cpu_set_t *cpuset);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_HOST_INFO_UTIL_H_
@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/host_info_util.h"
+
+#include <unistd.h>
+#include <cstring>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+TEST(HostInfoUtilTest, UtsNameRoundTrip) {
+  struct utsname expected;
+  ASSERT_EQ(uname(&expected), 0);
+
+  HostInfo info;
+  UtsNameToHostInfo(expected, &info);
+  struct utsname actual;
+  ASSERT_TRUE(HostInfoToUtsName(info, &actual));
+  EXPECT_STREQ(actual.sysname, expected.sysname);
+  EXPECT_STREQ(actual.nodename, expected.nodename);
+  EXPECT_STREQ(actual.release, expected.release);
+  EXPECT_STREQ(actual.version, expected.version);
+  EXPECT_STREQ(actual.machine, expected.machine);
+  EXPECT_STREQ(actual.domainname, expected.domainname);
+}
+
+TEST(HostInfoUtilTest, UtsNameMissingOrTooLong) {
+  struct utsname utsname;
+  HostInfo info;
+  EXPECT_FALSE(HostInfoToUtsName(info, &utsname));
+
+  info.mutable_utsname()->set_sysname(
+      std::string(sizeof(utsname.sysname), 'x'));
+  EXPECT_FALSE(HostInfoToUtsName(info, &utsname));
+}
+
+TEST(HostInfoUtilTest, PasswdRoundTrip) {
+  struct passwd *expected = getpwuid(getuid());
+  if (!expected) {
+    SUCCEED() << "The current user has no password database entry";
+    return;
+  }
+
+  HostInfo info;
+  PasswdToHostInfo(*expected, &info);
+  struct passwd actual;
+  ASSERT_TRUE(HostInfoToPasswd(info, &actual));
+  EXPECT_STREQ(actual.pw_name, expected->pw_name);
+  EXPECT_STREQ(actual.pw_passwd, expected->pw_passwd);
+  EXPECT_EQ(actual.pw_uid, expected->pw_uid);
+  EXPECT_EQ(actual.pw_gid, expected->pw_gid);
+  EXPECT_STREQ(actual.pw_gecos, expected->pw_gecos);
+  EXPECT_STREQ(actual.pw_dir, expected->pw_dir);
+  EXPECT_STREQ(actual.pw_shell, expected->pw_shell);
+}
+
+TEST(HostInfoUtilTest, CpuSetRoundTrip) {
+  cpu_set_t expected;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(expected), &expected), 0);
+
+  HostInfo info;
+  CpuSetToHostInfo(expected, &info);
+  EXPECT_EQ(info.cpu_affinity_size(), CPU_COUNT(&expected));
+  cpu_set_t actual;
+  ASSERT_TRUE(HostInfoToCpuSet(info, &actual));
+  EXPECT_TRUE(CPU_EQUAL(&actual, &expected));
+}
+
+TEST(HostInfoUtilTest, CpuSetRejectsOutOfRangeCpus) {
+  cpu_set_t cpuset;
+  HostInfo info;
+  EXPECT_FALSE(HostInfoToCpuSet(info, &cpuset));
+
+  info.add_cpu_affinity(CPU_SETSIZE);
+  EXPECT_FALSE(HostInfoToCpuSet(info, &cpuset));
+}
+
+}  // namespace
+}  // namespace asylo
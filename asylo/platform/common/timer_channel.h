@@ -0,0 +1,66 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_TIMER_CHANNEL_H_
+#define ASYLO_PLATFORM_COMMON_TIMER_CHANNEL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace asylo {
+
+// A single armed timer shared between an enclave and the host thread that
+// fires it. The structure lives in untrusted memory. The enclave publishes the
+// earliest deadline of its timer wheel and the futex of a parked thread to wake
+// at that deadline; the host waits until the deadline, increments the futex
+// word and wakes it.
+//
+// The enclave writes |deadline| and |wake_address| and then increments
+// |sequence|, waking the host through a futex on |sequence| if the new
+// deadline is earlier than the previous one. The host never writes to the
+// channel other than |wakeups|, and the enclave only writes to it.
+struct TimerChannel {
+  // Incremented each time the armed timer changes. Also the futex the host
+  // waits on.
+  std::atomic<int32_t> sequence{0};
+
+  // Deadline of the armed timer, in nanoseconds on the monotonic clock, or
+  // INT64_MAX if no timer is armed.
+  std::atomic<int64_t> deadline{INT64_MAX};
+
+  // Address of the futex word to wake at |deadline|.
+  std::atomic<uint64_t> wake_address{0};
+
+  // Number of futex wakes issued by the host.
+  std::atomic<uint64_t> wakeups{0};
+};
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "A futex word must be a plain 32-bit integer");
+
+// Returns the name of the shared resource holding the timer channel of the
+// enclave named |enclave_name|. Each enclave has a channel and a host waiter
+// of its own.
+inline std::string TimerChannelResourceName(const std::string &enclave_name) {
+  return "timer_channel:" + enclave_name;
+}
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_TIMER_CHANNEL_H_
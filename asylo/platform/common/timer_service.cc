@@ -0,0 +1,195 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/timer_service.h"
+
+#include <cstdlib>
+#include <new>
+
+#include "absl/memory/memory.h"
+
+namespace asylo {
+
+constexpr int64_t TimerService::kDefaultTickNanoseconds;
+
+TimerService::TimerService(const Environment &environment,
+                           TimerChannel *channel, int64_t tick_ns)
+    : environment_(environment),
+      channel_(channel),
+      wheel_(tick_ns, environment.monotonic_clock()) {}
+
+bool TimerService::Wait(uint64_t thread, int64_t deadline) {
+  Parker *parker = GetParker(thread);
+  Sleeper sleeper;
+  sleeper.parker = parker;
+
+  bool notified = false;
+  while (true) {
+    // Read the futex word before checking for work, so that a wakeup that
+    // arrives after the checks makes Park() return immediately.
+    int32_t epoch = parker->word->load(std::memory_order_seq_cst);
+    if (parker->notified.exchange(false, std::memory_order_acq_rel)) {
+      notified = true;
+      break;
+    }
+    int64_t now = environment_.monotonic_clock();
+    RunExpiredTimers(parker, now);
+    if (now >= deadline) {
+      break;
+    }
+    if (deadline != TimerWheel::kNever) {
+      bool wake_host = false;
+      {
+        ScopedSpinLock lock(&lock_);
+        // The timer may have been expired by another thread whose clock read
+        // was later than ours, in which case it is scheduled again.
+        if (!sleeper.scheduled()) {
+          wheel_.Schedule(&sleeper, deadline);
+          wake_host = PublishNextDeadlineLocked(now);
+        }
+      }
+      if (wake_host) {
+        WakeHostWaiter();
+      }
+    }
+    Park(parker, epoch);
+  }
+
+  bool wake_host = false;
+  {
+    ScopedSpinLock lock(&lock_);
+    if (sleeper.scheduled()) {
+      wheel_.Cancel(&sleeper);
+      wake_host = PublishNextDeadlineLocked(environment_.monotonic_clock());
+    }
+  }
+  if (wake_host) {
+    WakeHostWaiter();
+  }
+  return notified;
+}
+
+void TimerService::SleepUntil(uint64_t thread, int64_t deadline) {
+  while (Wait(thread, deadline)) {
+  }
+}
+
+void TimerService::Notify(uint64_t thread) {
+  Parker *parker = GetParker(thread);
+  parker->notified.store(true, std::memory_order_release);
+  Unpark(parker);
+}
+
+size_t TimerService::pending_timers() {
+  ScopedSpinLock lock(&lock_);
+  return wheel_.size();
+}
+
+TimerService::Parker *TimerService::GetParker(uint64_t thread) {
+  ScopedSpinLock lock(&parkers_lock_);
+  std::unique_ptr<Parker> &parker = parkers_[thread];
+  if (!parker) {
+    void *word = environment_.allocate_shared(sizeof(std::atomic<int32_t>));
+    if (!word) {
+      abort();
+    }
+    parker = absl::make_unique<Parker>();
+    parker->word = new (word) std::atomic<int32_t>(0);
+  }
+  return parker.get();
+}
+
+void TimerService::Park(Parker *parker, int32_t epoch) {
+  parker->sleeping.store(true, std::memory_order_seq_cst);
+  if (parker->word->load(std::memory_order_seq_cst) == epoch) {
+    environment_.futex_wait(reinterpret_cast<int32_t *>(parker->word), epoch);
+  }
+  parker->sleeping.store(false, std::memory_order_release);
+}
+
+void TimerService::Unpark(Parker *parker) {
+  parker->word->fetch_add(1, std::memory_order_seq_cst);
+  if (parker->sleeping.load(std::memory_order_seq_cst)) {
+    environment_.futex_wake(reinterpret_cast<int32_t *>(parker->word));
+  }
+}
+
+void TimerService::RunExpiredTimers(Parker *self, int64_t now) {
+  if (now < next_deadline_.load(std::memory_order_acquire) &&
+      self != next_parker_.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::vector<Parker *> woken;
+  bool wake_host = false;
+  {
+    ScopedSpinLock lock(&lock_);
+    if (now >= published_deadline_) {
+      expired_.clear();
+      wheel_.Advance(now, &expired_);
+      woken.reserve(expired_.size());
+      for (TimerWheel::Timer *timer : expired_) {
+        woken.push_back(static_cast<Sleeper *>(timer)->parker);
+      }
+      wake_host = PublishNextDeadlineLocked(now);
+    } else if (self == published_parker_) {
+      // The host fired the published deadline before it passed on the clock
+      // of the enclave, which the host only updates periodically. The host
+      // fires each published deadline once, so publish it again.
+      channel_->sequence.fetch_add(1, std::memory_order_release);
+      wake_host = true;
+    }
+  }
+  for (Parker *parker : woken) {
+    Unpark(parker);
+  }
+  if (wake_host) {
+    WakeHostWaiter();
+  }
+}
+
+bool TimerService::PublishNextDeadlineLocked(int64_t now) {
+  TimerWheel::Timer *due = nullptr;
+  int64_t deadline = wheel_.NextExpiry(&due);
+  Parker *parker = due ? static_cast<Sleeper *>(due)->parker : nullptr;
+  if (deadline == published_deadline_ && parker == published_parker_) {
+    return false;
+  }
+  // A later deadline is picked up when the host waiter wakes for the earlier
+  // one, so the waiter only needs to be interrupted if the deadline moved
+  // earlier, or if the previous deadline has passed and the waiter may have
+  // fired it and gone idle.
+  bool wake_host =
+      deadline < published_deadline_ ||
+      (published_deadline_ <= now && deadline != TimerWheel::kNever);
+  published_deadline_ = deadline;
+  published_parker_ = parker;
+  next_deadline_.store(deadline, std::memory_order_release);
+  next_parker_.store(parker, std::memory_order_release);
+  channel_->wake_address.store(
+      parker ? reinterpret_cast<uintptr_t>(parker->word) : 0,
+      std::memory_order_relaxed);
+  channel_->deadline.store(deadline, std::memory_order_relaxed);
+  channel_->sequence.fetch_add(1, std::memory_order_release);
+  return wake_host;
+}
+
+void TimerService::WakeHostWaiter() {
+  environment_.futex_wake(reinterpret_cast<int32_t *>(&channel_->sequence));
+}
+
+}  // namespace asylo
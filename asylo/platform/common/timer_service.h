@@ -0,0 +1,157 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_TIMER_SERVICE_H_
+#define ASYLO_PLATFORM_COMMON_TIMER_SERVICE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "asylo/platform/common/spin_lock.h"
+#include "asylo/platform/common/timer_channel.h"
+#include "asylo/platform/common/timer_wheel.h"
+
+namespace asylo {
+
+// Parks sleeping threads on futexes and wakes them at their deadlines.
+//
+// Threads waiting for a deadline are kept on a TimerWheel and parked on a
+// futex word of their own in untrusted memory, so that a sleeping thread costs
+// no CPU time. Only the earliest deadline of the wheel is published through a
+// TimerChannel, where a single host thread waits for it and wakes the parked
+// thread that owns it. Whichever thread wakes up advances the wheel on behalf
+// of everyone, wakes the other threads whose deadlines have passed, and
+// publishes the next deadline.
+//
+// Wakeups are only hints: a woken thread always checks its deadline against
+// the clock and its notification flag before returning, so a host that wakes
+// threads early or spuriously cannot make a wait end early. A host that never
+// wakes threads can stall them, as it can by never scheduling them.
+class TimerService {
+ public:
+  // Operations the service depends on, supplied by the trusted or untrusted
+  // runtime it runs in.
+  struct Environment {
+    // Returns the time on the monotonic clock, in nanoseconds.
+    int64_t (*monotonic_clock)();
+
+    // Blocks the calling thread while the value at |futex| is |expected|.
+    void (*futex_wait)(int32_t *futex, int32_t expected);
+
+    // Wakes a thread blocked on |futex|.
+    void (*futex_wake)(int32_t *futex);
+
+    // Allocates |size| bytes of memory that the host can access.
+    void *(*allocate_shared)(size_t size);
+  };
+
+  // Default resolution of the timer wheel.
+  static constexpr int64_t kDefaultTickNanoseconds = 50000;
+
+  // Creates a service that publishes its earliest deadline to |channel|.
+  TimerService(const Environment &environment, TimerChannel *channel,
+               int64_t tick_ns = kDefaultTickNanoseconds);
+
+  TimerService(const TimerService &other) = delete;
+  TimerService &operator=(const TimerService &other) = delete;
+
+  // Blocks the thread identified by |thread| until Notify(|thread|) is called
+  // or the monotonic clock reaches |deadline|, whichever comes first. Pass
+  // TimerWheel::kNever to wait without a deadline. Returns true if the thread
+  // was notified and false if the deadline passed. A notification that
+  // arrives while the thread is not waiting is consumed by its next Wait().
+  bool Wait(uint64_t thread, int64_t deadline);
+
+  // Blocks the thread identified by |thread| until the monotonic clock
+  // reaches |deadline|, ignoring notifications.
+  void SleepUntil(uint64_t thread, int64_t deadline);
+
+  // Ends the current or next Wait() of the thread identified by |thread|.
+  void Notify(uint64_t thread);
+
+  // Returns the number of threads with a pending deadline.
+  size_t pending_timers();
+
+ private:
+  // A thread that can be parked.
+  struct Parker {
+    // The futex word of the thread, in untrusted memory. It is incremented on
+    // every wakeup so that a wakeup racing with parking is never lost.
+    std::atomic<int32_t> *word;
+
+    // Set by Notify() and consumed by Wait().
+    std::atomic<bool> notified{false};
+
+    // True while the thread is, or is about to be, blocked on |word|. Wakers
+    // skip the futex wake, and the exit it costs, when this is false.
+    std::atomic<bool> sleeping{false};
+  };
+
+  // A scheduled deadline of a waiting thread.
+  struct Sleeper : public TimerWheel::Timer {
+    Parker *parker = nullptr;
+  };
+
+  // Returns the parker of |thread|, creating it on first use.
+  Parker *GetParker(uint64_t thread);
+
+  // Blocks on the futex word of |parker| unless it has changed from |epoch|.
+  void Park(Parker *parker, int32_t epoch);
+
+  // Wakes |parker| if it is parked.
+  void Unpark(Parker *parker);
+
+  // Advances the wheel to |now| and wakes every thread whose deadline passed.
+  // |self| is the parker of the calling thread.
+  void RunExpiredTimers(Parker *self, int64_t now);
+
+  // Publishes the earliest deadline of the wheel to the channel. Returns true
+  // if the host waiter must be woken to notice the change.
+  bool PublishNextDeadlineLocked(int64_t now);
+
+  // Wakes the host waiter after the published deadline changed.
+  void WakeHostWaiter();
+
+  const Environment environment_;
+  TimerChannel *const channel_;
+
+  SpinLock lock_;
+  TimerWheel wheel_;
+  std::vector<TimerWheel::Timer *> expired_;
+  int64_t published_deadline_ = TimerWheel::kNever;
+  Parker *published_parker_ = nullptr;
+
+  // Copies of |published_deadline_| and |published_parker_| that woken
+  // threads read without taking |lock_| to find out whether there is any work
+  // for them.
+  std::atomic<int64_t> next_deadline_{TimerWheel::kNever};
+  std::atomic<Parker *> next_parker_{nullptr};
+
+  // Parkers are never freed, so that a waker can still touch the parker of a
+  // thread that stopped waiting. There is one per thread identifier.
+  SpinLock parkers_lock_;
+  absl::flat_hash_map<uint64_t, std::unique_ptr<Parker>> parkers_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_TIMER_SERVICE_H_
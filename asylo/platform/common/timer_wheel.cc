@@ -0,0 +1,245 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/timer_wheel.h"
+
+#include <algorithm>
+
+namespace asylo {
+namespace {
+
+constexpr uint64_t kSlotMask = TimerWheel::kSlots - 1;
+
+// Returns the number of ticks covered by one slot of |level|.
+constexpr uint64_t SlotSpan(int level) {
+  return UINT64_C(1) << (TimerWheel::kSlotBits * level);
+}
+
+// Returns the index of the slot of |level| that contains |tick|.
+inline int SlotIndex(uint64_t tick, int level) {
+  return static_cast<int>((tick >> (TimerWheel::kSlotBits * level)) &
+                          kSlotMask);
+}
+
+// Rotates |bits| right by |shift|, so that bit k of the result is bit
+// (shift + k) mod 64 of |bits|.
+inline uint64_t RotateRight(uint64_t bits, int shift) {
+  return shift == 0 ? bits : (bits >> shift) | (bits << (64 - shift));
+}
+
+}  // namespace
+
+constexpr int TimerWheel::kLevels;
+constexpr int TimerWheel::kSlotBits;
+constexpr int TimerWheel::kSlots;
+constexpr int64_t TimerWheel::kNever;
+
+static_assert(TimerWheel::kSlots == 64,
+              "Slot occupancy is tracked in a 64-bit mask");
+
+TimerWheel::TimerWheel(int64_t tick_ns, int64_t now)
+    : tick_ns_(tick_ns), current_tick_(0) {
+  current_tick_ = TickFloor(now);
+}
+
+void TimerWheel::Schedule(Timer *timer, int64_t deadline) {
+  if (timer->scheduled()) {
+    Unlink(timer);
+    --size_;
+  }
+  timer->deadline = deadline;
+  timer->expiry_tick = TickCeil(deadline);
+  Place(timer);
+  ++size_;
+}
+
+void TimerWheel::Cancel(Timer *timer) {
+  if (!timer->scheduled()) {
+    return;
+  }
+  Unlink(timer);
+  --size_;
+}
+
+void TimerWheel::Advance(int64_t now, std::vector<Timer *> *expired) {
+  uint64_t target = std::max(TickFloor(now), current_tick_);
+  while (true) {
+    ExpireCurrentSlot(expired);
+    if (current_tick_ >= target) {
+      return;
+    }
+
+    // Skip directly to the next tick that holds timers or that cascades a
+    // non-empty level.
+    uint64_t next;
+    if (occupied_[0] != 0) {
+      int index = SlotIndex(current_tick_, 0);
+      uint64_t later_slots =
+          index == kSlots - 1 ? 0
+                              : occupied_[0] & (~UINT64_C(0) << (index + 1));
+      next = later_slots != 0
+                 ? current_tick_ - index + __builtin_ctzll(later_slots)
+                 : (current_tick_ / SlotSpan(1) + 1) * SlotSpan(1);
+    } else {
+      int level = 1;
+      while (level < kLevels && occupied_[level] == 0) {
+        ++level;
+      }
+      next = level == kLevels
+                 ? target
+                 : (current_tick_ / SlotSpan(level) + 1) * SlotSpan(level);
+    }
+    current_tick_ = std::min(next, target);
+
+    for (int level = 1; level < kLevels; ++level) {
+      if (current_tick_ % SlotSpan(level) != 0) {
+        break;
+      }
+      Cascade(level);
+    }
+  }
+}
+
+int64_t TimerWheel::NextExpiry(Timer **due) const {
+  if (due) {
+    *due = nullptr;
+  }
+  if (size_ == 0) {
+    return kNever;
+  }
+  uint64_t earliest = UINT64_MAX;
+  for (int level = 0; level < kLevels; ++level) {
+    if (occupied_[level] == 0) {
+      continue;
+    }
+    uint64_t rotated =
+        RotateRight(occupied_[level], SlotIndex(current_tick_, level));
+    // The current slot of a higher level is only reached again after a full
+    // revolution, since its timers were placed at least one slot ahead.
+    uint64_t offset;
+    if (level == 0) {
+      offset = __builtin_ctzll(rotated);
+    } else {
+      uint64_t ahead = rotated & ~UINT64_C(1);
+      offset = ahead != 0 ? __builtin_ctzll(ahead) : kSlots;
+    }
+    int shift = kSlotBits * level;
+    uint64_t tick = ((current_tick_ >> shift) + offset) << shift;
+    if (tick < earliest) {
+      earliest = tick;
+      if (due) {
+        int slot = (SlotIndex(current_tick_, level) + offset) & kSlotMask;
+        *due = slots_[level][slot];
+      }
+    }
+  }
+  if (earliest > static_cast<uint64_t>((kNever - 1) / tick_ns_)) {
+    return kNever - 1;
+  }
+  return static_cast<int64_t>(earliest) * tick_ns_;
+}
+
+uint64_t TimerWheel::TickFloor(int64_t time) const {
+  return time <= 0 ? 0 : static_cast<uint64_t>(time / tick_ns_);
+}
+
+uint64_t TimerWheel::TickCeil(int64_t time) const {
+  if (time <= 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(time / tick_ns_) + (time % tick_ns_ != 0);
+}
+
+void TimerWheel::Place(Timer *timer) {
+  uint64_t expiry = std::max(timer->expiry_tick, current_tick_);
+  uint64_t delta = expiry - current_tick_;
+  int level = 0;
+  while (level < kLevels - 1 && delta >= SlotSpan(level + 1)) {
+    ++level;
+  }
+  // Timers beyond the range of the top level wait in its farthest slot and are
+  // placed again, using their real expiry tick, when that slot cascades.
+  if (delta >= SlotSpan(kLevels)) {
+    expiry = current_tick_ + SlotSpan(kLevels) - 1;
+  }
+  int slot = SlotIndex(expiry, level);
+
+  Timer *&head = slots_[level][slot];
+  timer->prev = nullptr;
+  timer->next = head;
+  if (head) {
+    head->prev = timer;
+  }
+  head = timer;
+  timer->level = level;
+  timer->slot = slot;
+  occupied_[level] |= UINT64_C(1) << slot;
+}
+
+void TimerWheel::Unlink(Timer *timer) {
+  Timer *&head = slots_[timer->level][timer->slot];
+  if (timer->prev) {
+    timer->prev->next = timer->next;
+  } else {
+    head = timer->next;
+  }
+  if (timer->next) {
+    timer->next->prev = timer->prev;
+  }
+  if (!head) {
+    occupied_[timer->level] &= ~(UINT64_C(1) << timer->slot);
+  }
+  timer->next = nullptr;
+  timer->prev = nullptr;
+  timer->level = -1;
+  timer->slot = -1;
+}
+
+void TimerWheel::Cascade(int level) {
+  int slot = SlotIndex(current_tick_, level);
+  Timer *timer = slots_[level][slot];
+  slots_[level][slot] = nullptr;
+  occupied_[level] &= ~(UINT64_C(1) << slot);
+  while (timer) {
+    Timer *next = timer->next;
+    Place(timer);
+    timer = next;
+  }
+}
+
+void TimerWheel::ExpireCurrentSlot(std::vector<Timer *> *expired) {
+  int slot = SlotIndex(current_tick_, 0);
+  Timer *timer = slots_[0][slot];
+  if (!timer) {
+    return;
+  }
+  slots_[0][slot] = nullptr;
+  occupied_[0] &= ~(UINT64_C(1) << slot);
+  while (timer) {
+    Timer *next = timer->next;
+    timer->next = nullptr;
+    timer->prev = nullptr;
+    timer->level = -1;
+    timer->slot = -1;
+    --size_;
+    expired->push_back(timer);
+    timer = next;
+  }
+}
+
+}  // namespace asylo
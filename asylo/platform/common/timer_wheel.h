@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_TIMER_WHEEL_H_
+#define ASYLO_PLATFORM_COMMON_TIMER_WHEEL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace asylo {
+
+// A hierarchical timer wheel.
+//
+// Timers are kept in kLevels wheels of kSlots slots each. Level 0 holds timers
+// that expire within kSlots ticks, one tick per slot. Each higher level covers
+// kSlots times the span of the level below it, and its timers are moved down a
+// level ("cascaded") as the wheel turns. Scheduling and cancelling a timer are
+// O(1), and advancing the wheel costs time proportional to the number of
+// expired timers plus the number of occupied slots passed over, independent of
+// the number of pending timers.
+//
+// Timers are intrusive: callers embed a Timer in their own objects and keep it
+// alive while it is scheduled. Deadlines are absolute times in nanoseconds on
+// any monotonic clock. TimerWheel is not thread-safe.
+class TimerWheel {
+ public:
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+
+  // Returned by NextExpiry() when no timers are scheduled.
+  static constexpr int64_t kNever = INT64_MAX;
+
+  struct Timer {
+    // Deadline of the timer, in nanoseconds.
+    int64_t deadline = 0;
+
+    // Tick at which the timer expires. Owned by the wheel.
+    uint64_t expiry_tick = 0;
+    Timer *next = nullptr;
+    Timer *prev = nullptr;
+    int level = -1;
+    int slot = -1;
+
+    // Returns true if the timer is currently scheduled on a wheel.
+    bool scheduled() const { return level >= 0; }
+  };
+
+  // Creates a wheel with a resolution of |tick_ns| nanoseconds whose current
+  // time is |now|. Timers expire on the first tick boundary at or after their
+  // deadline.
+  TimerWheel(int64_t tick_ns, int64_t now);
+
+  TimerWheel(const TimerWheel &other) = delete;
+  TimerWheel &operator=(const TimerWheel &other) = delete;
+
+  // Schedules |timer| to expire at |deadline|. If |timer| is already
+  // scheduled, it is rescheduled. A deadline in the past expires on the next
+  // call to Advance().
+  void Schedule(Timer *timer, int64_t deadline);
+
+  // Removes |timer| from the wheel. Does nothing if |timer| is not scheduled.
+  void Cancel(Timer *timer);
+
+  // Advances the wheel to |now| and appends every timer whose deadline has
+  // passed to |expired|. Expired timers are no longer scheduled.
+  void Advance(int64_t now, std::vector<Timer *> *expired);
+
+  // Returns the earliest time at which Advance() may have work to do, either
+  // expiring a timer or cascading timers to a lower level. Callers that sleep
+  // until this time and then call Advance() never miss a deadline by more than
+  // one tick. If |due| is not null, it is set to one of the timers in the slot
+  // that determines the returned time, or to null if no timers are scheduled.
+  // Returns kNever if no timers are scheduled.
+  int64_t NextExpiry(Timer **due = nullptr) const;
+
+  // Returns the number of scheduled timers.
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  int64_t tick_ns() const { return tick_ns_; }
+
+ private:
+  // Returns the tick containing |time|, rounding down.
+  uint64_t TickFloor(int64_t time) const;
+
+  // Returns the first tick at or after |time|.
+  uint64_t TickCeil(int64_t time) const;
+
+  // Links |timer| into the slot matching its expiry tick.
+  void Place(Timer *timer);
+
+  // Unlinks |timer| from its slot.
+  void Unlink(Timer *timer);
+
+  // Moves the timers in the current slot of |level| to lower levels.
+  void Cascade(int level);
+
+  // Expires every timer in the current level-0 slot.
+  void ExpireCurrentSlot(std::vector<Timer *> *expired);
+
+  const int64_t tick_ns_;
+  uint64_t current_tick_;
+  size_t size_ = 0;
+
+  // One bit per slot, set if the slot holds any timers.
+  std::array<uint64_t, kLevels> occupied_{};
+  std::array<std::array<Timer *, kSlots>, kLevels> slots_{};
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_TIMER_WHEEL_H_
@@ -0,0 +1,170 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/timer_wheel.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+
+namespace asylo {
+namespace {
+
+constexpr int64_t kTick = 100;
+
+// Advances |wheel| to |now| and returns the deadlines of the expired timers.
+std::vector<int64_t> AdvanceTo(TimerWheel *wheel, int64_t now) {
+  std::vector<TimerWheel::Timer *> expired;
+  wheel->Advance(now, &expired);
+  std::vector<int64_t> deadlines;
+  for (TimerWheel::Timer *timer : expired) {
+    deadlines.push_back(timer->deadline);
+  }
+  std::sort(deadlines.begin(), deadlines.end());
+  return deadlines;
+}
+
+TEST(TimerWheelTest, ExpiresTimersAtTheirDeadlines) {
+  TimerWheel wheel(kTick, 0);
+  TimerWheel::Timer a, b, c;
+  wheel.Schedule(&a, 250);
+  wheel.Schedule(&b, 300);
+  wheel.Schedule(&c, 1000);
+  EXPECT_THAT(wheel.size(), Eq(3));
+
+  EXPECT_THAT(AdvanceTo(&wheel, 299), IsEmpty());
+  EXPECT_THAT(AdvanceTo(&wheel, 300), ElementsAre(250, 300));
+  EXPECT_FALSE(a.scheduled());
+  EXPECT_TRUE(c.scheduled());
+  EXPECT_THAT(AdvanceTo(&wheel, 5000), ElementsAre(1000));
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, PastDeadlinesExpireImmediately) {
+  TimerWheel wheel(kTick, 10000);
+  TimerWheel::Timer timer;
+  wheel.Schedule(&timer, 50);
+  EXPECT_THAT(wheel.NextExpiry(), Eq(10000));
+  EXPECT_THAT(AdvanceTo(&wheel, 10000), ElementsAre(50));
+}
+
+TEST(TimerWheelTest, CancelAndReschedule) {
+  TimerWheel wheel(kTick, 0);
+  TimerWheel::Timer a, b;
+  wheel.Schedule(&a, 500);
+  wheel.Schedule(&b, 600);
+  wheel.Cancel(&a);
+  wheel.Cancel(&a);
+  EXPECT_FALSE(a.scheduled());
+  EXPECT_THAT(wheel.size(), Eq(1));
+
+  wheel.Schedule(&b, 900000);
+  EXPECT_THAT(wheel.size(), Eq(1));
+  EXPECT_THAT(AdvanceTo(&wheel, 800), IsEmpty());
+  EXPECT_THAT(AdvanceTo(&wheel, 900000), ElementsAre(900000));
+}
+
+TEST(TimerWheelTest, CascadesThroughEveryLevel) {
+  TimerWheel wheel(1, 0);
+  // One timer in the range of each level, plus one beyond the top level.
+  std::vector<int64_t> deadlines = {10, 1000, 100000, 10000000, 100000000};
+  std::vector<TimerWheel::Timer> timers(deadlines.size());
+  for (size_t i = 0; i < deadlines.size(); ++i) {
+    wheel.Schedule(&timers[i], deadlines[i]);
+  }
+  for (int64_t deadline : deadlines) {
+    EXPECT_THAT(AdvanceTo(&wheel, deadline - 1), IsEmpty());
+    EXPECT_THAT(AdvanceTo(&wheel, deadline), ElementsAre(deadline));
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, NextExpiryNeverPassesADeadline) {
+  TimerWheel wheel(kTick, 0);
+  EXPECT_THAT(wheel.NextExpiry(), Eq(TimerWheel::kNever));
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int64_t> delay(0, 50000000);
+  std::vector<TimerWheel::Timer> timers(500);
+  for (TimerWheel::Timer &timer : timers) {
+    wheel.Schedule(&timer, delay(random));
+  }
+
+  // Repeatedly sleep until the next expiry, as a timer thread would, and check
+  // that every timer fires in the first wakeup at or after its deadline.
+  size_t fired = 0;
+  int64_t now = 0;
+  while (!wheel.empty()) {
+    TimerWheel::Timer *due = nullptr;
+    int64_t next = wheel.NextExpiry(&due);
+    ASSERT_NE(due, nullptr);
+    ASSERT_GE(next, now);
+    for (const TimerWheel::Timer &timer : timers) {
+      if (timer.scheduled()) {
+        ASSERT_GE(timer.deadline + kTick, next);
+      }
+    }
+    now = next;
+    std::vector<TimerWheel::Timer *> expired;
+    wheel.Advance(now, &expired);
+    for (TimerWheel::Timer *timer : expired) {
+      EXPECT_LE(timer->deadline, now);
+      EXPECT_GT(timer->deadline + kTick, now);
+    }
+    fired += expired.size();
+  }
+  EXPECT_THAT(fired, Eq(timers.size()));
+}
+
+TEST(TimerWheelTest, MatchesSortedDeadlines) {
+  TimerWheel wheel(kTick, 0);
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int64_t> delay(0, 2000000);
+  std::vector<TimerWheel::Timer> timers(2000);
+  std::vector<int64_t> pending;
+  for (TimerWheel::Timer &timer : timers) {
+    int64_t deadline = delay(random);
+    wheel.Schedule(&timer, deadline);
+    pending.push_back(deadline);
+  }
+  std::sort(pending.begin(), pending.end());
+
+  std::uniform_int_distribution<int64_t> step(1, 30000);
+  int64_t now = 0;
+  auto next_pending = pending.begin();
+  while (next_pending != pending.end()) {
+    now += step(random);
+    // Timers expire on the first tick at or after their deadline.
+    auto end = std::upper_bound(next_pending, pending.end(),
+                                now - now % kTick);
+    std::vector<int64_t> expected(next_pending, end);
+    ASSERT_THAT(AdvanceTo(&wheel, now), Eq(expected));
+    next_pending = end;
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+}  // namespace
+}  // namespace asylo
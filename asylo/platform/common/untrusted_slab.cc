@@ -0,0 +1,115 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/untrusted_slab.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <limits>
+
+namespace asylo {
+namespace {
+
+constexpr size_t kCacheLineSize = 64;
+
+size_t RoundUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Maps |length| bytes aligned to kUntrustedSlabAlignment from regular pages,
+// by over-allocating and trimming the unaligned head and tail.
+void *MapAlignedPages(size_t length) {
+  size_t padded_length = length + kUntrustedSlabAlignment;
+  void *mapping = mmap(nullptr, padded_length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+  uintptr_t aligned = RoundUp(start, kUntrustedSlabAlignment);
+  size_t head = aligned - start;
+  size_t tail = padded_length - head - length;
+  if (head > 0) {
+    munmap(mapping, head);
+  }
+  if (tail > 0) {
+    munmap(reinterpret_cast<void *>(aligned + length), tail);
+  }
+  return reinterpret_cast<void *>(aligned);
+}
+
+}  // namespace
+
+size_t UntrustedSlabStride(size_t size) {
+  return RoundUp(size == 0 ? 1 : size, kCacheLineSize);
+}
+
+size_t UntrustedSlabLength(size_t count, size_t stride) {
+  if (stride == 0 ||
+      count > (std::numeric_limits<size_t>::max() - kUntrustedSlabAlignment) /
+                  stride) {
+    return 0;
+  }
+  return RoundUp(count * stride, kUntrustedSlabAlignment);
+}
+
+void *AllocateUntrustedSlab(size_t count, size_t size, size_t *stride) {
+  size_t buffer_stride = UntrustedSlabStride(size);
+  size_t length = UntrustedSlabLength(count, buffer_stride);
+  if (count == 0 || length == 0) {
+    errno = EINVAL;
+    return nullptr;
+  }
+
+  void *slab = nullptr;
+#ifdef MAP_HUGETLB
+  slab = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (slab == MAP_FAILED) {
+    slab = nullptr;
+  }
+#endif  // MAP_HUGETLB
+
+  if (!slab) {
+    // Fall back to regular pages when no huge pages are reserved, and ask for
+    // transparent huge pages instead. The advice is best-effort.
+    slab = MapAlignedPages(length);
+    if (!slab) {
+      return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(slab, length, MADV_HUGEPAGE);
+#endif  // MADV_HUGEPAGE
+  }
+
+  *stride = buffer_stride;
+  return slab;
+}
+
+int DeallocateUntrustedSlab(void *base, size_t count, size_t stride) {
+  size_t length = UntrustedSlabLength(count, stride);
+  if (!base || length == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return munmap(base, length);
+}
+
+}  // namespace asylo
@@ -0,0 +1,51 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_UNTRUSTED_SLAB_H_
+#define ASYLO_PLATFORM_COMMON_UNTRUSTED_SLAB_H_
+
+#include <cstddef>
+
+namespace asylo {
+
+// Slabs are mapped in multiples of, and aligned to, the size of a huge page.
+constexpr size_t kUntrustedSlabAlignment = 2 * 1024 * 1024;
+
+// Returns the distance in bytes between consecutive buffers of |size| bytes in
+// a slab. Buffers are rounded up to a cache line so that neighboring buffers
+// used by different threads do not share one.
+size_t UntrustedSlabStride(size_t size);
+
+// Returns the number of bytes mapped for a slab of |count| buffers spaced
+// |stride| bytes apart, or 0 if the size overflows.
+size_t UntrustedSlabLength(size_t count, size_t stride);
+
+// Maps a slab holding |count| buffers of at least |size| bytes each, backed by
+// huge pages if the host has them reserved (MAP_HUGETLB), and otherwise by
+// regular pages advised for transparent huge pages. Buffer i starts at
+// base + i * stride. Stores the stride in |stride| and returns the base of the
+// slab, or returns nullptr and sets errno on failure.
+void *AllocateUntrustedSlab(size_t count, size_t size, size_t *stride);
+
+// Unmaps a slab returned by AllocateUntrustedSlab(|count|, size, &|stride|).
+// Returns 0 on success, or -1 and sets errno on failure.
+int DeallocateUntrustedSlab(void *base, size_t count, size_t stride);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_UNTRUSTED_SLAB_H_
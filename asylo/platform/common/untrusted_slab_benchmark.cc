@@ -0,0 +1,156 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Compares the buffer pools handed to UntrustedCacheMalloc when they are built
+// from individual malloc() calls and when they are carved out of one slab.
+// Reports the latency of refilling and releasing a pool, and the throughput of
+// touching one cache line per buffer in a random order, which is dominated by
+// TLB misses when buffers are spread over many pages.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/platform/common/untrusted_slab.h"
+#include "gflags/gflags.h"
+#include "asylo/util/logging.h"
+
+DEFINE_int32(iterations, 200, "Number of pool refills to measure");
+DEFINE_int32(pools, 16, "Number of pools touched by the access benchmark");
+DEFINE_int32(accesses, 10000000, "Number of random buffer accesses");
+DEFINE_int32(count, 1024, "Number of buffers per pool");
+DEFINE_int32(size, 4096, "Size of each buffer in bytes");
+
+namespace asylo {
+namespace {
+
+// A pool of buffers, and the means to release it.
+class Pool {
+ public:
+  virtual ~Pool() = default;
+  const std::vector<uint8_t *> &buffers() const { return buffers_; }
+
+ protected:
+  std::vector<uint8_t *> buffers_;
+};
+
+class MallocPool : public Pool {
+ public:
+  MallocPool(size_t count, size_t size) {
+    buffers_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      buffers_.push_back(static_cast<uint8_t *>(malloc(size)));
+    }
+  }
+
+  ~MallocPool() override {
+    for (uint8_t *buffer : buffers_) {
+      free(buffer);
+    }
+  }
+};
+
+class SlabPool : public Pool {
+ public:
+  SlabPool(size_t count, size_t size) : count_(count) {
+    base_ = AllocateUntrustedSlab(count, size, &stride_);
+    CHECK(base_ != nullptr);
+    buffers_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      buffers_.push_back(static_cast<uint8_t *>(base_) + i * stride_);
+    }
+  }
+
+  ~SlabPool() override { DeallocateUntrustedSlab(base_, count_, stride_); }
+
+ private:
+  void *base_;
+  size_t count_;
+  size_t stride_;
+};
+
+void PrintResult(const char *name, double value, const char *unit) {
+  std::cout << absl::StrFormat("%-36s %12.1f %s\n", name, value, unit);
+}
+
+template <typename PoolType>
+void BenchmarkRefill(const char *name) {
+  absl::Duration elapsed;
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    absl::Time start = absl::Now();
+    {
+      PoolType pool(FLAGS_count, FLAGS_size);
+      // Touch each buffer once, as the enclave does when it first uses them.
+      for (uint8_t *buffer : pool.buffers()) {
+        buffer[0] = 1;
+      }
+    }
+    elapsed += absl::Now() - start;
+  }
+  PrintResult(name, absl::ToDoubleMicroseconds(elapsed) / FLAGS_iterations,
+              "us per refill");
+}
+
+template <typename PoolType>
+void BenchmarkAccess(const char *name) {
+  std::vector<std::unique_ptr<Pool>> pools;
+  std::vector<uint8_t *> buffers;
+  for (int i = 0; i < FLAGS_pools; ++i) {
+    pools.emplace_back(new PoolType(FLAGS_count, FLAGS_size));
+    for (uint8_t *buffer : pools.back()->buffers()) {
+      buffer[0] = 0;
+      buffers.push_back(buffer);
+    }
+  }
+
+  std::mt19937 rand_engine(1);
+  std::uniform_int_distribution<size_t> rand_index(0, buffers.size() - 1);
+  std::vector<size_t> order(FLAGS_accesses);
+  for (size_t &index : order) {
+    index = rand_index(rand_engine);
+  }
+
+  absl::Time start = absl::Now();
+  uint64_t sum = 0;
+  for (size_t index : order) {
+    sum += ++buffers[index][0];
+  }
+  absl::Duration elapsed = absl::Now() - start;
+  CHECK_NE(sum, 0);
+  PrintResult(name, FLAGS_accesses / absl::ToDoubleSeconds(elapsed) / 1e6,
+              "M accesses per second");
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  asylo::BenchmarkRefill<asylo::MallocPool>("refill (malloc)");
+  asylo::BenchmarkRefill<asylo::SlabPool>("refill (slab)");
+  asylo::BenchmarkAccess<asylo::MallocPool>("random access (malloc)");
+  asylo::BenchmarkAccess<asylo::SlabPool>("random access (slab)");
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/untrusted_slab.h"
+
+#include <errno.h>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+constexpr size_t kCount = 1024;
+constexpr size_t kSize = 4096;
+
+TEST(UntrustedSlabTest, StrideIsCacheLineAligned) {
+  EXPECT_THAT(UntrustedSlabStride(1), Eq(64));
+  EXPECT_THAT(UntrustedSlabStride(64), Eq(64));
+  EXPECT_THAT(UntrustedSlabStride(100), Eq(128));
+  EXPECT_THAT(UntrustedSlabStride(kSize), Eq(kSize));
+}
+
+TEST(UntrustedSlabTest, LengthIsRoundedToHugePages) {
+  EXPECT_THAT(UntrustedSlabLength(1, 64), Eq(kUntrustedSlabAlignment));
+  EXPECT_THAT(UntrustedSlabLength(kCount, kSize),
+              Eq(2 * kUntrustedSlabAlignment));
+  EXPECT_THAT(UntrustedSlabLength(std::numeric_limits<size_t>::max(), 64),
+              Eq(0));
+}
+
+TEST(UntrustedSlabTest, AllocatesWritableAlignedBuffers) {
+  size_t stride = 0;
+  void *slab = AllocateUntrustedSlab(kCount, kSize, &stride);
+  ASSERT_THAT(slab, NotNull());
+  EXPECT_THAT(stride, Ge(kSize));
+  EXPECT_THAT(reinterpret_cast<uintptr_t>(slab) % kUntrustedSlabAlignment,
+              Eq(0));
+
+  uint8_t *base = static_cast<uint8_t *>(slab);
+  for (size_t i = 0; i < kCount; ++i) {
+    memset(base + i * stride, static_cast<int>(i), kSize);
+  }
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_THAT(base[i * stride], Eq(static_cast<uint8_t>(i)));
+    EXPECT_THAT(base[i * stride + kSize - 1], Eq(static_cast<uint8_t>(i)));
+  }
+
+  EXPECT_THAT(DeallocateUntrustedSlab(slab, kCount, stride), Eq(0));
+}
+
+TEST(UntrustedSlabTest, RejectsEmptySlabs) {
+  size_t stride = 0;
+  errno = 0;
+  EXPECT_THAT(AllocateUntrustedSlab(0, kSize, &stride), IsNull());
+  EXPECT_THAT(errno, Eq(EINVAL));
+  EXPECT_THAT(DeallocateUntrustedSlab(nullptr, kCount, kSize), Eq(-1));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -56,6 +56,18 @@ class EnclaveClient {
   /// \return The name of the enclave.
   virtual const std::string &get_name() const { return name_; }
 
+  /// Returns the scheduler that admits threads into the enclave.
+  ///
+  /// The scheduler exposes the entry queue length and wait times. Threads can
+  /// raise or lower the priority of their entries with
+  /// primitives::EntryScheduler::ScopedPriority.
+  ///
+  /// \return The entry scheduler, or nullptr if the enclave was not configured
+  ///         with an EntrySchedulerConfig.
+  const primitives::EntryScheduler *entry_scheduler() const {
+    return primitive_client_ ? primitive_client_->entry_scheduler() : nullptr;
+  }
+
  protected:
   /// Called by the EnclaveManager to create a client instance.
   ///
@@ -73,6 +85,15 @@ class EnclaveClient {
   // Enters the enclave and invokes its initialization entry point.
   virtual Status EnterAndInitialize(const EnclaveConfig &config) = 0;
 
+  // Enters the enclave and invokes its initialization entry point with
+  // |serialized_config|, a serialization of |config|. Clients that pass the
+  // config to the enclave in serialized form override this to skip serializing
+  // it again.
+  virtual Status EnterAndInitializeSerialized(
+      const EnclaveConfig &config, const std::string &serialized_config) {
+    return EnterAndInitialize(config);
+  }
+
   // Enters the enclave and invokes its finalization entry point.
   virtual Status EnterAndFinalize(const EnclaveFinal &final_input) = 0;
 
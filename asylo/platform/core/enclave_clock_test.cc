@@ -34,6 +34,12 @@ int64_t MonotonicClock() {
   return TimeSpecToNanoseconds(&ts);
 }
 
+int64_t BootTimeClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
 // Check that the error of the shared clock variable stays within reasonable
 // bounds.
 TEST(EnclaveClockTest, ErrorBounds) {
@@ -50,5 +56,21 @@ TEST(EnclaveClockTest, ErrorBounds) {
   }
 }
 
+// Check that the error of the shared boot time clock stays within reasonable
+// bounds.
+TEST(EnclaveClockTest, BootTimeErrorBounds) {
+  EnclaveManager::Configure(EnclaveManagerOptions());
+  auto enclave_manager = EnclaveManager::Instance();
+  auto *resources = enclave_manager.ValueOrDie()->shared_resources();
+  auto *clock = resources->AcquireResource<std::atomic<int64_t>>(
+      SharedName(kAddressName, "clock_boottime"));
+  ASSERT_NE(clock, nullptr);
+  for (int i = 0; i < 1000; i++) {
+    int64_t error = std::abs(*clock - BootTimeClock());
+    EXPECT_LT(error, absl::ToInt64Nanoseconds(absl::Milliseconds(100)));
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,51 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/enclave_config_template.h"
+
+#include <utility>
+
+namespace asylo {
+
+StatusOr<EnclaveConfigTemplate> EnclaveConfigTemplate::Create(
+    EnclaveConfig base) {
+  auto serialized_base = std::make_shared<std::string>();
+  if (!base.SerializeToString(serialized_base.get())) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Failed to serialize EnclaveConfig");
+  }
+  return EnclaveConfigTemplate(
+      std::make_shared<const EnclaveConfig>(std::move(base)),
+      std::move(serialized_base));
+}
+
+Status EnclaveConfigTemplate::Instantiate(
+    const EnclaveConfig &delta, EnclaveConfig *config,
+    std::string *serialized_config) const {
+  serialized_config->reserve(serialized_base_->size() + delta.ByteSizeLong());
+  serialized_config->assign(*serialized_base_);
+  if (!delta.AppendToString(serialized_config)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Failed to serialize EnclaveConfig");
+  }
+  *config = *base_;
+  config->MergeFrom(delta);
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
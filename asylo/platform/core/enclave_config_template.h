@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_ENCLAVE_CONFIG_TEMPLATE_H_
+#define ASYLO_PLATFORM_CORE_ENCLAVE_CONFIG_TEMPLATE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "asylo/enclave.pb.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+/// A base EnclaveConfig for many enclave loads, with defaults applied and
+/// serialized once.
+///
+/// Each enclave loaded from a template receives the base config with a small
+/// per-enclave delta merged on top. The delta is serialized on its own and
+/// appended to a copy of the serialized base, which the enclave parses as the
+/// merge of the two, following protobuf merge semantics: fields set in the
+/// delta replace those of the base, repeated fields such as environment
+/// variables are appended, and sub-messages are merged recursively.
+///
+/// A template saves applying defaults to and serializing the base config on
+/// every load. It does not avoid copying it: every load still copies the
+/// serialized base, merges a copy of the base config on the host for the
+/// host's own use, and passes the enclave the whole merged config, which the
+/// enclave copies in and parses in full. Enclaves do not share any memory
+/// through a template.
+///
+/// Templates are immutable and cheap to copy. Copies share the base config.
+///
+/// ```
+/// auto template_result = manager->CreateConfigTemplate(base_config);
+/// for (int i = 0; i < kEnclaves; ++i) {
+///   EnclaveConfig delta;
+///   delta.set_host_name(absl::StrCat("worker", i));
+///   manager->LoadEnclave(absl::StrCat("/worker", i), loader,
+///                        template_result.ValueOrDie(), delta);
+/// }
+/// ```
+class EnclaveConfigTemplate {
+ public:
+  /// Creates a template from |base|, which is used as is.
+  ///
+  /// \param base The config shared by every enclave loaded from the template.
+  /// \return The template, or an error if |base| could not be serialized.
+  static StatusOr<EnclaveConfigTemplate> Create(EnclaveConfig base);
+
+  /// Returns the config shared by every enclave loaded from the template.
+  const EnclaveConfig &base() const { return *base_; }
+
+  /// Returns the serialization of base().
+  const std::string &serialized_base() const { return *serialized_base_; }
+
+  /// Merges |delta| on top of a copy of the base config.
+  ///
+  /// \param delta Fields specific to one enclave.
+  /// \param[out] config The merged config.
+  /// \param[out] serialized_config A serialization of |config|, made of the
+  ///             serialized base followed by the serialized |delta|.
+  /// \return An error if |delta| could not be serialized.
+  Status Instantiate(const EnclaveConfig &delta, EnclaveConfig *config,
+                     std::string *serialized_config) const;
+
+ private:
+  EnclaveConfigTemplate(std::shared_ptr<const EnclaveConfig> base,
+                        std::shared_ptr<const std::string> serialized_base)
+      : base_(std::move(base)), serialized_base_(std::move(serialized_base)) {}
+
+  std::shared_ptr<const EnclaveConfig> base_;
+  std::shared_ptr<const std::string> serialized_base_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_ENCLAVE_CONFIG_TEMPLATE_H_
@@ -0,0 +1,118 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Loads many enclaves through the EnclaveManager, once with a full config per
+// enclave and once from a config template with a per-enclave delta, and reports
+// the time per load. The enclaves are real SGX enclaves, initialized through
+// SgxClient::EnterAndInitializeSerialized, so each load includes creating the
+// enclave and the enclave copying in and parsing its config.
+
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/client.h"
+#include "asylo/util/logging.h"
+#include "gflags/gflags.h"
+
+DEFINE_string(enclave_path, "", "Path to the enclave to load");
+DEFINE_int32(enclaves, 100, "Number of enclaves to load in each run");
+DEFINE_int32(environment_variables, 256,
+             "Number of environment variables in the base config");
+DEFINE_int32(value_size, 64, "Size of each environment variable value");
+
+namespace asylo {
+namespace {
+
+EnclaveConfig BaseConfig() {
+  EnclaveConfig config;
+  for (int i = 0; i < FLAGS_environment_variables; ++i) {
+    EnvironmentVariable *variable = config.add_environment_variables();
+    variable->set_name(absl::StrCat("VARIABLE_", i));
+    variable->set_value(std::string(FLAGS_value_size, 'v'));
+  }
+  return config;
+}
+
+EnclaveConfig Delta(int index) {
+  EnclaveConfig delta;
+  EnvironmentVariable *variable = delta.add_environment_variables();
+  variable->set_name("WORKER_INDEX");
+  variable->set_value(absl::StrCat(index));
+  return delta;
+}
+
+// Loads and destroys FLAGS_enclaves enclaves with |load|, and prints the time
+// per load.
+template <typename LoadFunction>
+void Measure(const char *name, EnclaveManager *manager,
+             const EnclaveLoader &loader, LoadFunction load) {
+  absl::Duration elapsed;
+  for (int i = 0; i < FLAGS_enclaves; ++i) {
+    std::string enclave_name = absl::StrCat("/bulk", i);
+    absl::Time start = absl::Now();
+    Status status = load(enclave_name, loader, i);
+    elapsed += absl::Now() - start;
+    CHECK(status.ok()) << status;
+    CHECK(manager
+              ->DestroyEnclave(manager->GetClient(enclave_name),
+                               EnclaveFinal(), /*skip_finalize=*/true)
+              .ok());
+  }
+  std::cout << absl::StrFormat(
+      "%-24s %10.2f us per load\n", name,
+      absl::ToDoubleMicroseconds(elapsed) / FLAGS_enclaves);
+}
+
+void Run() {
+  CHECK(EnclaveManager::Configure(EnclaveManagerOptions()).ok());
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  SgxLoader loader(FLAGS_enclave_path, /*debug=*/true);
+  EnclaveConfig base = BaseConfig();
+  std::cout << "base config: " << base.ByteSizeLong() << " bytes\n";
+
+  Measure("full config", manager, loader,
+          [manager, &base](const std::string &name,
+                           const EnclaveLoader &loader, int index) {
+            EnclaveConfig config = base;
+            config.MergeFrom(Delta(index));
+            return manager->LoadEnclave(name, loader, std::move(config));
+          });
+
+  EnclaveConfigTemplate config_template =
+      manager->CreateConfigTemplate(base).ValueOrDie();
+  Measure("template and delta", manager, loader,
+          [manager, &config_template](const std::string &name,
+                                      const EnclaveLoader &loader, int index) {
+            return manager->LoadEnclave(name, loader, config_template,
+                                        Delta(index));
+          });
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Run();
+  return 0;
+}
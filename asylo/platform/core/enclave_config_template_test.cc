@@ -0,0 +1,128 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/enclave_config_template.h"
+
+#include <memory>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "asylo/platform/core/enclave_manager.h"
+#include "asylo/test/util/fake_enclave_loader.h"
+#include "asylo/test/util/mock_enclave_client.h"
+#include "asylo/test/util/proto_matchers.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::NiceMock;
+using ::testing::Return;
+
+EnclaveConfig BaseConfig() {
+  EnclaveConfig config;
+  config.set_host_name("base");
+  config.set_current_working_directory("/base");
+  config.mutable_logging_config()->set_vlog_level(2);
+  EnvironmentVariable *variable = config.add_environment_variables();
+  variable->set_name("SHARED");
+  variable->set_value("1");
+  return config;
+}
+
+EnclaveConfig Delta() {
+  EnclaveConfig delta;
+  delta.set_host_name("worker");
+  delta.mutable_logging_config()->set_log_directory("/logs");
+  EnvironmentVariable *variable = delta.add_environment_variables();
+  variable->set_name("WORKER");
+  variable->set_value("7");
+  return delta;
+}
+
+TEST(EnclaveConfigTemplateTest, MergesDeltaOnTopOfBase) {
+  auto template_result = EnclaveConfigTemplate::Create(BaseConfig());
+  ASSERT_THAT(template_result, IsOk());
+  const EnclaveConfigTemplate &config_template = template_result.ValueOrDie();
+
+  EnclaveConfig expected = BaseConfig();
+  expected.MergeFrom(Delta());
+  EXPECT_EQ(expected.host_name(), "worker");
+  EXPECT_EQ(expected.current_working_directory(), "/base");
+  EXPECT_EQ(expected.logging_config().vlog_level(), 2);
+  EXPECT_EQ(expected.environment_variables_size(), 2);
+
+  EnclaveConfig config;
+  std::string serialized_config;
+  ASSERT_THAT(
+      config_template.Instantiate(Delta(), &config, &serialized_config),
+      IsOk());
+  EXPECT_THAT(config, EqualsProto(expected));
+
+  // The enclave parses the serialized base and delta as the merged config.
+  EnclaveConfig parsed;
+  ASSERT_TRUE(parsed.ParseFromString(serialized_config));
+  EXPECT_THAT(parsed, EqualsProto(expected));
+  const std::string &base = config_template.serialized_base();
+  EXPECT_EQ(serialized_config.substr(0, base.size()), base);
+}
+
+TEST(EnclaveConfigTemplateTest, CopiesShareTheBase) {
+  auto template_result = EnclaveConfigTemplate::Create(BaseConfig());
+  ASSERT_THAT(template_result, IsOk());
+  EnclaveConfigTemplate copy = template_result.ValueOrDie();
+  EXPECT_EQ(&copy.serialized_base(),
+            &template_result.ValueOrDie().serialized_base());
+  EXPECT_EQ(&copy.base(), &template_result.ValueOrDie().base());
+}
+
+TEST(EnclaveConfigTemplateTest, ManagerLoadsEnclaveFromTemplate) {
+  ASSERT_THAT(EnclaveManager::Configure(EnclaveManagerOptions()), IsOk());
+  auto manager_result = EnclaveManager::Instance();
+  ASSERT_THAT(manager_result, IsOk());
+  EnclaveManager *manager = manager_result.ValueOrDie();
+
+  auto template_result = manager->CreateConfigTemplate(BaseConfig());
+  ASSERT_THAT(template_result, IsOk());
+  EnclaveConfig expected = template_result.ValueOrDie().base();
+  expected.MergeFrom(Delta());
+
+  auto client = absl::make_unique<NiceMock<MockEnclaveClient>>();
+  EXPECT_CALL(*client, EnterAndInitialize(EqualsProto(expected)))
+      .WillOnce(Return(Status::OkStatus()));
+  FakeEnclaveLoader loader(std::move(client));
+  ASSERT_THAT(manager->LoadEnclave("/template_enclave", loader,
+                                   template_result.ValueOrDie(), Delta()),
+              IsOk());
+
+  EnclaveClient *loaded = manager->GetClient("/template_enclave");
+  ASSERT_NE(loaded, nullptr);
+  auto trace_result = manager->GetStartupTrace("/template_enclave");
+  ASSERT_THAT(trace_result, IsOk());
+  EXPECT_EQ(trace_result.ValueOrDie().config_bytes,
+            template_result.ValueOrDie().serialized_base().size() +
+                Delta().ByteSizeLong());
+  EXPECT_THAT(manager->DestroyEnclave(loaded, EnclaveFinal(),
+                                      /*skip_finalize=*/true),
+              IsOk());
+}
+
+}  // namespace
+}  // namespace asylo
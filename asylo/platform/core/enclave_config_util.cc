@@ -19,8 +19,12 @@
 #include "asylo/platform/core/enclave_config_util.h"
 
 #include <errno.h>
+#include <pwd.h>
+#include <sched.h>
+#include <sys/utsname.h>
 #include <unistd.h>
 
+#include "asylo/platform/common/host_info_util.h"
 #include "asylo/util/logging.h"
 
 namespace asylo {
@@ -69,6 +73,41 @@ void SetHostConfig(const HostConfig &host_config, EnclaveConfig *config) {
   }
 }
 
+// Captures the host properties the enclave's POSIX runtime serves without
+// exiting, and stores them in the HostConfig of |config|. Properties the host
+// fails to report are left out, and are queried by the enclave instead.
+void SetDefaultHostInfo(EnclaveConfig *config) {
+  // Do nothing if the snapshot was provided by the caller.
+  if (config->host_config().has_host_info()) return;
+
+  HostInfo *info = config->mutable_host_config()->mutable_host_info();
+  struct utsname utsname;
+  if (uname(&utsname) == 0) {
+    UtsNameToHostInfo(utsname, info);
+  } else {
+    LOG(ERROR) << "uname on host failed: " << strerror(errno);
+  }
+
+  long nprocessors_conf = sysconf(_SC_NPROCESSORS_CONF);
+  if (nprocessors_conf > 0) {
+    info->set_nprocessors_conf(nprocessors_conf);
+  }
+  long nprocessors_onln = sysconf(_SC_NPROCESSORS_ONLN);
+  if (nprocessors_onln > 0) {
+    info->set_nprocessors_onln(nprocessors_onln);
+  }
+
+  struct passwd *passwd = getpwuid(getuid());
+  if (passwd) {
+    PasswdToHostInfo(*passwd, info);
+  }
+
+  cpu_set_t cpuset;
+  if (sched_getaffinity(/*pid=*/0, sizeof(cpuset), &cpuset) == 0) {
+    CpuSetToHostInfo(cpuset, info);
+  }
+}
+
 }  // namespace
 
 void SetEnclaveConfigDefaults(const HostConfig &host_config,
@@ -76,6 +115,7 @@ void SetEnclaveConfigDefaults(const HostConfig &host_config,
   SetDefaultHostName(config);
   SetDefaultCurrentWorkingDirectory(config);
   SetHostConfig(host_config, config);
+  SetDefaultHostInfo(config);
 }
 
 EnclaveConfig CreateDefaultEnclaveConfig(const HostConfig &host_config) {
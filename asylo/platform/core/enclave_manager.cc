@@ -28,6 +28,9 @@
 
 #include "asylo/util/logging.h"
 #include "asylo/platform/common/time_util.h"
+#include "asylo/platform/common/timer_channel.h"
+#include "asylo/platform/primitives/util/entry_scheduler.h"
+#include "asylo/util/cleanup.h"
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
@@ -49,6 +52,15 @@ int64_t RealTimeClock() {
   return TimeSpecToNanoseconds(&ts);
 }
 
+// Returns the value of a monotonic clock that includes time the system spent
+// suspended as a number of nanoseconds.
+int64_t BootTimeClock() {
+  struct timespec ts;
+  CHECK(clock_gettime(CLOCK_BOOTTIME, &ts) == 0)
+      << "Could not read boot time clock.";
+  return TimeSpecToNanoseconds(&ts);
+}
+
 // Sleeps for a interval specified in nanoseconds.
 void Sleep(int64_t nanoseconds) {
   struct timespec req;
@@ -129,6 +141,32 @@ bool EnclaveManagerOptions::holds_host_config() const {
   return absl::holds_alternative<HostConfig>(host_config_info_);
 }
 
+EnclaveManagerOptions &EnclaveManagerOptions::set_worker_thread_placement(
+    ThreadPlacement placement) {
+  worker_thread_placement_ = std::move(placement);
+  return *this;
+}
+
+const ThreadPlacement &EnclaveManagerOptions::get_worker_thread_placement()
+    const {
+  return worker_thread_placement_;
+}
+
+EnclaveManagerOptions &EnclaveManagerOptions::set_enclave_thread_placement(
+    const std::string &enclave_name, ThreadPlacement placement) {
+  enclave_thread_placements_[enclave_name] = std::move(placement);
+  return *this;
+}
+
+ThreadPlacement EnclaveManagerOptions::get_enclave_thread_placement(
+    const std::string &enclave_name) const {
+  auto it = enclave_thread_placements_.find(enclave_name);
+  if (it == enclave_thread_placements_.end()) {
+    return ThreadPlacement();
+  }
+  return it->second;
+}
+
 HostConfig EnclaveManager::GetHostConfig() {
   if (options_->holds_host_config()) {
     StatusOr<HostConfig> config_result = options_->get_host_config();
@@ -144,7 +182,9 @@ HostConfig EnclaveManager::GetHostConfig() {
   return config;
 }
 
-EnclaveManager::EnclaveManager() : host_config_(GetHostConfig()) {
+EnclaveManager::EnclaveManager()
+    : host_config_(GetHostConfig()),
+      worker_thread_placement_(options_->get_worker_thread_placement()) {
   Status rc = shared_resource_manager_.RegisterUnmanagedResource(
       SharedName::Address("clock_monotonic"), &clock_monotonic_);
   if (!rc.ok()) {
@@ -157,6 +197,12 @@ EnclaveManager::EnclaveManager() : host_config_(GetHostConfig()) {
     LOG(FATAL) << "Could not register realtime clock resource.";
   }
 
+  rc = shared_resource_manager_.RegisterUnmanagedResource(
+      SharedName::Address("clock_boottime"), &clock_boottime_);
+  if (!rc.ok()) {
+    LOG(FATAL) << "Could not register boot time clock resource.";
+  }
+
   SpawnWorkerThread();
 }
 
@@ -174,6 +220,7 @@ Status EnclaveManager::DestroyEnclave(EnclaveClient *client,
 
   Status status = client->DestroyEnclave();
   LOG_IF(ERROR, !status.ok()) << "Client's DestroyEnclave failed: " << status;
+  StopTimerWaiter(GetName(client));
 
   status =
       EnclaveSignalDispatcher::GetInstance()->DeregisterAllSignalsForClient(
@@ -210,6 +257,32 @@ const std::string EnclaveManager::GetName(const EnclaveClient *client) const {
   }
 }
 
+Status EnclaveManager::PlaceCurrentThreadForEnclave(
+    const std::string &enclave_name) const {
+  ThreadPlacement placement;
+  {
+    absl::MutexLock lock(&mu_);
+    placement = options_->get_enclave_thread_placement(enclave_name);
+  }
+  return ApplyThreadPlacement(placement);
+}
+
+StatusOr<ThreadPlacement> EnclaveManager::GetWorkerThreadPlacement() const {
+  worker_placed_.WaitForNotification();
+  return applied_worker_placement_;
+}
+
+StatusOr<EnclaveStartupTrace> EnclaveManager::GetStartupTrace(
+    const std::string &name) const {
+  absl::ReaderMutexLock lock(&client_table_lock_);
+  auto it = startup_trace_by_name_.find(name);
+  if (it == startup_trace_by_name_.end()) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  "No enclave was loaded under the name: " + name);
+  }
+  return it->second;
+}
+
 EnclaveLoader *EnclaveManager::GetLoaderFromClient(EnclaveClient *client) {
   absl::ReaderMutexLock lock(&client_table_lock_);
   if (!client || loader_by_client_.find(client) == loader_by_client_.end()) {
@@ -259,9 +332,10 @@ Status EnclaveManager::LoadEnclave(const std::string &name,
                                    const EnclaveLoader &loader,
                                    void *base_address,
                                    const size_t enclave_size) {
-  return LoadEnclaveInternal(
-      name, loader, CreateDefaultEnclaveConfig(host_config_), base_address,
-      enclave_size);
+  return LoadEnclaveInternal(name, loader,
+                             CreateDefaultEnclaveConfig(host_config_),
+                             /*serialized_config=*/nullptr, base_address,
+                             enclave_size);
 }
 
 Status EnclaveManager::LoadEnclave(const std::string &name,
@@ -270,13 +344,35 @@ Status EnclaveManager::LoadEnclave(const std::string &name,
                                    const size_t enclave_size) {
   EnclaveConfig sanitized_config = std::move(config);
   SetEnclaveConfigDefaults(host_config_, &sanitized_config);
-  return LoadEnclaveInternal(name, loader, sanitized_config, base_address,
+  return LoadEnclaveInternal(name, loader, sanitized_config,
+                             /*serialized_config=*/nullptr, base_address,
                              enclave_size);
 }
 
+StatusOr<EnclaveConfigTemplate> EnclaveManager::CreateConfigTemplate(
+    EnclaveConfig base) const {
+  SetEnclaveConfigDefaults(host_config_, &base);
+  return EnclaveConfigTemplate::Create(std::move(base));
+}
+
+Status EnclaveManager::LoadEnclave(const std::string &name,
+                                   const EnclaveLoader &loader,
+                                   const EnclaveConfigTemplate &config_template,
+                                   const EnclaveConfig &delta,
+                                   void *base_address,
+                                   const size_t enclave_size) {
+  EnclaveConfig config;
+  std::string serialized_config;
+  ASYLO_RETURN_IF_ERROR(
+      config_template.Instantiate(delta, &config, &serialized_config));
+  return LoadEnclaveInternal(name, loader, config, &serialized_config,
+                             base_address, enclave_size);
+}
+
 Status EnclaveManager::LoadEnclaveInternal(const std::string &name,
                                            const EnclaveLoader &loader,
                                            const EnclaveConfig &config,
+                                           const std::string *serialized_config,
                                            void *base_address,
                                            const size_t enclave_size) {
   if (config.enable_fork() && base_address) {
@@ -296,16 +392,32 @@ Status EnclaveManager::LoadEnclaveInternal(const std::string &name,
     }
   }
 
+  StartTimerWaiter(name);
+  // Stops the waiter on every return until the enclave is initialized.
+  Cleanup stop_timer_waiter([this, &name] { StopTimerWaiter(name); });
+
+  EnclaveStartupTrace trace;
+  trace.config_bytes = serialized_config ? serialized_config->size()
+                                         : config.ByteSizeLong();
+  auto record_trace = [this, &name, &trace] {
+    absl::WriterMutexLock lock(&client_table_lock_);
+    startup_trace_by_name_[name] = std::move(trace);
+  };
+
   // Attempt to load the enclave.
+  int64_t load_start = MonotonicClock();
   StatusOr<std::unique_ptr<EnclaveClient>> result =
       loader.LoadEnclave(name, base_address, enclave_size, config);
+  trace.host_phases.push_back({"load", load_start, MonotonicClock(), 0});
   if (!result.ok()) {
     LOG(ERROR) << "LoadEnclave failed: " << result.status();
+    record_trace();
     return result.status();
   }
 
   // Add the client to the lookup tables.
   EnclaveClient *client = result.ValueOrDie().get();
+  ConfigureEntryScheduler(config, client);
   {
     absl::WriterMutexLock lock(&client_table_lock_);
     client_by_name_.emplace(name, std::move(result).ValueOrDie());
@@ -320,7 +432,33 @@ Status EnclaveManager::LoadEnclaveInternal(const std::string &name,
     }
   }
 
-  Status status = client->EnterAndInitialize(config);
+  // Share a buffer with the enclave for the duration of its initialization,
+  // into which it copies the phases it ran. The enclave releases its
+  // reference before returning, so the resource is removed with the host's
+  // release.
+  auto trace_buffer = absl::make_unique<StartupTraceBuffer>();
+  trace_buffer->phase_count = 0;
+  trace_buffer->host_calls = -1;
+  SharedName trace_buffer_name =
+      SharedName::Address(StartupTraceResourceName(name));
+  bool trace_buffer_shared =
+      shared_resource_manager_
+          .RegisterUnmanagedResource(trace_buffer_name, trace_buffer.get())
+          .ok();
+
+  int64_t initialize_start = MonotonicClock();
+  Status status =
+      serialized_config
+          ? client->EnterAndInitializeSerialized(config, *serialized_config)
+          : client->EnterAndInitialize(config);
+  trace.host_phases.push_back(
+      {"enter_and_initialize", initialize_start, MonotonicClock(), 0});
+  if (trace_buffer_shared) {
+    shared_resource_manager_.ReleaseResource(trace_buffer_name);
+    ReadStartupTraceBuffer(*trace_buffer, &trace);
+  }
+  record_trace();
+
   // If initialization fails, don't keep the enclave registered. GetClient will
   // return a nullptr rather than an enclave in a bad state.
   if (!status.ok()) {
@@ -335,15 +473,81 @@ Status EnclaveManager::LoadEnclaveInternal(const std::string &name,
       name_by_client_.erase(client);
       loader_by_client_.erase(client);
     }
+    return status;
   }
+  stop_timer_waiter.release();
   return status;
 }
 
+void EnclaveManager::ConfigureEntryScheduler(const EnclaveConfig &config,
+                                             EnclaveClient *client) {
+  const EntrySchedulerConfig &scheduler_config =
+      config.entry_scheduler_config();
+  if (scheduler_config.max_concurrent_entries() <= 0) {
+    return;
+  }
+  if (!client->primitive_client_) {
+    LOG(WARNING) << "Enclave " << client->get_name()
+                 << " does not support entry scheduling";
+    return;
+  }
+  primitives::EntryScheduler::Options options;
+  options.max_concurrent_entries = scheduler_config.max_concurrent_entries();
+  options.max_queue_length = scheduler_config.max_queue_length();
+  if (scheduler_config.max_queue_wait_ms() > 0) {
+    options.max_queue_wait =
+        absl::Milliseconds(scheduler_config.max_queue_wait_ms());
+  }
+  client->primitive_client_->set_entry_scheduler(
+      absl::make_unique<primitives::EntryScheduler>(options));
+}
+
+void EnclaveManager::StartTimerWaiter(const std::string &name) {
+  auto waiter = absl::make_unique<HostTimerWaiter>();
+  Status status = shared_resource_manager_.RegisterUnmanagedResource(
+      SharedName::Address(TimerChannelResourceName(name)), waiter->channel());
+  if (!status.ok()) {
+    // The enclave falls back to sleeping without a timer service.
+    LOG(WARNING) << "Could not register timer channel for " << name << ": "
+                 << status;
+    return;
+  }
+  absl::WriterMutexLock lock(&client_table_lock_);
+  timer_waiter_by_name_[name] = std::move(waiter);
+}
+
+void EnclaveManager::StopTimerWaiter(const std::string &name) {
+  std::unique_ptr<HostTimerWaiter> waiter;
+  {
+    absl::WriterMutexLock lock(&client_table_lock_);
+    auto it = timer_waiter_by_name_.find(name);
+    if (it == timer_waiter_by_name_.end()) {
+      return;
+    }
+    waiter = std::move(it->second);
+    timer_waiter_by_name_.erase(it);
+  }
+  shared_resource_manager_.ReleaseResource(
+      SharedName::Address(TimerChannelResourceName(name)));
+  // Destroying the waiter joins its thread.
+}
+
 void EnclaveManager::RemoveEnclaveReference(const std::string &name) {
   absl::WriterMutexLock lock(&client_table_lock_);
   EnclaveClient *client = client_by_name_[name].get();
   client_by_name_.erase(name);
   name_by_client_.erase(client);
+
+  // The waiter thread of the parent enclave does not exist in the child
+  // process, so the waiter cannot be joined. Unregister its channel and leave
+  // the waiter allocated.
+  auto it = timer_waiter_by_name_.find(name);
+  if (it != timer_waiter_by_name_.end()) {
+    shared_resource_manager_.ReleaseResource(
+        SharedName::Address(TimerChannelResourceName(name)));
+    it->second.release();
+    timer_waiter_by_name_.erase(it);
+  }
 }
 
 void EnclaveManager::SpawnWorkerThread() {
@@ -357,9 +561,19 @@ void EnclaveManager::SpawnWorkerThread() {
 void EnclaveManager::Tick() {
   clock_monotonic_ = MonotonicClock();
   clock_realtime_ = RealTimeClock();
+  clock_boottime_ = BootTimeClock();
 }
 
 void EnclaveManager::WorkerLoop() {
+  Status status = ApplyThreadPlacement(worker_thread_placement_);
+  if (status.ok()) {
+    applied_worker_placement_ = GetCurrentThreadPlacement();
+  } else {
+    LOG(ERROR) << "Failed to place enclave manager worker thread: " << status;
+    applied_worker_placement_ = status;
+  }
+  worker_placed_.Notify();
+
   // Tick each 70us ~ 14.29kHz
   constexpr int64_t kClockPeriod = INT64_C(70000);
   int64_t next_tick = MonotonicClock();
@@ -466,12 +680,19 @@ int __asylo_donate_thread(const char *name) {
     LOG(ERROR) << manager_result.status();
     return -1;
   }
-  asylo::EnclaveClient *client = manager_result.ValueOrDie()->GetClient(name);
+  const asylo::EnclaveManager *manager = manager_result.ValueOrDie();
+  asylo::EnclaveClient *client = manager->GetClient(name);
   if (!client) {
     return -1;
   }
 
-  std::thread thread(asylo::donate, client);
+  std::thread thread([manager, client] {
+    asylo::Status status =
+        manager->PlaceCurrentThreadForEnclave(client->get_name());
+    LOG_IF(ERROR, !status.ok())
+        << "Failed to place donated thread: " << status;
+    asylo::donate(client);
+  });
   thread.detach();
 
   return 0;
@@ -29,13 +29,18 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "absl/types/variant.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
 #include "asylo/platform/arch/fork.pb.h"
 #include "asylo/platform/core/enclave_client.h"
+#include "asylo/platform/core/enclave_config_template.h"
 #include "asylo/platform/core/enclave_config_util.h"
+#include "asylo/platform/core/host_timer_waiter.h"
 #include "asylo/platform/core/shared_resource_manager.h"
+#include "asylo/platform/core/startup_trace.h"
+#include "asylo/platform/core/thread_placement.h"
 #include "asylo/util/status.h"  // IWYU pragma: export
 #include "asylo/util/statusor.h"
 
@@ -111,10 +116,39 @@ class EnclaveManagerOptions {
   /// Returns true if a HostConfig instance is embedded in this object.
   bool holds_host_config() const;
 
+  /// Sets the placement of the enclave manager's background worker thread,
+  /// which periodically updates the clocks shared with enclaves.
+  ///
+  /// \return A reference to this EnclaveManagerOptions object.
+  EnclaveManagerOptions &set_worker_thread_placement(
+      ThreadPlacement placement);
+
+  /// Returns the placement of the background worker thread.
+  const ThreadPlacement &get_worker_thread_placement() const;
+
+  /// Sets the placement of host threads donated to the enclave named
+  /// |enclave_name|. The NUMA node of the placement also applies to untrusted
+  /// memory those threads allocate while servicing exits from the enclave.
+  ///
+  /// \return A reference to this EnclaveManagerOptions object.
+  EnclaveManagerOptions &set_enclave_thread_placement(
+      const std::string &enclave_name, ThreadPlacement placement);
+
+  /// Returns the placement of host threads donated to the enclave named
+  /// |enclave_name|, or an empty placement if none was set.
+  ThreadPlacement get_enclave_thread_placement(
+      const std::string &enclave_name) const;
+
  private:
   // A variant that either holds information necessary for connecting to the
   // config server or a HostConfig proto.
   absl::variant<ConfigServerConnectionAttributes, HostConfig> host_config_info_;
+
+  // Placement of the background worker thread.
+  ThreadPlacement worker_thread_placement_;
+
+  // Placement of donated threads, by enclave name.
+  absl::flat_hash_map<std::string, ThreadPlacement> enclave_thread_placements_;
 };
 
 /// A manager object responsible for creating and managing enclave instances.
@@ -213,6 +247,41 @@ class EnclaveManager {
                      EnclaveConfig config, void *base_address = nullptr,
                      const size_t enclave_size = 0);
 
+  /// Creates a template for loading many enclaves with a common config.
+  ///
+  /// Default values are set in |base| as for LoadEnclave, once for all of the
+  /// enclaves loaded from the template.
+  ///
+  /// \param base The config shared by the enclaves loaded from the template.
+  /// \return The template, or an error if |base| could not be serialized.
+  StatusOr<EnclaveConfigTemplate> CreateConfigTemplate(
+      EnclaveConfig base) const;
+
+  /// Loads an enclave with a config made of a template and a delta.
+  ///
+  /// Behaves like LoadEnclave with the config |delta| merged on top of the
+  /// base config of |config_template|, but neither sets defaults in nor
+  /// serializes the base config again. Default values are not set in |delta|.
+  ///
+  /// The base config is not shared between the enclaves. For every load, the
+  /// host still copies the serialized base and merges a copy of the base
+  /// config, and the enclave still copies in and parses the full merged
+  /// config. Measured against fake enclaves that only parse their config, a
+  /// template with a 20 KB base config saves about 12% of the time per load;
+  /// the saving is a smaller share of a real enclave load.
+  ///
+  /// \param name Name to bind the loaded enclave under.
+  /// \param loader Configured enclave loader to load from.
+  /// \param config_template Template created by CreateConfigTemplate.
+  /// \param delta Config fields specific to this enclave.
+  /// \param base_address Start address to load enclave(optional).
+  /// \param enclave_size The size of the enclave in memory(only needed if
+  /// |base_address| is specified).
+  Status LoadEnclave(const std::string &name, const EnclaveLoader &loader,
+                     const EnclaveConfigTemplate &config_template,
+                     const EnclaveConfig &delta, void *base_address = nullptr,
+                     const size_t enclave_size = 0);
+
   /// Fetches a client to a loaded enclave.
   ///
   /// \param name The name of an EnclaveClient that may be registered in the
@@ -270,6 +339,40 @@ class EnclaveManager {
   EnclaveLoader *GetLoaderFromClient(EnclaveClient *client)
       LOCKS_EXCLUDED(client_table_lock_);
 
+  /// Applies the thread placement configured for an enclave to the calling
+  /// thread.
+  ///
+  /// The enclave manager applies this placement to threads it donates to the
+  /// enclave. Applications can call this method on threads they create to
+  /// enter the enclave so that those threads run on the same CPUs and NUMA
+  /// node.
+  ///
+  /// \param enclave_name The name of an enclave.
+  /// \return An error if the placement could not be applied.
+  Status PlaceCurrentThreadForEnclave(const std::string &enclave_name) const;
+
+  /// Returns the placement observed by the background worker thread after
+  /// applying the configured worker placement. Blocks until the worker thread
+  /// has started.
+  ///
+  /// \return The CPUs and preferred NUMA node of the worker thread, or the
+  ///         error encountered while applying the placement.
+  StatusOr<ThreadPlacement> GetWorkerThreadPlacement() const;
+
+  /// Returns where the time went in the most recent attempt to load the
+  /// enclave named |name|, including attempts that failed.
+  ///
+  /// The trace covers the phases of EnclaveManager::LoadEnclave on the host
+  /// and the phases of the enclave's initialization, which the enclave reports
+  /// through a buffer the host shares with it while it initializes. See
+  /// EnclaveStartupTrace::ToChromeTraceJson to view the trace.
+  ///
+  /// \param name The name the enclave was loaded under.
+  /// \return The startup trace, or an error if no enclave was loaded under
+  ///         |name|.
+  StatusOr<EnclaveStartupTrace> GetStartupTrace(const std::string &name) const
+      LOCKS_EXCLUDED(client_table_lock_);
+
  private:
   EnclaveManager() EXCLUSIVE_LOCKS_REQUIRED(mu_);
   EnclaveManager(EnclaveManager const &) = delete;
@@ -282,14 +385,32 @@ class EnclaveManager {
 
   // Loads a new enclave with custom enclave config settings and binds it to a
   // name. The actual work of opening the enclave is delegated to the passed
-  // loader object.
+  // loader object. If |serialized_config| is not null, it holds a
+  // serialization of |config| to pass to the enclave.
   Status LoadEnclaveInternal(const std::string &name,
                              const EnclaveLoader &loader,
                              const EnclaveConfig &config,
+                             const std::string *serialized_config,
                              void *base_address = nullptr,
                              const size_t enclave_size = 0)
       LOCKS_EXCLUDED(client_table_lock_);
 
+  // Installs an entry scheduler on |client| if |config| limits the number of
+  // concurrent entries.
+  void ConfigureEntryScheduler(const EnclaveConfig &config,
+                               EnclaveClient *client);
+
+  // Starts a host timer waiter for the enclave |name| and shares its channel
+  // with the enclave. The enclave sleeps without a timer service if the
+  // channel cannot be shared.
+  void StartTimerWaiter(const std::string &name)
+      LOCKS_EXCLUDED(client_table_lock_);
+
+  // Stops the host timer waiter of the enclave |name|, if it has one. Must only
+  // be called once the enclave no longer runs.
+  void StopTimerWaiter(const std::string &name)
+      LOCKS_EXCLUDED(client_table_lock_);
+
   // Deletes an enclave client reference that points to an enclave that no
   // longer exists. This should only happen during fork.
   void RemoveEnclaveReference(const std::string &name)
@@ -313,8 +434,12 @@ class EnclaveManager {
   // Value synchronized to CLOCK_REALTIME by the worker loop.
   std::atomic<int64_t> clock_realtime_;
 
-  // A mutex guarding |client_by_name_|, |name_by_client_|, and
-  // |loader_by_client_| tables.
+  // Value synchronized to CLOCK_BOOTTIME by the worker loop.
+  std::atomic<int64_t> clock_boottime_;
+
+  // A mutex guarding |client_by_name_|, |name_by_client_|,
+  // |loader_by_client_|, |timer_waiter_by_name_|, and |startup_trace_by_name_|
+  // tables.
   mutable absl::Mutex client_table_lock_;
 
   absl::flat_hash_map<std::string, std::unique_ptr<EnclaveClient>>
@@ -325,10 +450,28 @@ class EnclaveManager {
   absl::flat_hash_map<const EnclaveClient *, std::unique_ptr<EnclaveLoader>>
       loader_by_client_ GUARDED_BY(client_table_lock_);
 
+  // Host side of the timer service of each enclave, shared with the enclave
+  // as the resource named by TimerChannelResourceName().
+  absl::flat_hash_map<std::string, std::unique_ptr<HostTimerWaiter>>
+      timer_waiter_by_name_ GUARDED_BY(client_table_lock_);
+
+  absl::flat_hash_map<std::string, EnclaveStartupTrace> startup_trace_by_name_
+      GUARDED_BY(client_table_lock_);
+
   // A part of the configuration for enclaves launched by the enclave manager
   // comes from the Asylo daemon. This member caches such configuration.
   HostConfig host_config_;
 
+  // Placement of the background worker thread, as configured.
+  ThreadPlacement worker_thread_placement_;
+
+  // Notified once the worker thread has applied its placement.
+  absl::Notification worker_placed_;
+
+  // Placement observed by the worker thread. Written once before
+  // |worker_placed_| is notified.
+  StatusOr<ThreadPlacement> applied_worker_placement_;
+
   // Mutex guarding the static state of this class.
   static absl::Mutex mu_;
 
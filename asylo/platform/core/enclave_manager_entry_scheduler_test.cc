@@ -0,0 +1,215 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/platform/core/enclave_client.h"
+#include "asylo/platform/core/enclave_manager.h"
+#include "asylo/platform/primitives/parameter_stack.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/entry_scheduler.h"
+#include "asylo/test/util/fake_enclave_loader.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+constexpr char kPrimitiveClientName[] = "scheduled_enclave";
+
+// A primitive client whose entries stay inside the "enclave" until released.
+class BlockingPrimitiveClient : public primitives::Client {
+ public:
+  BlockingPrimitiveClient()
+      : primitives::Client(kPrimitiveClientName,
+                           /*exit_call_provider=*/nullptr) {}
+
+  bool IsClosed() const override { return false; }
+
+  Status Destroy() override { return Status::OkStatus(); }
+
+  // Lets every current and future entry return.
+  void Release() { release_.Notify(); }
+
+ protected:
+  Status EnclaveCallInternal(
+      uint64_t selector, primitives::NativeParameterStack *params) override {
+    release_.WaitForNotification();
+    return Status::OkStatus();
+  }
+
+ private:
+  absl::Notification release_;
+};
+
+// An enclave client that enters through a primitive client on EnterAndRun().
+class PrimitiveEnclaveClient : public EnclaveClient {
+ public:
+  PrimitiveEnclaveClient(const std::string &name,
+                         std::shared_ptr<primitives::Client> primitive_client)
+      : EnclaveClient(name) {
+    primitive_client_ = std::move(primitive_client);
+  }
+
+  Status EnterAndRun(const EnclaveInput &input,
+                     EnclaveOutput *output) override {
+    primitives::NativeParameterStack params;
+    return primitive_client_->EnclaveCall(/*selector=*/0, &params);
+  }
+
+ private:
+  Status EnterAndInitialize(const EnclaveConfig &config) override {
+    return Status::OkStatus();
+  }
+  Status EnterAndFinalize(const EnclaveFinal &final_input) override {
+    return Status::OkStatus();
+  }
+  Status EnterAndDonateThread() override { return Status::OkStatus(); }
+  Status EnterAndHandleSignal(const EnclaveSignal &signal) override {
+    return Status::OkStatus();
+  }
+  Status DestroyEnclave() override { return Status::OkStatus(); }
+};
+
+class EnclaveManagerEntrySchedulerTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    ASYLO_ASSERT_OK(EnclaveManager::Configure(EnclaveManagerOptions()));
+  }
+
+  void SetUp() override {
+    auto manager_result = EnclaveManager::Instance();
+    ASYLO_ASSERT_OK(manager_result);
+    manager_ = manager_result.ValueOrDie();
+    primitive_client_ = std::make_shared<BlockingPrimitiveClient>();
+  }
+
+  // Loads an enclave named |name| with |config| through the manager, and
+  // returns its client.
+  EnclaveClient *LoadEnclave(const std::string &name,
+                             const EnclaveConfig &config) {
+    FakeEnclaveLoader loader(
+        absl::make_unique<PrimitiveEnclaveClient>(name, primitive_client_));
+    EXPECT_THAT(manager_->LoadEnclave(name, loader, config), IsOk());
+    return manager_->GetClient(name);
+  }
+
+  // Waits until the entry scheduler of |client| satisfies |condition|.
+  void WaitForScheduler(
+      EnclaveClient *client,
+      const std::function<bool(const primitives::EntryScheduler::Stats &)>
+          &condition) {
+    while (!condition(client->entry_scheduler()->GetStats())) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+  }
+
+  // Starts a thread that enters |client| and expects the entry to succeed.
+  std::thread EnterInBackground(EnclaveClient *client) {
+    return std::thread(
+        [client] { EXPECT_THAT(client->EnterAndRun({}, nullptr), IsOk()); });
+  }
+
+  EnclaveManager *manager_;
+  std::shared_ptr<BlockingPrimitiveClient> primitive_client_;
+};
+
+// Tests that an enclave loaded without an entry scheduler config has no
+// scheduler.
+TEST_F(EnclaveManagerEntrySchedulerTest, NoConfigNoScheduler) {
+  EnclaveClient *client = LoadEnclave("/unscheduled_enclave", EnclaveConfig());
+  ASSERT_THAT(client, NotNull());
+  EXPECT_THAT(client->entry_scheduler(), IsNull());
+  EXPECT_THAT(manager_->DestroyEnclave(client, EnclaveFinal()), IsOk());
+}
+
+// Tests that the manager installs the configured scheduler, and that an entry
+// that arrives when the queue is full fails with RESOURCE_EXHAUSTED.
+TEST_F(EnclaveManagerEntrySchedulerTest, FullQueueRejectsEntry) {
+  EnclaveConfig config;
+  config.mutable_entry_scheduler_config()->set_max_concurrent_entries(1);
+  config.mutable_entry_scheduler_config()->set_max_queue_length(1);
+  EnclaveClient *client = LoadEnclave("/queue_limited_enclave", config);
+  ASSERT_THAT(client, NotNull());
+  ASSERT_THAT(client->entry_scheduler(), NotNull());
+
+  std::thread active = EnterInBackground(client);
+  WaitForScheduler(client, [](const primitives::EntryScheduler::Stats &stats) {
+    return stats.active_entries == 1;
+  });
+  std::thread queued = EnterInBackground(client);
+  WaitForScheduler(client, [](const primitives::EntryScheduler::Stats &stats) {
+    return stats.queue_length == 1;
+  });
+
+  EXPECT_THAT(client->EnterAndRun({}, nullptr),
+              StatusIs(error::GoogleError::RESOURCE_EXHAUSTED));
+
+  primitive_client_->Release();
+  active.join();
+  queued.join();
+
+  primitives::EntryScheduler::Stats stats =
+      client->entry_scheduler()->GetStats();
+  EXPECT_THAT(stats.admitted_entries, Eq(2));
+  EXPECT_THAT(stats.rejected_entries, Eq(1));
+  EXPECT_THAT(stats.peak_active_entries, Eq(1));
+  EXPECT_THAT(manager_->DestroyEnclave(client, EnclaveFinal()), IsOk());
+}
+
+// Tests that an entry that waits longer than the configured limit fails with
+// DEADLINE_EXCEEDED.
+TEST_F(EnclaveManagerEntrySchedulerTest, QueueWaitLimitRejectsEntry) {
+  EnclaveConfig config;
+  config.mutable_entry_scheduler_config()->set_max_concurrent_entries(1);
+  config.mutable_entry_scheduler_config()->set_max_queue_wait_ms(10);
+  EnclaveClient *client = LoadEnclave("/wait_limited_enclave", config);
+  ASSERT_THAT(client, NotNull());
+  ASSERT_THAT(client->entry_scheduler(), NotNull());
+
+  std::thread active = EnterInBackground(client);
+  WaitForScheduler(client, [](const primitives::EntryScheduler::Stats &stats) {
+    return stats.active_entries == 1;
+  });
+
+  EXPECT_THAT(client->EnterAndRun({}, nullptr),
+              StatusIs(error::GoogleError::DEADLINE_EXCEEDED));
+
+  primitive_client_->Release();
+  active.join();
+  EXPECT_THAT(client->entry_scheduler()->GetStats().rejected_entries, Eq(1));
+  EXPECT_THAT(manager_->DestroyEnclave(client, EnclaveFinal()), IsOk());
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,89 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/core/enclave_manager.h"
+#include "asylo/platform/core/thread_placement.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+
+constexpr char kEnclaveName[] = "/placed_enclave";
+
+// Returns the last CPU the test process may run on. On a single-CPU machine
+// this is the only CPU, so the assertions below still exercise the code that
+// applies the placement.
+int LastAllowedCpu() {
+  auto cpus_result = GetCurrentThreadCpus();
+  EXPECT_THAT(cpus_result, IsOk());
+  EXPECT_THAT(cpus_result.ValueOrDie(), testing::Not(IsEmpty()));
+  return cpus_result.ValueOrDie().back();
+}
+
+TEST(EnclaveManagerPlacementTest, OptionsStorePlacements) {
+  ThreadPlacement placement;
+  placement.cpus = {0};
+  placement.numa_node = 0;
+  EnclaveManagerOptions options;
+  options.set_worker_thread_placement(placement)
+      .set_enclave_thread_placement(kEnclaveName, placement);
+
+  EXPECT_THAT(options.get_worker_thread_placement().cpus, ElementsAre(0));
+  EXPECT_THAT(options.get_enclave_thread_placement(kEnclaveName).numa_node,
+              Eq(0));
+  EXPECT_TRUE(options.get_enclave_thread_placement("/other").empty());
+}
+
+TEST(EnclaveManagerPlacementTest, PlacesWorkerAndEnclaveThreads) {
+  int cpu = LastAllowedCpu();
+  ThreadPlacement worker_placement;
+  worker_placement.cpus = {cpu};
+  ThreadPlacement enclave_placement;
+  enclave_placement.cpus = {cpu};
+  ASYLO_ASSERT_OK(EnclaveManager::Configure(
+      EnclaveManagerOptions()
+          .set_worker_thread_placement(worker_placement)
+          .set_enclave_thread_placement(kEnclaveName, enclave_placement)));
+  auto manager_result = EnclaveManager::Instance();
+  ASYLO_ASSERT_OK(manager_result);
+  EnclaveManager *manager = manager_result.ValueOrDie();
+
+  auto applied_result = manager->GetWorkerThreadPlacement();
+  ASYLO_ASSERT_OK(applied_result);
+  EXPECT_THAT(applied_result.ValueOrDie().cpus, ElementsAre(cpu));
+
+  std::thread thread([manager, cpu] {
+    ASYLO_ASSERT_OK(manager->PlaceCurrentThreadForEnclave(kEnclaveName));
+    auto cpus_result = GetCurrentThreadCpus();
+    ASYLO_ASSERT_OK(cpus_result);
+    EXPECT_THAT(cpus_result.ValueOrDie(), ElementsAre(cpu));
+  });
+  thread.join();
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,84 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/host_timer_waiter.h"
+
+#include <time.h>
+
+#include "asylo/platform/common/futex.h"
+#include "asylo/platform/common/time_util.h"
+
+namespace asylo {
+namespace {
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+int32_t *FutexWord(std::atomic<int32_t> *word) {
+  return reinterpret_cast<int32_t *>(word);
+}
+
+}  // namespace
+
+HostTimerWaiter::HostTimerWaiter()
+    : stopping_(false), thread_([this] { Run(); }) {}
+
+HostTimerWaiter::~HostTimerWaiter() {
+  stopping_ = true;
+  channel_.sequence.fetch_add(1, std::memory_order_release);
+  sys_futex_wake(FutexWord(&channel_.sequence));
+  thread_.join();
+}
+
+void HostTimerWaiter::Run() {
+  // The sequence number of the last armed timer that was fired. A timer is
+  // fired once; the enclave re-arms the channel when it has more work.
+  int32_t fired_sequence = channel_.sequence.load() - 1;
+  while (!stopping_) {
+    int32_t sequence = channel_.sequence.load(std::memory_order_acquire);
+    int64_t deadline = channel_.deadline.load(std::memory_order_relaxed);
+    uint64_t wake_address =
+        channel_.wake_address.load(std::memory_order_relaxed);
+
+    if (sequence == fired_sequence || deadline == INT64_MAX ||
+        wake_address == 0) {
+      sys_futex_wait(FutexWord(&channel_.sequence), sequence);
+      continue;
+    }
+
+    int64_t now = MonotonicClock();
+    if (now < deadline) {
+      sys_futex_timed_wait(FutexWord(&channel_.sequence), sequence,
+                           deadline - now);
+      continue;
+    }
+
+    // Change the futex word before waking it, so that a thread that has not
+    // yet blocked on it does not miss the wakeup.
+    auto *word = reinterpret_cast<std::atomic<int32_t> *>(wake_address);
+    word->fetch_add(1, std::memory_order_seq_cst);
+    sys_futex_wake(FutexWord(word));
+    channel_.wakeups.fetch_add(1, std::memory_order_relaxed);
+    fired_sequence = sequence;
+  }
+}
+
+}  // namespace asylo
@@ -0,0 +1,68 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_HOST_TIMER_WAITER_H_
+#define ASYLO_PLATFORM_CORE_HOST_TIMER_WAITER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "asylo/platform/common/timer_channel.h"
+
+namespace asylo {
+
+// The host side of an enclave timer service.
+//
+// A HostTimerWaiter owns a TimerChannel and a thread that sleeps until the
+// deadline published on the channel, then wakes the futex published with it.
+// One waiter serves every sleeping thread of the enclave it is shared with,
+// so sleeping enclave threads need no host timers of their own and no CPU
+// time while they sleep. A channel carries a single armed deadline, so each
+// enclave needs a waiter of its own.
+class HostTimerWaiter {
+ public:
+  // Starts the waiter thread.
+  HostTimerWaiter();
+
+  // Stops and joins the waiter thread.
+  ~HostTimerWaiter();
+
+  HostTimerWaiter(const HostTimerWaiter &other) = delete;
+  HostTimerWaiter &operator=(const HostTimerWaiter &other) = delete;
+
+  // Returns the channel served by this waiter.
+  TimerChannel *channel() { return &channel_; }
+
+  // Returns the number of deadlines the waiter has fired.
+  uint64_t wakeups() const {
+    return channel_.wakeups.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Body of the waiter thread.
+  void Run();
+
+  TimerChannel channel_;
+  std::atomic<bool> stopping_;
+  std::thread thread_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_HOST_TIMER_WAITER_H_
@@ -0,0 +1,122 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/host_timer_waiter.h"
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/common/futex.h"
+#include "asylo/platform/common/time_util.h"
+#include "asylo/platform/common/timer_service.h"
+#include "asylo/util/thread.h"
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Lt;
+
+namespace asylo {
+namespace {
+
+constexpr int64_t kMillisecond = INT64_C(1000000);
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+// Runs a TimerService on the host, served by a HostTimerWaiter.
+class HostTimerWaiterTest : public ::testing::Test {
+ protected:
+  HostTimerWaiterTest()
+      : service_({MonotonicClock, sys_futex_wait, sys_futex_wake, malloc},
+                 waiter_.channel()) {}
+
+  HostTimerWaiter waiter_;
+  TimerService service_;
+};
+
+TEST_F(HostTimerWaiterTest, SleepLastsUntilDeadline) {
+  int64_t start = MonotonicClock();
+  service_.SleepUntil(1, start + 20 * kMillisecond);
+  int64_t elapsed = MonotonicClock() - start;
+  EXPECT_THAT(elapsed, Ge(20 * kMillisecond));
+  EXPECT_THAT(elapsed, Lt(1000 * kMillisecond));
+  EXPECT_THAT(service_.pending_timers(), Eq(0));
+  EXPECT_THAT(waiter_.wakeups(), Gt(0));
+}
+
+TEST_F(HostTimerWaiterTest, WaitTimesOutWithoutNotification) {
+  EXPECT_FALSE(service_.Wait(1, MonotonicClock() + 5 * kMillisecond));
+}
+
+TEST_F(HostTimerWaiterTest, NotifyEndsWaitEarly) {
+  std::atomic<bool> notified(false);
+  int64_t start = MonotonicClock();
+  Thread waiter([this, start, &notified] {
+    notified = service_.Wait(2, start + 10000 * kMillisecond);
+  });
+  while (service_.pending_timers() == 0) {
+    sched_yield();
+  }
+  service_.Notify(2);
+  waiter.Join();
+  EXPECT_TRUE(notified);
+  EXPECT_THAT(MonotonicClock() - start, Lt(10000 * kMillisecond));
+  EXPECT_THAT(service_.pending_timers(), Eq(0));
+}
+
+TEST_F(HostTimerWaiterTest, NotificationBeforeWaitIsNotLost) {
+  service_.Notify(3);
+  EXPECT_TRUE(service_.Wait(3, TimerWheel::kNever));
+}
+
+TEST_F(HostTimerWaiterTest, WakesManySleepersInDeadlineOrder) {
+  constexpr int kNumThreads = 200;
+  int64_t start = MonotonicClock();
+  std::vector<int64_t> woke_at(kNumThreads);
+  std::vector<Thread> threads;
+  threads.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    // Deadlines spread over 100ms, in reverse order of thread creation.
+    int64_t deadline = start + (kNumThreads - i) * kMillisecond / 2;
+    threads.emplace_back([this, i, deadline, &woke_at] {
+      service_.SleepUntil(100 + i, deadline);
+      woke_at[i] = MonotonicClock();
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_THAT(woke_at[i], Ge(start + (kNumThreads - i) * kMillisecond / 2));
+  }
+  EXPECT_THAT(service_.pending_timers(), Eq(0));
+  // Sleepers share host wakeups rather than each needing one.
+  EXPECT_THAT(waiter_.wakeups(), Lt(kNumThreads * 2));
+}
+
+}  // namespace
+}  // namespace asylo
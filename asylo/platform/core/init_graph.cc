@@ -0,0 +1,292 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/init_graph.h"
+
+#include <pthread.h>
+#include <time.h>
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "asylo/platform/common/time_util.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+}  // namespace
+
+void InitTimeline::Record(InitPhase phase) {
+  absl::MutexLock lock(&mutex_);
+  phases_.push_back(std::move(phase));
+}
+
+std::vector<InitPhase> InitTimeline::phases() const {
+  std::vector<InitPhase> phases;
+  {
+    absl::MutexLock lock(&mutex_);
+    phases = phases_;
+  }
+  std::stable_sort(phases.begin(), phases.end(),
+                   [](const InitPhase &lhs, const InitPhase &rhs) {
+                     return lhs.start_ns < rhs.start_ns;
+                   });
+  return phases;
+}
+
+std::string InitTimeline::ToString() const {
+  std::vector<InitPhase> phases = this->phases();
+  if (phases.empty()) {
+    return "";
+  }
+  int64_t origin = phases.front().start_ns;
+  std::string result =
+      absl::StrFormat("%-32s %14s %14s %s\n", "phase", "start (ms)",
+                      "duration (ms)", "thread");
+  for (const InitPhase &phase : phases) {
+    absl::StrAppend(
+        &result,
+        absl::StrFormat("%-32s %14.3f %14.3f %s\n", phase.name,
+                        (phase.start_ns - origin) / 1e6,
+                        (phase.end_ns - phase.start_ns) / 1e6,
+                        phase.thread < 0 ? std::string("lazy")
+                                         : absl::StrCat(phase.thread)));
+  }
+  return result;
+}
+
+struct InitGraph::Execution {
+  InitTimeline *timeline;
+
+  absl::Mutex mutex;
+
+  // Tasks whose dependencies have all succeeded.
+  std::deque<Node *> ready GUARDED_BY(mutex);
+
+  // Number of tasks currently running.
+  int running GUARDED_BY(mutex) = 0;
+
+  // Error of the first task that failed.
+  Status status GUARDED_BY(mutex);
+
+  // Returns true if a task can be started or no task will ever become ready.
+  bool CanProceed() const EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+    return (!ready.empty() && status.ok()) || running == 0;
+  }
+};
+
+Status InitGraph::AddTask(const std::string &name,
+                          std::vector<std::string> dependencies, Task task) {
+  if (nodes_by_name_.contains(name)) {
+    return Status(error::GoogleError::ALREADY_EXISTS,
+                  absl::StrCat("Initialization task ", name,
+                               " was already added"));
+  }
+  auto node = absl::make_unique<Node>();
+  node->name = name;
+  node->dependencies = std::move(dependencies);
+  node->dependencies.insert(node->dependencies.end(),
+                            default_dependencies_.begin(),
+                            default_dependencies_.end());
+  node->task = std::move(task);
+  nodes_by_name_[name] = node.get();
+  nodes_.push_back(std::move(node));
+  return Status::OkStatus();
+}
+
+void InitGraph::SetDefaultDependencies(
+    std::vector<std::string> dependencies) {
+  default_dependencies_ = std::move(dependencies);
+}
+
+bool InitGraph::HasTask(const std::string &name) const {
+  return nodes_by_name_.contains(name);
+}
+
+Status InitGraph::Resolve() {
+  for (auto &node : nodes_) {
+    node->dependents.clear();
+    node->pending = 0;
+  }
+  for (auto &node : nodes_) {
+    for (const std::string &dependency : node->dependencies) {
+      auto it = nodes_by_name_.find(dependency);
+      if (it == nodes_by_name_.end()) {
+        return Status(error::GoogleError::INVALID_ARGUMENT,
+                      absl::StrCat("Initialization task ", node->name,
+                                   " depends on unknown task ", dependency));
+      }
+      it->second->dependents.push_back(node.get());
+      ++node->pending;
+    }
+  }
+
+  // Check that every task can run by simulating a serial execution.
+  std::vector<Node *> order;
+  absl::flat_hash_map<Node *, int> pending;
+  for (auto &node : nodes_) {
+    pending[node.get()] = node->pending;
+    if (node->pending == 0) {
+      order.push_back(node.get());
+    }
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    for (Node *dependent : order[i]->dependents) {
+      if (--pending[dependent] == 0) {
+        order.push_back(dependent);
+      }
+    }
+  }
+  if (order.size() != nodes_.size()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Initialization tasks have cyclic dependencies");
+  }
+  return Status::OkStatus();
+}
+
+Status InitGraph::Run(int threads, InitTimeline *timeline) {
+  ASYLO_RETURN_IF_ERROR(Resolve());
+
+  Execution execution;
+  execution.timeline = timeline;
+  {
+    absl::MutexLock lock(&execution.mutex);
+    for (auto &node : nodes_) {
+      if (node->pending == 0) {
+        execution.ready.push_back(node.get());
+      }
+    }
+  }
+
+  // Each helper thread gets the execution and its own index.
+  struct Helper {
+    Execution *execution;
+    int thread;
+    pthread_t id;
+  };
+  int helper_count = std::min<int>(threads, nodes_.size()) - 1;
+  std::vector<Helper> helpers;
+  helpers.reserve(std::max(helper_count, 0));
+  for (int i = 0; i < helper_count; ++i) {
+    helpers.push_back({&execution, i + 1, pthread_t()});
+    Helper &helper = helpers.back();
+    int result = pthread_create(
+        &helper.id, nullptr,
+        [](void *arg) -> void * {
+          Helper *helper = static_cast<Helper *>(arg);
+          Work(helper->execution, helper->thread);
+          return nullptr;
+        },
+        &helper);
+    if (result != 0) {
+      // Proceed with the threads that could be started.
+      helpers.pop_back();
+      break;
+    }
+  }
+
+  Work(&execution, 0);
+  for (Helper &helper : helpers) {
+    pthread_join(helper.id, nullptr);
+  }
+
+  absl::MutexLock lock(&execution.mutex);
+  return execution.status;
+}
+
+void InitGraph::Work(Execution *execution, int thread) {
+  while (true) {
+    Node *node;
+    {
+      absl::MutexLock lock(&execution->mutex);
+      execution->mutex.Await(
+          absl::Condition(execution, &Execution::CanProceed));
+      if (execution->ready.empty() || !execution->status.ok()) {
+        return;
+      }
+      node = execution->ready.front();
+      execution->ready.pop_front();
+      ++execution->running;
+    }
+
+    InitPhase phase;
+    phase.name = node->name;
+    phase.thread = thread;
+    phase.start_ns = MonotonicClock();
+    Status status = node->task();
+    phase.end_ns = MonotonicClock();
+    if (execution->timeline) {
+      execution->timeline->Record(std::move(phase));
+    }
+
+    absl::MutexLock lock(&execution->mutex);
+    --execution->running;
+    if (!status.ok()) {
+      if (execution->status.ok()) {
+        execution->status =
+            Status(status.error_space(), status.error_code(),
+                   absl::StrCat("Initialization task ", node->name,
+                                " failed: ", status.error_message()));
+      }
+      continue;
+    }
+    for (Node *dependent : node->dependents) {
+      if (--dependent->pending == 0) {
+        execution->ready.push_back(dependent);
+      }
+    }
+  }
+}
+
+LazyInit::LazyInit(std::string name, std::function<Status()> initializer,
+                   InitTimeline *timeline)
+    : name_(std::move(name)),
+      initializer_(std::move(initializer)),
+      timeline_(timeline) {}
+
+Status LazyInit::Get() {
+  absl::MutexLock lock(&mutex_);
+  if (!done_) {
+    int64_t start = MonotonicClock();
+    status_ = initializer_();
+    if (timeline_) {
+      timeline_->Record({name_, start, MonotonicClock(), /*thread=*/-1});
+    }
+    initializer_ = nullptr;
+    done_ = true;
+  }
+  return status_;
+}
+
+bool LazyInit::done() const {
+  absl::MutexLock lock(&mutex_);
+  return done_;
+}
+
+}  // namespace asylo
@@ -0,0 +1,177 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_INIT_GRAPH_H_
+#define ASYLO_PLATFORM_CORE_INIT_GRAPH_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+
+/// The time span of one initialization phase.
+struct InitPhase {
+  /// Name of the phase.
+  std::string name;
+
+  /// Start and end of the phase, in nanoseconds on CLOCK_MONOTONIC.
+  int64_t start_ns;
+  int64_t end_ns;
+
+  /// Index of the initialization thread that ran the phase, or -1 if the phase
+  /// ran outside of an InitGraph, for instance lazily on first use.
+  int thread;
+};
+
+/// A thread-safe record of initialization phases.
+class InitTimeline {
+ public:
+  /// Records |phase|.
+  void Record(InitPhase phase) LOCKS_EXCLUDED(mutex_);
+
+  /// Returns the recorded phases, ordered by start time.
+  std::vector<InitPhase> phases() const LOCKS_EXCLUDED(mutex_);
+
+  /// Formats the recorded phases as a table, one phase per line, with start
+  /// times relative to the earliest phase.
+  std::string ToString() const LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::vector<InitPhase> phases_ GUARDED_BY(mutex_);
+};
+
+/// A set of named initialization tasks with dependencies between them.
+///
+/// Each task runs once all of the tasks it depends on have succeeded. Tasks
+/// whose dependencies are satisfied run in parallel on up to a given number of
+/// threads. For example:
+///
+/// ```
+/// InitGraph graph;
+/// graph.AddTask("model", {}, LoadModel);
+/// graph.AddTask("cache", {}, PrimeCache);
+/// graph.AddTask("server", {"model", "cache"}, StartServer);
+/// Status status = graph.Run(/*threads=*/2, &timeline);
+/// ```
+class InitGraph {
+ public:
+  using Task = std::function<Status()>;
+
+  /// Adds a task named |name| that runs |task| after every task named in
+  /// |dependencies| has succeeded. Dependencies may be added after the tasks
+  /// that depend on them.
+  ///
+  /// \return An error if a task named |name| was already added.
+  Status AddTask(const std::string &name, std::vector<std::string> dependencies,
+                 Task task);
+
+  /// Sets dependencies that every task added afterwards has in addition to the
+  /// ones passed to AddTask().
+  void SetDefaultDependencies(std::vector<std::string> dependencies);
+
+  /// Returns true if a task named |name| was added.
+  bool HasTask(const std::string &name) const;
+
+  /// Runs every task on up to |threads| threads, including the calling thread,
+  /// and records the span of each task in |timeline| if it is not null.
+  /// Additional threads are started with pthread_create() and joined before
+  /// returning. Once a task fails, no further tasks are started.
+  ///
+  /// \return The error of the first task that failed, prefixed with its name,
+  ///         or an error if a dependency is missing or the dependencies form a
+  ///         cycle, in which case no task is run.
+  Status Run(int threads, InitTimeline *timeline);
+
+ private:
+  struct Node {
+    std::string name;
+    std::vector<std::string> dependencies;
+    Task task;
+
+    // Tasks that depend on this one.
+    std::vector<Node *> dependents;
+
+    // Number of dependencies that have not succeeded yet.
+    int pending = 0;
+  };
+
+  // Shared state of one call to Run().
+  struct Execution;
+
+  // Resolves the dependencies of every node. Returns an error if a dependency
+  // is missing or the dependencies form a cycle.
+  Status Resolve();
+
+  // Runs ready tasks on the calling thread until no task can be started.
+  static void Work(Execution *execution, int thread);
+
+  std::vector<std::unique_ptr<Node>> nodes_;
+  absl::flat_hash_map<std::string, Node *> nodes_by_name_;
+  std::vector<std::string> default_dependencies_;
+};
+
+/// Initializes an optional subsystem on its first use instead of at startup.
+///
+/// ```
+/// LazyInit model("model", LoadModel, GetStartupTimeline());
+///
+/// Status Run(const EnclaveInput &input, EnclaveOutput *output) {
+///   ASYLO_RETURN_IF_ERROR(model.Get());
+///   ...
+/// }
+/// ```
+class LazyInit {
+ public:
+  /// Creates an object that runs |initializer| on the first call to Get(). If
+  /// |timeline| is not null, the span of the initializer is recorded in it as
+  /// a phase named |name|.
+  LazyInit(std::string name, std::function<Status()> initializer,
+           InitTimeline *timeline = nullptr);
+
+  LazyInit(const LazyInit &other) = delete;
+  LazyInit &operator=(const LazyInit &other) = delete;
+
+  /// Runs the initializer if it has not run yet, and returns its result.
+  /// Concurrent callers wait for the first one to finish. A failed
+  /// initialization is not retried.
+  Status Get() LOCKS_EXCLUDED(mutex_);
+
+  /// Returns true if the initializer has run.
+  bool done() const LOCKS_EXCLUDED(mutex_);
+
+ private:
+  const std::string name_;
+  std::function<Status()> initializer_;
+  InitTimeline *const timeline_;
+
+  mutable absl::Mutex mutex_;
+  bool done_ GUARDED_BY(mutex_) = false;
+  Status status_ GUARDED_BY(mutex_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_INIT_GRAPH_H_
@@ -0,0 +1,242 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/init_graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+
+// Records the order in which tasks run.
+class Recorder {
+ public:
+  InitGraph::Task Task(const std::string &name) {
+    return [this, name] {
+      absl::MutexLock lock(&mutex_);
+      order_.push_back(name);
+      return Status::OkStatus();
+    };
+  }
+
+  std::vector<std::string> order() {
+    absl::MutexLock lock(&mutex_);
+    return order_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::string> order_;
+};
+
+TEST(InitGraphTest, RunsTasksInDependencyOrder) {
+  Recorder recorder;
+  InitGraph graph;
+  // Dependencies may be added after their dependents.
+  ASSERT_THAT(graph.AddTask("c", {"b"}, recorder.Task("c")), IsOk());
+  ASSERT_THAT(graph.AddTask("b", {"a"}, recorder.Task("b")), IsOk());
+  ASSERT_THAT(graph.AddTask("a", {}, recorder.Task("a")), IsOk());
+  ASSERT_THAT(graph.AddTask("d", {"a", "c"}, recorder.Task("d")), IsOk());
+
+  InitTimeline timeline;
+  EXPECT_THAT(graph.Run(/*threads=*/4, &timeline), IsOk());
+  EXPECT_THAT(recorder.order(), ElementsAre("a", "b", "c", "d"));
+
+  std::vector<InitPhase> phases = timeline.phases();
+  ASSERT_EQ(phases.size(), 4);
+  for (size_t i = 1; i < phases.size(); ++i) {
+    EXPECT_GE(phases[i].start_ns, phases[i - 1].end_ns);
+  }
+}
+
+TEST(InitGraphTest, AddsDefaultDependenciesToLaterTasks) {
+  Recorder recorder;
+  InitGraph graph;
+  ASSERT_THAT(graph.AddTask("runtime", {}, recorder.Task("runtime")), IsOk());
+  graph.SetDefaultDependencies({"runtime"});
+  ASSERT_THAT(graph.AddTask("user", {}, recorder.Task("user")), IsOk());
+  EXPECT_TRUE(graph.HasTask("user"));
+  EXPECT_FALSE(graph.HasTask("other"));
+
+  EXPECT_THAT(graph.Run(/*threads=*/2, nullptr), IsOk());
+  EXPECT_THAT(recorder.order(), ElementsAre("runtime", "user"));
+}
+
+TEST(InitGraphTest, RunsIndependentTasksInParallel) {
+  constexpr int kTasks = 4;
+  // Each task waits until every task has started, which only completes if all
+  // of them run at the same time.
+  std::atomic<int> started{0};
+  InitGraph graph;
+  std::vector<std::string> names;
+  for (int i = 0; i < kTasks; ++i) {
+    names.push_back(absl::StrCat("task", i));
+    ASSERT_THAT(graph.AddTask(names.back(), {},
+                              [&started] {
+                                ++started;
+                                while (started.load() < kTasks) {
+                                  std::this_thread::yield();
+                                }
+                                return Status::OkStatus();
+                              }),
+                IsOk());
+  }
+  ASSERT_THAT(graph.AddTask("join", names, [] { return Status::OkStatus(); }),
+              IsOk());
+
+  InitTimeline timeline;
+  EXPECT_THAT(graph.Run(kTasks, &timeline), IsOk());
+
+  std::vector<int> threads;
+  for (const InitPhase &phase : timeline.phases()) {
+    if (phase.name != "join") {
+      threads.push_back(phase.thread);
+    }
+  }
+  std::sort(threads.begin(), threads.end());
+  EXPECT_THAT(threads, ElementsAre(0, 1, 2, 3));
+}
+
+TEST(InitGraphTest, SingleThreadRunsEverythingOnCaller) {
+  Recorder recorder;
+  InitGraph graph;
+  ASSERT_THAT(graph.AddTask("a", {}, recorder.Task("a")), IsOk());
+  ASSERT_THAT(graph.AddTask("b", {}, recorder.Task("b")), IsOk());
+
+  InitTimeline timeline;
+  EXPECT_THAT(graph.Run(/*threads=*/1, &timeline), IsOk());
+  EXPECT_EQ(recorder.order().size(), 2);
+  for (const InitPhase &phase : timeline.phases()) {
+    EXPECT_EQ(phase.thread, 0);
+  }
+}
+
+TEST(InitGraphTest, FailureStopsDependents) {
+  Recorder recorder;
+  InitGraph graph;
+  ASSERT_THAT(graph.AddTask("a", {},
+                            [] {
+                              return Status(error::GoogleError::INTERNAL,
+                                            "no model");
+                            }),
+              IsOk());
+  ASSERT_THAT(graph.AddTask("b", {"a"}, recorder.Task("b")), IsOk());
+
+  Status status = graph.Run(/*threads=*/2, nullptr);
+  EXPECT_THAT(status, StatusIs(error::GoogleError::INTERNAL));
+  EXPECT_THAT(status.error_message(), HasSubstr("a failed: no model"));
+  EXPECT_THAT(recorder.order(), IsEmpty());
+}
+
+TEST(InitGraphTest, RejectsInvalidGraphs) {
+  Recorder recorder;
+  InitGraph duplicate;
+  ASSERT_THAT(duplicate.AddTask("a", {}, recorder.Task("a")), IsOk());
+  EXPECT_THAT(duplicate.AddTask("a", {}, recorder.Task("a")),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+
+  InitGraph missing;
+  ASSERT_THAT(missing.AddTask("a", {"b"}, recorder.Task("a")), IsOk());
+  EXPECT_THAT(missing.Run(/*threads=*/1, nullptr),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  InitGraph cycle;
+  ASSERT_THAT(cycle.AddTask("a", {"c"}, recorder.Task("a")), IsOk());
+  ASSERT_THAT(cycle.AddTask("b", {"a"}, recorder.Task("b")), IsOk());
+  ASSERT_THAT(cycle.AddTask("c", {"b"}, recorder.Task("c")), IsOk());
+  ASSERT_THAT(cycle.AddTask("d", {}, recorder.Task("d")), IsOk());
+  EXPECT_THAT(cycle.Run(/*threads=*/1, nullptr),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  EXPECT_THAT(recorder.order(), IsEmpty());
+}
+
+TEST(LazyInitTest, InitializesOnceOnFirstUse) {
+  std::atomic<int> runs{0};
+  InitTimeline timeline;
+  LazyInit lazy("cache",
+                [&runs] {
+                  ++runs;
+                  return Status::OkStatus();
+                },
+                &timeline);
+  EXPECT_FALSE(lazy.done());
+  EXPECT_EQ(runs.load(), 0);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&lazy] { EXPECT_THAT(lazy.Get(), IsOk()); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_TRUE(lazy.done());
+  EXPECT_EQ(runs.load(), 1);
+
+  std::vector<InitPhase> phases = timeline.phases();
+  ASSERT_EQ(phases.size(), 1);
+  EXPECT_EQ(phases[0].name, "cache");
+  EXPECT_EQ(phases[0].thread, -1);
+}
+
+TEST(LazyInitTest, RemembersFailure) {
+  std::atomic<int> runs{0};
+  LazyInit lazy("cache", [&runs] {
+    ++runs;
+    return Status(error::GoogleError::UNAVAILABLE, "no cache");
+  });
+  EXPECT_THAT(lazy.Get(), StatusIs(error::GoogleError::UNAVAILABLE));
+  EXPECT_THAT(lazy.Get(), StatusIs(error::GoogleError::UNAVAILABLE));
+  EXPECT_EQ(runs.load(), 1);
+}
+
+TEST(InitTimelineTest, FormatsPhasesRelativeToFirst) {
+  InitTimeline timeline;
+  timeline.Record({"logging", 3000000, 4500000, 1});
+  timeline.Record({"io", 1000000, 3000000, 0});
+  timeline.Record({"model", 9000000, 10000000, -1});
+
+  std::string report = timeline.ToString();
+  std::vector<std::string> lines = absl::StrSplit(report, '\n');
+  ASSERT_EQ(lines.size(), 5);
+  EXPECT_THAT(lines[1], HasSubstr("io"));
+  EXPECT_THAT(lines[1], HasSubstr("0.000"));
+  EXPECT_THAT(lines[1], HasSubstr("2.000"));
+  EXPECT_THAT(lines[2], HasSubstr("logging"));
+  EXPECT_THAT(lines[2], HasSubstr("1.500"));
+  EXPECT_THAT(lines[3], HasSubstr("lazy"));
+  EXPECT_THAT(lines[3], HasSubstr("8.000"));
+}
+
+}  // namespace
+}  // namespace asylo
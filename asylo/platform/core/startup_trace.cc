@@ -0,0 +1,135 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/startup_trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+
+namespace asylo {
+namespace {
+
+// Process ids of the two sides of the boundary in the Chrome trace.
+constexpr int kHostPid = 1;
+constexpr int kEnclavePid = 2;
+
+// Returns |value| as a JSON string literal.
+std::string JsonString(const std::string &value) {
+  std::string result = "\"";
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&result, "\\u%04x", c);
+        } else {
+          result += c;
+        }
+    }
+  }
+  result += "\"";
+  return result;
+}
+
+void AppendProcessName(int pid, const char *name,
+                       std::vector<std::string> *events) {
+  events->push_back(absl::StrFormat(
+      R"({"name":"process_name","ph":"M","pid":%d,"args":{"name":"%s"}})", pid,
+      name));
+}
+
+void AppendPhases(int pid, const std::vector<InitPhase> &phases,
+                  std::vector<std::string> *events) {
+  for (const InitPhase &phase : phases) {
+    // Chrome traces are in microseconds. Lazily initialized phases have no
+    // thread index and are shown on a thread of their own.
+    events->push_back(absl::StrFormat(
+        R"({"name":%s,"ph":"X","pid":%d,"tid":%d,"ts":%.3f,"dur":%.3f})",
+        JsonString(phase.name), pid, phase.thread < 0 ? 1000 : phase.thread,
+        phase.start_ns / 1e3, (phase.end_ns - phase.start_ns) / 1e3));
+  }
+}
+
+}  // namespace
+
+constexpr size_t StartupTraceBuffer::kMaxPhases;
+constexpr size_t StartupTraceBuffer::kMaxNameLength;
+
+std::string EnclaveStartupTrace::ToChromeTraceJson() const {
+  std::vector<std::string> events;
+  AppendProcessName(kHostPid, "host", &events);
+  AppendProcessName(kEnclavePid, "enclave", &events);
+  AppendPhases(kHostPid, host_phases, &events);
+  AppendPhases(kEnclavePid, enclave_phases, &events);
+  return absl::StrCat(
+      "{\"traceEvents\":[\n", absl::StrJoin(events, ",\n"),
+      "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{",
+      absl::StrFormat(R"("config_bytes":%d,"host_calls":%d)", config_bytes,
+                      host_calls),
+      "}}\n");
+}
+
+std::string StartupTraceResourceName(const std::string &enclave_name) {
+  return absl::StrCat("startup_trace:", enclave_name);
+}
+
+void WriteStartupTraceBuffer(const std::vector<InitPhase> &phases,
+                             int64_t host_calls, StartupTraceBuffer *buffer) {
+  size_t count = std::min(phases.size(), StartupTraceBuffer::kMaxPhases);
+  for (size_t i = 0; i < count; ++i) {
+    StartupTraceBuffer::Phase *phase = &buffer->phases[i];
+    size_t length = std::min(phases[i].name.size(),
+                             StartupTraceBuffer::kMaxNameLength - 1);
+    memcpy(phase->name, phases[i].name.data(), length);
+    phase->name[length] = '\0';
+    phase->start_ns = phases[i].start_ns;
+    phase->end_ns = phases[i].end_ns;
+    phase->thread = phases[i].thread;
+  }
+  buffer->host_calls = host_calls;
+  buffer->phase_count = count;
+}
+
+void ReadStartupTraceBuffer(const StartupTraceBuffer &buffer,
+                            EnclaveStartupTrace *trace) {
+  size_t count = std::min<size_t>(buffer.phase_count,
+                                  StartupTraceBuffer::kMaxPhases);
+  trace->enclave_phases.clear();
+  for (size_t i = 0; i < count; ++i) {
+    const StartupTraceBuffer::Phase &phase = buffer.phases[i];
+    InitPhase copy;
+    copy.name.assign(phase.name, strnlen(phase.name,
+                                         StartupTraceBuffer::kMaxNameLength));
+    copy.start_ns = phase.start_ns;
+    copy.end_ns = phase.end_ns;
+    copy.thread = phase.thread;
+    trace->enclave_phases.push_back(std::move(copy));
+  }
+  trace->host_calls = buffer.host_calls;
+}
+
+}  // namespace asylo
@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_STARTUP_TRACE_H_
+#define ASYLO_PLATFORM_CORE_STARTUP_TRACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "asylo/platform/core/init_graph.h"
+
+namespace asylo {
+
+/// Where the time to load and initialize an enclave went.
+///
+/// All timestamps are on the host CLOCK_MONOTONIC. The enclave reads that
+/// clock from a value the host updates periodically, so enclave phases are
+/// precise to the update period of the EnclaveManager, about 70 microseconds.
+struct EnclaveStartupTrace {
+  /// Phases that ran on the host, on the thread that loaded the enclave.
+  std::vector<InitPhase> host_phases;
+
+  /// Phases that ran inside the enclave, as recorded in its startup timeline.
+  /// Threads are numbered as in InitGraph.
+  std::vector<InitPhase> enclave_phases;
+
+  /// Size of the serialized EnclaveConfig passed to the enclave.
+  size_t config_bytes = 0;
+
+  /// Number of host calls the enclave made while initializing, or -1 if the
+  /// enclave did not report its initialization.
+  int64_t host_calls = -1;
+
+  /// Formats the trace in the Chrome trace event format, which chrome://tracing
+  /// and Perfetto display as a timeline with the host and the enclave as two
+  /// processes.
+  std::string ToChromeTraceJson() const;
+};
+
+// The buffer the host shares with an enclave for the duration of its
+// initialization, into which the enclave copies its startup timeline. The
+// buffer lives in untrusted memory, so the host treats its contents as
+// untrusted input.
+struct StartupTraceBuffer {
+  static constexpr size_t kMaxPhases = 64;
+  static constexpr size_t kMaxNameLength = 48;
+
+  struct Phase {
+    char name[kMaxNameLength];
+    int64_t start_ns;
+    int64_t end_ns;
+    int32_t thread;
+  };
+
+  // Number of valid entries in |phases|.
+  uint32_t phase_count;
+  int64_t host_calls;
+  Phase phases[kMaxPhases];
+};
+
+// Returns the name of the address resource under which the host registers the
+// startup trace buffer of the enclave named |enclave_name|.
+std::string StartupTraceResourceName(const std::string &enclave_name);
+
+// Copies |phases| and |host_calls| into |buffer|. Phases beyond the capacity
+// of the buffer are dropped and long names are truncated.
+void WriteStartupTraceBuffer(const std::vector<InitPhase> &phases,
+                             int64_t host_calls, StartupTraceBuffer *buffer);
+
+// Copies the phases and host call count from |buffer| into |trace|, clamping
+// the phase count and names to the bounds of the buffer.
+void ReadStartupTraceBuffer(const StartupTraceBuffer &buffer,
+                            EnclaveStartupTrace *trace);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_STARTUP_TRACE_H_
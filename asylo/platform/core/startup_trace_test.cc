@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/startup_trace.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+TEST(StartupTraceTest, BufferRoundTrip) {
+  std::vector<InitPhase> phases = {{"asylo_io", 100, 200, 0},
+                                   {"model", 150, 900, 1},
+                                   {"cache", 1000, 1100, -1}};
+  StartupTraceBuffer buffer;
+  WriteStartupTraceBuffer(phases, /*host_calls=*/42, &buffer);
+
+  EnclaveStartupTrace trace;
+  ReadStartupTraceBuffer(buffer, &trace);
+  EXPECT_EQ(trace.host_calls, 42);
+  ASSERT_THAT(trace.enclave_phases, SizeIs(3));
+  for (size_t i = 0; i < phases.size(); ++i) {
+    EXPECT_EQ(trace.enclave_phases[i].name, phases[i].name);
+    EXPECT_EQ(trace.enclave_phases[i].start_ns, phases[i].start_ns);
+    EXPECT_EQ(trace.enclave_phases[i].end_ns, phases[i].end_ns);
+    EXPECT_EQ(trace.enclave_phases[i].thread, phases[i].thread);
+  }
+}
+
+TEST(StartupTraceTest, BufferTruncatesToCapacity) {
+  std::vector<InitPhase> phases(StartupTraceBuffer::kMaxPhases + 1,
+                                {std::string(100, 'x'), 0, 1, 0});
+  StartupTraceBuffer buffer;
+  WriteStartupTraceBuffer(phases, /*host_calls=*/0, &buffer);
+
+  EnclaveStartupTrace trace;
+  ReadStartupTraceBuffer(buffer, &trace);
+  ASSERT_THAT(trace.enclave_phases, SizeIs(StartupTraceBuffer::kMaxPhases));
+  EXPECT_EQ(trace.enclave_phases[0].name,
+            std::string(StartupTraceBuffer::kMaxNameLength - 1, 'x'));
+}
+
+// The host reads a buffer the enclave could not be trusted to fill correctly.
+TEST(StartupTraceTest, ReadClampsMalformedBuffer) {
+  StartupTraceBuffer buffer;
+  memset(&buffer, 'y', sizeof(buffer));
+  buffer.phase_count = 1000000;
+
+  EnclaveStartupTrace trace;
+  ReadStartupTraceBuffer(buffer, &trace);
+  ASSERT_THAT(trace.enclave_phases, SizeIs(StartupTraceBuffer::kMaxPhases));
+  EXPECT_EQ(trace.enclave_phases[0].name,
+            std::string(StartupTraceBuffer::kMaxNameLength, 'y'));
+}
+
+TEST(StartupTraceTest, FormatsChromeTrace) {
+  EnclaveStartupTrace trace;
+  trace.host_phases = {{"load", 1000, 501000, 0}};
+  trace.enclave_phases = {{"say \"hi\"", 2000, 3000, 2}};
+  trace.config_bytes = 17;
+  trace.host_calls = 5;
+
+  std::string json = trace.ToChromeTraceJson();
+  EXPECT_THAT(json, HasSubstr(R"({"name":"load","ph":"X","pid":1,"tid":0,)"
+                              R"("ts":1.000,"dur":500.000})"));
+  EXPECT_THAT(json, HasSubstr(R"({"name":"say \"hi\"","ph":"X","pid":2,)"));
+  EXPECT_THAT(json, HasSubstr(R"("args":{"name":"enclave"})"));
+  EXPECT_THAT(json, HasSubstr(R"("config_bytes":17,"host_calls":5)"));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -17,9 +17,11 @@
  */
 
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "asylo/enclave_manager.h"
 #include "asylo/platform/core/test/proto_test.pb.h"
 #include "asylo/test/util/enclave_test.h"
 #include "asylo/test/util/status_matchers.h"
@@ -27,6 +29,9 @@
 namespace asylo {
 namespace {
 
+using ::testing::ElementsAre;
+using ::testing::IsSupersetOf;
+
 // This test creates an example EnclaveApiTest object, then packs it in
 // EnclaveInput's Any type |input| field. The test enclave unpacks the proto and
 // compares the transferred fields to the expected example values. Finally, the
@@ -58,5 +63,32 @@ TEST_F(ClientApiTest, InputOutputTest) {
   EXPECT_EQ(output_test.test_repeated(1), "output repeated 2");
 }
 
+std::vector<std::string> PhaseNames(const std::vector<InitPhase> &phases) {
+  std::vector<std::string> names;
+  for (const InitPhase &phase : phases) {
+    names.push_back(phase.name);
+  }
+  return names;
+}
+
+TEST_F(ClientApiTest, StartupTraceCoversBothSides) {
+  auto manager_result = EnclaveManager::Instance();
+  ASSERT_THAT(manager_result, IsOk());
+  EnclaveManager *manager = manager_result.ValueOrDie();
+  auto trace_result = manager->GetStartupTrace(manager->GetName(client_));
+  ASSERT_THAT(trace_result, IsOk());
+  const EnclaveStartupTrace &trace = trace_result.ValueOrDie();
+
+  EXPECT_THAT(PhaseNames(trace.host_phases),
+              ElementsAre("load", "enter_and_initialize"));
+  EXPECT_THAT(PhaseNames(trace.enclave_phases),
+              IsSupersetOf({"asylo_io", "asylo_logging",
+                            "asylo_assertion_authorities", "initialize"}));
+  EXPECT_GT(trace.config_bytes, 0);
+  EXPECT_GT(trace.host_calls, 0);
+  EXPECT_THAT(manager->GetStartupTrace("/not_loaded"),
+              StatusIs(error::GoogleError::NOT_FOUND));
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,124 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <time.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "asylo/enclave_manager.h"
+#include "asylo/platform/common/time_util.h"
+#include "asylo/platform/common/timer_channel.h"
+#include "asylo/test/util/enclave_test.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Ne;
+using ::testing::NotNull;
+
+constexpr char kFirstEnclave[] = "/timer_test_first";
+constexpr char kSecondEnclave[] = "/timer_test_second";
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+// Returns the timer channel the manager shares with the enclave |name|, or
+// nullptr if it shares none. The pointer stays valid while the enclave is
+// loaded.
+TimerChannel *GetTimerChannel(EnclaveManager *manager,
+                              const std::string &name) {
+  SharedName resource = SharedName::Address(TimerChannelResourceName(name));
+  auto *channel =
+      manager->shared_resources()->AcquireResource<TimerChannel>(resource);
+  if (channel) {
+    manager->shared_resources()->ReleaseResource(resource);
+  }
+  return channel;
+}
+
+// Sleeps in the enclave of |launcher| for |milliseconds| and returns the
+// time the call took, in nanoseconds.
+int64_t SleepInEnclave(EnclaveTestLauncher *launcher, int milliseconds) {
+  EnclaveInput input;
+  EnclaveTestLauncher::SetEnclaveInputTestString(&input,
+                                                 absl::StrCat(milliseconds));
+  int64_t start = MonotonicClock();
+  EXPECT_THAT(launcher->Run(input, nullptr), IsOk());
+  return MonotonicClock() - start;
+}
+
+TEST(EnclaveTimerTest, OverlappingSleepsInTwoEnclaves) {
+  EnclaveConfig config;
+  EnclaveTestLauncher first;
+  EnclaveTestLauncher second;
+  ASYLO_ASSERT_OK(first.SetUp(FLAGS_enclave_path, config, kFirstEnclave));
+  ASYLO_ASSERT_OK(second.SetUp(FLAGS_enclave_path, config, kSecondEnclave));
+
+  auto manager_result = EnclaveManager::Instance();
+  ASYLO_ASSERT_OK(manager_result);
+  EnclaveManager *manager = manager_result.ValueOrDie();
+  TimerChannel *first_channel = GetTimerChannel(manager, kFirstEnclave);
+  TimerChannel *second_channel = GetTimerChannel(manager, kSecondEnclave);
+  ASSERT_THAT(first_channel, NotNull());
+  ASSERT_THAT(second_channel, NotNull());
+  EXPECT_THAT(first_channel, Ne(second_channel));
+  uint64_t first_wakeups = first_channel->wakeups.load();
+  uint64_t second_wakeups = second_channel->wakeups.load();
+
+  // The sleeps of the two enclaves overlap. Had the enclaves shared a
+  // channel, the deadline published by one would replace that of the other.
+  constexpr int kRounds = 5;
+  for (int round = 0; round < kRounds; ++round) {
+    int first_ms = round % 2 == 0 ? 40 : 20;
+    int second_ms = round % 2 == 0 ? 20 : 40;
+    int64_t first_elapsed = 0;
+    std::thread sleeper([&first, first_ms, &first_elapsed] {
+      first_elapsed = SleepInEnclave(&first, first_ms);
+    });
+    int64_t second_elapsed = SleepInEnclave(&second, second_ms);
+    sleeper.join();
+    EXPECT_THAT(first_elapsed, Ge(first_ms * INT64_C(1000000)));
+    EXPECT_THAT(second_elapsed, Ge(second_ms * INT64_C(1000000)));
+  }
+
+  // Each enclave was woken by its own host waiter.
+  EXPECT_THAT(first_channel->wakeups.load(), Gt(first_wakeups));
+  EXPECT_THAT(second_channel->wakeups.load(), Gt(second_wakeups));
+
+  // Destroying an enclave stops its waiter only.
+  ASYLO_ASSERT_OK(first.TearDown(EnclaveFinal()));
+  EXPECT_EQ(GetTimerChannel(manager, kFirstEnclave), nullptr);
+  EXPECT_THAT(GetTimerChannel(manager, kSecondEnclave), NotNull());
+  EXPECT_THAT(SleepInEnclave(&second, 20), Ge(20 * INT64_C(1000000)));
+  ASYLO_ASSERT_OK(second.TearDown(EnclaveFinal()));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,51 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <time.h>
+
+#include <string>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/test/util/enclave_test_application.h"
+
+namespace asylo {
+
+// Sleeps for the number of milliseconds given as the input test string.
+class TimerTestEnclave : public EnclaveTestCase {
+ public:
+  Status Run(const EnclaveInput &input, EnclaveOutput *) override {
+    const std::string &milliseconds = GetEnclaveInputTestString(input);
+    int64_t duration;
+    if (!absl::SimpleAtoi(milliseconds, &duration) || duration < 0) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Bad sleep duration: ", milliseconds));
+    }
+    struct timespec request;
+    request.tv_sec = duration / 1000;
+    request.tv_nsec = (duration % 1000) * 1000000;
+    if (nanosleep(&request, nullptr) != 0) {
+      return Status(error::GoogleError::INTERNAL, "nanosleep failed");
+    }
+    return Status::OkStatus();
+  }
+};
+
+TrustedApplication *BuildTrustedApplication() { return new TimerTestEnclave; }
+
+}  // namespace asylo
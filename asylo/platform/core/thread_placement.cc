@@ -0,0 +1,146 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/thread_placement.h"
+
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <climits>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Largest number of NUMA nodes supported by the kernel.
+constexpr int kMaxNumaNodes = 1024;
+
+constexpr int kBitsPerWord = sizeof(unsigned long) * CHAR_BIT;
+
+// A node mask in the format expected by the memory policy system calls.
+using NodeMask = std::vector<unsigned long>;
+
+NodeMask EmptyNodeMask() {
+  return NodeMask(kMaxNumaNodes / kBitsPerWord, 0);
+}
+
+}  // namespace
+
+Status SetCurrentThreadCpus(const std::vector<int> &cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Invalid CPU: ", cpu));
+    }
+    CPU_SET(cpu, &cpu_set);
+  }
+  int result =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (result != 0) {
+    return Status(static_cast<error::PosixError>(result),
+                  "pthread_setaffinity_np failed");
+  }
+  return Status::OkStatus();
+}
+
+StatusOr<std::vector<int>> GetCurrentThreadCpus() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  int result =
+      pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (result != 0) {
+    return Status(static_cast<error::PosixError>(result),
+                  "pthread_getaffinity_np failed");
+  }
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+Status SetCurrentThreadPreferredNumaNode(int numa_node) {
+  if (numa_node < 0 || numa_node >= kMaxNumaNodes) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Invalid NUMA node: ", numa_node));
+  }
+  NodeMask mask = EmptyNodeMask();
+  mask[numa_node / kBitsPerWord] |= 1UL << (numa_node % kBitsPerWord);
+  if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(),
+              kMaxNumaNodes + 1) != 0) {
+    return Status(static_cast<error::PosixError>(errno),
+                  "set_mempolicy failed");
+  }
+  return Status::OkStatus();
+}
+
+StatusOr<int> GetCurrentThreadPreferredNumaNode() {
+  int mode = MPOL_DEFAULT;
+  NodeMask mask = EmptyNodeMask();
+  if (syscall(SYS_get_mempolicy, &mode, mask.data(), kMaxNumaNodes + 1,
+              nullptr, 0) != 0) {
+    // Kernels without NUMA support and restrictive seccomp profiles reject
+    // the call. The placement of the thread is then unknown, not an error.
+    if (errno == ENOSYS || errno == EPERM) {
+      return -1;
+    }
+    return Status(static_cast<error::PosixError>(errno),
+                  "get_mempolicy failed");
+  }
+  if (mode != MPOL_PREFERRED) {
+    return -1;
+  }
+  for (int node = 0; node < kMaxNumaNodes; ++node) {
+    if (mask[node / kBitsPerWord] & (1UL << (node % kBitsPerWord))) {
+      return node;
+    }
+  }
+  return -1;
+}
+
+Status ApplyThreadPlacement(const ThreadPlacement &placement) {
+  if (!placement.cpus.empty()) {
+    ASYLO_RETURN_IF_ERROR(SetCurrentThreadCpus(placement.cpus));
+  }
+  if (placement.numa_node >= 0) {
+    ASYLO_RETURN_IF_ERROR(
+        SetCurrentThreadPreferredNumaNode(placement.numa_node));
+  }
+  return Status::OkStatus();
+}
+
+StatusOr<ThreadPlacement> GetCurrentThreadPlacement() {
+  ThreadPlacement placement;
+  ASYLO_ASSIGN_OR_RETURN(placement.cpus, GetCurrentThreadCpus());
+  ASYLO_ASSIGN_OR_RETURN(placement.numa_node,
+                         GetCurrentThreadPreferredNumaNode());
+  return placement;
+}
+
+}  // namespace asylo
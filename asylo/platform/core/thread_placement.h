@@ -0,0 +1,72 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_THREAD_PLACEMENT_H_
+#define ASYLO_PLATFORM_CORE_THREAD_PLACEMENT_H_
+
+#include <vector>
+
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+/// Placement of a host thread on CPUs and NUMA nodes.
+///
+/// Host threads that enter an enclave or service its exits share untrusted
+/// buffers with the enclave. On multi-socket machines, keeping these threads
+/// and the memory they allocate on one NUMA node avoids cross-socket traffic.
+struct ThreadPlacement {
+  /// CPUs the thread may run on. An empty set leaves the CPU affinity of the
+  /// thread unchanged.
+  std::vector<int> cpus;
+
+  /// NUMA node that memory allocated by the thread is preferably placed on. A
+  /// negative value leaves the memory policy of the thread unchanged.
+  int numa_node = -1;
+
+  /// Returns true if this placement does not constrain the thread.
+  bool empty() const { return cpus.empty() && numa_node < 0; }
+};
+
+/// Restricts the calling thread to the CPUs in |cpus|.
+Status SetCurrentThreadCpus(const std::vector<int> &cpus);
+
+/// Returns the CPUs the calling thread may run on, in increasing order.
+StatusOr<std::vector<int>> GetCurrentThreadCpus();
+
+/// Makes the calling thread prefer memory on |numa_node| for its subsequent
+/// allocations.
+Status SetCurrentThreadPreferredNumaNode(int numa_node);
+
+/// Returns the NUMA node preferred by the memory policy of the calling thread,
+/// or -1 if the thread has no preferred node or the node is unknown because
+/// memory policies are not available to the process, for example under a
+/// seccomp profile that blocks them.
+StatusOr<int> GetCurrentThreadPreferredNumaNode();
+
+/// Applies |placement| to the calling thread.
+Status ApplyThreadPlacement(const ThreadPlacement &placement);
+
+/// Returns the CPUs and preferred NUMA node of the calling thread. The node is
+/// -1 if it is not known.
+StatusOr<ThreadPlacement> GetCurrentThreadPlacement();
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_THREAD_PLACEMENT_H_
@@ -0,0 +1,122 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/thread_placement.h"
+
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::Not;
+
+// Runs |test| on a new thread, so that placement changes do not leak into
+// other tests.
+template <typename Function>
+void RunOnNewThread(Function test) {
+  std::thread thread(test);
+  thread.join();
+}
+
+TEST(ThreadPlacementTest, SetsCpuAffinity) {
+  RunOnNewThread([] {
+    auto cpus_result = GetCurrentThreadCpus();
+    ASYLO_ASSERT_OK(cpus_result);
+    ASSERT_THAT(cpus_result.ValueOrDie(), Not(IsEmpty()));
+    int cpu = cpus_result.ValueOrDie().back();
+
+    ASYLO_ASSERT_OK(SetCurrentThreadCpus({cpu}));
+    cpus_result = GetCurrentThreadCpus();
+    ASYLO_ASSERT_OK(cpus_result);
+    EXPECT_THAT(cpus_result.ValueOrDie(), ElementsAre(cpu));
+  });
+}
+
+// Returns true if |status| reports that memory policies are not available to
+// the process.
+bool IsNumaUnavailable(const Status &status) {
+  return status.Is(error::PosixError::P_ENOSYS) ||
+         status.Is(error::PosixError::P_EPERM);
+}
+
+TEST(ThreadPlacementTest, SetsPreferredNumaNode) {
+  RunOnNewThread([] {
+    Status status = SetCurrentThreadPreferredNumaNode(0);
+    if (IsNumaUnavailable(status)) {
+      return;
+    }
+    ASYLO_ASSERT_OK(status);
+    auto node_result = GetCurrentThreadPreferredNumaNode();
+    ASYLO_ASSERT_OK(node_result);
+    EXPECT_THAT(node_result.ValueOrDie(), Eq(0));
+  });
+}
+
+TEST(ThreadPlacementTest, AppliesPlacement) {
+  RunOnNewThread([] {
+    auto cpus_result = GetCurrentThreadCpus();
+    ASYLO_ASSERT_OK(cpus_result);
+    auto node_result = GetCurrentThreadPreferredNumaNode();
+    ASYLO_ASSERT_OK(node_result);
+    ThreadPlacement placement;
+    placement.cpus = {cpus_result.ValueOrDie().front()};
+    ASYLO_ASSERT_OK(ApplyThreadPlacement(placement));
+
+    auto placement_result = GetCurrentThreadPlacement();
+    ASYLO_ASSERT_OK(placement_result);
+    EXPECT_THAT(placement_result.ValueOrDie().cpus, Eq(placement.cpus));
+    EXPECT_THAT(placement_result.ValueOrDie().numa_node,
+                Eq(node_result.ValueOrDie()));
+  });
+}
+
+TEST(ThreadPlacementTest, EmptyPlacementLeavesThreadUnchanged) {
+  RunOnNewThread([] {
+    auto before = GetCurrentThreadPlacement();
+    ASYLO_ASSERT_OK(before);
+    ThreadPlacement placement;
+    EXPECT_TRUE(placement.empty());
+    ASYLO_ASSERT_OK(ApplyThreadPlacement(placement));
+
+    auto after = GetCurrentThreadPlacement();
+    ASYLO_ASSERT_OK(after);
+    EXPECT_THAT(after.ValueOrDie().cpus, Eq(before.ValueOrDie().cpus));
+    EXPECT_THAT(after.ValueOrDie().numa_node,
+                Eq(before.ValueOrDie().numa_node));
+  });
+}
+
+TEST(ThreadPlacementTest, RejectsInvalidPlacement) {
+  EXPECT_THAT(SetCurrentThreadCpus({-1}),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(SetCurrentThreadPreferredNumaNode(-1),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace asylo
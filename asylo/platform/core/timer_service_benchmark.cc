@@ -0,0 +1,142 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the CPU time consumed by many threads that repeatedly sleep for a
+// short interval, comparing the busy-wait used by the enclave nanosleep for
+// short sleeps, a host nanosleep per thread, and threads parked by a
+// TimerService driven by a single HostTimerWaiter. Also reports how late
+// sleepers wake up on average.
+
+#include <sys/resource.h>
+#include <time.h>
+#include <xmmintrin.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "asylo/platform/common/futex.h"
+#include "asylo/platform/common/time_util.h"
+#include "asylo/platform/common/timer_service.h"
+#include "asylo/platform/core/host_timer_waiter.h"
+#include "asylo/util/thread.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(threads, 1000, "Number of sleeping threads");
+DEFINE_int32(sleep_us, 1000, "Length of each sleep in microseconds");
+DEFINE_int32(duration_ms, 1000, "Duration of each measurement");
+
+namespace asylo {
+namespace {
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+// Returns the user and system CPU time consumed by the process so far.
+double CpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Runs FLAGS_threads threads that call |sleep_until| with consecutive
+// deadlines FLAGS_sleep_us apart for FLAGS_duration_ms, then prints the number
+// of cores kept busy and the mean wakeup latency.
+void Benchmark(const char *name,
+               const std::function<void(uint64_t, int64_t)> &sleep_until) {
+  const int64_t interval = FLAGS_sleep_us * INT64_C(1000);
+  const int64_t start = MonotonicClock();
+  const int64_t end = start + FLAGS_duration_ms * INT64_C(1000000);
+  std::atomic<int64_t> total_latency(0);
+  std::atomic<int64_t> sleeps(0);
+
+  double cpu_start = CpuSeconds();
+  std::vector<Thread> threads;
+  threads.reserve(FLAGS_threads);
+  for (int i = 0; i < FLAGS_threads; ++i) {
+    threads.emplace_back([&, i] {
+      int64_t latency = 0;
+      int64_t count = 0;
+      for (int64_t deadline = MonotonicClock() + interval; deadline < end;
+           deadline += interval) {
+        sleep_until(i + 1, deadline);
+        int64_t now = MonotonicClock();
+        latency += now - deadline;
+        ++count;
+        // Skip deadlines missed while the thread was not running.
+        while (deadline + interval < now) {
+          deadline += interval;
+        }
+      }
+      total_latency += latency;
+      sleeps += count;
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  double cpu = CpuSeconds() - cpu_start;
+  double wall = (MonotonicClock() - start) / 1e9;
+
+  std::cout << absl::StrFormat(
+      "%-24s %8.2f cores busy %10.1f us mean wakeup latency\n", name,
+      cpu / wall,
+      sleeps > 0 ? total_latency / 1e3 / sleeps.load() : 0.0);
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  asylo::Benchmark("busy wait", [](uint64_t thread, int64_t deadline) {
+    while (asylo::MonotonicClock() < deadline) {
+      _mm_pause();
+    }
+  });
+
+  asylo::Benchmark("nanosleep per thread", [](uint64_t thread,
+                                              int64_t deadline) {
+    int64_t delay;
+    while ((delay = deadline - asylo::MonotonicClock()) > 0) {
+      struct timespec ts;
+      nanosleep(asylo::NanosecondsToTimeSpec(&ts, delay), nullptr);
+    }
+  });
+
+  asylo::HostTimerWaiter waiter;
+  asylo::TimerService service(
+      {asylo::MonotonicClock, sys_futex_wait, sys_futex_wake, malloc},
+      waiter.channel());
+  asylo::Benchmark("timer service", [&service](uint64_t thread,
+                                              int64_t deadline) {
+    service.SleepUntil(thread, deadline);
+  });
+  std::cout << absl::StrFormat("%-24s %8lu host wakeups\n", "timer service",
+                               waiter.wakeups());
+  return 0;
+}
@@ -19,8 +19,10 @@
 #include "asylo/platform/core/trusted_application.h"
 
 #include <sys/ucontext.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -36,7 +38,10 @@
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/arch/include/trusted/time.h"
 #include "asylo/platform/common/bridge_functions.h"
+#include "asylo/platform/common/enclave_exits.h"
+#include "asylo/platform/common/time_util.h"
 #include "asylo/platform/core/shared_name_kind.h"
+#include "asylo/platform/core/startup_trace.h"
 #include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/platform/core/untrusted_cache_malloc.h"
 #include "asylo/platform/posix/io/io_manager.h"
@@ -68,6 +73,22 @@ void LogError(const Status &status) {
   }
 }
 
+// Copies the startup timeline of the enclave into the buffer the host shares
+// for it while the enclave initializes, if the host registered one.
+void PublishStartupTrace(const std::string &enclave_name, int64_t host_calls) {
+  std::string resource = StartupTraceResourceName(enclave_name);
+  void *address =
+      enc_untrusted_acquire_shared_resource(kAddressName, resource.c_str());
+  if (!address) {
+    return;
+  }
+  if (enc_is_outside_enclave(address, sizeof(StartupTraceBuffer))) {
+    WriteStartupTraceBuffer(GetStartupTimeline()->phases(), host_calls,
+                            static_cast<StartupTraceBuffer *>(address));
+  }
+  enc_untrusted_release_shared_resource(kAddressName, resource.c_str());
+}
+
 // StatusSerializer can be used to serialize a given proto2 message to an
 // untrusted buffer.
 //
@@ -215,32 +236,75 @@ Status InitializeEnvironmentVariables(
   return Status::OkStatus();
 }
 
+constexpr char TrustedApplication::kAssertionAuthoritiesInitTask[];
+
+InitTimeline *GetStartupTimeline() {
+  static InitTimeline *const timeline = new InitTimeline;
+  return timeline;
+}
+
 Status TrustedApplication::InitializeInternal(const EnclaveConfig &config) {
-  InitializeIO(config);
-  Status status =
-      InitializeEnvironmentVariables(config.environment_variables());
-  const char *log_directory = config.logging_config().log_directory().c_str();
-  int vlog_level = config.logging_config().vlog_level();
-  if(!InitLogging(log_directory, GetEnclaveName().c_str(), vlog_level)) {
-    fprintf(stderr, "Initialization of enclave logging failed\n");
-  }
-  if (!status.ok()) {
+  InitTimeline *timeline = GetStartupTimeline();
+
+  // The runtime is set up by a chain of dependent tasks on the initializing
+  // thread, since the ThreadManager does not accept donated threads before the
+  // enclave reaches kUserInitializing.
+  InitGraph runtime;
+  Status environment_status;
+  runtime.AddTask("asylo_io", {}, [&config] {
+    InitializeIO(config);
+    return Status::OkStatus();
+  });
+  runtime.AddTask("asylo_environment", {"asylo_io"},
+                  [&config, &environment_status] {
+                    environment_status = InitializeEnvironmentVariables(
+                        config.environment_variables());
+                    return Status::OkStatus();
+                  });
+  runtime.AddTask("asylo_logging", {"asylo_environment"}, [&config] {
+    const char *log_directory =
+        config.logging_config().log_directory().c_str();
+    int vlog_level = config.logging_config().vlog_level();
+    if (!InitLogging(log_directory, GetEnclaveName().c_str(), vlog_level)) {
+      fprintf(stderr, "Initialization of enclave logging failed\n");
+    }
+    return Status::OkStatus();
+  });
+  ASYLO_RETURN_IF_ERROR(runtime.Run(/*threads=*/1, timeline));
+  if (!environment_status.ok()) {
     LOG(WARNING) << "Initialization of enclave environment variables failed: "
-                 << status;
+                 << environment_status;
   }
   SetEnclaveConfig(config);
-  // This call can fail, but it should not stop the enclave from running.
-  status = InitializeEnclaveAssertionAuthorities(
-      config.enclave_assertion_authority_configs().begin(),
-      config.enclave_assertion_authority_configs().end());
-  if (!status.ok()) {
-    LOG(WARNING) << "Initialization of enclave assertion authorities failed: "
-                 << status;
-  }
 
   ASYLO_RETURN_IF_ERROR(VerifyAndSetState(EnclaveState::kInternalInitializing,
                                           EnclaveState::kUserInitializing));
-  return Initialize(config);
+
+  InitGraph graph;
+  graph.AddTask(kAssertionAuthoritiesInitTask, {}, [&config] {
+    // This call can fail, but it should not stop the enclave from running.
+    Status status = InitializeEnclaveAssertionAuthorities(
+        config.enclave_assertion_authority_configs().begin(),
+        config.enclave_assertion_authority_configs().end());
+    if (!status.ok()) {
+      LOG(WARNING) << "Initialization of enclave assertion authorities failed: "
+                   << status;
+    }
+    return Status::OkStatus();
+  });
+  ASYLO_RETURN_IF_ERROR(RegisterInitializationTasks(config, &graph));
+  ASYLO_RETURN_IF_ERROR(
+      graph.Run(std::max(1, config.initialization_threads()), timeline));
+
+  // Initialize() runs outside of the graph so that its error is returned as is.
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  Status status = Initialize(config);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  timeline->Record({"initialize", TimeSpecToNanoseconds(&start),
+                    TimeSpecToNanoseconds(&end), /*thread=*/0});
+  VLOG(1) << "Enclave startup timeline:\n" << timeline->ToString();
+  return status;
 }
 
 void InitializeIO(const EnclaveConfig &config) {
@@ -299,6 +363,7 @@ int __asylo_user_init(const char *name, const char *config, size_t config_len,
     }
   } init_cleaner;
 
+  int64_t exits_at_entry = EnclaveExitCount();
   Status status = VerifyOutputArguments(output, output_len);
   if (!status.ok()) {
     return 1;
@@ -323,6 +388,7 @@ int __asylo_user_init(const char *name, const char *config, size_t config_len,
   SetEnclaveName(name);
   // Invoke the enclave entry-point.
   status = trusted_application->InitializeInternal(enclave_config);
+  PublishStartupTrace(name, EnclaveExitCount() - exits_at_entry);
   if (!status.ok()) {
     trusted_application->SetState(EnclaveState::kUninitialized);
     return status_serializer.Serialize(status);
@@ -26,6 +26,7 @@
 #include "asylo/enclave.pb.h"
 #include "asylo/platform/arch/fork.pb.h"
 #include "asylo/platform/core/entry_points.h"
+#include "asylo/platform/core/init_graph.h"
 #include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/util/status.h"
 
@@ -88,9 +89,30 @@ class TrustedApplication {
     kFinalized,
   };
 
+  /// Name of the initialization task that initializes the enclave assertion
+  /// authorities. Tasks that attest must list it as a dependency.
+  static constexpr char kAssertionAuthoritiesInitTask[] =
+      "asylo_assertion_authorities";
+
   /// \private
   Status InitializeInternal(const EnclaveConfig &config);
 
+  /// Registers initialization tasks that run in parallel before Initialize().
+  ///
+  /// The tasks run after the I/O, logging, and environment of the enclave are
+  /// set up, on up to `EnclaveConfig.initialization_threads` enclave threads,
+  /// alongside the initialization of the assertion authorities. Initialize()
+  /// runs once all of them have succeeded. Subsystems that are not needed by
+  /// every enclave can instead be initialized on first use with LazyInit.
+  ///
+  /// \param config The configuration used to initialize the enclave.
+  /// \param graph The graph to add tasks to.
+  /// \return An OK status or an error if the tasks could not be registered.
+  virtual Status RegisterInitializationTasks(const EnclaveConfig &config,
+                                             InitGraph *graph) {
+    return Status::OkStatus();
+  }
+
   /// Implements enclave initialization entry-point.
   ///
   /// \param config The configuration used to initialize the enclave.
@@ -173,6 +195,13 @@ TrustedApplication *BuildTrustedApplication();
 /// \relates TrustedApplication
 TrustedApplication *GetApplicationInstance();
 
+/// Returns the timeline of the initialization of the enclave, to which lazily
+/// initialized subsystems may add their own phases.
+///
+/// \return The startup timeline of the enclave.
+/// \relates TrustedApplication
+InitTimeline *GetStartupTimeline();
+
 }  // namespace asylo
 
 #endif  // ASYLO_PLATFORM_CORE_TRUSTED_APPLICATION_H_
@@ -17,6 +17,7 @@
  */
 #include "asylo/platform/core/untrusted_cache_malloc.h"
 
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 
@@ -44,6 +45,8 @@ void untrusted_cache_free(void *buffer) {
 namespace asylo {
 
 bool UntrustedCacheMalloc::is_destroyed = false;
+UntrustedCacheMalloc::RetiredSlabs *UntrustedCacheMalloc::retired_slabs =
+    nullptr;
 
 UntrustedCacheMalloc *UntrustedCacheMalloc::Instance() {
   static UntrustedCacheMalloc *instance = new UntrustedCacheMalloc();
@@ -54,59 +57,77 @@ UntrustedCacheMalloc::UntrustedCacheMalloc() {
   if (is_destroyed) {
     return;
   }
-  // Initialize a free list object in the trusted heap. The free list object
+  // Initialize a free queue object in the trusted heap. The free queue object
   // stores an array of buffers stored in the untrusted heap.
-  free_list_ = absl::make_unique<FreeList>();
-  free_list_->buffers.reset(reinterpret_cast<void**>(enc_untrusted_malloc(
-      sizeof(void*) * kFreeListCapacity)));
-  free_list_->count = 0;
+  free_queue_ = absl::make_unique<UntrustedFreeQueue>(kFreeListCapacity);
 }
 
 UntrustedCacheMalloc::~UntrustedCacheMalloc() {
-  while (!buffer_pool_.empty()) {
-    PushToFreeList(buffer_pool_.top());
-    buffer_pool_.pop();
-  }
-
-  // Free remaining elements in the free_list_.
-  // The free_list_ object and the struct FreeList member buffers are destroyed
-  // when the unique pointers referencing them go out of scope.
-  if (free_list_->count > 0) {
-    enc_untrusted_deallocate_free_list(free_list_->buffers.get(),
-                                       free_list_->count);
+  // Free remaining elements in the free_queue_.
+  free_queue_.reset();
+
+  // Pool buffers are carved out of slabs, so a slab can only be unmapped once
+  // none of its buffers are in use. Buffers still held by clients keep every
+  // slab mapped until the last of them is freed.
+  if (busy_buffers_.empty()) {
+    for (const Slab &slab : slabs_) {
+      enc_untrusted_deallocate_slab(slab.base, kPoolIncrement, slab.stride);
+    }
+  } else {
+    RetiredSlabs *retired = new RetiredSlabs;
+    retired->slabs = slabs_;
+    retired->busy_count = busy_buffers_.size();
+    retired_slabs = retired;
   }
   is_destroyed = true;
 }
 
 void *UntrustedCacheMalloc::GetBuffer() {
-  void **buffers = nullptr;
-  void *buffer;
-  bool is_pool_empty;
-
-  {
-    ScopedSpinLock spin_lock(&lock_);
-    is_pool_empty = buffer_pool_.empty();
-    if (is_pool_empty) {
-      buffers = enc_untrusted_allocate_buffers(kPoolIncrement, kPoolEntrySize);
-      for (int i = 0; i < kPoolIncrement; i++) {
-        if (!buffers[i]
-            || !enc_is_outside_enclave(buffers[i], kPoolEntrySize)) {
-          abort();
-        }
-        buffer_pool_.push(buffers[i]);
-      }
+  ScopedSpinLock spin_lock(&lock_);
+  if (buffer_pool_.empty()) {
+    // Map a whole pool increment at once and validate it with a single range
+    // check rather than one check per buffer.
+    Slab slab;
+    slab.base = enc_untrusted_allocate_slab(kPoolIncrement, kPoolEntrySize,
+                                            &slab.stride);
+    if (!slab.base ||
+        !enc_is_outside_enclave(slab.base, kPoolIncrement * slab.stride)) {
+      abort();
+    }
+    slabs_.push_back(slab);
+    uint8_t *base = reinterpret_cast<uint8_t *>(slab.base);
+    for (size_t i = kPoolIncrement; i > 0; i--) {
+      buffer_pool_.push(base + (i - 1) * slab.stride);
     }
-    buffer = buffer_pool_.top();
-    buffer_pool_.pop();
-    busy_buffers_.insert(buffer);
   }
+  void *buffer = buffer_pool_.top();
+  buffer_pool_.pop();
+  busy_buffers_.insert(buffer);
+  return buffer;
+}
 
-  if (is_pool_empty) {
-    // Free memory held by the array of buffer pointers returned by
-    // enc_untrusted_allocate_buffers.
-    Free(buffers);
+bool UntrustedCacheMalloc::FreeRetiredBuffer(void *buffer) {
+  RetiredSlabs *retired = retired_slabs;
+  if (!retired) {
+    return false;
   }
-  return buffer;
+  ScopedSpinLock spin_lock(&retired->lock);
+  uint8_t *address = reinterpret_cast<uint8_t *>(buffer);
+  for (const Slab &slab : retired->slabs) {
+    uint8_t *base = reinterpret_cast<uint8_t *>(slab.base);
+    if (address < base || address >= base + kPoolIncrement * slab.stride) {
+      continue;
+    }
+    if (--retired->busy_count == 0) {
+      for (const Slab &unmapped : retired->slabs) {
+        enc_untrusted_deallocate_slab(unmapped.base, kPoolIncrement,
+                                      unmapped.stride);
+      }
+      retired->slabs.clear();
+    }
+    return true;
+  }
+  return false;
 }
 
 void *UntrustedCacheMalloc::Malloc(size_t size) {
@@ -116,33 +137,27 @@ void *UntrustedCacheMalloc::Malloc(size_t size) {
   return GetBuffer();
 }
 
-void UntrustedCacheMalloc::PushToFreeList(void *buffer) {
-  free_list_->buffers.get()[free_list_->count] = buffer;
-  free_list_->count++;
-
-  if (free_list_->count == kFreeListCapacity) {
-    enc_untrusted_deallocate_free_list(free_list_->buffers.get(),
-                                       kFreeListCapacity);
-    free_list_->count = 0;
-  }
-}
-
 void UntrustedCacheMalloc::Free(void *buffer) {
   if (is_destroyed) {
-    enc_untrusted_free(buffer);
+    // Pool buffers live in host-mapped slabs and must never reach the host
+    // free().
+    if (!FreeRetiredBuffer(buffer)) {
+      enc_untrusted_free(buffer);
+    }
     return;
   }
-  ScopedSpinLock spin_lock(&lock_);
-
-  // Add the buffer to the free list if it was not allocated from the buffer
-  // pool and was allocated via the enc_untrusted_malloc host call. If the
-  // buffer was allocated from the buffer pool push it back to the pool.
-  if (busy_buffers_.find(buffer) == busy_buffers_.end()) {
-    PushToFreeList(buffer);
-    return;
+  {
+    ScopedSpinLock spin_lock(&lock_);
+    // If the buffer was allocated from the buffer pool push it back to the
+    // pool.
+    if (busy_buffers_.erase(buffer) > 0) {
+      buffer_pool_.push(buffer);
+      return;
+    }
   }
-  busy_buffers_.erase(buffer);
-  buffer_pool_.push(buffer);
+  // Otherwise the buffer was allocated via the enc_untrusted_malloc host call
+  // or by the host, so add it to the free queue.
+  free_queue_->Push(buffer);
 }
 
 }  // namespace asylo
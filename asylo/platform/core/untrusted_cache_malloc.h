@@ -21,10 +21,12 @@
 
 #include <cstddef>
 #include <stack>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/common/spin_lock.h"
+#include "asylo/platform/core/untrusted_free_queue.h"
 #include "asylo/platform/primitives/util/trusted_memory.h"
 
 namespace asylo {
@@ -35,7 +37,9 @@ namespace asylo {
 //
 // For smaller allocations, the implementation allocates memory from a buffer
 // pool maintained by the class. The buffer pool is implemented as a stack
-// of untrusted buffers.
+// of untrusted buffers. Pool buffers are carved out of slabs mapped by the
+// host, preferably backed by huge pages, which are never returned to the host
+// while the singleton is alive.
 //
 // This class is initialized in the trusted space and manages the buffers
 // in untrusted memory 1) assigning buffers to threads requesting memory and
@@ -59,13 +63,27 @@ class UntrustedCacheMalloc {
   //   * If the host call fails for any reason (this may be backend-specific)
   void *Malloc(size_t size);
 
-  // Releases memory on the untrusted heap.
+  // Releases memory on the untrusted heap. Buffers that were not allocated
+  // from the buffer pool, including buffers allocated by the host, are queued
+  // and freed in batches.
   void Free(void *buffer);
 
+  // Returns the queue of untrusted buffers waiting to be freed.
+  UntrustedFreeQueue *free_queue() { return free_queue_.get(); }
+
  private:
-  struct FreeList {
-    UntrustedUniquePtr<void*> buffers;
-    int count;
+  // A contiguous run of kPoolIncrement pool buffers, |stride| bytes apart.
+  struct Slab {
+    void *base;
+    size_t stride;
+  };
+
+  // Slabs of a destroyed instance that still back buffers in use, and the
+  // number of those buffers.
+  struct RetiredSlabs {
+    SpinLock lock;
+    std::vector<Slab> slabs;
+    size_t busy_count;
   };
 
   SpinLock lock_;
@@ -76,8 +94,8 @@ class UntrustedCacheMalloc {
   // Size of a buffer pool entry in bytes.
   static constexpr size_t kPoolEntrySize = 4096;
 
-  // Maximum entries in the free list. When this limit is reached, all memory
-  // held by the pointers in the free list is freed.
+  // Maximum entries in the free queue. When this limit is reached, all memory
+  // held by the pointers in the free queue is freed.
   static constexpr size_t kFreeListCapacity = 1024;
 
   // Defaults to false. Set to true when the singleton class object is
@@ -85,6 +103,11 @@ class UntrustedCacheMalloc {
   // (de)allocation to the native malloc/free implementation.
   static bool is_destroyed;
 
+  // Slabs kept mapped by the destroyed instance, or nullptr if there are none.
+  // Pool buffers freed after destruction are released here rather than on the
+  // host heap, and the slabs are unmapped once the last of them is freed.
+  static RetiredSlabs *retired_slabs;
+
   UntrustedCacheMalloc();
 
   // Returns a buffer from the pool. If no buffers are available in the pool,
@@ -92,14 +115,12 @@ class UntrustedCacheMalloc {
   // returning the buffer.
   void *GetBuffer();
 
-  // Pushes |buffer| to the free list. If the free list capacity is reached,
-  // this function is also responsible for first emptying the free list by
-  // freeing all buffer pointers stored in the list before pushing |buffer| to
-  // the list.
-  void PushToFreeList(void *buffer);
+  // Releases a pool buffer freed after the instance is destroyed. Returns false
+  // if |buffer| does not belong to a retired slab.
+  static bool FreeRetiredBuffer(void *buffer);
 
-  // List of pointers to untrusted buffers which need to be freed.
-  std::unique_ptr<FreeList> free_list_;
+  // Queue of untrusted buffers which need to be freed.
+  std::unique_ptr<UntrustedFreeQueue> free_queue_;
 
   // Pool of pointers to free buffers allocated on the untrusted heap. The
   // buffer pool is implemented as a stack. This allows for a warmer cache as a
@@ -107,6 +128,9 @@ class UntrustedCacheMalloc {
   // reassigned to a thread requesting a buffer.
   std::stack<void *> buffer_pool_;
 
+  // Slabs backing the buffer pool.
+  std::vector<Slab> slabs_;
+
   // Set of buffers returned to and owned by buffer pool clients.
   absl::flat_hash_set<void *> busy_buffers_;
 };
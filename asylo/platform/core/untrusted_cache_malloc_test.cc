@@ -67,5 +67,20 @@ TEST_F(UntrustedCacheMallocTest, StressTest) {
   }
 }
 
+// Destroys the singleton, after which every call is served by the host heap.
+TEST_F(UntrustedCacheMallocTest, FreePoolBufferAfterDestruction) {
+  void *pool_buffer = untrusted_cache_malloc_->Malloc(1);
+  void *host_buffer = untrusted_cache_malloc_->Malloc(1 << 16);
+  delete untrusted_cache_malloc_;
+
+  // The pool buffer is returned to its slab rather than to the host free().
+  untrusted_cache_malloc_->Free(pool_buffer);
+  untrusted_cache_malloc_->Free(host_buffer);
+
+  void *buffer = untrusted_cache_malloc_->Malloc(1);
+  EXPECT_NE(buffer, nullptr);
+  untrusted_cache_malloc_->Free(buffer);
+}
+
 }  // namespace
 }  // namespace asylo
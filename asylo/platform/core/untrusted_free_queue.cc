@@ -0,0 +1,68 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/untrusted_free_queue.h"
+
+#include "asylo/platform/arch/include/trusted/host_calls.h"
+
+namespace asylo {
+
+UntrustedFreeQueue::UntrustedFreeQueue(size_t capacity)
+    : capacity_(capacity),
+      buffers_(reinterpret_cast<void **>(
+          enc_untrusted_malloc(sizeof(void *) * capacity))) {}
+
+UntrustedFreeQueue::~UntrustedFreeQueue() {
+  Flush();
+  enc_untrusted_free(buffers_);
+}
+
+void UntrustedFreeQueue::Push(void *buffer) {
+  ScopedSpinLock spin_lock(&lock_);
+  buffers_[count_] = buffer;
+  count_++;
+  buffers_queued_++;
+  if (count_ == capacity_) {
+    FlushLocked();
+  }
+}
+
+void UntrustedFreeQueue::Flush() {
+  ScopedSpinLock spin_lock(&lock_);
+  FlushLocked();
+}
+
+UntrustedFreeQueue::Stats UntrustedFreeQueue::GetStats() {
+  ScopedSpinLock spin_lock(&lock_);
+  Stats stats;
+  stats.buffers_queued = buffers_queued_;
+  stats.host_calls = host_calls_;
+  stats.buffers_pending = count_;
+  return stats;
+}
+
+void UntrustedFreeQueue::FlushLocked() {
+  if (count_ == 0) {
+    return;
+  }
+  enc_untrusted_deallocate_free_list(buffers_, count_);
+  count_ = 0;
+  host_calls_++;
+}
+
+}  // namespace asylo
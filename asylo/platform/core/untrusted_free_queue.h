@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_UNTRUSTED_FREE_QUEUE_H_
+#define ASYLO_PLATFORM_CORE_UNTRUSTED_FREE_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/platform/common/spin_lock.h"
+
+namespace asylo {
+
+// A queue of buffers on the untrusted heap waiting to be freed. Freeing an
+// untrusted buffer from trusted code costs an enclave exit, so rather than
+// freeing each buffer the host returns with its own host call, trusted code
+// pushes it to the queue. The queue releases every queued buffer with a single
+// host call once |capacity| buffers are queued, when Flush() is called, or when
+// the queue is destroyed.
+//
+// The queue itself is an array of pointers in untrusted memory, so that the
+// host can read it directly. The class is thread-safe.
+class UntrustedFreeQueue {
+ public:
+  // Counters describing the frees handled by a queue.
+  struct Stats {
+    // Number of buffers pushed to the queue.
+    uint64_t buffers_queued;
+
+    // Number of host calls made to free queued buffers.
+    uint64_t host_calls;
+
+    // Number of buffers queued but not yet freed.
+    uint64_t buffers_pending;
+
+    // Number of enclave exits saved compared to freeing every buffer with its
+    // own host call.
+    uint64_t ExitsSaved() const {
+      return buffers_queued - buffers_pending - host_calls;
+    }
+  };
+
+  explicit UntrustedFreeQueue(size_t capacity);
+  UntrustedFreeQueue(const UntrustedFreeQueue &) = delete;
+  UntrustedFreeQueue &operator=(const UntrustedFreeQueue &) = delete;
+
+  // Frees all buffers still in the queue.
+  ~UntrustedFreeQueue();
+
+  // Queues |buffer|, which must have been allocated on the untrusted heap, to
+  // be freed. Frees every queued buffer if the queue is full.
+  void Push(void *buffer);
+
+  // Frees every queued buffer with a single host call, if any are queued.
+  void Flush();
+
+  // Returns the counters of this queue.
+  Stats GetStats();
+
+ private:
+  // Frees every queued buffer. Must be called with |lock_| held.
+  void FlushLocked();
+
+  SpinLock lock_;
+
+  // Maximum number of buffers queued before the queue is flushed.
+  const size_t capacity_;
+
+  // Array of |capacity_| pointers to queued buffers, allocated on the
+  // untrusted heap.
+  void **buffers_;
+
+  // Number of entries of |buffers_| in use.
+  size_t count_ = 0;
+
+  uint64_t buffers_queued_ = 0;
+  uint64_t host_calls_ = 0;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_UNTRUSTED_FREE_QUEUE_H_
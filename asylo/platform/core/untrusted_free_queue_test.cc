@@ -0,0 +1,88 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/untrusted_free_queue.h"
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/core/untrusted_cache_malloc.h"
+
+namespace asylo {
+namespace {
+
+constexpr size_t kCapacity = 16;
+
+TEST(UntrustedFreeQueueTest, FreesFullBatchesWithOneHostCall) {
+  UntrustedFreeQueue queue(kCapacity);
+  for (size_t i = 0; i < 2 * kCapacity + 1; ++i) {
+    queue.Push(enc_untrusted_malloc(64));
+  }
+  UntrustedFreeQueue::Stats stats = queue.GetStats();
+  EXPECT_EQ(stats.buffers_queued, 2 * kCapacity + 1);
+  EXPECT_EQ(stats.host_calls, 2);
+  EXPECT_EQ(stats.buffers_pending, 1);
+  EXPECT_EQ(stats.ExitsSaved(), 2 * kCapacity - 2);
+
+  queue.Flush();
+  stats = queue.GetStats();
+  EXPECT_EQ(stats.host_calls, 3);
+  EXPECT_EQ(stats.buffers_pending, 0);
+  EXPECT_EQ(stats.ExitsSaved(), 2 * kCapacity - 2);
+
+  // Flushing an empty queue does not exit the enclave.
+  queue.Flush();
+  EXPECT_EQ(queue.GetStats().host_calls, 3);
+}
+
+TEST(UntrustedFreeQueueTest, ConcurrentPushes) {
+  constexpr int kThreads = 8;
+  constexpr int kBuffersPerThread = 100;
+  UntrustedFreeQueue queue(kCapacity);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&queue] {
+      for (int j = 0; j < kBuffersPerThread; ++j) {
+        queue.Push(enc_untrusted_malloc(64));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  UntrustedFreeQueue::Stats stats = queue.GetStats();
+  EXPECT_EQ(stats.buffers_queued, kThreads * kBuffersPerThread);
+  EXPECT_EQ(stats.host_calls, kThreads * kBuffersPerThread / kCapacity);
+  EXPECT_EQ(stats.buffers_pending, kThreads * kBuffersPerThread % kCapacity);
+}
+
+// Buffers the host allocates are queued by the untrusted memory cache rather
+// than freed one host call at a time.
+TEST(UntrustedFreeQueueTest, CacheQueuesHostBuffers) {
+  UntrustedFreeQueue *queue = UntrustedCacheMalloc::Instance()->free_queue();
+  UntrustedFreeQueue::Stats before = queue->GetStats();
+  untrusted_cache_free(enc_untrusted_malloc(64));
+  UntrustedFreeQueue::Stats after = queue->GetStats();
+  EXPECT_EQ(after.buffers_queued, before.buffers_queued + 1);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,161 @@
+#
+#
+# Copyright 2019 Asylo authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+r"""Generate untrusted exit handlers for host calls.
+
+This script reads a list of host call declarations from stdin and writes C++
+code implementing one exit handler per host call to stdout. Each handler checks
+the number of parameters on the stack, decodes every parameter into a local of
+its declared type, calls the host function, and writes the result over the
+storage of the first parameter, so that dispatching a host call does not
+allocate.
+
+For example, given a declaration like:
+
+  HOST_CALL(kIsAttyHandler, IsAtty, int, isatty, int, fd)
+
+This script will emit C++ code like:
+
+  Status IsAttyDispatcher(const std::shared_ptr<primitives::Client> &client,
+                          void *context,
+                          primitives::NativeParameterStack *parameters) {
+    ASYLO_RETURN_IF_INCORRECT_ARGUMENTS(parameters, 1);
+    int fd{};
+    ASYLO_RETURN_IF_ERROR(internal::ReadTopArgument(parameters, &fd));
+    internal::WriteResult<int>(parameters, ::isatty(fd));
+    return Status::OkStatus();
+  }
+
+along with a RegisterHostCallDispatchers function registering each handler for
+its selector. Please see untrusted/host_call_dispatchers.h for the helpers used
+by the generated code.
+"""
+
+from __future__ import print_function
+
+import re
+import sys
+
+
+class HostCallTable(object):
+  """A collection of host call declarations."""
+
+  def __init__(self, input_stream):
+    """Parses a stream of host call declarations from an input stream."""
+    self.declarations = input_stream.read()
+
+    # Discard comments.
+    self.declarations = re.sub(
+        re.compile('//.*$', re.MULTILINE), '', self.declarations)
+
+    # A list of (selector, name, return type, function, parameters) tuples,
+    # where parameters is a list of (type, name) pairs.
+    self.host_calls = []
+
+    self.parse_includes()
+    self.parse_host_calls()
+
+  def parse_includes(self):
+    """Collect each 'INCLUDE' directive in the input stream."""
+
+    pattern = re.compile(r'INCLUDE\(\s*\"([^)]*)\"\s*\)')
+    self.includes = re.findall(pattern, self.declarations)
+
+  def parse_host_calls(self):
+    """Parse each 'HOST_CALL' directive in the input stream."""
+
+    pattern = re.compile(r'HOST_CALL\s*\(([^)]*)\)', re.MULTILINE)
+    for definition in re.findall(pattern, self.declarations):
+      split = [item.strip() for item in definition.split(',')]
+
+      # 'split' is expected to begin with a selector, a name, a return type and
+      # a function, followed by one or more parameter type, parameter name
+      # values at consecutive offsets into the list.
+      if len(split) < 6 or len(split) % 2 != 0:
+        raise ValueError('Could not parse definition: ' + definition)
+
+      selector, name, return_type, function = split[:4]
+      parameters = [(split[i], split[i + 1]) for i in range(4, len(split), 2)]
+      self.host_calls.append(
+          (selector, name, return_type, function, parameters))
+
+  def write_includes(self):
+    """Emits the #include directives required by the generated code."""
+    print('#include "asylo/platform/host_call/exit_handler_constants.h"')
+    print('#include "asylo/platform/host_call/untrusted/'
+          'host_call_dispatchers.h"')
+    print('#include "asylo/util/status_macros.h"')
+    print()
+    for include in self.includes:
+      print('#include <{}>'.format(include))
+
+  def write_dispatcher(self, name, return_type, function, parameters):
+    """Emits the exit handler for a single host call."""
+    print('Status {}Dispatcher('.format(name))
+    print('    const std::shared_ptr<primitives::Client> &client, '
+          'void *context,')
+    print('    primitives::NativeParameterStack *parameters) {')
+    print('  ASYLO_RETURN_IF_INCORRECT_ARGUMENTS(parameters, {});'.format(
+        len(parameters)))
+    for parameter_type, parameter_name in parameters:
+      print('  {} {}{{}};'.format(parameter_type, parameter_name))
+
+    # The last parameter is at the top of the stack. Pop every parameter but
+    # the first, whose storage is reused for the result.
+    for parameter_type, parameter_name in reversed(parameters[1:]):
+      print('  ASYLO_RETURN_IF_ERROR(internal::PopArgument(parameters, &{}));'
+            .format(parameter_name))
+    print('  ASYLO_RETURN_IF_ERROR(internal::ReadTopArgument(parameters, &{}));'
+          .format(parameters[0][1]))
+    print('  internal::WriteResult<{}>(parameters, ::{}({}));'.format(
+        return_type, function,
+        ', '.join(parameter_name for _, parameter_name in parameters)))
+    print('  return Status::OkStatus();')
+    print('}')
+
+  def write_registration(self):
+    """Emits a function registering every generated exit handler."""
+    print('Status RegisterHostCallDispatchers(')
+    print('    primitives::Client::ExitCallProvider *exit_call_provider) {')
+    for selector, name, _, _, _ in self.host_calls:
+      print('  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(')
+      print('      {}, primitives::ExitHandler{{{}Dispatcher}}));'.format(
+          selector, name))
+    print('  return Status::OkStatus();')
+    print('}')
+
+  def write_dispatchers(self):
+    print('// Generated by generate_dispatchers.py. Do not edit.')
+    print()
+    self.write_includes()
+    print()
+    print('namespace asylo {')
+    print('namespace host_call {')
+    print('namespace {')
+    print()
+    for _, name, return_type, function, parameters in self.host_calls:
+      self.write_dispatcher(name, return_type, function, parameters)
+      print()
+    print('}  // namespace')
+    print()
+    self.write_registration()
+    print()
+    print('}  // namespace host_call')
+    print('}  // namespace asylo')
+
+
+host_calls = HostCallTable(sys.stdin)
+host_calls.write_dispatchers()
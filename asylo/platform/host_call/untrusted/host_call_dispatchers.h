@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_HOST_CALL_DISPATCHERS_H_
+#define ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_HOST_CALL_DISPATCHERS_H_
+
+#include <cstring>
+#include <memory>
+
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/parameter_stack.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace host_call {
+
+// Registers the exit handlers generated from host_call_spec.txt with
+// |exit_call_provider|. Each handler decodes the parameters of its host call
+// into typed values, calls the host function, and writes the result over the
+// storage of the first parameter, leaving the result alone on the stack.
+// Dispatching a host call through these handlers does not allocate.
+Status RegisterHostCallDispatchers(
+    primitives::Client::ExitCallProvider *exit_call_provider);
+
+namespace internal {
+
+// Checks that |extent| holds exactly a value of type T.
+template <typename T>
+Status CheckArgumentSize(const primitives::Extent &extent) {
+  if (extent.size() != sizeof(T)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Host call parameter has an unexpected size.");
+  }
+  return Status::OkStatus();
+}
+
+// Pops the parameter at the top of |parameters| into |value|.
+template <typename T>
+Status PopArgument(primitives::NativeParameterStack *parameters, T *value) {
+  auto extent = parameters->Pop();
+  Status status = CheckArgumentSize<T>(*extent);
+  if (status.ok()) {
+    memcpy(value, extent->data(), sizeof(T));
+  }
+  return status;
+}
+
+// Reads the parameter at the top of |parameters| into |value|, leaving it on
+// the stack so that its storage can hold the result.
+template <typename T>
+Status ReadTopArgument(primitives::NativeParameterStack *parameters,
+                       T *value) {
+  const primitives::Extent *extent = parameters->MutableTop();
+  Status status = CheckArgumentSize<T>(*extent);
+  if (status.ok()) {
+    memcpy(value, extent->data(), sizeof(T));
+  }
+  return status;
+}
+
+// Replaces the parameter at the top of |parameters| with |result|, reusing its
+// storage when it is large enough.
+template <typename T>
+void WriteResult(primitives::NativeParameterStack *parameters, T result) {
+  primitives::Extent *extent = parameters->MutableTop();
+  if (extent->size() >= sizeof(T)) {
+    memcpy(extent->data(), &result, sizeof(T));
+    *extent = primitives::Extent{extent->data(), sizeof(T)};
+    return;
+  }
+  parameters->Pop();
+  parameters->PushByCopy(result);
+}
+
+}  // namespace internal
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_HOST_CALL_DISPATCHERS_H_
@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/untrusted/host_call_dispatchers.h"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/untrusted/host_call_handlers.h"
+#include "asylo/platform/primitives/parameter_stack.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace host_call {
+namespace {
+
+class HostCallDispatchersTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASYLO_ASSERT_OK(RegisterHostCallDispatchers(&dispatch_table_));
+  }
+
+  Status Dispatch(uint64_t selector,
+                  primitives::NativeParameterStack *parameters) {
+    return dispatch_table_.InvokeExitHandler(selector, parameters,
+                                             client_.get());
+  }
+
+  // Calls the generated handler for |selector| and the generic |handler| with
+  // the single argument |argument|, and expects both to return |expected|.
+  template <typename T>
+  void ExpectSameResult(uint64_t selector,
+                        const primitives::ExitHandler &handler, T argument,
+                        int expected) {
+    primitives::NativeParameterStack generated_parameters;
+    generated_parameters.PushByCopy(argument);
+    ASYLO_ASSERT_OK(Dispatch(selector, &generated_parameters));
+    ASSERT_EQ(generated_parameters.size(), 1);
+    EXPECT_EQ(generated_parameters.Top().size(), sizeof(int));
+    EXPECT_EQ(generated_parameters.Pop<int>(), expected);
+
+    primitives::NativeParameterStack generic_parameters;
+    generic_parameters.PushByCopy(argument);
+    ASYLO_ASSERT_OK(handler.callback(client_, nullptr, &generic_parameters));
+    ASSERT_EQ(generic_parameters.size(), 1);
+    EXPECT_EQ(generic_parameters.Pop<int>(), expected);
+  }
+
+  class FakeClient : public primitives::Client {
+   public:
+    FakeClient() : primitives::Client(/*name=*/"fake", nullptr) {}
+
+    bool IsClosed() const override { return false; }
+    Status Destroy() override { return Status::OkStatus(); }
+    Status EnclaveCallInternal(
+        uint64_t selector, primitives::NativeParameterStack *params) override {
+      return Status::OkStatus();
+    }
+  };
+
+  primitives::DispatchTable dispatch_table_;
+  std::shared_ptr<primitives::Client> client_ = std::make_shared<FakeClient>();
+};
+
+TEST_F(HostCallDispatchersTest, RegistersEveryHostCall) {
+  EXPECT_THAT(dispatch_table_.RegisterExitHandler(
+                  kIsAttyHandler, primitives::ExitHandler{nullptr}),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+  EXPECT_THAT(dispatch_table_.RegisterExitHandler(
+                  kUSleepHandler, primitives::ExitHandler{nullptr}),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+}
+
+TEST_F(HostCallDispatchersTest, IsAttyMatchesGenericHandler) {
+  const primitives::ExitHandler handler{IsAttyHandler};
+  ExpectSameResult(kIsAttyHandler, handler, -1, 0);
+  ExpectSameResult(kIsAttyHandler, handler, 0, isatty(0));
+}
+
+TEST_F(HostCallDispatchersTest, USleepMatchesGenericHandler) {
+  const primitives::ExitHandler handler{USleepHandler};
+  ExpectSameResult<useconds_t>(kUSleepHandler, handler, 0, 0);
+}
+
+// The result is written over the argument rather than to a new extent.
+TEST_F(HostCallDispatchersTest, WritesResultInPlace) {
+  primitives::NativeParameterStack parameters;
+  parameters.PushByCopy(-1);
+  const void *argument_data = parameters.Top().data();
+  ASYLO_ASSERT_OK(Dispatch(kIsAttyHandler, &parameters));
+  ASSERT_EQ(parameters.size(), 1);
+  EXPECT_EQ(parameters.Top().data(), argument_data);
+}
+
+// A result larger than the argument is written to a new extent.
+TEST(HostCallDispatchersHelpersTest, WritesLargeResultToNewExtent) {
+  primitives::NativeParameterStack parameters;
+  parameters.PushByCopy<int32_t>(1);
+  int32_t argument;
+  ASYLO_ASSERT_OK(internal::ReadTopArgument(&parameters, &argument));
+  EXPECT_EQ(argument, 1);
+  internal::WriteResult<int64_t>(&parameters, INT64_MAX);
+  ASSERT_EQ(parameters.size(), 1);
+  EXPECT_EQ(parameters.Pop<int64_t>(), INT64_MAX);
+}
+
+TEST_F(HostCallDispatchersTest, RejectsIncorrectParameterCount) {
+  primitives::NativeParameterStack parameters;
+  EXPECT_THAT(Dispatch(kIsAttyHandler, &parameters),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  parameters.PushByCopy(1);
+  parameters.PushByCopy(2);
+  EXPECT_THAT(Dispatch(kIsAttyHandler, &parameters),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+// Unlike the generic handlers, the generated ones check the size of each
+// parameter before decoding it.
+TEST_F(HostCallDispatchersTest, RejectsIncorrectParameterSize) {
+  primitives::NativeParameterStack parameters;
+  parameters.PushByCopy<int64_t>(0);
+  EXPECT_THAT(Dispatch(kIsAttyHandler, &parameters),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  primitives::NativeParameterStack short_parameters;
+  short_parameters.PushByCopy<uint8_t>(0);
+  EXPECT_THAT(Dispatch(kUSleepHandler, &short_parameters),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace host_call
+}  // namespace asylo
@@ -18,6 +18,7 @@
 
 #include "asylo/platform/host_call/untrusted/host_call_handlers_initializer.h"
 #include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/untrusted/host_call_dispatchers.h"
 #include "asylo/platform/host_call/untrusted/host_call_handlers.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
@@ -33,11 +34,9 @@ GetHostCallHandlersMapping() {
   ASYLO_RETURN_IF_ERROR(dispatch_table->RegisterExitHandler(
       kSystemCallHandler, primitives::ExitHandler{SystemCallHandler}));
 
-  ASYLO_RETURN_IF_ERROR(dispatch_table->RegisterExitHandler(
-      kIsAttyHandler, primitives::ExitHandler{IsAttyHandler}));
-
-  ASYLO_RETURN_IF_ERROR(dispatch_table->RegisterExitHandler(
-      kUSleepHandler, primitives::ExitHandler{USleepHandler}));
+  // The remaining host calls are dispatched by handlers generated from
+  // host_call_spec.txt.
+  ASYLO_RETURN_IF_ERROR(RegisterHostCallDispatchers(dispatch_table.get()));
 
   return std::move(dispatch_table);
 }
@@ -0,0 +1,113 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/host_info_snapshot.h"
+
+#include <errno.h>
+#include <pwd.h>
+#include <sched.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "absl/memory/memory.h"
+#include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/common/host_info_util.h"
+#include "asylo/platform/core/trusted_global_state.h"
+#include "asylo/util/posix_error_space.h"
+
+namespace asylo {
+namespace {
+
+// The snapshot installed by the latest call to RefreshHostInfoSnapshot(), which
+// takes precedence over the one in the enclave config. Replaced snapshots are
+// leaked, since callers may still be reading them.
+std::atomic<const HostInfo *> refreshed_snapshot(nullptr);
+
+// Returns an error describing a failed host call from errno. A call that
+// failed without setting errno yields an INTERNAL error rather than an OK
+// status.
+Status HostCallError(const char *message) {
+  if (errno == 0) {
+    return Status(error::GoogleError::INTERNAL, message);
+  }
+  return Status(static_cast<error::PosixError>(errno), message);
+}
+
+}  // namespace
+
+const HostInfo *GetHostInfoSnapshot(HostInfo::Field field) {
+  StatusOr<const EnclaveConfig *> config_result = GetEnclaveConfig();
+  if (!config_result.ok()) {
+    return nullptr;
+  }
+  const EnclaveConfig *config = config_result.ValueOrDie();
+  for (int live_field : config->live_host_info()) {
+    if (live_field == field) {
+      return nullptr;
+    }
+  }
+
+  const HostInfo *refreshed =
+      refreshed_snapshot.load(std::memory_order_acquire);
+  if (refreshed) {
+    return refreshed;
+  }
+  if (!config->host_config().has_host_info()) {
+    return nullptr;
+  }
+  return &config->host_config().host_info();
+}
+
+Status RefreshHostInfoSnapshot() {
+  auto info = absl::make_unique<HostInfo>();
+
+  struct utsname utsname;
+  if (enc_untrusted_uname(&utsname) != 0) {
+    return HostCallError("uname failed on the host");
+  }
+  UtsNameToHostInfo(utsname, info.get());
+
+  // sysconf does not set errno for an indeterminate value.
+  errno = 0;
+  int64_t nprocessors_conf = enc_untrusted_sysconf(_SC_NPROCESSORS_CONF);
+  int64_t nprocessors_onln = enc_untrusted_sysconf(_SC_NPROCESSORS_ONLN);
+  if (nprocessors_conf <= 0 || nprocessors_onln <= 0) {
+    return HostCallError("sysconf failed on the host");
+  }
+  info->set_nprocessors_conf(nprocessors_conf);
+  info->set_nprocessors_onln(nprocessors_onln);
+
+  // The host user may have no password database entry, which is not an error.
+  struct passwd *passwd = enc_untrusted_getpwuid(enc_untrusted_getuid());
+  if (passwd) {
+    PasswdToHostInfo(*passwd, info.get());
+  }
+
+  cpu_set_t cpuset;
+  if (enc_untrusted_sched_getaffinity(/*pid=*/0, sizeof(cpuset), &cpuset) !=
+      0) {
+    return HostCallError("sched_getaffinity failed on the host");
+  }
+  CpuSetToHostInfo(cpuset, info.get());
+
+  refreshed_snapshot.store(info.release(), std::memory_order_release);
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
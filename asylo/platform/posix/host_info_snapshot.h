@@ -0,0 +1,48 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_HOST_INFO_SNAPSHOT_H_
+#define ASYLO_PLATFORM_POSIX_HOST_INFO_SNAPSHOT_H_
+
+#include "asylo/enclave.pb.h"
+#include "asylo/util/status.h"
+
+// The POSIX runtime serves uname(), sysconf(_SC_NPROCESSORS_*), getpwuid() of
+// the host user and sched_getaffinity() of the calling process from a snapshot
+// of the host captured when the enclave is loaded, instead of exiting the
+// enclave on every call. The snapshot is carried in the HostConfig of the
+// EnclaveConfig. Values listed in EnclaveConfig.live_host_info are always
+// queried from the host.
+//
+// The host is untrusted either way; the snapshot only changes when its answers
+// are taken.
+
+namespace asylo {
+
+// Returns the snapshot to serve |field| from, or nullptr if |field| must be
+// queried from the host. The caller must still check that the snapshot holds
+// |field|. Snapshots are immutable and are never freed.
+const HostInfo *GetHostInfoSnapshot(HostInfo::Field field);
+
+// Queries the host for every value in the snapshot and replaces the snapshot
+// with the result. Values that are live are unaffected.
+Status RefreshHostInfoSnapshot();
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_HOST_INFO_SNAPSHOT_H_
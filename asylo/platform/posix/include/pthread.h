@@ -0,0 +1,50 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include_next <pthread.h>
+
+#ifndef ASYLO_PLATFORM_POSIX_INCLUDE_PTHREAD_H_
+#define ASYLO_PLATFORM_POSIX_INCLUDE_PTHREAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reader-writer lock kinds, compatible with the GNU extension of the same
+// name. By default, readers may overtake a waiting writer until it reaches the
+// front of the wait queue. A lock that prefers writers stops admitting new
+// readers on its fast path as soon as a writer starts waiting.
+enum {
+  PTHREAD_RWLOCK_PREFER_READER_NP,
+  PTHREAD_RWLOCK_PREFER_WRITER_NP,
+  PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP,
+  PTHREAD_RWLOCK_DEFAULT_NP = PTHREAD_RWLOCK_PREFER_READER_NP
+};
+
+// Sets the lock kind of |attr| to |pref|, one of the PTHREAD_RWLOCK_*_NP
+// values.
+int pthread_rwlockattr_setkind_np(pthread_rwlockattr_t *attr, int pref);
+
+// Stores the lock kind of |attr| in |pref|.
+int pthread_rwlockattr_getkind_np(const pthread_rwlockattr_t *attr, int *pref);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // ASYLO_PLATFORM_POSIX_INCLUDE_PTHREAD_H_
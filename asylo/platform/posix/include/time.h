@@ -21,6 +21,33 @@
 #ifndef ASYLO_PLATFORM_POSIX_INCLUDE_TIME_H_
 #define ASYLO_PLATFORM_POSIX_INCLUDE_TIME_H_
 
+// Clocks served by clock_gettime() that newlib does not define. The coarse and
+// raw clocks read the same shared ticks as their precise counterparts, and the
+// CPU-time clocks count the time threads spend running inside the enclave.
+#ifndef CLOCK_PROCESS_CPUTIME_ID
+#define CLOCK_PROCESS_CPUTIME_ID ((clockid_t)2)
+#endif
+
+#ifndef CLOCK_THREAD_CPUTIME_ID
+#define CLOCK_THREAD_CPUTIME_ID ((clockid_t)3)
+#endif
+
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW ((clockid_t)5)
+#endif
+
+#ifndef CLOCK_REALTIME_COARSE
+#define CLOCK_REALTIME_COARSE ((clockid_t)6)
+#endif
+
+#ifndef CLOCK_MONOTONIC_COARSE
+#define CLOCK_MONOTONIC_COARSE ((clockid_t)7)
+#endif
+
+#ifndef CLOCK_BOOTTIME
+#define CLOCK_BOOTTIME ((clockid_t)8)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,6 +43,7 @@ class IOContextSecure : public IOManager::IOContext {
   int Close() override;
   int LSeek(off_t offset, int whence) override;
   int FSync() override;
+  int FTruncate(off_t length) override;
   int FStat(struct stat *st) override;
   int Isatty() override;
   int Ioctl(int request, void *argp) override;
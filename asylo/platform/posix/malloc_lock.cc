@@ -20,11 +20,20 @@
 
 #include "asylo/platform/primitives/trusted_runtime.h"
 
+#ifdef ASYLO_HEAP_HYBRID_LOCK
+#include "asylo/platform/primitives/x86/queue_lock.h"
+#endif  // ASYLO_HEAP_HYBRID_LOCK
+
 // The newlib implementation of malloc and free in mallocr.c depends on symbols
 // _malloc_lock and _malloc_unlock, and requires that a thread waiting on a lock
 // it already holds will not pause. This file provides a implementation of that
 // interface inside the enclave with minimal dependencies on other runtime
 // components which expect to call malloc.
+//
+// By default threads compete for the lock by compare-and-swapping their id
+// into lock_owner. Building with --define=ASYLO_HEAP_LOCK=hybrid makes them
+// take the hybrid queue lock from queue_lock.h first, so that only one waiter
+// at a time spins on the heap lock.
 
 #define CACHE_ALIGNED __attribute__((aligned(64)))
 
@@ -39,11 +48,27 @@ static volatile uint64_t lock_owner CACHE_ALIGNED = kInvalidThread;
 // not need to be updated atomically.
 static int lock_count CACHE_ALIGNED = 0;
 
+#ifdef ASYLO_HEAP_HYBRID_LOCK
+
+// Lock serializing threads that compete for lock_owner.
+static asylo_hybrid_lock_t heap_lock = ASYLO_HYBRID_LOCK_INITIALIZER;
+
+// Queue node of this thread while it waits for heap_lock.
+static thread_local asylo_mcs_node_t heap_lock_node;
+
+#endif  // ASYLO_HEAP_HYBRID_LOCK
+
 extern "C" {
 
 void __malloc_lock(struct reent *) {
   const uint64_t self = enc_thread_self();
 
+#ifdef ASYLO_HEAP_HYBRID_LOCK
+  if (lock_owner != self) {
+    asylo_hybrid_lock(&heap_lock, &heap_lock_node);
+    __atomic_store_n(&lock_owner, self, __ATOMIC_RELAXED);
+  }
+#else  // ASYLO_HEAP_HYBRID_LOCK
   while (lock_owner != self) {
     uint64_t prev = 0;
 
@@ -68,6 +93,7 @@ void __malloc_lock(struct reent *) {
       enc_pause();
     }
   }
+#endif  // ASYLO_HEAP_HYBRID_LOCK
 
   lock_count++;
 }
@@ -84,6 +110,9 @@ void __malloc_unlock(struct reent *) {
     // Release the lock with an atomic store. __ATOMIC_RELEASE ensures this
     // write is visible to threads obtaining the lock with __ATOMIC_SEQ_CST.
     __atomic_store_n(&lock_owner, kInvalidThread, __ATOMIC_RELEASE);
+#ifdef ASYLO_HEAP_HYBRID_LOCK
+    asylo_hybrid_unlock(&heap_lock);
+#endif  // ASYLO_HEAP_HYBRID_LOCK
   }
 }
 
@@ -26,12 +26,16 @@
 #include <type_traits>
 #include <array>
 #include <bitset>
+#include <vector>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/common/time_util.h"
+#include "asylo/platform/common/timer_wheel.h"
 #include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/platform/posix/include/semaphore.h"
 #include "asylo/platform/posix/pthread_impl.h"
+#include "asylo/platform/posix/threading/enclave_timer_service.h"
+#include "asylo/platform/posix/threading/reader_indicators.h"
 #include "asylo/platform/posix/threading/thread_manager.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
 #include "asylo/platform/primitives/util/trusted_memory.h"
@@ -136,12 +140,147 @@ int pthread_mutex_lock_internal(pthread_mutex_t *mutex) {
   return EBUSY;
 }
 
-// Read locks the given |rwlock| if possible and returns 0. On success,
-// pthread_self() is removed from |rwlock|._queue and |rwlock|._readers is
-// incremented. Returns EBUSY if the |rwlock| is write locked or pthread_self()
-// is not the front of |rwlock|._queue. |rwlock|._lock must be locked by the
-// caller.
-int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock) {
+// The |_reader_count| field of a pthread_rwlock_t packs the state of the lock
+// into a word that the reader fast path reads without taking |_lock|: the
+// number of readers that acquired the lock through its wait queue, the number
+// of such acquisitions since the lock was last write locked, and three flags.
+// It is only modified with |_lock| held.
+constexpr uint32_t kRwlockReadersMask = 0xffff;
+constexpr uint32_t kRwlockSlowReadsShift = 16;
+constexpr uint32_t kRwlockSlowReadsMask = 0xffu << kRwlockSlowReadsShift;
+
+// Set while a writer waits on a lock that prefers writers.
+constexpr uint32_t kRwlockWriterWaiting = 1u << 29;
+
+// Set if the lock was initialized to prefer writers.
+constexpr uint32_t kRwlockPreferWriter = 1u << 30;
+
+// Set while readers may acquire the lock by publishing themselves in the
+// ReaderIndicators table instead of updating the lock.
+constexpr uint32_t kRwlockReaderBias = 1u << 31;
+
+// Number of read acquisitions through the wait queue, with no write acquisition
+// in between, after which the reader fast path is enabled. Revoking it costs a
+// writer a scan of the ReaderIndicators table, so it is only enabled for locks
+// that are read far more often than they are written.
+constexpr uint32_t kRwlockBiasThreshold = 32;
+
+// Number of scans of the ReaderIndicators table a writer makes before it
+// starts yielding to the host scheduler between scans.
+constexpr int kRwlockDrainSpins = 100;
+
+uint32_t RwlockState(const pthread_rwlock_t *rwlock) {
+  return __atomic_load_n(&rwlock->_reader_count, __ATOMIC_SEQ_CST);
+}
+
+void SetRwlockState(pthread_rwlock_t *rwlock, uint32_t state) {
+  __atomic_store_n(&rwlock->_reader_count, state, __ATOMIC_SEQ_CST);
+}
+
+// A read lock held by the calling thread through the ReaderIndicators table.
+struct FastReadHold {
+  const pthread_rwlock_t *rwlock;
+  asylo::ReaderIndicators::Slot *slot;
+  int count;
+};
+
+// Read locks held through the fast path by the calling thread. A thread
+// holding more locks than this takes the others through the wait queue.
+constexpr int kMaxFastReadHolds = 4;
+thread_local FastReadHold fast_read_holds[kMaxFastReadHolds];
+
+// Returns the fast path hold of |rwlock| by the calling thread, or nullptr if
+// there is none. Passing nullptr returns an unused hold.
+FastReadHold *FindFastReadHold(const pthread_rwlock_t *rwlock) {
+  for (FastReadHold &hold : fast_read_holds) {
+    if (hold.rwlock == rwlock) {
+      return &hold;
+    }
+  }
+  return nullptr;
+}
+
+// Read locks |rwlock| without writing to it and returns true, if the calling
+// thread already holds it through the fast path or the reader fast path of
+// |rwlock| is enabled. Otherwise returns false.
+bool TryFastReadLock(pthread_rwlock_t *rwlock) {
+  FastReadHold *hold = FindFastReadHold(rwlock);
+  if (hold) {
+    hold->count++;
+    return true;
+  }
+  if ((RwlockState(rwlock) & (kRwlockReaderBias | kRwlockWriterWaiting)) !=
+      kRwlockReaderBias) {
+    return false;
+  }
+  hold = FindFastReadHold(nullptr);
+  if (!hold) {
+    return false;
+  }
+  asylo::ReaderIndicators::Slot *slot =
+      asylo::ReaderIndicators::Instance()->SlotFor(rwlock, pthread_self());
+  if (!asylo::ReaderIndicators::Publish(slot, rwlock)) {
+    return false;
+  }
+  // A writer clears the bias before it scans the table, so either it finds
+  // |slot| or this thread finds the bias cleared.
+  if (!(RwlockState(rwlock) & kRwlockReaderBias)) {
+    asylo::ReaderIndicators::Retract(slot);
+    return false;
+  }
+  hold->rwlock = rwlock;
+  hold->slot = slot;
+  hold->count = 1;
+  return true;
+}
+
+// Releases a read lock on |rwlock| held through the fast path and returns true,
+// or returns false if the calling thread holds no such lock.
+bool ReleaseFastReadLock(const pthread_rwlock_t *rwlock) {
+  FastReadHold *hold = FindFastReadHold(rwlock);
+  if (!hold) {
+    return false;
+  }
+  if (--hold->count == 0) {
+    asylo::ReaderIndicators::Retract(hold->slot);
+    hold->rwlock = nullptr;
+  }
+  return true;
+}
+
+// Waits until no reader holds |rwlock| through the fast path. The reader bias
+// of |rwlock| must be cleared.
+void WaitForFastReaders(const pthread_rwlock_t *rwlock) {
+  asylo::ReaderIndicators *indicators = asylo::ReaderIndicators::Instance();
+  for (int spins = 0; indicators->HasReaders(rwlock); ++spins) {
+    if (spins < kRwlockDrainSpins) {
+      enc_pause();
+    } else {
+      enc_untrusted_sched_yield();
+    }
+  }
+}
+
+// Wakes |waiter|, a thread parked in pthread_rwlock_lock(), if it is not
+// PTHREAD_T_NULL.
+void NotifyRwlockWaiter(pthread_t waiter) {
+  if (waiter == PTHREAD_T_NULL) {
+    return;
+  }
+  asylo::TimerService *timers = asylo::GetEnclaveTimerService();
+  if (timers) {
+    timers->Notify(waiter);
+  }
+}
+
+// Read locks the given |rwlock| through its wait queue if possible and returns
+// 0. On success, pthread_self() is removed from |rwlock|._queue and the reader
+// count of |rwlock| is incremented. Returns EBUSY if the |rwlock| is write
+// locked or pthread_self() is not the front of |rwlock|._queue, and EAGAIN if
+// the maximum number of readers has been reached. |rwlock|._lock must be locked
+// by the caller. |revoked_bias| is unused.
+int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock,
+                                      bool *revoked_bias) {
   // If |rwlock| is owned by a writer it is not read lockable.
   if (rwlock->_write_owner != PTHREAD_T_NULL) {
     return EBUSY;
@@ -153,8 +292,22 @@ int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock) {
   // If the current thread is at the front of the queue or the queue is empty
   // |rwlock| is read lockable.
   if (queue.Empty() || queue.Front() == self) {
+    uint32_t state = RwlockState(rwlock);
+    if ((state & kRwlockReadersMask) == kRwlockReadersMask) {
+      return EAGAIN;
+    }
     queue.Dequeue();
-    rwlock->_reader_count++;
+    state++;
+
+    // Enable the reader fast path once the lock has proven to be read-mostly.
+    // A lock that prefers writers only enables it while no writer waits.
+    if (((state & kRwlockSlowReadsMask) >> kRwlockSlowReadsShift) <
+        kRwlockBiasThreshold) {
+      state += 1u << kRwlockSlowReadsShift;
+    } else if (!(state & kRwlockPreferWriter) || queue.Empty()) {
+      state |= kRwlockReaderBias;
+    }
+    SetRwlockState(rwlock, state);
 
     return 0;
   }
@@ -164,12 +317,16 @@ int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock) {
 
 // Writes locks the given |rwlock| if possible and returns 0. On success,
 // pthread_self() is removed from |rwlock|._queue and added to
-// |rwlock|._write_owner. Returns EBUSY if the |rwlock| is write locked, read
-// locked, or pthread_self() is not the front of |rwlock|._queue. |rwlock|._lock
-// must be locked by the caller.
-int pthread_rwlock_trywrlock_internal(pthread_rwlock_t *rwlock) {
+// |rwlock|._write_owner, and the reader fast path of |rwlock| is disabled. If
+// it was enabled, |revoked_bias| is set to true and the caller must wait for
+// readers holding |rwlock| through it. Returns EBUSY if the |rwlock| is write
+// locked, read locked through the queue, or pthread_self() is not the front of
+// |rwlock|._queue. |rwlock|._lock must be locked by the caller.
+int pthread_rwlock_trywrlock_internal(pthread_rwlock_t *rwlock,
+                                      bool *revoked_bias) {
   // If |rwlock| is owned by a reader it is not write lockable.
-  if (rwlock->_reader_count != 0) {
+  uint32_t state = RwlockState(rwlock);
+  if ((state & kRwlockReadersMask) != 0) {
     return EBUSY;
   }
 
@@ -190,6 +347,11 @@ int pthread_rwlock_trywrlock_internal(pthread_rwlock_t *rwlock) {
   if (queue.Empty() || queue.Front() == self) {
     queue.Dequeue();
     rwlock->_write_owner = self;
+    if (state & kRwlockReaderBias) {
+      *revoked_bias = true;
+    }
+    SetRwlockState(rwlock, state & ~(kRwlockReaderBias | kRwlockWriterWaiting |
+                                     kRwlockSlowReadsMask));
 
     return 0;
   }
@@ -211,6 +373,30 @@ int ConvertToErrno(int err_value) {
   return -1;
 }
 
+// Converts |deadline|, an absolute time on CLOCK_REALTIME, to an absolute time
+// in nanoseconds on CLOCK_MONOTONIC and stores it in |monotonic_deadline|.
+int MonotonicDeadline(const timespec &deadline, int64_t *monotonic_deadline) {
+  timespec realtime_now;
+  timespec monotonic_now;
+  if (clock_gettime(CLOCK_REALTIME, &realtime_now) != 0 ||
+      clock_gettime(CLOCK_MONOTONIC, &monotonic_now) != 0) {
+    return EINVAL;
+  }
+  timespec time_left;
+  int64_t remaining = 0;
+  // TimeSpecSubtract returns true if deadline < realtime_now.
+  if (!asylo::TimeSpecSubtract(deadline, realtime_now, &time_left)) {
+    remaining = asylo::IsRepresentableAsNanoseconds(&time_left)
+                    ? asylo::TimeSpecToNanoseconds(&time_left)
+                    : asylo::TimerWheel::kNever;
+  }
+  int64_t now = asylo::TimeSpecToNanoseconds(&monotonic_now);
+  *monotonic_deadline = remaining > asylo::TimerWheel::kNever - now
+                            ? asylo::TimerWheel::kNever
+                            : now + remaining;
+  return 0;
+}
+
 // Returns a ThreadManager::ThreadOptions from the configuration of |attr|.
 asylo::ThreadManager::ThreadOptions CreateOptions(
     const pthread_attr_t *const attr) {
@@ -225,34 +411,60 @@ asylo::ThreadManager::ThreadOptions CreateOptions(
 
 // Acquires |rwlock| with a read lock or a write lock if |TryLockFunc| is
 // set to pthread_rwlock_tryrdlock_internal() or
-// pthread_rwlock_trywrlock_internal() respectively.
-template <int(TryLockFunc)(pthread_rwlock_t *)>
+// pthread_rwlock_trywrlock_internal() respectively. Threads that cannot take
+// the lock right away wait in |rwlock|._queue, parked on the timer service
+// until an unlock, or a reader that was ahead of them in the queue, wakes the
+// thread at the front.
+template <int(TryLockFunc)(pthread_rwlock_t *, bool *), bool kIsWriter>
 int pthread_rwlock_lock(pthread_rwlock_t *rwlock) {
   if (!asylo::IsValidEnclaveAddress<pthread_rwlock_t>(rwlock)) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
-  int ret = TryLockFunc(rwlock);
-  if (ret == 0) {
-    return 0;
-  }
+  asylo::TimerService *timers = asylo::GetEnclaveTimerService();
+  bool revoked_bias = false;
+  pthread_t next_waiter = PTHREAD_T_NULL;
+  int ret;
+  {
+    LockableGuard lock_guard(rwlock);
+    ret = TryLockFunc(rwlock, &revoked_bias);
+    if (ret == EBUSY) {
+      const pthread_t self = pthread_self();
+      asylo::pthread_impl::QueueOperations queue(rwlock);
+      if (queue.Contains(self)) {
+        return EDEADLK;
+      }
+      queue.Enqueue(self);
+      uint32_t state = RwlockState(rwlock);
+      if (kIsWriter && (state & kRwlockPreferWriter)) {
+        SetRwlockState(rwlock, state | kRwlockWriterWaiting);
+      }
 
-  const pthread_t self = pthread_self();
-  asylo::pthread_impl::QueueOperations queue(rwlock);
-  if (queue.Contains(self)) {
-    return EDEADLK;
-  }
-  queue.Enqueue(self);
+      while (ret == EBUSY) {
+        lock_guard.Unlock();
+        if (timers) {
+          timers->Wait(self, asylo::TimerWheel::kNever);
+        } else {
+          enc_untrusted_sched_yield();
+        }
+        lock_guard.Lock();
 
-  while (ret == EBUSY) {
-    lock_guard.Unlock();
-    enc_untrusted_sched_yield();
-    lock_guard.Lock();
+        ret = TryLockFunc(rwlock, &revoked_bias);
+      }
 
-    ret = TryLockFunc(rwlock);
+      if (ret != 0) {
+        queue.Remove(self);
+      } else if (!kIsWriter && !queue.Empty()) {
+        // The next thread in the queue may be a reader that can share the lock.
+        next_waiter = queue.Front();
+      }
+    }
   }
 
+  NotifyRwlockWaiter(next_waiter);
+  if (revoked_bias) {
+    WaitForFastReaders(rwlock);
+  }
   return ret;
 }
 
@@ -582,6 +794,17 @@ int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
 
   const pthread_t self = pthread_self();
 
+  // Park the thread on the timer service rather than polling, if available.
+  // The service keeps time on the monotonic clock.
+  asylo::TimerService *timers = asylo::GetEnclaveTimerService();
+  int64_t monotonic_deadline = asylo::TimerWheel::kNever;
+  if (timers && deadline != nullptr) {
+    int ret = MonotonicDeadline(*deadline, &monotonic_deadline);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+
   asylo::pthread_impl::QueueOperations list(cond);
   {
     LockableGuard lock_guard(cond);
@@ -594,6 +817,21 @@ int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
   }
 
   while (true) {
+    if (timers) {
+      // A notification is only a hint; the thread was signaled if and only if
+      // it was removed from the wait list.
+      bool timed_out = !timers->Wait(self, monotonic_deadline);
+      LockableGuard lock_guard(cond);
+      if (!list.Contains(self)) {
+        break;
+      }
+      if (timed_out) {
+        ret = ETIMEDOUT;
+        break;
+      }
+      continue;
+    }
+
     enc_untrusted_sched_yield();
 
     // If a deadline has been specified, check to see if it has passed.
@@ -649,14 +887,21 @@ int pthread_cond_signal(pthread_cond_t *cond) {
     return EFAULT;
   }
 
-  LockableGuard lock_guard(cond);
-  asylo::pthread_impl::QueueOperations list(cond);
-  if (list.Empty()) {
-    return 0;
+  pthread_t waiter;
+  {
+    LockableGuard lock_guard(cond);
+    asylo::pthread_impl::QueueOperations list(cond);
+    if (list.Empty()) {
+      return 0;
+    }
+    waiter = list.Front();
+    list.Dequeue();
   }
 
-  list.Dequeue();
-
+  asylo::TimerService *timers = asylo::GetEnclaveTimerService();
+  if (timers) {
+    timers->Notify(waiter);
+  }
   return 0;
 }
 
@@ -666,12 +911,22 @@ int pthread_cond_broadcast(pthread_cond_t *cond) {
     return EFAULT;
   }
 
+  std::vector<pthread_t> waiters;
   asylo::pthread_impl::QueueOperations list(cond);
   {
     LockableGuard lock_guard(cond);
-    list.Clear();
+    while (!list.Empty()) {
+      waiters.push_back(list.Front());
+      list.Dequeue();
+    }
   }
 
+  asylo::TimerService *timers = asylo::GetEnclaveTimerService();
+  if (timers) {
+    for (pthread_t waiter : waiters) {
+      timers->Notify(waiter);
+    }
+  }
   return 0;
 }
 
@@ -793,6 +1048,49 @@ int sem_destroy(sem_t *sem) {
   return 0;
 }
 
+int pthread_rwlockattr_init(pthread_rwlockattr_t *attr) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr)) {
+    return ConvertToErrno(EFAULT);
+  }
+
+  // The only field of pthread_rwlockattr_t holds the lock kind.
+  attr->_dummy = PTHREAD_RWLOCK_DEFAULT_NP;
+  return 0;
+}
+
+int pthread_rwlockattr_destroy(pthread_rwlockattr_t *attr) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr)) {
+    return ConvertToErrno(EFAULT);
+  }
+  return 0;
+}
+
+int pthread_rwlockattr_setkind_np(pthread_rwlockattr_t *attr, int pref) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr)) {
+    return ConvertToErrno(EFAULT);
+  }
+
+  if (pref != PTHREAD_RWLOCK_PREFER_READER_NP &&
+      pref != PTHREAD_RWLOCK_PREFER_WRITER_NP &&
+      pref != PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP) {
+    return EINVAL;
+  }
+
+  attr->_dummy = pref;
+  return 0;
+}
+
+int pthread_rwlockattr_getkind_np(const pthread_rwlockattr_t *attr,
+                                  int *pref) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr) ||
+      !asylo::IsValidEnclaveAddress<int>(pref)) {
+    return ConvertToErrno(EFAULT);
+  }
+
+  *pref = attr->_dummy;
+  return 0;
+}
+
 int pthread_rwlock_init(pthread_rwlock_t *rwlock,
                         const pthread_rwlockattr_t *attr) {
   if (!asylo::IsValidEnclaveAddress<pthread_rwlock_t>(rwlock)) {
@@ -800,6 +1098,14 @@ int pthread_rwlock_init(pthread_rwlock_t *rwlock,
   }
 
   *rwlock = PTHREAD_RWLOCK_INITIALIZER;
+  if (attr != nullptr) {
+    if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr)) {
+      return ConvertToErrno(EFAULT);
+    }
+    if (attr->_dummy != PTHREAD_RWLOCK_PREFER_READER_NP) {
+      rwlock->_reader_count = kRwlockPreferWriter;
+    }
+  }
 
   return 0;
 }
@@ -809,8 +1115,13 @@ int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
+  if (TryFastReadLock(rwlock)) {
+    return 0;
+  }
+
+  bool revoked_bias = false;
   LockableGuard lock_guard(rwlock);
-  return pthread_rwlock_tryrdlock_internal(rwlock);
+  return pthread_rwlock_tryrdlock_internal(rwlock, &revoked_bias);
 }
 
 int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock) {
@@ -818,16 +1129,40 @@ int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
-  return pthread_rwlock_trywrlock_internal(rwlock);
+  pthread_t next_waiter = PTHREAD_T_NULL;
+  {
+    LockableGuard lock_guard(rwlock);
+    bool revoked_bias = false;
+    int ret = pthread_rwlock_trywrlock_internal(rwlock, &revoked_bias);
+    if (ret != 0 || !revoked_bias ||
+        !asylo::ReaderIndicators::Instance()->HasReaders(rwlock)) {
+      return ret;
+    }
+
+    // Readers still hold the lock through the fast path. Give it back, and
+    // wake any thread that queued while it was held.
+    rwlock->_write_owner = PTHREAD_T_NULL;
+    asylo::pthread_impl::QueueOperations queue(rwlock);
+    if (!queue.Empty()) {
+      next_waiter = queue.Front();
+    }
+  }
+  NotifyRwlockWaiter(next_waiter);
+  return EBUSY;
 }
 
 int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock) {
-  return pthread_rwlock_lock<pthread_rwlock_tryrdlock_internal>(rwlock);
+  if (asylo::IsValidEnclaveAddress<pthread_rwlock_t>(rwlock) &&
+      TryFastReadLock(rwlock)) {
+    return 0;
+  }
+  return pthread_rwlock_lock<pthread_rwlock_tryrdlock_internal,
+                             /*kIsWriter=*/false>(rwlock);
 }
 
 int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock) {
-  return pthread_rwlock_lock<pthread_rwlock_trywrlock_internal>(rwlock);
+  return pthread_rwlock_lock<pthread_rwlock_trywrlock_internal,
+                             /*kIsWriter=*/true>(rwlock);
 }
 
 int pthread_rwlock_unlock(pthread_rwlock_t *rwlock) {
@@ -835,15 +1170,35 @@ int pthread_rwlock_unlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
-
-  const pthread_t self = pthread_self();
-  if (rwlock->_write_owner == self) {
-    rwlock->_write_owner = PTHREAD_T_NULL;
+  if (ReleaseFastReadLock(rwlock)) {
     return 0;
   }
 
-  rwlock->_reader_count--;
+  pthread_t next_waiter = PTHREAD_T_NULL;
+  {
+    LockableGuard lock_guard(rwlock);
+
+    const pthread_t self = pthread_self();
+    if (rwlock->_write_owner == self) {
+      rwlock->_write_owner = PTHREAD_T_NULL;
+    } else {
+      uint32_t state = RwlockState(rwlock);
+      if ((state & kRwlockReadersMask) == 0) {
+        return EPERM;
+      }
+      SetRwlockState(rwlock, --state);
+      if ((state & kRwlockReadersMask) != 0) {
+        return 0;
+      }
+    }
+
+    // The lock is free. Wake the thread at the front of the queue.
+    asylo::pthread_impl::QueueOperations queue(rwlock);
+    if (!queue.Empty()) {
+      next_waiter = queue.Front();
+    }
+  }
+  NotifyRwlockWaiter(next_waiter);
   return 0;
 }
 
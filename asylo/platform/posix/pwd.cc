@@ -21,6 +21,8 @@
 #include <sys/types.h>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/common/host_info_util.h"
+#include "asylo/platform/posix/host_info_snapshot.h"
 
 extern "C" {
 
@@ -35,6 +37,16 @@ int getpwnam_r(const char *name, struct passwd *pwd, char *buf, size_t buflen,
 }
 
 struct passwd *getpwuid(uid_t uid) {
+  // The entry of the host user is served from the host snapshot. Its strings
+  // point into the snapshot, which is never freed.
+  const asylo::HostInfo *snapshot =
+      asylo::GetHostInfoSnapshot(asylo::HostInfo::PASSWD);
+  if (snapshot && snapshot->has_passwd() && snapshot->passwd().uid() == uid) {
+    static thread_local struct passwd snapshot_passwd;
+    if (asylo::HostInfoToPasswd(*snapshot, &snapshot_passwd)) {
+      return &snapshot_passwd;
+    }
+  }
   return enc_untrusted_getpwuid(uid);
 }
 
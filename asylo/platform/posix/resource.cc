@@ -20,8 +20,11 @@
 #define THIRD_PARTY_ASYLO_PLATFORM_POSIX_SRC_RESOURCE_H_
 
 #include <sys/resource.h>
+#include <cstring>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/common/cpu_time.h"
+#include "asylo/platform/common/time_util.h"
 #include "asylo/platform/posix/io/io_manager.h"
 
 extern "C" {
@@ -46,8 +49,27 @@ int setrlimit(int resource, const struct rlimit *rlim) {
   }
 }
 
+// Serves the CPU time of the enclave and of the calling thread without leaving
+// the enclave. All of it is reported as user time, and the other fields are
+// not tracked by the enclave. The usage of child processes is requested from
+// the host.
 int getrusage(int who, struct rusage *usage) {
-  return enc_untrusted_getrusage(who, usage);
+  int64_t user_time;
+  switch (who) {
+    case RUSAGE_SELF:
+      user_time = asylo::ProcessCpuTimeNanoseconds();
+      break;
+#ifdef RUSAGE_THREAD
+    case RUSAGE_THREAD:
+      user_time = asylo::ThreadCpuTimeNanoseconds();
+      break;
+#endif
+    default:
+      return enc_untrusted_getrusage(who, usage);
+  }
+  memset(usage, 0, sizeof(*usage));
+  asylo::NanosecondsToTimeVal(&usage->ru_utime, user_time);
+  return 0;
 }
 
 }  // extern "C"
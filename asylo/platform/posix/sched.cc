@@ -22,6 +22,8 @@
 #include <bitset>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/common/host_info_util.h"
+#include "asylo/platform/posix/host_info_snapshot.h"
 
 inline size_t WordNum(int cpu) { return cpu / (8 * sizeof(CpuSetWord)); }
 
@@ -69,6 +71,14 @@ int CpuSetEqual(CpuSet *set1, CpuSet *set2) {
 }
 
 int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t *mask) {
+  // Only the affinity of the calling process is in the host snapshot.
+  const asylo::HostInfo *snapshot =
+      pid == 0 ? asylo::GetHostInfoSnapshot(asylo::HostInfo::CPU_AFFINITY)
+               : nullptr;
+  if (snapshot && cpusetsize >= sizeof(cpu_set_t) &&
+      asylo::HostInfoToCpuSet(*snapshot, mask)) {
+    return 0;
+  }
   return enc_untrusted_sched_getaffinity(pid, cpusetsize, mask);
 }
 
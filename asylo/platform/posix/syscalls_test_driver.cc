@@ -667,6 +667,47 @@ TEST_F(SyscallsTest, SchedGetAffinityAfterSet) {
   }
 }
 
+// Tests that sched_getaffinity() of the calling process is served from the
+// snapshot of the host taken when the enclave was loaded, until the snapshot is
+// refreshed.
+TEST_F(SyscallsTest, SchedGetAffinityOfSelfAfterRefresh) {
+  cpu_set_t initial_mask;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(cpu_set_t), &initial_mask), 0);
+  if (CPU_COUNT(&initial_mask) < 2) {
+    SUCCEED() << "Only one CPU in affinity mask. Not continuing with test.";
+    return;
+  }
+
+  // Restrict the host process to the first CPU in its mask.
+  cpu_set_t new_mask;
+  CPU_ZERO(&new_mask);
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &initial_mask)) {
+      CPU_SET(cpu, &new_mask);
+      break;
+    }
+  }
+  ASSERT_EQ(sched_setaffinity(0, sizeof(cpu_set_t), &new_mask), 0);
+
+  SyscallsTestOutput test_output;
+  cpu_set_t enclave_mask;
+  ASSERT_THAT(RunSyscallInsideEnclave("sched_getaffinity(0)", /*file_path=*/"",
+                                      &test_output),
+              IsOk());
+  EXPECT_EQ(test_output.int_syscall_return(), 0);
+  ExtractCpuSetFromTestOutput(test_output, &enclave_mask);
+  EXPECT_FALSE(CPU_EQUAL(&new_mask, &enclave_mask));
+
+  ASSERT_THAT(RunSyscallInsideEnclave("sched_getaffinity(0) after refresh",
+                                      /*file_path=*/"", &test_output),
+              IsOk());
+  EXPECT_EQ(test_output.int_syscall_return(), 0);
+  ExtractCpuSetFromTestOutput(test_output, &enclave_mask);
+  EXPECT_TRUE(CPU_EQUAL(&new_mask, &enclave_mask));
+
+  ASSERT_EQ(sched_setaffinity(0, sizeof(cpu_set_t), &initial_mask), 0);
+}
+
 // Tests the enclave-native implementations of the macros defined in
 // http://man7.org/linux/man-pages/man3/CPU_SET.3.html#DESCRIPTION.
 TEST_F(SyscallsTest, CpuSetMacros) {
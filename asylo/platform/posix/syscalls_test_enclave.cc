@@ -38,6 +38,7 @@
 #include "absl/strings/str_cat.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/common/bridge_proto_serializer.h"
+#include "asylo/platform/posix/host_info_snapshot.h"
 #include "asylo/platform/posix/syscalls_test.pb.h"
 #include "asylo/platform/storage/utils/fd_closer.h"
 #include "asylo/test/util/enclave_test_application.h"
@@ -103,6 +104,11 @@ class SyscallsEnclave : public EnclaveTestCase {
       return RunGetPpidTest(output);
     } else if (test_input.test_target() == "sched_getaffinity") {
       return RunSchedGetAffinityTest(output);
+    } else if (test_input.test_target() == "sched_getaffinity(0)") {
+      return RunSchedGetAffinityOfSelfTest(/*refresh=*/false, output);
+    } else if (test_input.test_target() ==
+               "sched_getaffinity(0) after refresh") {
+      return RunSchedGetAffinityOfSelfTest(/*refresh=*/true, output);
     } else if (test_input.test_target() == "sched_getaffinity failure") {
       return RunSchedGetAffinityFailureTest(output);
     } else if (test_input.test_target() == "CPU_SET macros") {
@@ -701,6 +707,25 @@ class SyscallsEnclave : public EnclaveTestCase {
     return Status::OkStatus();
   }
 
+  // Runs sched_getaffinity() on the calling process, which is served from the
+  // host snapshot. Refreshes the snapshot first if |refresh| is true.
+  Status RunSchedGetAffinityOfSelfTest(bool refresh, EnclaveOutput *output) {
+    if (refresh) {
+      ASYLO_RETURN_IF_ERROR(RefreshHostInfoSnapshot());
+    }
+
+    SyscallsTestOutput output_ret;
+    cpu_set_t mask;
+    output_ret.set_int_syscall_return(
+        sched_getaffinity(/*pid=*/0, sizeof(cpu_set_t), &mask));
+    EncodeCpuSetInTestOutput(mask, &output_ret);
+
+    if (output) {
+      output->MutableExtension(syscalls_test_output)->CopyFrom(output_ret);
+    }
+    return Status::OkStatus();
+  }
+
   Status RunSchedGetAffinityFailureTest(EnclaveOutput *output) {
     SyscallsTestOutput output_ret;
     pid_t my_pid = getpid();
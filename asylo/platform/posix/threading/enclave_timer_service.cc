@@ -0,0 +1,91 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/threading/enclave_timer_service.h"
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+
+#include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/common/time_util.h"
+#include "asylo/platform/common/timer_channel.h"
+#include "asylo/platform/core/shared_name_kind.h"
+#include "asylo/platform/core/trusted_global_state.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+
+namespace asylo {
+namespace {
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+TimerService *CreateTimerService() {
+  std::string resource = TimerChannelResourceName(GetEnclaveName());
+  void *channel =
+      enc_untrusted_acquire_shared_resource(kAddressName, resource.c_str());
+  if (!channel) {
+    return nullptr;
+  }
+  // The host keeps the channel of an enclave until the enclave is destroyed,
+  // so no reference is held. Holding one would keep the name registered after
+  // the host stops the waiter.
+  enc_untrusted_release_shared_resource(kAddressName, resource.c_str());
+  if (!enc_is_outside_enclave(channel, sizeof(TimerChannel))) {
+    abort();
+  }
+  TimerService::Environment environment;
+  environment.monotonic_clock = MonotonicClock;
+  environment.futex_wait = enc_untrusted_sys_futex_wait;
+  environment.futex_wake = enc_untrusted_sys_futex_wake;
+  environment.allocate_shared = enc_untrusted_malloc;
+  return new TimerService(environment, static_cast<TimerChannel *>(channel));
+}
+
+enum InitState { kUninitialized, kInitializing, kInitialized };
+
+// The service is created without a function-local static, whose guard may
+// itself wait on a condition variable and so re-enter this function.
+std::atomic<int> init_state(kUninitialized);
+std::atomic<TimerService *> service(nullptr);
+
+}  // namespace
+
+TimerService *GetEnclaveTimerService() {
+  int state = init_state.load(std::memory_order_acquire);
+  if (state == kInitialized) {
+    return service.load(std::memory_order_acquire);
+  }
+  // Threads that call in while another thread creates the service proceed
+  // without it.
+  if (state == kInitializing ||
+      !init_state.compare_exchange_strong(state, kInitializing,
+                                          std::memory_order_acq_rel)) {
+    return nullptr;
+  }
+  service.store(CreateTimerService(), std::memory_order_release);
+  init_state.store(kInitialized, std::memory_order_release);
+  return service.load(std::memory_order_acquire);
+}
+
+}  // namespace asylo
@@ -0,0 +1,33 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_THREADING_ENCLAVE_TIMER_SERVICE_H_
+#define ASYLO_PLATFORM_POSIX_THREADING_ENCLAVE_TIMER_SERVICE_H_
+
+#include "asylo/platform/common/timer_service.h"
+
+namespace asylo {
+
+// Returns the timer service that parks sleeping and waiting threads of this
+// enclave, or nullptr if the host does not provide a timer channel, in which
+// case callers fall back to waiting on the host or spinning.
+TimerService *GetEnclaveTimerService();
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_THREADING_ENCLAVE_TIMER_SERVICE_H_
@@ -0,0 +1,63 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/threading/reader_indicators.h"
+
+namespace asylo {
+namespace {
+
+ReaderIndicators global_indicators;
+
+}  // namespace
+
+constexpr size_t ReaderIndicators::kSlots;
+
+static_assert(sizeof(ReaderIndicators::Slot) == 64,
+              "Reader indicator slots must not share cache lines");
+
+ReaderIndicators *ReaderIndicators::Instance() { return &global_indicators; }
+
+ReaderIndicators::Slot *ReaderIndicators::SlotFor(const void *lock,
+                                                  uint64_t thread) {
+  // Locks span several words, so the low bits of their addresses carry little
+  // information.
+  uint64_t hash = (reinterpret_cast<uintptr_t>(lock) >> 4) ^ thread;
+  hash *= 0x9e3779b97f4a7c15ULL;
+  return &slots_[(hash >> 32) % kSlots];
+}
+
+bool ReaderIndicators::Publish(Slot *slot, const void *lock) {
+  const void *expected = nullptr;
+  return slot->lock.compare_exchange_strong(expected, lock,
+                                            std::memory_order_seq_cst);
+}
+
+void ReaderIndicators::Retract(Slot *slot) {
+  slot->lock.store(nullptr, std::memory_order_release);
+}
+
+bool ReaderIndicators::HasReaders(const void *lock) const {
+  for (const Slot &slot : slots_) {
+    if (slot.lock.load(std::memory_order_seq_cst) == lock) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace asylo
@@ -0,0 +1,77 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_THREADING_READER_INDICATORS_H_
+#define ASYLO_PLATFORM_POSIX_THREADING_READER_INDICATORS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace asylo {
+
+// A table of visible readers shared by every reader-writer lock.
+//
+// A reader announces that it holds a lock by storing the address of the lock
+// in a slot chosen by hashing the lock and the reader's thread, instead of
+// incrementing a reader count in the lock itself. Readers of the same lock on
+// different threads therefore write to different cache lines. A writer that
+// needs to exclude such readers scans the table for slots holding its lock.
+//
+// Two threads whose slots collide cannot both publish; the second one falls
+// back to the lock's own reader count.
+//
+// The table has no constructor so that a static instance is zero-initialized
+// before any code runs, which lets it be used by the earliest threads of the
+// runtime.
+class ReaderIndicators {
+ public:
+  // Number of slots in the table. A writer scans every slot, so this trades
+  // the rate of collisions between readers against the cost of a write lock.
+  static constexpr size_t kSlots = 1024;
+
+  // A slot of the table, holding the lock its reader holds or nullptr. Each
+  // slot occupies a cache line of its own.
+  struct alignas(64) Slot {
+    std::atomic<const void *> lock;
+  };
+
+  // Returns the table shared by every lock in the process.
+  static ReaderIndicators *Instance();
+
+  // Returns the slot where |thread| announces that it reads |lock|.
+  Slot *SlotFor(const void *lock, uint64_t thread);
+
+  // Stores |lock| in |slot| and returns true if |slot| is empty. Otherwise
+  // returns false. The store is sequentially consistent, so a writer that
+  // subsequently calls HasReaders() observes it.
+  static bool Publish(Slot *slot, const void *lock);
+
+  // Empties |slot|, which was published by the calling thread.
+  static void Retract(Slot *slot);
+
+  // Returns true if any slot holds |lock|.
+  bool HasReaders(const void *lock) const;
+
+ private:
+  Slot slots_[kSlots];
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_THREADING_READER_INDICATORS_H_
@@ -16,15 +16,20 @@
  *
  */
 
+#include <errno.h>
+#include <pthread.h>
 #include <sys/time.h>
+#include <sys/times.h>
 #include <time.h>
 #include <atomic>
 #include <cstring>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/arch/include/trusted/time.h"
+#include "asylo/platform/common/cpu_time.h"
 #include "asylo/platform/common/time_util.h"
 #include "asylo/platform/core/shared_name.h"
+#include "asylo/platform/posix/threading/enclave_timer_service.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
 #include "include/sgx_trts.h"
 
@@ -49,21 +54,46 @@ std::atomic<int64_t> *GetClockAddressOrDie(const char *name) {
   return static_cast<std::atomic<int64_t> *>(addr);
 }
 
+// Returns the value of |clock|, a clock that must never move backwards, and
+// aborts if it did since the calling thread last read it. |last_tick| holds the
+// value of the last read.
+inline int64_t ReadMonotonicClock(const std::atomic<int64_t> *clock,
+                                  int64_t *last_tick) {
+  int64_t tick = clock->load(std::memory_order_relaxed);
+  if (tick < *last_tick) abort();
+  *last_tick = tick;
+  return tick;
+}
+
 // Returns the value of a monotonic clock as a number of nanoseconds.
 inline int64_t MonotonicClock() {
   static std::atomic<int64_t> *clock_monotonic =
       GetClockAddressOrDie("clock_monotonic");
-  thread_local static int64_t last_tick = *clock_monotonic;
-  if (*clock_monotonic < last_tick) abort();
-  last_tick = *clock_monotonic;
-  return *clock_monotonic;
+  thread_local static int64_t last_tick = 0;
+  return ReadMonotonicClock(clock_monotonic, &last_tick);
 }
 
-// Returns the value of a monotonic clock as a number of nanoseconds.
+// Returns the value of a monotonic clock that includes time the host spent
+// suspended as a number of nanoseconds.
+inline int64_t BootTimeClock() {
+  static std::atomic<int64_t> *clock_boottime =
+      GetClockAddressOrDie("clock_boottime");
+  thread_local static int64_t last_tick = 0;
+  return ReadMonotonicClock(clock_boottime, &last_tick);
+}
+
+// Returns the value of a realtime clock as a number of nanoseconds.
 inline int64_t RealtimeClock() {
   static std::atomic<int64_t> *clock_realtime =
       GetClockAddressOrDie("clock_realtime");
-  return *clock_realtime;
+  return clock_realtime->load(std::memory_order_relaxed);
+}
+
+// Converts a number of nanoseconds to a number of clock ticks as reported by
+// times().
+inline clock_t NanosecondsToClockTicks(int64_t nanoseconds) {
+  return static_cast<clock_t>(nanoseconds / (INT64_C(1000000000) /
+                                             CLOCKS_PER_SEC));
 }
 
 // Busy wait with asm("pause").
@@ -79,20 +109,30 @@ static int busy_sleep(const struct timespec *requested) {
 
 extern "C" {
 
-// Custom in-enclave nanosleep that will leave the enclave for the standard
-// nanosleep if the requested sleep time is longer than we expect an enclave
-// round-trip to take. Otherwise, busy wait.
+// Custom in-enclave nanosleep. Sleeps shorter than an enclave round-trip busy
+// wait. Longer sleeps park the thread on the enclave timer service, which
+// costs no CPU time while sleeping. If the host does not provide a timer
+// service, sleeps longer than 3ms leave the enclave for the standard
+// nanosleep and shorter ones busy wait.
 int nanosleep(const struct timespec *requested, struct timespec *remainder) {
-  // If we want to sleep more than 3ms, then exit the enclave to sleep.
+  constexpr int64_t kSpinThreshold = INT64_C(50000);
   constexpr int64_t kExitThreshold = INT64_C(3000000);
   int64_t delay = TimeSpecToNanoseconds(requested);
-  if (delay > kExitThreshold) {
+  asylo::TimerService *timers = nullptr;
+  if (delay > kSpinThreshold) {
+    timers = asylo::GetEnclaveTimerService();
+  }
+  if (!timers && delay > kExitThreshold) {
     return enc_untrusted_nanosleep(requested, remainder);
   }
-  // Otherwise, wait on the shared clock.
   if (remainder) {
     NanosecondsToTimeSpec(remainder, 0);
   }
+  if (timers) {
+    timers->SleepUntil(pthread_self(), MonotonicClock() + delay);
+    return 0;
+  }
+  // Otherwise, wait on the shared clock.
   return busy_sleep(requested);
 }
 
@@ -106,17 +146,42 @@ int enclave_gettimeofday(struct timeval *__restrict time, void *timezone) {
 }
 
 
-int enclave_times(struct tms *buf) { return enc_untrusted_times(buf); }
+// Reports the CPU time of the enclave in units of CLOCKS_PER_SEC, as newlib's
+// clock() expects. All of it is user time, since trusted code never runs in
+// the kernel, and the CPU time of child processes is not known to the enclave.
+int enclave_times(struct tms *buf) {
+  buf->tms_utime = NanosecondsToClockTicks(asylo::ProcessCpuTimeNanoseconds());
+  buf->tms_stime = 0;
+  buf->tms_cutime = 0;
+  buf->tms_cstime = 0;
+  return NanosecondsToClockTicks(MonotonicClock());
+}
 
+// The coarse and raw clocks are served from the same shared ticks as the
+// precise clocks, which the host only updates periodically. The CPU-time
+// clocks count the time threads spend running trusted code.
 int clock_gettime(clockid_t clock_id, struct timespec *time) {
   switch (clock_id) {
     case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_COARSE:
+    case CLOCK_MONOTONIC_RAW:
       NanosecondsToTimeSpec(time, MonotonicClock());
       return 0;
     case CLOCK_REALTIME:
+    case CLOCK_REALTIME_COARSE:
       NanosecondsToTimeSpec(time, RealtimeClock());
       return 0;
+    case CLOCK_BOOTTIME:
+      NanosecondsToTimeSpec(time, BootTimeClock());
+      return 0;
+    case CLOCK_PROCESS_CPUTIME_ID:
+      NanosecondsToTimeSpec(time, asylo::ProcessCpuTimeNanoseconds());
+      return 0;
+    case CLOCK_THREAD_CPUTIME_ID:
+      NanosecondsToTimeSpec(time, asylo::ThreadCpuTimeNanoseconds());
+      return 0;
     default:
+      errno = EINVAL;
       return -1;
   }
 }
@@ -20,12 +20,14 @@
 
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <cstdlib>
 #include <cstring>
 
 #include "asylo/platform/arch/include/trusted/fork.h"
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/core/trusted_global_state.h"
+#include "asylo/platform/posix/host_info_snapshot.h"
 #include "asylo/platform/posix/io/io_manager.h"
 #include "asylo/util/statusor.h"
 
@@ -113,21 +115,37 @@ int gethostname(char *name, size_t len) {
   return 0;
 }
 
-// Only _SC_NPROCESSORS_ONLN, _SC_NPROCESSORS_CONF, and _SC_PAGESIZE are
-// supported for now. _SC_NPROCESSORS_CONF and _SC_NOPROCESSORS_ONLN retrieve
-// the return value from the host because processor resources are under control
-// of the host. _SC_PAGESIZE is hard-coded because a malicious value returned by
-// a host could result in undesired behavior. For any other arguments, -1 is
-// returned.
+// Only _SC_NPROCESSORS_ONLN, _SC_NPROCESSORS_CONF, _SC_PAGESIZE, and
+// _SC_CLK_TCK are supported for now. _SC_NPROCESSORS_CONF and
+// _SC_NOPROCESSORS_ONLN retrieve the return value from the host because
+// processor resources are under control of the host. _SC_PAGESIZE is
+// hard-coded because a malicious value returned by a host could result in
+// undesired behavior. _SC_CLK_TCK is the unit of times(), which is served
+// inside the enclave. For any other arguments, -1 is returned.
 long sysconf(int name) {
   switch (name) {
-    case _SC_NPROCESSORS_CONF:
-    case _SC_NPROCESSORS_ONLN:
+    case _SC_NPROCESSORS_CONF: {
+      const asylo::HostInfo *snapshot =
+          asylo::GetHostInfoSnapshot(asylo::HostInfo::NPROCESSORS_CONF);
+      if (snapshot && snapshot->has_nprocessors_conf()) {
+        return snapshot->nprocessors_conf();
+      }
       return enc_untrusted_sysconf(name);
+    }
+    case _SC_NPROCESSORS_ONLN: {
+      const asylo::HostInfo *snapshot =
+          asylo::GetHostInfoSnapshot(asylo::HostInfo::NPROCESSORS_ONLN);
+      if (snapshot && snapshot->has_nprocessors_onln()) {
+        return snapshot->nprocessors_onln();
+      }
+      return enc_untrusted_sysconf(name);
+    }
     case _SC_PAGESIZE:
       // Hard-code a reasonable guess for the page size, without having to
       // make an untrusted call.
       return kPageSize;
+    case _SC_CLK_TCK:
+      return CLOCKS_PER_SEC;
     default:
       errno = ENOSYS;
       return -1;
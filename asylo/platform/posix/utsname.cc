@@ -16,14 +16,31 @@
  *
  */
 
+#include <errno.h>
 #include <stdlib.h>
 #include <sys/utsname.h>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/common/host_info_util.h"
+#include "asylo/platform/posix/host_info_snapshot.h"
 
 extern "C" {
 
-// Retrieves system information from the host.
-int uname(struct utsname *buf) { return enc_untrusted_uname(buf); }
+// Retrieves system information from the host snapshot, or from the host if
+// there is none.
+int uname(struct utsname *buf) {
+  const asylo::HostInfo *snapshot =
+      asylo::GetHostInfoSnapshot(asylo::HostInfo::UNAME);
+  if (snapshot && snapshot->has_utsname()) {
+    if (!buf) {
+      errno = EFAULT;
+      return -1;
+    }
+    if (asylo::HostInfoToUtsName(*snapshot, buf)) {
+      return 0;
+    }
+  }
+  return enc_untrusted_uname(buf);
+}
 
 }  // extern "C"
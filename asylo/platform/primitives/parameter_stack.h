@@ -138,6 +138,12 @@ class ParameterStack {
   // Returns the Extent at the top of the stack. Valid only if !empty().
   Extent Top() { return top_->extent; }
 
+  // Returns the Extent at the top of the stack for modification in place. The
+  // extent may be shrunk to reuse its storage, for instance to write a result
+  // over an argument, but must keep pointing to the buffer owned by the stack.
+  // Valid only if !empty().
+  Extent *MutableTop() { return &top_->extent; }
+
   // Allocates and pushes a new extent of the specified size.
   Extent PushAlloc(size_t extent_size) {
     auto item = static_cast<Item *>((*ALLOCATOR)(sizeof(Item)));
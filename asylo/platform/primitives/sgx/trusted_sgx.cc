@@ -23,6 +23,7 @@
 #include "absl/strings/str_cat.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/arch/sgx/trusted/generated_bridge_t.h"
+#include "asylo/platform/common/enclave_exits.h"
 #include "asylo/platform/core/entry_points.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
@@ -38,7 +39,7 @@
 #include "include/sgx_trts.h"
 
 extern "C" void *enc_untrusted_malloc(size_t size);
-extern "C" void enc_untrusted_free(void *ptr);
+extern "C" void untrusted_cache_free(void *buffer);
 
 namespace asylo {
 namespace primitives {
@@ -51,7 +52,11 @@ using UntrustedAllocatorStack =
 
 #define CHECK_OCALL(status_)                                                 \
   do {                                                                       \
-    sgx_status_t status##__COUNTER__ = status_;                              \
+    sgx_status_t status##__COUNTER__;                                        \
+    {                                                                        \
+      asylo::ScopedEnclaveExit enclave_exit;                                 \
+      status##__COUNTER__ = status_;                                         \
+    }                                                                        \
     if (status##__COUNTER__ != SGX_SUCCESS) {                                \
       TrustedPrimitives::DebugPuts(                                          \
           absl::StrCat(                                                      \
@@ -103,7 +108,7 @@ PrimitiveStatus Initialize(void *context, TrustedParameterStack *params) {
   if (!result) {
     params->PushByCopy(Extent{output, output_len});
   }
-  enc_untrusted_free(output);
+  untrusted_cache_free(output);
   return PrimitiveStatus(result);
 }
 
@@ -129,7 +134,7 @@ PrimitiveStatus Run(void *context, TrustedParameterStack *params) {
   if (!result) {
     params->PushByCopy(Extent{output, output_len});
   }
-  enc_untrusted_free(output);
+  untrusted_cache_free(output);
   return PrimitiveStatus(result);
 }
 
@@ -156,7 +161,7 @@ PrimitiveStatus Finalize(void *context, TrustedParameterStack *params) {
   if (!result) {
     params->PushByCopy(Extent{output, output_len});
   }
-  enc_untrusted_free(output);
+  untrusted_cache_free(output);
   return PrimitiveStatus(result);
 }
 
@@ -254,7 +259,9 @@ void *TrustedPrimitives::UntrustedLocalAlloc(size_t size) {
 }
 
 void TrustedPrimitives::UntrustedLocalFree(void *ptr) {
-  enc_untrusted_free(ptr);
+  // Parameter stack items and extents are freed in batches by the untrusted
+  // memory cache rather than with one host call each.
+  untrusted_cache_free(ptr);
 }
 
 void TrustedPrimitives::DebugPuts(const char *message) {
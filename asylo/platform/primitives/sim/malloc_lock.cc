@@ -21,35 +21,65 @@
 #include "asylo/platform/primitives/util/primitive_locks.h"
 #include "asylo/platform/primitives/x86/spin_lock.h"
 
+#ifdef ASYLO_HEAP_HYBRID_LOCK
+#include "asylo/platform/primitives/x86/queue_lock.h"
+#endif  // ASYLO_HEAP_HYBRID_LOCK
+
 // The newlib implementation of malloc and free in mallocr.c depends on symbols
 // _malloc_lock and _malloc_unlock, and requires that a thread waiting on a lock
 // it already holds will not pause. This file provides a implementation of that
 // interface inside the enclave with minimal dependencies on other runtime
 // components which expect to call malloc.
+//
+// The heap lock is a test-and-test-and-set spin lock. Building with
+// --define=ASYLO_HEAP_LOCK=hybrid selects the hybrid queue lock from
+// queue_lock.h instead, which keeps waiters of a heavily contended heap from
+// all spinning on the lock word.
 
 namespace asylo {
 namespace primitives {
 
-// Global lock protecting the heap.
-asylo_spinlock_t heap_lock = ASYLO_SPIN_LOCK_INITIALIZER;
-
 // Per-thread counter of how many times the lock was taken.
 // It is only incremented once a thread took the lock, so for all threads except
 // possibly one it will be zero.
 thread_local int64_t thread_lock_count = 0;
 
+#ifdef ASYLO_HEAP_HYBRID_LOCK
+
+// Global lock protecting the heap.
+asylo_hybrid_lock_t heap_lock = ASYLO_HYBRID_LOCK_INITIALIZER;
+
+// Queue node of this thread while it waits for the heap lock. The lock is not
+// taken recursively, so a thread needs a single node.
+thread_local asylo_mcs_node_t heap_lock_node;
+
+inline void LockHeap() { asylo_hybrid_lock(&heap_lock, &heap_lock_node); }
+
+inline void UnlockHeap() { asylo_hybrid_unlock(&heap_lock); }
+
+#else  // ASYLO_HEAP_HYBRID_LOCK
+
+// Global lock protecting the heap.
+asylo_spinlock_t heap_lock = ASYLO_SPIN_LOCK_INITIALIZER;
+
+inline void LockHeap() { asylo_spin_lock(&heap_lock); }
+
+inline void UnlockHeap() { asylo_spin_unlock(&heap_lock); }
+
+#endif  // ASYLO_HEAP_HYBRID_LOCK
+
 extern "C" {
 
 void __malloc_lock(struct reent *) {
   if (thread_lock_count == 0) {
-    asylo_spin_lock(&heap_lock);
+    LockHeap();
   }
   ++thread_lock_count;
 }
 
 void __malloc_unlock(struct reent *) {
   if (--thread_lock_count == 0) {
-    asylo_spin_unlock(&heap_lock);
+    UnlockHeap();
   }
 }
 
@@ -0,0 +1,71 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sim/parameter_arena.h"
+
+#include <malloc.h>
+#include <cstdlib>
+
+namespace asylo {
+namespace primitives {
+
+constexpr size_t ParameterArena::kBlockSize;
+constexpr size_t ParameterArena::kCapacity;
+
+ParameterArena::~ParameterArena() {
+  while (count_ > 0) {
+    free(blocks_[--count_]);
+  }
+}
+
+ParameterArena *ParameterArena::ForCurrentThread() {
+  static thread_local ParameterArena arena;
+  return &arena;
+}
+
+void ParameterArena::Reserve(size_t count) {
+  while (count_ < count && count_ < kCapacity) {
+    blocks_[count_++] = malloc(kBlockSize);
+  }
+}
+
+void *ParameterArena::Allocate(size_t size) {
+  if (size > kBlockSize) {
+    return malloc(size);
+  }
+  if (count_ > 0) {
+    return blocks_[--count_];
+  }
+  return malloc(kBlockSize);
+}
+
+void ParameterArena::Free(void *ptr) {
+  // Only cache blocks that fit an allocation of kBlockSize without holding on
+  // to large buffers.
+  if (ptr != nullptr && count_ < kCapacity) {
+    size_t usable_size = malloc_usable_size(ptr);
+    if (usable_size >= kBlockSize && usable_size < 2 * kBlockSize) {
+      blocks_[count_++] = ptr;
+      return;
+    }
+  }
+  free(ptr);
+}
+
+}  // namespace primitives
+}  // namespace asylo
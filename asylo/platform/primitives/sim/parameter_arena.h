@@ -0,0 +1,77 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SIM_PARAMETER_ARENA_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SIM_PARAMETER_ARENA_H_
+
+#include <cstddef>
+
+namespace asylo {
+namespace primitives {
+
+// A per-thread cache of preallocated blocks backing the parameter stack items
+// and small extents the simulated enclave allocates in untrusted memory.
+//
+// Blocks are ordinary malloc() allocations of kBlockSize bytes. Parameter
+// stacks are shared across the boundary, and untrusted code releases items
+// pushed by the enclave with free(), so every pointer handed out by the arena
+// must remain valid to pass to free(). The arena keeps freed blocks instead of
+// returning them to malloc, and hands them out again for the next allocation
+// that fits.
+//
+// An arena is not thread-safe; each thread uses its own.
+class ParameterArena {
+ public:
+  // Size of a cached block in bytes.
+  static constexpr size_t kBlockSize = 256;
+
+  // Maximum number of blocks cached by an arena.
+  static constexpr size_t kCapacity = 64;
+
+  ParameterArena() = default;
+  ParameterArena(const ParameterArena &) = delete;
+  ParameterArena &operator=(const ParameterArena &) = delete;
+
+  // Frees all cached blocks.
+  ~ParameterArena();
+
+  // Returns the arena of the calling thread.
+  static ParameterArena *ForCurrentThread();
+
+  // Preallocates blocks until |count| blocks, or kCapacity, are cached.
+  void Reserve(size_t count);
+
+  // Allocates |size| bytes, from a cached block if |size| fits in one.
+  void *Allocate(size_t size);
+
+  // Releases |ptr|, which must have been returned by malloc() or Allocate(),
+  // caching it if it can be reused as a block.
+  void Free(void *ptr);
+
+  // Returns the number of cached blocks.
+  size_t cached() const { return count_; }
+
+ private:
+  void *blocks_[kCapacity];
+  size_t count_ = 0;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SIM_PARAMETER_ARENA_H_
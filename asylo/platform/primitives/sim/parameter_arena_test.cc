@@ -0,0 +1,92 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sim/parameter_arena.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+TEST(ParameterArenaTest, ReusesFreedBlocks) {
+  ParameterArena arena;
+  void *block = arena.Allocate(16);
+  ASSERT_NE(block, nullptr);
+  memset(block, 0, ParameterArena::kBlockSize);
+  arena.Free(block);
+  EXPECT_EQ(arena.cached(), 1);
+  EXPECT_EQ(arena.Allocate(ParameterArena::kBlockSize), block);
+  EXPECT_EQ(arena.cached(), 0);
+  arena.Free(block);
+}
+
+TEST(ParameterArenaTest, ReservePreallocatesBlocks) {
+  ParameterArena arena;
+  arena.Reserve(8);
+  EXPECT_EQ(arena.cached(), 8);
+  arena.Reserve(2 * ParameterArena::kCapacity);
+  EXPECT_EQ(arena.cached(), ParameterArena::kCapacity);
+  void *block = arena.Allocate(1);
+  EXPECT_EQ(arena.cached(), ParameterArena::kCapacity - 1);
+  arena.Free(block);
+  EXPECT_EQ(arena.cached(), ParameterArena::kCapacity);
+
+  // A full arena releases freed blocks.
+  arena.Free(malloc(ParameterArena::kBlockSize));
+  EXPECT_EQ(arena.cached(), ParameterArena::kCapacity);
+}
+
+TEST(ParameterArenaTest, LargeBuffersBypassTheCache) {
+  ParameterArena arena;
+  void *buffer = arena.Allocate(16 * ParameterArena::kBlockSize);
+  ASSERT_NE(buffer, nullptr);
+  arena.Free(buffer);
+  EXPECT_EQ(arena.cached(), 0);
+
+  // Buffers too small to serve as a block are not cached either.
+  arena.Free(malloc(8));
+  EXPECT_EQ(arena.cached(), 0);
+}
+
+// Blocks remain ordinary malloc() allocations, so untrusted code may release
+// them with free().
+TEST(ParameterArenaTest, BlocksMayBeReleasedWithFree) {
+  ParameterArena arena;
+  arena.Reserve(1);
+  free(arena.Allocate(32));
+  EXPECT_EQ(arena.cached(), 0);
+}
+
+TEST(ParameterArenaTest, ThreadsUseSeparateArenas) {
+  ParameterArena *main_arena = ParameterArena::ForCurrentThread();
+  ParameterArena *thread_arena = nullptr;
+  std::thread thread(
+      [&thread_arena] { thread_arena = ParameterArena::ForCurrentThread(); });
+  thread.join();
+  EXPECT_NE(thread_arena, main_arena);
+  EXPECT_EQ(ParameterArena::ForCurrentThread(), main_arena);
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
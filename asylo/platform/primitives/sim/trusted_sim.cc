@@ -20,6 +20,8 @@
 #include <cstdio>
 #include <cstring>
 
+#include "asylo/platform/common/cpu_time.h"
+#include "asylo/platform/common/enclave_exits.h"
 #include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/sim/shared_sim.h"
 #include "asylo/platform/primitives/primitive_status.h"
@@ -101,8 +103,11 @@ extern "C" void *enclave_sbrk(intptr_t increment) {
   return result;
 }
 
+// The time the calling thread spends in the enclave is charged to its CPU-time
+// clocks, as on the SGX backend.
 extern "C" PrimitiveStatus asylo_enclave_call(uint64_t selector,
                                               TrustedParameterStack *params) {
+  ScopedTrustedExecution trusted_execution;
   if (GetSimTrampoline()->magic_number != kTrampolineMagicNumber ||
       GetSimTrampoline()->version != kTrampolineVersion) {
     TrustedPrimitives::BestEffortAbort(
@@ -131,6 +136,8 @@ PrimitiveStatus TrustedPrimitives::UntrustedCall(
     uint64_t untrusted_selector,
     ParameterStack<TrustedPrimitives::UntrustedLocalAlloc,
                    TrustedPrimitives::UntrustedLocalFree> *params) {
+  ScopedEnclaveExit enclave_exit;
+  ScopedUntrustedExecution untrusted_execution;
   return GetSimTrampoline()->asylo_exit_call(untrusted_selector, params);
 }
 
@@ -20,7 +20,9 @@
 
 #include <dlfcn.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
+#include <chrono>
 #include <cstddef>
 #include <cstdlib>
 #include <memory>
@@ -30,9 +32,11 @@
 #include "absl/debugging/leak_check.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "asylo/platform/common/time_util.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/sim/parameter_arena.h"
 #include "asylo/platform/primitives/sim/shared_sim.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/status_conversions.h"
@@ -44,14 +48,69 @@ namespace primitives {
 
 namespace {
 
+// Number of parameter blocks preallocated for the thread loading an enclave.
+constexpr size_t kReservedParameterBlocks = 16;
+
+// Options of the enclave the calling thread is executing in, or nullptr outside
+// of an enclave.
+thread_local const SimOptions *current_options = nullptr;
+
+// Sets the options of the enclave the calling thread executes in and restores
+// the previous ones when going out of scope.
+class ScopedSimOptions {
+ public:
+  explicit ScopedSimOptions(const SimOptions *options)
+      : saved_options_(current_options) {
+    current_options = options;
+  }
+  ~ScopedSimOptions() { current_options = saved_options_; }
+
+  ScopedSimOptions(const ScopedSimOptions &other) = delete;
+  ScopedSimOptions &operator=(const ScopedSimOptions &other) = delete;
+
+ private:
+  const SimOptions *saved_options_;
+};
+
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+// Busy-waits for |latency_ns| nanoseconds to simulate an enclave transition.
+void InjectTransitionLatency(int64_t latency_ns) {
+  if (latency_ns <= 0) {
+    return;
+  }
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::nanoseconds(latency_ns);
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+}
+
 PrimitiveStatus sim_asylo_exit_call(uint64_t untrusted_selector, void *params) {
-  return Client::ExitCallback(untrusted_selector,
-                              reinterpret_cast<NativeParameterStack *>(params));
+  const SimOptions *options = current_options;
+  if (!options) {
+    return Client::ExitCallback(
+        untrusted_selector, reinterpret_cast<NativeParameterStack *>(params));
+  }
+  InjectTransitionLatency(options->exit_latency_ns);
+  PrimitiveStatus status = Client::ExitCallback(
+      untrusted_selector, reinterpret_cast<NativeParameterStack *>(params));
+  InjectTransitionLatency(options->enter_latency_ns);
+  return status;
 }
 
-void *sim_asylo_local_alloc_handler(size_t size) { return malloc(size); }
+// Parameter stack items and extents allocated by the enclave are served from
+// the per-thread parameter arena rather than by malloc.
+void *sim_asylo_local_alloc_handler(size_t size) {
+  return ParameterArena::ForCurrentThread()->Allocate(size);
+}
 
-void sim_asylo_local_free_handler(void *ptr) { return free(ptr); }
+void sim_asylo_local_free_handler(void *ptr) {
+  ParameterArena::ForCurrentThread()->Free(ptr);
+}
 
 inline size_t RoundUpToPageBoundary(size_t size) {
   const size_t kPageSize = getpagesize();
@@ -98,25 +157,38 @@ StatusOr<std::shared_ptr<Client>> SimBackend::Load(
     const absl::string_view enclave_name,
     const std::string &path,
     std::unique_ptr<Client::ExitCallProvider> exit_call_provider) {
+  return Load(enclave_name, path, std::move(exit_call_provider), SimOptions());
+}
+
+StatusOr<std::shared_ptr<Client>> SimBackend::Load(
+    const absl::string_view enclave_name, const std::string &path,
+    std::unique_ptr<Client::ExitCallProvider> exit_call_provider,
+    const SimOptions &options) {
   // Initialize trampoline once. absl::call_once guarantees that initialization
   // will run exactly once across all threads, and all other threads will not
   // run it, but will instead wait for the first one to finish running.
   absl::call_once(init_trampoline_once, &InitTrampolineOnce);
+  ParameterArena::ForCurrentThread()->Reserve(kReservedParameterBlocks);
 
   std::shared_ptr<SimEnclaveClient> client(
       new SimEnclaveClient(enclave_name, std::move(exit_call_provider)));
+  client->options_ = options;
 
   // Open the enclave shared object file.
+  int64_t dlopen_start = MonotonicClock();
   {
     // Make client reference available as thread-local for the time it loads
     // the enclave binary, in order to enable exit calls by the enclave
     // initialization.
     Client::ScopedCurrentClient scoped_client(client.get());
+    ScopedSimOptions scoped_options(&client->options_);
 
     // dlopen may allocate resources which are not disposed by dlclose.
     absl::LeakCheckDisabler disabler;
     client->dl_handle_ = dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
   }
+  client->load_phases_.push_back(
+      {"dlopen", dlopen_start, MonotonicClock(), 0});
   if (!client->dl_handle_) {
     return Status{
         error::GoogleError::NOT_FOUND,
@@ -124,7 +196,10 @@ StatusOr<std::shared_ptr<Client>> SimBackend::Load(
   }
 
   // Resolve and set the enclave entry point trampoline.
+  int64_t resolve_start = MonotonicClock();
   void *asylo_enclave_call = dlsym(client->dl_handle_, "asylo_enclave_call");
+  client->load_phases_.push_back(
+      {"resolve_entry_points", resolve_start, MonotonicClock(), 0});
   if (!asylo_enclave_call) {
     return Status{error::GoogleError::NOT_FOUND,
                   "Could not resolve enclave entry handler: "
@@ -153,8 +228,13 @@ Status SimEnclaveClient::EnclaveCallInternal(uint64_t selector,
                   "Enclave client closed or uninitialized."};
   }
 
-  const auto status = enclave_call_(selector, params);
-  return MakeStatus(status);
+  InjectTransitionLatency(options_.enter_latency_ns);
+  {
+    ScopedSimOptions scoped_options(&options_);
+    primitive_status = enclave_call_(selector, params);
+  }
+  InjectTransitionLatency(options_.exit_latency_ns);
+  return MakeStatus(primitive_status);
 }
 
 bool SimEnclaveClient::IsClosed() const { return dl_handle_ == nullptr; }
@@ -22,8 +22,10 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "asylo/platform/core/init_graph.h"
 #include "asylo/platform/primitives/sim/shared_sim.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/util/statusor.h"
@@ -42,6 +44,22 @@
 namespace asylo {
 namespace primitives {
 
+// Options of a simulated enclave.
+//
+// The simulator crosses the boundary with plain function calls, which makes it
+// much cheaper to enter and exit than a hardware enclave. The latency options
+// add a busy-wait to every transition, so that the simulator can stand in for
+// hardware when modeling the benefit of avoiding or batching transitions. With
+// both set to the measured EENTER and EEXIT costs, an enclave call costs one
+// entry and one exit, and an exit call one exit and one re-entry.
+struct SimOptions {
+  // Time spent entering the enclave, in nanoseconds.
+  int64_t enter_latency_ns = 0;
+
+  // Time spent exiting the enclave, in nanoseconds.
+  int64_t exit_latency_ns = 0;
+};
+
 // Simulator implementation of the generic "EnclaveBackend" concept.
 struct SimBackend {
   // Loads a simulation enclave from a file system path for the untrusted
@@ -51,6 +69,12 @@ struct SimBackend {
       const absl::string_view enclave_name,
       const std::string &path,
       std::unique_ptr<Client::ExitCallProvider> exit_call_provider);
+
+  // Loads a simulation enclave with the given |options|.
+  static StatusOr<std::shared_ptr<Client>> Load(
+      const absl::string_view enclave_name, const std::string &path,
+      std::unique_ptr<Client::ExitCallProvider> exit_call_provider,
+      const SimOptions &options);
 };
 
 // Simulator implementation of Client.
@@ -62,6 +86,11 @@ class SimEnclaveClient : public Client {
                              NativeParameterStack *params) override;
   bool IsClosed() const override;
 
+  // Returns the phases of loading the enclave, on the host thread that loaded
+  // it. "dlopen" includes the static initializers of the enclave and the exits
+  // they make. "resolve_entry_points" looks up the enclave entry handler.
+  const std::vector<InitPhase> &load_phases() const { return load_phases_; }
+
  private:
   // Allow the loader to create client instances directly.
   friend SimBackend;
@@ -79,6 +108,12 @@ class SimEnclaveClient : public Client {
   // trusted execution mode and entering the enclave with a selector and message
   // buffers.
   EnclaveCallPtr enclave_call_ = nullptr;
+
+  // Options the enclave was loaded with.
+  SimOptions options_;
+
+  // Phases of SimBackend::Load, in the order they ran.
+  std::vector<InitPhase> load_phases_;
 };
 
 }  // namespace primitives
@@ -35,12 +35,15 @@
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/primitives/util/entry_scheduler.h"
 #include "asylo/test/util/status_matchers.h"
 #include "asylo/util/status.h"
 #include "asylo/util/thread.h"
 
 using ::testing::_;
 using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::Le;
 using ::testing::MockFunction;
 using ::testing::Not;
 using ::testing::NotNull;
@@ -231,47 +234,50 @@ TEST_F(PrimitivesTest, AbortEnclave) {
   EXPECT_THAT(status, Not(IsOk()));
 }
 
+// Enter an instance of the test enclave to compute a Fibonacci number, which
+// recurses through UntrustedFibonacci.
+int32_t TrustedFibonacciOrDie(const std::shared_ptr<Client> &client,
+                              int32_t n) {
+  NativeParameterStack params;
+  params.PushByCopy<int32_t>(n);
+  ASYLO_EXPECT_OK(client->EnclaveCall(kTrustedFibonacci, &params));
+  EXPECT_FALSE(params.empty());
+  const int32_t res = params.Pop<int32_t>();
+  EXPECT_TRUE(params.empty());
+  return res;
+}
+
+// An exit handler to compute a Fibonacci number, calling back into the enclave
+// recursively.
+Status UntrustedFibonacci(std::shared_ptr<Client> client, void *context,
+                          NativeParameterStack *params) {
+  if (params->empty()) {
+    return Status{error::GoogleError::INVALID_ARGUMENT,
+                  "TrustedFibonacci called with incorrent argument(s)."};
+  }
+  const int32_t n = params->Pop<int32_t>();
+  if (!params->empty()) {
+    return Status{error::GoogleError::INVALID_ARGUMENT,
+                  "TrustedFibonacci called with incorrent argument(s)."};
+  }
+  if (n >= 50) {
+    return Status{error::GoogleError::INVALID_ARGUMENT,
+                  "UntrustedFibonacci called with invalid argument."};
+  }
+  params->PushByCopy<int32_t>(n < 2 ? n
+                                    : TrustedFibonacciOrDie(client, n - 1) +
+                                          TrustedFibonacciOrDie(client, n - 2));
+  return Status::OkStatus();
+}
+
 // Test control flow passing in and out of an enclave.
 TEST_F(PrimitivesTest, CallChain) {
   auto client = LoadTestEnclaveOrDie(/*reload=*/false);
 
-  auto trusted_fibonacci = [&client](int32_t n) -> int32_t {
-    NativeParameterStack params;
-    params.PushByCopy<int32_t>(n);
-    ASYLO_EXPECT_OK(client->EnclaveCall(kTrustedFibonacci, &params));
-    EXPECT_FALSE(params.empty());
-    const int32_t res = params.Pop<int32_t>();
-    EXPECT_TRUE(params.empty());
-    return res;
-  };
-
-  // An exit handler to compute a Fibonacci number, calling back into the
-  // enclave recursively.
-  ExitHandler::Callback fibonacci_handler =
-      [&](std::shared_ptr<Client> client, void *context,
-          NativeParameterStack *params) -> Status {
-    if (params->empty()) {
-      return Status{error::GoogleError::INVALID_ARGUMENT,
-                    "TrustedFibonacci called with incorrent argument(s)."};
-    }
-    const int32_t n = params->Pop<int32_t>();
-    if (!params->empty()) {
-      return Status{error::GoogleError::INVALID_ARGUMENT,
-                    "TrustedFibonacci called with incorrent argument(s)."};
-    }
-    if (n >= 50) {
-      return Status{error::GoogleError::INVALID_ARGUMENT,
-                    "UntrustedFibonacci called with invalid argument."};
-    }
-    params->PushByCopy<int32_t>(
-        n < 2 ? n : trusted_fibonacci(n - 1) + trusted_fibonacci(n - 2));
-    return Status::OkStatus();
-  };
-
   // Register the Fibonacci exit handler.
   ASYLO_EXPECT_OK(client->exit_call_provider()->RegisterExitHandler(
-      kUntrustedFibonacci, ExitHandler{fibonacci_handler}));
-  EXPECT_THAT(trusted_fibonacci(20), Eq(6765));
+      kUntrustedFibonacci, ExitHandler{UntrustedFibonacci}));
+  EXPECT_THAT(TrustedFibonacciOrDie(client, 20), Eq(6765));
 }
 
 // Ensure many threads can attempt enter the enclave simultaneously.
@@ -292,6 +298,49 @@ TEST_F(PrimitivesTest, ThreadedTest) {
   }
 }
 
+// Ensure entries beyond the limit of an entry scheduler wait for a slot rather
+// than fail.
+TEST_F(PrimitivesTest, ScheduledThreadedTest) {
+  constexpr int kNumThreads = 64;
+  constexpr int kMaxEntries = 2;
+  auto client = LoadTestEnclaveOrDie(/*reload=*/false);
+  EntryScheduler::Options options;
+  options.max_concurrent_entries = kMaxEntries;
+  client->set_entry_scheduler(absl::make_unique<EntryScheduler>(options));
+
+  std::vector<Thread> threads;
+  for (int j = 0; j < kNumThreads; j++) {
+    threads.emplace_back([&client, j]() {
+      auto result = MultiplyByTwoOrDie(client, j);
+      EXPECT_THAT(result, Eq(2 * j));
+    });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  const EntryScheduler::Stats stats = client->entry_scheduler()->GetStats();
+  EXPECT_THAT(stats.admitted_entries, Eq(kNumThreads));
+  EXPECT_THAT(stats.peak_active_entries, Le(kMaxEntries));
+  EXPECT_THAT(stats.rejected_entries, Eq(0));
+  EXPECT_THAT(stats.active_entries, Eq(0));
+  EXPECT_THAT(stats.queue_length, Eq(0));
+}
+
+// Ensure calls back into the enclave from an exit handler reuse the entry slot
+// of the calling thread instead of waiting for a new one.
+TEST_F(PrimitivesTest, ScheduledCallChain) {
+  auto client = LoadTestEnclaveOrDie(/*reload=*/false);
+  EntryScheduler::Options options;
+  options.max_concurrent_entries = 1;
+  client->set_entry_scheduler(absl::make_unique<EntryScheduler>(options));
+
+  ASYLO_EXPECT_OK(client->exit_call_provider()->RegisterExitHandler(
+      kUntrustedFibonacci, ExitHandler{UntrustedFibonacci}));
+  EXPECT_THAT(TrustedFibonacciOrDie(client, 10), Eq(55));
+  EXPECT_THAT(client->entry_scheduler()->GetStats().admitted_entries, Eq(1));
+}
+
 TEST_F(PrimitivesTest, ThreadedStressMallocsTest) {
   constexpr int kNumThreads = 64;
   constexpr uint64_t kMallocCount = 64;
@@ -346,6 +395,17 @@ TEST_F(PrimitivesTest, TrustedMalloc) {
   EXPECT_TRUE(params.empty());
 }
 
+// Ensure the time a thread spends in the enclave is charged to its CPU-time
+// clock.
+TEST_F(PrimitivesTest, ThreadCpuTime) {
+  auto client = LoadTestEnclaveOrDie(/*reload=*/false);
+  NativeParameterStack params;
+  ASYLO_EXPECT_OK(client->EnclaveCall(kThreadCpuTimeSelector, &params));
+  EXPECT_FALSE(params.empty());
+  EXPECT_THAT(params.Pop<int64_t>(), Gt(0));
+  EXPECT_TRUE(params.empty());
+}
+
 // Ensure the buffers returned by untrusted alloc do not satisfy
 // TrustedPrimitives::IsTrustedExtent().
 TEST_F(PrimitivesTest, UnrustedAlloc) {
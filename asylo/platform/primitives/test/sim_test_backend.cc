@@ -31,6 +31,10 @@
 
 DEFINE_string(enclave_binary, "",
               "Path to the Sim enclave binary to be loaded");
+DEFINE_int64(sim_enter_latency_ns, 0,
+             "Simulated cost of entering the enclave, in nanoseconds");
+DEFINE_int64(sim_exit_latency_ns, 0,
+             "Simulated cost of exiting the enclave, in nanoseconds");
 
 namespace asylo {
 namespace primitives {
@@ -39,9 +43,11 @@ namespace test {
 StatusOr<std::shared_ptr<Client>> SimTestBackend::LoadTestEnclave(
     const absl::string_view enclave_name,
     std::unique_ptr<Client::ExitCallProvider> exit_call_provider) {
-  return LoadEnclave<SimBackend>(enclave_name,
-                                 FLAGS_enclave_binary,
-                                 std::move(exit_call_provider));
+  SimOptions options;
+  options.enter_latency_ns = FLAGS_sim_enter_latency_ns;
+  options.exit_latency_ns = FLAGS_sim_exit_latency_ns;
+  return LoadEnclave<SimBackend>(enclave_name, FLAGS_enclave_binary,
+                                 std::move(exit_call_provider), options);
 }
 
 TestBackend *TestBackend::Get() {
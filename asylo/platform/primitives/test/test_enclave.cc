@@ -18,6 +18,7 @@
 
 #include <vector>
 
+#include "asylo/platform/common/cpu_time.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/parameter_stack.h"
 #include "asylo/platform/primitives/primitive_status.h"
@@ -224,6 +225,24 @@ PrimitiveStatus StressMallocs(void *context, TrustedParameterStack *params) {
   return PrimitiveStatus::OkStatus();
 }
 
+// Reads the CPU time of the calling thread until it advances, and returns the
+// difference between the last and the first reading. Parameter is a single
+// OUT.
+PrimitiveStatus ThreadCpuTime(void *context, TrustedParameterStack *params) {
+  if (!params->empty()) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "ThreadCpuTime called with incorrect argument(s)."};
+  }
+  constexpr int kMaxReads = 1 << 24;
+  const int64_t start = ThreadCpuTimeNanoseconds();
+  int64_t end = start;
+  for (int i = 0; i < kMaxReads && end == start; ++i) {
+    end = ThreadCpuTimeNanoseconds();
+  }
+  params->PushByCopy<int64_t>(end - start);
+  return PrimitiveStatus::OkStatus();
+}
+
 }  // namespace
 
 // Implements the required enclave initialization function.
@@ -244,6 +263,8 @@ extern "C" PrimitiveStatus asylo_enclave_init() {
       kCopyMultipleParamsSelector, EntryHandler{CopyMultipleParams}));
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
       kStressMallocs, EntryHandler{StressMallocs}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      kThreadCpuTimeSelector, EntryHandler{ThreadCpuTime}));
   return initialized
              ? PrimitiveStatus::OkStatus()
              : PrimitiveStatus{::asylo::error::GoogleError::FAILED_PRECONDITION,
@@ -28,6 +28,7 @@
 #include "asylo/platform/primitives/util/status_conversions.h"
 #include "asylo/util/asylo_macros.h"
 #include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
 
 namespace asylo {
@@ -36,8 +37,20 @@ namespace primitives {
 thread_local Client *Client::current_client_ = nullptr;
 
 Status Client::EnclaveCall(uint64_t selector, NativeParameterStack *params) {
-  ScopedCurrentClient scoped_client(this);
-  return EnclaveCallInternal(selector, params);
+  // A call made from an exit handler of this enclave reuses the entry slot of
+  // the thread that exited, so only outermost calls are scheduled.
+  if (!entry_scheduler_ || current_client_ == this) {
+    ScopedCurrentClient scoped_client(this);
+    return EnclaveCallInternal(selector, params);
+  }
+  ASYLO_RETURN_IF_ERROR(entry_scheduler_->Enter());
+  Status status;
+  {
+    ScopedCurrentClient scoped_client(this);
+    status = EnclaveCallInternal(selector, params);
+  }
+  entry_scheduler_->Exit();
+  return status;
 }
 
 PrimitiveStatus Client::ExitCallback(uint64_t untrusted_selector,
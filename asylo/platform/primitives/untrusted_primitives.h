@@ -27,6 +27,7 @@
 #include "asylo/platform/primitives/parameter_stack.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/util/entry_scheduler.h"
 #include "asylo/util/asylo_macros.h"
 #include "asylo/util/status.h"
 #include "asylo/util/statusor.h"
@@ -140,9 +141,23 @@ class Client : public std::enable_shared_from_this<Client> {
   // Input `params` is copied into the enclave, which occurs locally inside the
   // same address space.
   // Conversely, results are copied and returned in 'params'.
+  // If an entry scheduler is installed, the call waits for an entry slot
+  // unless it is nested inside an exit from this enclave on the same thread.
   Status EnclaveCall(uint64_t selector,
                      NativeParameterStack *params) ASYLO_MUST_USE_RESULT;
 
+  // Installs a scheduler that limits the number of threads concurrently inside
+  // the enclave. Must be called before the enclave is entered concurrently.
+  void set_entry_scheduler(std::unique_ptr<EntryScheduler> entry_scheduler) {
+    entry_scheduler_ = std::move(entry_scheduler);
+  }
+
+  // Returns the installed entry scheduler, or nullptr if entries are not
+  // scheduled.
+  const EntryScheduler *entry_scheduler() const {
+    return entry_scheduler_.get();
+  }
+
   // Enclave exit callback function shared with the enclave.
   static PrimitiveStatus ExitCallback(uint64_t untrusted_selector,
                                       NativeParameterStack *params);
@@ -164,6 +179,10 @@ class Client : public std::enable_shared_from_this<Client> {
   // Exit call provider for the enclave.
   const std::unique_ptr<ExitCallProvider> exit_call_provider_;
 
+  // Admission control for enclave entries, or nullptr if entries are not
+  // limited.
+  std::unique_ptr<EntryScheduler> entry_scheduler_;
+
   // Thread-local reference to the enclave that makes exit call.
   // Can be set by EnclaveCall, enclave loader.
   static thread_local Client *current_client_;
@@ -20,22 +20,45 @@
 
 #include <memory>
 
+#include "absl/memory/memory.h"
+
 namespace asylo {
 namespace primitives {
 
+constexpr uint64_t DispatchTable::kFlatCapacity;
+
+DispatchTable::DispatchTable()
+    : exit_table_(absl::flat_hash_map<uint64_t, const ExitHandler *>()) {
+  for (auto &slot : flat_table_) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
 // Registers a callback as the handler routine for an enclave exit point
 // `untrusted_selector`. Returns an error code if a handler has already been
 // registered for `trusted_selector` or if an invalid selector value is
 // passed.
 Status DispatchTable::RegisterExitHandler(uint64_t untrusted_selector,
                                           const ExitHandler &handler) {
+  absl::MutexLock lock(&mu_);
   // Ensure no handler is installed for untrusted_selector.
+  if (untrusted_selector < kFlatCapacity) {
+    if (flat_table_[untrusted_selector].load(std::memory_order_relaxed)) {
+      return {error::GoogleError::ALREADY_EXISTS,
+              "Invalid selector in RegisterExitHandler."};
+    }
+    handlers_.push_back(absl::make_unique<ExitHandler>(handler));
+    flat_table_[untrusted_selector].store(handlers_.back().get(),
+                                          std::memory_order_release);
+    return Status::OkStatus();
+  }
   auto locked_exit_table = exit_table_.Lock();
   if (locked_exit_table->contains(untrusted_selector)) {
     return {error::GoogleError::ALREADY_EXISTS,
             "Invalid selector in RegisterExitHandler."};
   }
-  locked_exit_table->emplace(untrusted_selector, handler);
+  handlers_.push_back(absl::make_unique<ExitHandler>(handler));
+  locked_exit_table->emplace(untrusted_selector, handlers_.back().get());
   return Status::OkStatus();
 }
 
@@ -43,17 +66,22 @@ Status DispatchTable::RegisterExitHandler(uint64_t untrusted_selector,
 Status DispatchTable::InvokeExitHandler(uint64_t untrusted_selector,
                                         NativeParameterStack *params,
                                         Client *client) {
-  ExitHandler handler;
-  {
+  const ExitHandler *handler = nullptr;
+  if (untrusted_selector < kFlatCapacity) {
+    handler = flat_table_[untrusted_selector].load(std::memory_order_acquire);
+  } else {
     auto locked_exit_table = exit_table_.ReaderLock();
     auto it = locked_exit_table->find(untrusted_selector);
-    if (it == locked_exit_table->end()) {
-      return {error::GoogleError::OUT_OF_RANGE,
-              "Invalid selector in enclave exit."};
+    if (it != locked_exit_table->end()) {
+      handler = it->second;
     }
-    handler = it->second;
   }
-  return handler.callback(client->shared_from_this(), handler.context, params);
+  if (!handler) {
+    return {error::GoogleError::OUT_OF_RANGE,
+            "Invalid selector in enclave exit."};
+  }
+  return handler->callback(client->shared_from_this(), handler->context,
+                           params);
 }
 
 }  // namespace primitives
@@ -19,20 +19,37 @@
 #ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_DISPATCH_TABLE_H_
 #define ASYLO_PLATFORM_PRIMITIVES_UTIL_DISPATCH_TABLE_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/platform/primitives/parameter_stack.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/util/asylo_macros.h"
-#include "asylo/util/mutex_guarded.h"
+#include "asylo/util/read_mostly_guarded.h"
 
 namespace asylo {
 namespace primitives {
 
 // Implementation of ExitCallProvider based on dispatch table (thread safe).
+// Handlers are registered once at startup and looked up on every exit.
+// Selectors are small dense integers, so selectors below |kFlatCapacity| index
+// a fixed array of slots directly: a lookup is one acquire load, without
+// hashing or locking, and the handler is invoked in place rather than copied.
+// Larger selectors fall back to a read-mostly hash map. Registered handlers are
+// never removed, so a published slot stays valid for the life of the table.
 class DispatchTable : public Client::ExitCallProvider {
  public:
-  DispatchTable() : exit_table_(absl::flat_hash_map<uint64_t, ExitHandler>()) {}
+  // Number of selectors served by the flat table. Covers the runtime's reserved
+  // selectors and the first user selectors.
+  static constexpr uint64_t kFlatCapacity = 512;
+
+  DispatchTable();
 
   // Registers a callback as the handler routine for an enclave exit point
   // `untrusted_selector`. Returns an error code if a handler has already been
@@ -47,7 +64,17 @@ class DispatchTable : public Client::ExitCallProvider {
                            Client *client) override ASYLO_MUST_USE_RESULT;
 
  private:
-  MutexGuarded<absl::flat_hash_map<uint64_t, ExitHandler>> exit_table_;
+  // Handlers for selectors below kFlatCapacity, published with release
+  // semantics once fully constructed.
+  std::array<std::atomic<const ExitHandler *>, kFlatCapacity> flat_table_;
+
+  // Handlers for selectors at or above kFlatCapacity.
+  ReadMostlyGuarded<absl::flat_hash_map<uint64_t, const ExitHandler *>>
+      exit_table_;
+
+  // Serializes registration and owns every registered handler.
+  absl::Mutex mu_;
+  std::vector<std::unique_ptr<ExitHandler>> handlers_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace primitives
@@ -109,6 +109,33 @@ TEST(DispatchTableTest, HandlersInvocation) {
               StatusIs(error::GoogleError::OUT_OF_RANGE));
 }
 
+TEST(DispatchTableTest, SelectorsBeyondFlatCapacity) {
+  const auto client = std::make_shared<MockedEnclaveClient>();
+  MockedEnclaveClient::MockExitHandlerCallback callbacks[2];
+  const uint64_t kLastFlat = DispatchTable::kFlatCapacity - 1;
+  const uint64_t kFirstHashed = DispatchTable::kFlatCapacity;
+  EXPECT_CALL(callbacks[0], Call(Eq(client), _, _)).Times(1);
+  EXPECT_CALL(callbacks[1], Call(Eq(client), _, _)).Times(1);
+  Client::ExitCallProvider *provider = client->exit_call_provider();
+  ASSERT_THAT(provider->RegisterExitHandler(
+                  kLastFlat, ExitHandler{callbacks[0].AsStdFunction()}),
+              IsOk());
+  ASSERT_THAT(provider->RegisterExitHandler(
+                  kFirstHashed, ExitHandler{callbacks[1].AsStdFunction()}),
+              IsOk());
+  ASSERT_THAT(provider->RegisterExitHandler(
+                  kFirstHashed, ExitHandler{callbacks[1].AsStdFunction()}),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+  NativeParameterStack params;
+  EXPECT_THAT(provider->InvokeExitHandler(kLastFlat, &params, client.get()),
+              IsOk());
+  EXPECT_THAT(provider->InvokeExitHandler(kFirstHashed, &params, client.get()),
+              IsOk());
+  EXPECT_THAT(
+      provider->InvokeExitHandler(kFirstHashed + 1, &params, client.get()),
+      StatusIs(error::GoogleError::OUT_OF_RANGE));
+}
+
 TEST(DispatchTableTest, HandlersInMultipleThreads) {
   const size_t kThreads = 64;
   const size_t kCount = 256;
@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/entry_scheduler.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Priority of entries made by the current thread.
+thread_local EntryScheduler::Priority current_priority =
+    EntryScheduler::kNormal;
+
+}  // namespace
+
+constexpr int EntryScheduler::kNumPriorities;
+
+EntryScheduler::ScopedPriority::ScopedPriority(Priority priority)
+    : saved_priority_(current_priority) {
+  current_priority = priority;
+}
+
+EntryScheduler::ScopedPriority::~ScopedPriority() {
+  current_priority = saved_priority_;
+}
+
+EntryScheduler::EntryScheduler(const Options &options)
+    : options_(options), active_entries_(0) {}
+
+Status EntryScheduler::Enter() {
+  absl::MutexLock lock(&mu_);
+
+  // Admit the caller immediately only if nobody is queued ahead of it.
+  size_t queue_length = QueueLengthLocked();
+  if (active_entries_ < options_.max_concurrent_entries && queue_length == 0) {
+    ++active_entries_;
+    RecordAdmissionLocked(absl::ZeroDuration());
+    return Status::OkStatus();
+  }
+
+  if (options_.max_queue_length > 0 &&
+      queue_length >= options_.max_queue_length) {
+    ++stats_.rejected_entries;
+    return Status(error::GoogleError::RESOURCE_EXHAUSTED,
+                  absl::StrCat("Enclave entry queue is full (",
+                               queue_length, " callers waiting)"));
+  }
+
+  Waiter waiter;
+  std::deque<Waiter *> &queue = queues_[current_priority];
+  queue.push_back(&waiter);
+  absl::Time start = absl::Now();
+  if (!mu_.AwaitWithTimeout(absl::Condition(&waiter.admitted),
+                            options_.max_queue_wait)) {
+    queue.erase(std::find(queue.begin(), queue.end(), &waiter));
+    ++stats_.rejected_entries;
+    return Status(error::GoogleError::DEADLINE_EXCEEDED,
+                  "Timed out waiting to enter the enclave");
+  }
+
+  // The slot was handed over by Exit(), which left |active_entries_|
+  // unchanged.
+  ++stats_.queued_entries;
+  RecordAdmissionLocked(absl::Now() - start);
+  return Status::OkStatus();
+}
+
+void EntryScheduler::Exit() {
+  absl::MutexLock lock(&mu_);
+  for (int priority = kNumPriorities - 1; priority >= 0; --priority) {
+    std::deque<Waiter *> &queue = queues_[priority];
+    if (!queue.empty()) {
+      queue.front()->admitted = true;
+      queue.pop_front();
+      return;
+    }
+  }
+  --active_entries_;
+}
+
+size_t EntryScheduler::queue_length() const {
+  absl::MutexLock lock(&mu_);
+  return QueueLengthLocked();
+}
+
+EntryScheduler::Stats EntryScheduler::GetStats() const {
+  absl::MutexLock lock(&mu_);
+  Stats stats = stats_;
+  stats.active_entries = active_entries_;
+  stats.queue_length = QueueLengthLocked();
+  return stats;
+}
+
+size_t EntryScheduler::QueueLengthLocked() const {
+  size_t length = 0;
+  for (const auto &queue : queues_) {
+    length += queue.size();
+  }
+  return length;
+}
+
+void EntryScheduler::RecordAdmissionLocked(absl::Duration wait) {
+  ++stats_.admitted_entries;
+  stats_.peak_active_entries =
+      std::max(stats_.peak_active_entries, active_entries_);
+  stats_.total_queue_wait += wait;
+  stats_.max_queue_wait = std::max(stats_.max_queue_wait, wait);
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,152 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_ENTRY_SCHEDULER_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_ENTRY_SCHEDULER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace primitives {
+
+// Admission control for enclave entries.
+//
+// An enclave can only be entered by as many threads at once as it has thread
+// control structures (TCS). Rather than letting excess entries fail, an
+// EntryScheduler admits up to |max_concurrent_entries| callers and queues the
+// rest. Queued callers are admitted in priority order, and in FIFO order among
+// callers of the same priority. When a caller leaves, its slot is handed
+// directly to the next queued caller, so a stream of new arrivals cannot
+// overtake callers that are already waiting.
+//
+// Entries can be rejected rather than queued once the queue reaches
+// |max_queue_length|, and queued callers give up after |max_queue_wait|, so
+// that overload degrades into bounded latency rather than unbounded queueing.
+class EntryScheduler {
+ public:
+  // Entry priorities. Higher priorities are admitted first.
+  enum Priority { kLow = 0, kNormal = 1, kHigh = 2 };
+
+  struct Options {
+    // Maximum number of threads allowed inside the enclave at once. Must be
+    // positive.
+    int max_concurrent_entries = 1;
+
+    // Maximum number of queued callers. Entries that arrive when the queue is
+    // full fail with RESOURCE_EXHAUSTED. Zero means unbounded.
+    size_t max_queue_length = 0;
+
+    // Maximum time a caller waits in the queue before failing with
+    // DEADLINE_EXCEEDED.
+    absl::Duration max_queue_wait = absl::InfiniteDuration();
+  };
+
+  // A snapshot of the scheduler counters.
+  struct Stats {
+    // Number of callers currently inside the enclave.
+    int active_entries = 0;
+
+    // Largest number of callers that were inside the enclave at once.
+    int peak_active_entries = 0;
+
+    // Number of callers currently waiting to be admitted.
+    size_t queue_length = 0;
+
+    // Number of admitted entries, and how many of those had to wait.
+    uint64_t admitted_entries = 0;
+    uint64_t queued_entries = 0;
+
+    // Number of entries rejected because the queue was full or the wait timed
+    // out.
+    uint64_t rejected_entries = 0;
+
+    // Total and maximum time spent waiting by admitted entries.
+    absl::Duration total_queue_wait = absl::ZeroDuration();
+    absl::Duration max_queue_wait = absl::ZeroDuration();
+  };
+
+  // Sets the priority of entries made by the calling thread for the lifetime
+  // of the object. Threads that do not set a priority enter at kNormal.
+  class ScopedPriority {
+   public:
+    explicit ScopedPriority(Priority priority);
+    ~ScopedPriority();
+
+    ScopedPriority(const ScopedPriority &other) = delete;
+    ScopedPriority &operator=(const ScopedPriority &other) = delete;
+
+   private:
+    Priority saved_priority_;
+  };
+
+  explicit EntryScheduler(const Options &options);
+
+  EntryScheduler(const EntryScheduler &other) = delete;
+  EntryScheduler &operator=(const EntryScheduler &other) = delete;
+
+  // Blocks until the calling thread may enter the enclave, at the priority set
+  // by the innermost ScopedPriority on this thread. Returns an error if the
+  // entry was rejected, in which case Exit() must not be called.
+  Status Enter() LOCKS_EXCLUDED(mu_);
+
+  // Releases an entry slot acquired by a successful call to Enter().
+  void Exit() LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of callers waiting to be admitted.
+  size_t queue_length() const LOCKS_EXCLUDED(mu_);
+
+  // Returns a snapshot of the scheduler counters.
+  Stats GetStats() const LOCKS_EXCLUDED(mu_);
+
+  const Options &options() const { return options_; }
+
+ private:
+  static constexpr int kNumPriorities = kHigh + 1;
+
+  // A queued caller. Waiters live on the stack of the waiting thread.
+  struct Waiter {
+    bool admitted = false;
+  };
+
+  // Returns the number of queued callers across all priorities.
+  size_t QueueLengthLocked() const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records that a caller was admitted after waiting for |wait|.
+  void RecordAdmissionLocked(absl::Duration wait)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  int active_entries_ GUARDED_BY(mu_);
+  std::array<std::deque<Waiter *>, kNumPriorities> queues_ GUARDED_BY(mu_);
+  Stats stats_ GUARDED_BY(mu_);
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_ENTRY_SCHEDULER_H_
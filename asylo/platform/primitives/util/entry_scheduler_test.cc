@@ -0,0 +1,204 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/entry_scheduler.h"
+
+#include <atomic>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/thread.h"
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Le;
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+EntryScheduler::Options MakeOptions(int max_concurrent_entries) {
+  EntryScheduler::Options options;
+  options.max_concurrent_entries = max_concurrent_entries;
+  return options;
+}
+
+// Waits until |scheduler| has |length| queued callers.
+void WaitForQueueLength(const EntryScheduler &scheduler, size_t length) {
+  while (scheduler.queue_length() != length) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+}
+
+// Records the order in which threads are admitted.
+class AdmissionLog {
+ public:
+  void Add(int id) {
+    absl::MutexLock lock(&mu_);
+    ids_.push_back(id);
+  }
+
+  std::vector<int> ids() {
+    absl::MutexLock lock(&mu_);
+    return ids_;
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<int> ids_;
+};
+
+// Starts a thread that enters |scheduler| at |priority|, logs |id|, and exits.
+Thread StartEntry(EntryScheduler *scheduler, AdmissionLog *log, int id,
+                  EntryScheduler::Priority priority) {
+  return Thread([scheduler, log, id, priority] {
+    EntryScheduler::ScopedPriority scoped_priority(priority);
+    ASYLO_ASSERT_OK(scheduler->Enter());
+    log->Add(id);
+    scheduler->Exit();
+  });
+}
+
+TEST(EntrySchedulerTest, QueuesEntriesBeyondLimit) {
+  EntryScheduler scheduler(MakeOptions(2));
+  ASYLO_ASSERT_OK(scheduler.Enter());
+  ASYLO_ASSERT_OK(scheduler.Enter());
+  EXPECT_THAT(scheduler.GetStats().active_entries, Eq(2));
+
+  AdmissionLog log;
+  Thread waiter = StartEntry(&scheduler, &log, 1, EntryScheduler::kNormal);
+  WaitForQueueLength(scheduler, 1);
+  EXPECT_TRUE(log.ids().empty());
+
+  scheduler.Exit();
+  waiter.Join();
+  EXPECT_THAT(log.ids(), ElementsAre(1));
+  scheduler.Exit();
+
+  EntryScheduler::Stats stats = scheduler.GetStats();
+  EXPECT_THAT(stats.active_entries, Eq(0));
+  EXPECT_THAT(stats.peak_active_entries, Eq(2));
+  EXPECT_THAT(stats.queue_length, Eq(0));
+  EXPECT_THAT(stats.admitted_entries, Eq(3));
+  EXPECT_THAT(stats.queued_entries, Eq(1));
+  EXPECT_THAT(stats.rejected_entries, Eq(0));
+  EXPECT_THAT(stats.max_queue_wait, Ge(absl::ZeroDuration()));
+}
+
+TEST(EntrySchedulerTest, AdmitsByPriorityThenFifo) {
+  EntryScheduler scheduler(MakeOptions(1));
+  ASYLO_ASSERT_OK(scheduler.Enter());
+
+  AdmissionLog log;
+  std::vector<Thread> threads;
+  threads.push_back(StartEntry(&scheduler, &log, 1, EntryScheduler::kLow));
+  WaitForQueueLength(scheduler, 1);
+  threads.push_back(StartEntry(&scheduler, &log, 2, EntryScheduler::kNormal));
+  WaitForQueueLength(scheduler, 2);
+  threads.push_back(StartEntry(&scheduler, &log, 3, EntryScheduler::kHigh));
+  WaitForQueueLength(scheduler, 3);
+  threads.push_back(StartEntry(&scheduler, &log, 4, EntryScheduler::kNormal));
+  WaitForQueueLength(scheduler, 4);
+
+  scheduler.Exit();
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+  EXPECT_THAT(log.ids(), ElementsAre(3, 2, 4, 1));
+  EXPECT_THAT(scheduler.GetStats().peak_active_entries, Eq(1));
+}
+
+TEST(EntrySchedulerTest, RejectsEntriesWhenQueueIsFull) {
+  EntryScheduler::Options options = MakeOptions(1);
+  options.max_queue_length = 1;
+  EntryScheduler scheduler(options);
+  ASYLO_ASSERT_OK(scheduler.Enter());
+
+  AdmissionLog log;
+  Thread waiter = StartEntry(&scheduler, &log, 1, EntryScheduler::kNormal);
+  WaitForQueueLength(scheduler, 1);
+  EXPECT_THAT(scheduler.Enter(),
+              StatusIs(error::GoogleError::RESOURCE_EXHAUSTED));
+
+  scheduler.Exit();
+  waiter.Join();
+  EXPECT_THAT(scheduler.GetStats().rejected_entries, Eq(1));
+}
+
+TEST(EntrySchedulerTest, QueuedEntriesTimeOut) {
+  EntryScheduler::Options options = MakeOptions(1);
+  options.max_queue_wait = absl::Milliseconds(10);
+  EntryScheduler scheduler(options);
+  ASYLO_ASSERT_OK(scheduler.Enter());
+
+  EXPECT_THAT(scheduler.Enter(),
+              StatusIs(error::GoogleError::DEADLINE_EXCEEDED));
+  EXPECT_THAT(scheduler.queue_length(), Eq(0));
+  scheduler.Exit();
+
+  // The slot released above is free again.
+  ASYLO_EXPECT_OK(scheduler.Enter());
+  scheduler.Exit();
+  EXPECT_THAT(scheduler.GetStats().rejected_entries, Eq(1));
+}
+
+TEST(EntrySchedulerTest, NeverExceedsConcurrencyLimit) {
+  constexpr int kMaxEntries = 3;
+  constexpr int kNumThreads = 32;
+  constexpr int kEntriesPerThread = 100;
+  EntryScheduler scheduler(MakeOptions(kMaxEntries));
+
+  std::atomic<int> inside(0);
+  std::atomic<int> max_inside(0);
+  std::vector<Thread> threads;
+  threads.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&scheduler, &inside, &max_inside] {
+      for (int j = 0; j < kEntriesPerThread; ++j) {
+        ASYLO_ASSERT_OK(scheduler.Enter());
+        int now_inside = ++inside;
+        int observed = max_inside.load();
+        while (now_inside > observed &&
+               !max_inside.compare_exchange_weak(observed, now_inside)) {
+        }
+        --inside;
+        scheduler.Exit();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  EXPECT_THAT(max_inside.load(), Le(kMaxEntries));
+  EntryScheduler::Stats stats = scheduler.GetStats();
+  EXPECT_THAT(stats.peak_active_entries, Le(kMaxEntries));
+  EXPECT_THAT(stats.admitted_entries, Eq(kNumThreads * kEntriesPerThread));
+  EXPECT_THAT(stats.active_entries, Eq(0));
+  EXPECT_THAT(stats.queue_length, Eq(0));
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
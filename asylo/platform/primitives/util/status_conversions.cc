@@ -36,8 +36,11 @@ PrimitiveStatus MakePrimitiveStatus(const Status& status) {
 }
 
 Status MakeStatus(const PrimitiveStatus& primitiveStatus) {
-  return Status{error::GoogleErrorSpace::GetInstance(),
-                primitiveStatus.error_code(), primitiveStatus.error_message()};
+  // Errors returned across the enclave boundary come from a small set of
+  // messages, so their blocks are shared rather than allocated each time.
+  return Status::Recurring(error::GoogleErrorSpace::GetInstance(),
+                           primitiveStatus.error_code(),
+                           primitiveStatus.error_message());
 }
 
 }  // namespace primitives
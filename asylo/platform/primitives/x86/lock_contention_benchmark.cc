@@ -0,0 +1,158 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the test-and-test-and-set spin lock, the ticket lock, the MCS lock,
+// and the hybrid lock under contention from 1 to --max_threads threads. Each
+// thread repeatedly takes the lock, updates shared state, releases it, and does
+// some work of its own. The benchmark reports the total throughput and two
+// fairness measures over the per-thread acquisition counts: the ratio of the
+// smallest count to the largest, and Jain's fairness index, both of which are 1
+// when every thread acquired the lock equally often.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "asylo/platform/primitives/x86/queue_lock.h"
+#include "asylo/platform/primitives/x86/spin_lock.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(max_threads, 64, "Largest number of contending threads");
+DEFINE_int32(duration_ms, 500, "Duration of each measurement");
+DEFINE_int32(critical_section_work, 20,
+             "Iterations of work done while holding the lock");
+DEFINE_int32(outside_work, 100,
+             "Iterations of work done between acquisitions");
+
+namespace asylo {
+namespace {
+
+struct SpinLock {
+  using Node = int;
+  void Lock(Node *) { asylo_spin_lock(&lock); }
+  void Unlock(Node *) { asylo_spin_unlock(&lock); }
+  asylo_spinlock_t lock = ASYLO_SPIN_LOCK_INITIALIZER;
+};
+
+struct TicketLock {
+  using Node = int;
+  void Lock(Node *) { asylo_ticket_lock(&lock); }
+  void Unlock(Node *) { asylo_ticket_unlock(&lock); }
+  asylo_ticket_lock_t lock = ASYLO_TICKET_LOCK_INITIALIZER;
+};
+
+struct McsLock {
+  using Node = asylo_mcs_node_t;
+  void Lock(Node *node) { asylo_mcs_lock(&lock, node); }
+  void Unlock(Node *node) { asylo_mcs_unlock(&lock, node); }
+  asylo_mcs_lock_t lock = ASYLO_MCS_LOCK_INITIALIZER;
+};
+
+struct HybridLock {
+  using Node = asylo_mcs_node_t;
+  void Lock(Node *node) { asylo_hybrid_lock(&lock, node); }
+  void Unlock(Node *) { asylo_hybrid_unlock(&lock); }
+  asylo_hybrid_lock_t lock = ASYLO_HYBRID_LOCK_INITIALIZER;
+};
+
+// Spins for |iterations| iterations of work the compiler cannot remove.
+void Work(int iterations, uint64_t *state) {
+  for (int i = 0; i < iterations; ++i) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    __asm__ volatile("" : "+r"(*state));
+  }
+}
+
+// Runs |threads| threads contending for a LockT for FLAGS_duration_ms and
+// prints the throughput and fairness.
+template <typename LockT>
+void Measure(const char *name, int threads) {
+  LockT lock;
+  uint64_t shared_state = 0;
+  std::atomic<bool> start(false);
+  std::atomic<bool> stop(false);
+  std::vector<uint64_t> counts(threads);
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([&, i] {
+      typename LockT::Node node;
+      uint64_t local_state = i;
+      uint64_t count = 0;
+      while (!start.load(std::memory_order_acquire)) {
+      }
+      while (!stop.load(std::memory_order_relaxed)) {
+        lock.Lock(&node);
+        Work(FLAGS_critical_section_work, &shared_state);
+        lock.Unlock(&node);
+        ++count;
+        Work(FLAGS_outside_work, &local_state);
+      }
+      counts[i] = count;
+    });
+  }
+
+  start.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_duration_ms));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  double total = 0;
+  double sum_of_squares = 0;
+  for (uint64_t count : counts) {
+    total += count;
+    sum_of_squares += static_cast<double>(count) * count;
+  }
+  auto minmax = std::minmax_element(counts.begin(), counts.end());
+  double min_max_ratio =
+      *minmax.second == 0 ? 0 : static_cast<double>(*minmax.first) /
+                                    *minmax.second;
+  double jain_index =
+      sum_of_squares == 0 ? 0 : total * total / (threads * sum_of_squares);
+  std::cout << absl::StrFormat("%-8s %3d threads %10.2f Mops/s"
+                               "   min/max %5.3f   Jain %5.3f\n",
+                               name, threads,
+                               total / FLAGS_duration_ms / 1e3,
+                               min_max_ratio, jain_index);
+}
+
+void Run() {
+  for (int threads = 1; threads <= FLAGS_max_threads; threads *= 2) {
+    Measure<SpinLock>("spin", threads);
+    Measure<TicketLock>("ticket", threads);
+    Measure<McsLock>("mcs", threads);
+    Measure<HybridLock>("hybrid", threads);
+  }
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Run();
+  return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_X86_QUEUE_LOCK_H_
+#define ASYLO_PLATFORM_PRIMITIVES_X86_QUEUE_LOCK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asylo/platform/primitives/x86/spin_lock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// This file declares queue-based spin locks for x86-64, complementing the
+// test-and-test-and-set lock in spin_lock.h, which is unfair and has every
+// waiter hammer the same cache line. Like spin_lock.h, this header may be
+// included from runtime components written in C and must not make use of C++
+// features.
+//
+// A ticket lock has the same interface as asylo_spinlock_t and serves waiters
+// in arrival order. Waiters spin on a single shared word, which is cheap to
+// acquire when the lock is lightly contended.
+//
+// An MCS lock serves waiters in arrival order and has each waiter spin on a
+// queue node of its own, so releasing the lock touches only the cache line of
+// the next waiter. It scales best under heavy contention. Callers pass the node
+// to both lock and unlock, and the node must remain valid until the lock is
+// released.
+//
+// Both hand the lock to the next waiter in line, so they stall whenever that
+// waiter is descheduled. A hybrid lock, declared last, queues waiters in an
+// MCS queue in front of a spin lock and suits hot locks that may be contended
+// by more threads than there are cores. It does not switch between modes
+// according to measured contention: every acquisition tries the spin lock
+// once and queues if that fails.
+//
+// The MCS and hybrid locks take a queue node from the caller, so they are not
+// drop-in replacements for asylo_spinlock_t behind an interface that passes
+// only the lock, such as a C API. Callers typically keep a thread-local node.
+
+// Ticket lock type, aligned to an x86-64 cache line to prevent false sharing.
+typedef struct {
+  // Ticket handed to the next thread to request the lock.
+  volatile uint32_t next;
+  // Ticket of the thread holding the lock.
+  volatile uint32_t owner;
+} asylo_ticket_lock_t __attribute__((aligned(64)));
+
+// Static initializer expression for an unlocked ticket lock.
+#define ASYLO_TICKET_LOCK_INITIALIZER \
+  { 0, 0 }
+
+// Locks the ticket lock referred to by |lock|. Waiting threads acquire the lock
+// in the order they called this routine. The behavior of calling this routine
+// on a lock the calling thread already holds is undefined.
+inline void asylo_ticket_lock(asylo_ticket_lock_t *lock) {
+  uint32_t ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+  uint32_t owner;
+  while ((owner = __atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE)) != ticket) {
+    // Back off in proportion to the number of waiters ahead of this one to
+    // limit the traffic on the shared cache line.
+    for (uint32_t i = (ticket - owner) * 16; i > 0; --i) {
+      __builtin_ia32_pause();
+    }
+  }
+}
+
+// Attempts to lock the ticket lock referred to by |lock| without waiting,
+// returning true if the lock was acquired.
+inline bool asylo_ticket_trylock(asylo_ticket_lock_t *lock) {
+  // The compare-exchange below reads |next|, which unlocking does not write,
+  // so it is this load that synchronizes with the release by the last holder.
+  uint32_t owner = __atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE);
+  uint32_t expected = owner;
+  return __atomic_compare_exchange_n(&lock->next,
+                                     /*expected=*/&expected,
+                                     /*desired=*/owner + 1,
+                                     /*weak=*/false,
+                                     /*success_memorder=*/__ATOMIC_ACQUIRE,
+                                     /*failure_memorder=*/__ATOMIC_RELAXED);
+}
+
+// Unlocks the ticket lock referred to by |lock|, handing it to the next waiting
+// thread. The behavior of unlocking a lock not held by the calling thread is
+// undefined.
+inline void asylo_ticket_unlock(asylo_ticket_lock_t *lock) {
+  // Only the holder writes |owner|, so a plain increment suffices.
+  __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+}
+
+// Queue node of a thread waiting on or holding an MCS lock, aligned to an
+// x86-64 cache line so that each waiter spins on a line of its own.
+typedef struct asylo_mcs_node {
+  struct asylo_mcs_node *volatile next;
+  volatile uint32_t locked;
+} asylo_mcs_node_t __attribute__((aligned(64)));
+
+// MCS lock type, pointing to the last node in the queue of waiters.
+typedef struct {
+  asylo_mcs_node_t *volatile tail;
+} asylo_mcs_lock_t __attribute__((aligned(64)));
+
+// Static initializer expression for an unlocked MCS lock.
+#define ASYLO_MCS_LOCK_INITIALIZER \
+  { NULL }
+
+// Locks the MCS lock referred to by |lock|, enqueuing |node|. Waiting threads
+// acquire the lock in the order they called this routine. The behavior of
+// calling this routine on a lock the calling thread already holds is undefined.
+inline void asylo_mcs_lock(asylo_mcs_lock_t *lock, asylo_mcs_node_t *node) {
+  node->next = NULL;
+  node->locked = 1;
+  asylo_mcs_node_t *predecessor =
+      __atomic_exchange_n(&lock->tail, node, __ATOMIC_ACQ_REL);
+  if (predecessor == NULL) {
+    return;
+  }
+  __atomic_store_n(&predecessor->next, node, __ATOMIC_RELEASE);
+  while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) {
+    __builtin_ia32_pause();
+  }
+}
+
+// Attempts to lock the MCS lock referred to by |lock| with |node| without
+// waiting, returning true if the lock was acquired.
+inline bool asylo_mcs_trylock(asylo_mcs_lock_t *lock, asylo_mcs_node_t *node) {
+  node->next = NULL;
+  node->locked = 0;
+  asylo_mcs_node_t *expected = NULL;
+  return __atomic_compare_exchange_n(&lock->tail,
+                                     /*expected=*/&expected,
+                                     /*desired=*/node,
+                                     /*weak=*/false,
+                                     /*success_memorder=*/__ATOMIC_ACQUIRE,
+                                     /*failure_memorder=*/__ATOMIC_RELAXED);
+}
+
+// Unlocks the MCS lock referred to by |lock|, which the calling thread acquired
+// with |node|, handing it to the next waiting thread. The behavior of unlocking
+// a lock not held by the calling thread is undefined.
+inline void asylo_mcs_unlock(asylo_mcs_lock_t *lock, asylo_mcs_node_t *node) {
+  asylo_mcs_node_t *successor = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+  if (successor == NULL) {
+    asylo_mcs_node_t *expected = node;
+    if (__atomic_compare_exchange_n(&lock->tail,
+                                    /*expected=*/&expected,
+                                    /*desired=*/NULL,
+                                    /*weak=*/false,
+                                    /*success_memorder=*/__ATOMIC_RELEASE,
+                                    /*failure_memorder=*/__ATOMIC_RELAXED)) {
+      return;
+    }
+    // A thread has swapped itself in as the tail but has not yet linked itself
+    // behind |node|. Wait for the link.
+    while ((successor = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) ==
+           NULL) {
+      __builtin_ia32_pause();
+    }
+  }
+  __atomic_store_n(&successor->locked, 0, __ATOMIC_RELEASE);
+}
+
+// Hybrid lock type. An uncontended acquisition takes the spin lock directly.
+// Under contention, waiters line up in an MCS queue and only the thread at the
+// head of the queue spins on the spin lock, so the shared cache line sees one
+// waiter at a time. Unlike the ticket and MCS locks, the lock itself is never
+// handed to a particular waiter, so it does not sit idle while that waiter is
+// descheduled.
+//
+// The lock is not fair. A newly arriving thread that finds the spin lock free
+// takes it ahead of queued waiters, so a waiter can be overtaken repeatedly
+// while the lock is released and retaken by other threads.
+typedef struct {
+  asylo_spinlock_t word;
+  asylo_mcs_lock_t queue;
+} asylo_hybrid_lock_t;
+
+// Static initializer expression for an unlocked hybrid lock.
+#define ASYLO_HYBRID_LOCK_INITIALIZER \
+  { ASYLO_SPIN_LOCK_INITIALIZER, ASYLO_MCS_LOCK_INITIALIZER }
+
+// Locks the hybrid lock referred to by |lock|, using |node| to wait in the
+// queue if the lock is contended. |node| is no longer needed once this routine
+// returns. The behavior of calling this routine on a lock the calling thread
+// already holds is undefined.
+inline void asylo_hybrid_lock(asylo_hybrid_lock_t *lock,
+                              asylo_mcs_node_t *node) {
+  if (asylo_spin_trylock(&lock->word)) {
+    return;
+  }
+  asylo_mcs_lock(&lock->queue, node);
+  asylo_spin_lock(&lock->word);
+  asylo_mcs_unlock(&lock->queue, node);
+}
+
+// Attempts to lock the hybrid lock referred to by |lock| without waiting,
+// returning true if the lock was acquired.
+inline bool asylo_hybrid_trylock(asylo_hybrid_lock_t *lock) {
+  return asylo_spin_trylock(&lock->word);
+}
+
+// Unlocks the hybrid lock referred to by |lock|. The behavior of unlocking a
+// lock not held by the calling thread is undefined.
+inline void asylo_hybrid_unlock(asylo_hybrid_lock_t *lock) {
+  asylo_spin_unlock(&lock->word);
+}
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+#endif  // ASYLO_PLATFORM_PRIMITIVES_X86_QUEUE_LOCK_H_
@@ -0,0 +1,169 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/x86/queue_lock.h"
+
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+constexpr int kManyThreads = 128;
+
+TEST(TicketLockTest, ManyThreadsTest) {
+  int shared_counter = 0;
+  asylo_ticket_lock_t lock = ASYLO_TICKET_LOCK_INITIALIZER;
+  std::vector<std::thread> threads;
+  threads.reserve(kManyThreads);
+  for (int i = 0; i < kManyThreads; i++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 256; i++) {
+        if (!asylo_ticket_trylock(&lock)) {
+          asylo_ticket_lock(&lock);
+        }
+        shared_counter++;
+        EXPECT_EQ(shared_counter, 1);
+        shared_counter--;
+        EXPECT_EQ(shared_counter, 0);
+        asylo_ticket_unlock(&lock);
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(shared_counter, 0);
+}
+
+TEST(TicketLockTest, TrylockFailsWhileHeld) {
+  asylo_ticket_lock_t lock = ASYLO_TICKET_LOCK_INITIALIZER;
+  EXPECT_TRUE(asylo_ticket_trylock(&lock));
+  EXPECT_FALSE(asylo_ticket_trylock(&lock));
+  asylo_ticket_unlock(&lock);
+  EXPECT_TRUE(asylo_ticket_trylock(&lock));
+  asylo_ticket_unlock(&lock);
+}
+
+TEST(McsLockTest, ManyThreadsTest) {
+  int shared_counter = 0;
+  asylo_mcs_lock_t lock = ASYLO_MCS_LOCK_INITIALIZER;
+  std::vector<std::thread> threads;
+  threads.reserve(kManyThreads);
+  for (int i = 0; i < kManyThreads; i++) {
+    threads.emplace_back([&]() {
+      asylo_mcs_node_t node;
+      for (int i = 0; i < 256; i++) {
+        if (!asylo_mcs_trylock(&lock, &node)) {
+          asylo_mcs_lock(&lock, &node);
+        }
+        shared_counter++;
+        EXPECT_EQ(shared_counter, 1);
+        shared_counter--;
+        EXPECT_EQ(shared_counter, 0);
+        asylo_mcs_unlock(&lock, &node);
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(shared_counter, 0);
+}
+
+TEST(McsLockTest, TrylockFailsWhileHeld) {
+  asylo_mcs_lock_t lock = ASYLO_MCS_LOCK_INITIALIZER;
+  asylo_mcs_node_t holder;
+  asylo_mcs_node_t other;
+  EXPECT_TRUE(asylo_mcs_trylock(&lock, &holder));
+  EXPECT_FALSE(asylo_mcs_trylock(&lock, &other));
+  asylo_mcs_unlock(&lock, &holder);
+  EXPECT_TRUE(asylo_mcs_trylock(&lock, &other));
+  asylo_mcs_unlock(&lock, &other);
+}
+
+// Checks that MCS waiters are granted the lock in the order they queued.
+TEST(McsLockTest, FifoOrder) {
+  constexpr int kWaiters = 8;
+  asylo_mcs_lock_t lock = ASYLO_MCS_LOCK_INITIALIZER;
+  asylo_mcs_node_t holder;
+  asylo_mcs_lock(&lock, &holder);
+
+  std::vector<int> order;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kWaiters; i++) {
+    asylo_mcs_node_t *tail = lock.tail;
+    threads.emplace_back([&lock, &order, i]() {
+      asylo_mcs_node_t node;
+      asylo_mcs_lock(&lock, &node);
+      order.push_back(i);
+      asylo_mcs_unlock(&lock, &node);
+    });
+    // Wait for the thread to enqueue before starting the next one.
+    while (lock.tail == tail) {
+      std::this_thread::yield();
+    }
+  }
+  asylo_mcs_unlock(&lock, &holder);
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(order.size(), static_cast<size_t>(kWaiters));
+  for (int i = 0; i < kWaiters; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+TEST(HybridLockTest, ManyThreadsTest) {
+  int shared_counter = 0;
+  asylo_hybrid_lock_t lock = ASYLO_HYBRID_LOCK_INITIALIZER;
+  std::vector<std::thread> threads;
+  threads.reserve(kManyThreads);
+  for (int i = 0; i < kManyThreads; i++) {
+    threads.emplace_back([&]() {
+      asylo_mcs_node_t node;
+      for (int i = 0; i < 256; i++) {
+        if (!asylo_hybrid_trylock(&lock)) {
+          asylo_hybrid_lock(&lock, &node);
+        }
+        shared_counter++;
+        EXPECT_EQ(shared_counter, 1);
+        shared_counter--;
+        EXPECT_EQ(shared_counter, 0);
+        asylo_hybrid_unlock(&lock);
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(shared_counter, 0);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,992 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/kv/sealed_kv_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+#include "asylo/platform/storage/secure/ctmmt_authenticated_dictionary.h"
+#include "asylo/platform/storage/utils/untrusted_file.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+using experimental::AeadCryptor;
+using platform::storage::CTMMTAuthenticatedDictionary;
+using platform::storage::FdCloser;
+
+constexpr char kCheckpointFileName[] = "CHECKPOINT";
+
+// Associated data that separates frames from checkpoints.
+constexpr char kFrameContext[] = "Asylo sealed KV store frame v1";
+constexpr char kCheckpointContext[] = "Asylo sealed KV store checkpoint v1";
+
+// A frame consists of a header followed by the sealed record. The header holds
+// the sequence number of the record (8 bytes), the size of the ciphertext (4
+// bytes), flags (1 byte), three reserved bytes and the nonce (12 bytes). All
+// of the header except the nonce is authenticated as associated data, along
+// with the id of the log segment.
+constexpr size_t kNonceSize = 12;
+constexpr size_t kAuthenticatedHeaderSize = 16;
+constexpr size_t kFrameHeaderSize = kAuthenticatedHeaderSize + kNonceSize;
+
+// Frame flag marking the last record of a batch.
+constexpr uint8_t kEndsBatch = 1;
+
+// A sealed record consists of its type (1 byte), the size of its key (4 bytes),
+// the key, and the value.
+constexpr uint8_t kPutRecord = 0;
+constexpr uint8_t kDeleteRecord = 1;
+constexpr size_t kRecordHeaderSize = 5;
+
+constexpr size_t kMaxKeySize = 1 << 16;
+constexpr size_t kMaxValueSize = 1 << 24;
+
+// A checkpoint consists of six 8-byte fields followed by the Merkle root.
+constexpr size_t kRootSize = 32;
+constexpr size_t kCheckpointSize = 6 * sizeof(uint64_t) + kRootSize;
+constexpr size_t kSealOverhead = 16;
+
+// Approximate number of bytes of updates committed by one group.
+constexpr size_t kMaxGroupBytes = 1 << 20;
+
+// Number of bytes the compactor buffers before writing to the new log.
+constexpr size_t kCompactionChunkSize = 1 << 20;
+
+void AppendUint32(uint32_t value, std::string *output) {
+  for (int i = 0; i < 4; ++i) {
+    output->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void AppendUint64(uint64_t value, std::string *output) {
+  for (int i = 0; i < 8; ++i) {
+    output->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+uint32_t LoadUint32(const uint8_t *input) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(input[i]) << (8 * i);
+  }
+  return value;
+}
+
+uint64_t LoadUint64(const uint8_t *input) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(input[i]) << (8 * i);
+  }
+  return value;
+}
+
+// Returns the associated data of a frame in the log segment with |segment_id|
+// and with the header |header|. Binding the segment keeps a frame from being
+// replayed in another log.
+std::string FrameAssociatedData(uint64_t segment_id,
+                                ByteContainerView header) {
+  std::string associated_data = kFrameContext;
+  AppendUint64(segment_id, &associated_data);
+  associated_data.append(reinterpret_cast<const char *>(header.data()),
+                         kAuthenticatedHeaderSize);
+  return associated_data;
+}
+
+Status DataLoss(absl::string_view message) {
+  return Status(error::GoogleError::DATA_LOSS, message);
+}
+
+}  // namespace
+
+struct SealedKvStore::SealedCheckpoint {
+  uint8_t nonce[kNonceSize];
+  uint8_t ciphertext[kCheckpointSize + kSealOverhead];
+};
+
+struct SealedKvStore::Segment {
+  Segment(uint64_t id, std::string path, int fd)
+      : id(id),
+        path(std::move(path)),
+        fd(fd),
+        file(absl::make_unique<UntrustedFile>(fd)) {}
+
+  const uint64_t id;
+  const std::string path;
+  FdCloser fd;
+
+  // Serializes accesses to |file|, which does not support concurrent I/O.
+  absl::Mutex mu;
+  std::unique_ptr<UntrustedFile> file GUARDED_BY(mu);
+};
+
+struct SealedKvStore::Writer {
+  const KvWriteBatch *batch;
+  Status status;
+  bool done;
+};
+
+void KvWriteBatch::Put(absl::string_view key, absl::string_view value) {
+  updates_.push_back(Update{false, std::string(key), std::string(value)});
+}
+
+void KvWriteBatch::Delete(absl::string_view key) {
+  updates_.push_back(Update{true, std::string(key), std::string()});
+}
+
+void KvWriteBatch::Clear() { updates_.clear(); }
+
+StatusOr<std::unique_ptr<SealedKvStore>> SealedKvStore::Open(
+    const std::string &directory, ByteContainerView key,
+    const SealedKvStoreOptions &options) {
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, AeadCryptor::CreateAesGcmSivCryptor(key));
+  if (cryptor->NonceSize() != kNonceSize ||
+      cryptor->MaxSealOverhead() != kSealOverhead) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Unexpected parameters of the AEAD scheme");
+  }
+  if (mkdir(directory.c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+    return Status(static_cast<error::PosixError>(errno),
+                  absl::StrCat("Could not create ", directory));
+  }
+
+  std::unique_ptr<SealedKvStore> store(
+      new SealedKvStore(directory, std::move(cryptor), options));
+  ASYLO_RETURN_IF_ERROR(store->Recover());
+  if (options.background_compaction) {
+    SealedKvStore *raw_store = store.get();
+    store->compaction_thread_ =
+        std::thread([raw_store] { raw_store->CompactionLoop(); });
+  }
+  return std::move(store);
+}
+
+SealedKvStore::SealedKvStore(std::string directory,
+                             std::unique_ptr<AeadCryptor> cryptor,
+                             const SealedKvStoreOptions &options)
+    : directory_(std::move(directory)),
+      cryptor_(std::move(cryptor)),
+      options_(options),
+      dictionary_(absl::make_unique<CTMMTAuthenticatedDictionary>()),
+      checkpoint_number_(0),
+      first_sequence_(0),
+      next_sequence_(0),
+      records_since_checkpoint_(0),
+      log_end_(0),
+      live_bytes_(0),
+      compaction_attempt_log_end_(0),
+      stopping_(false) {}
+
+SealedKvStore::~SealedKvStore() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  if (compaction_thread_.joinable()) {
+    compaction_thread_.join();
+  }
+
+  absl::MutexLock lock(&commit_mu_);
+  if (records_since_checkpoint_ > 0 && log_status_.ok()) {
+    std::shared_ptr<Segment> segment;
+    {
+      absl::ReaderMutexLock index_lock(&mu_);
+      segment = segment_;
+    }
+    Status status = WriteCheckpoint(CurrentCheckpoint(), segment.get());
+    LOG_IF(ERROR, !status.ok()) << "Could not write final checkpoint: "
+                                << status;
+  }
+}
+
+StatusOr<std::string> SealedKvStore::Get(absl::string_view key) {
+  Location location;
+  std::shared_ptr<Segment> segment;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return Status(error::GoogleError::NOT_FOUND, "Key not found");
+    }
+    location = it->second;
+    segment = segment_;
+  }
+
+  Record record;
+  ASYLO_RETURN_IF_ERROR(ReadFrame(segment.get(), location, &record));
+  if (record.is_delete || record.key != key) {
+    return DataLoss("Log frame does not hold the requested key");
+  }
+  return std::move(record.value);
+}
+
+Status SealedKvStore::Put(absl::string_view key, absl::string_view value) {
+  KvWriteBatch batch;
+  batch.Put(key, value);
+  return Write(batch);
+}
+
+Status SealedKvStore::Delete(absl::string_view key) {
+  KvWriteBatch batch;
+  batch.Delete(key);
+  return Write(batch);
+}
+
+Status SealedKvStore::Write(const KvWriteBatch &batch) {
+  for (const KvWriteBatch::Update &update : batch.updates_) {
+    if (update.key.size() > kMaxKeySize ||
+        update.value.size() > kMaxValueSize) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Keys are limited to ", kMaxKeySize,
+                                 " bytes and values to ", kMaxValueSize,
+                                 " bytes"));
+    }
+  }
+
+  Writer writer{&batch, Status::OkStatus(), false};
+  absl::MutexLock lock(&writers_mu_);
+  writers_.push_back(&writer);
+  while (!writer.done && writers_.front() != &writer) {
+    writers_cv_.Wait(&writers_mu_);
+  }
+  if (writer.done) {
+    return writer.status;
+  }
+
+  // This writer is at the front of the queue, so it commits the updates of
+  // the writers queued behind it as well.
+  std::vector<Writer *> group;
+  size_t group_bytes = 0;
+  for (Writer *queued : writers_) {
+    if (!group.empty() && group_bytes >= kMaxGroupBytes) {
+      break;
+    }
+    group.push_back(queued);
+    for (const KvWriteBatch::Update &update : queued->batch->updates_) {
+      group_bytes += update.key.size() + update.value.size();
+    }
+  }
+
+  writers_mu_.Unlock();
+  Status status;
+  {
+    absl::MutexLock commit_lock(&commit_mu_);
+    status = CommitGroup(group);
+  }
+  writers_mu_.Lock();
+
+  for (Writer *committed : group) {
+    writers_.pop_front();
+    committed->status = status;
+    committed->done = true;
+  }
+  writers_cv_.SignalAll();
+  return status;
+}
+
+StatusOr<std::vector<std::pair<std::string, std::string>>> SealedKvStore::Scan(
+    absl::string_view start_key, size_t limit) {
+  std::vector<Location> locations;
+  std::shared_ptr<Segment> segment;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    for (auto it = index_.lower_bound(start_key);
+         it != index_.end() && locations.size() < limit; ++it) {
+      locations.push_back(it->second);
+    }
+    segment = segment_;
+  }
+
+  std::vector<std::pair<std::string, std::string>> results;
+  results.reserve(locations.size());
+  for (const Location &location : locations) {
+    Record record;
+    ASYLO_RETURN_IF_ERROR(ReadFrame(segment.get(), location, &record));
+    if (record.is_delete) {
+      return DataLoss("Log frame of a live key holds a deletion");
+    }
+    results.emplace_back(std::move(record.key), std::move(record.value));
+  }
+  return std::move(results);
+}
+
+Status SealedKvStore::Checkpoint() {
+  absl::MutexLock lock(&commit_mu_);
+  std::shared_ptr<Segment> segment;
+  {
+    absl::ReaderMutexLock index_lock(&mu_);
+    segment = segment_;
+  }
+  return WriteCheckpoint(CurrentCheckpoint(), segment.get());
+}
+
+Status SealedKvStore::Compact() {
+  absl::MutexLock lock(&commit_mu_);
+  return CompactLocked();
+}
+
+uint64_t SealedKvStore::CheckpointNumber() {
+  absl::MutexLock lock(&commit_mu_);
+  return checkpoint_number_;
+}
+
+Status SealedKvStore::CheckpointStatus() {
+  absl::MutexLock lock(&commit_mu_);
+  return log_status_.ok() ? checkpoint_status_ : log_status_;
+}
+
+size_t SealedKvStore::Size() const {
+  absl::ReaderMutexLock lock(&mu_);
+  return index_.size();
+}
+
+uint64_t SealedKvStore::LogSize() const {
+  absl::ReaderMutexLock lock(&mu_);
+  return log_end_;
+}
+
+double SealedKvStore::GarbageRatio() const {
+  absl::ReaderMutexLock lock(&mu_);
+  if (log_end_ == 0) {
+    return 0;
+  }
+  return 1.0 - static_cast<double>(live_bytes_) / log_end_;
+}
+
+Status SealedKvStore::Recover() {
+  std::string checkpoint_path =
+      absl::StrCat(directory_, "/", kCheckpointFileName);
+  int fd = open(checkpoint_path.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    return Status(static_cast<error::PosixError>(errno),
+                  absl::StrCat("Could not open ", checkpoint_path));
+  }
+
+  absl::MutexLock lock(&commit_mu_);
+  checkpoint_fd_.reset(fd);
+  checkpoint_file_ = absl::make_unique<UntrustedFile>(fd);
+  checkpoints_ = absl::make_unique<RecordStore<SealedCheckpoint>>(
+      /*capacity=*/2, checkpoint_file_.get());
+
+  CheckpointState checkpoint;
+  Status status = LoadCheckpoint(&checkpoint);
+  if (status.ok()) {
+    std::shared_ptr<Segment> segment;
+    ASYLO_ASSIGN_OR_RETURN(
+        segment, OpenSegment(checkpoint.segment_id, /*create=*/false));
+    checkpoint_number_ = checkpoint.number;
+    return ReplayLog(checkpoint, std::move(segment));
+  }
+  if (status.error_code() != error::GoogleError::NOT_FOUND) {
+    return status;
+  }
+
+  // The directory holds no store. The first log must not exist or be empty,
+  // since it is created after the checkpoint file and only written to once
+  // the first checkpoint has been written.
+  struct stat log_stat;
+  if (stat(SegmentPath(0).c_str(), &log_stat) == 0 && log_stat.st_size > 0) {
+    return DataLoss("Log exists but the checkpoint file is empty");
+  }
+  std::shared_ptr<Segment> segment;
+  ASYLO_ASSIGN_OR_RETURN(segment, OpenSegment(0, /*create=*/true));
+  {
+    absl::MutexLock index_lock(&mu_);
+    segment_ = segment;
+  }
+  return WriteCheckpoint(CurrentCheckpoint(), segment.get());
+}
+
+Status SealedKvStore::LoadCheckpoint(CheckpointState *checkpoint) {
+  bool found = false;
+  for (off_t slot = 0; slot < 2; ++slot) {
+    SealedCheckpoint sealed;
+    if (!checkpoints_->Read(slot * sizeof(SealedCheckpoint), &sealed).ok()) {
+      continue;
+    }
+    CleansingVector<uint8_t> plaintext(kCheckpointSize + kSealOverhead);
+    size_t plaintext_size;
+    if (!cryptor_
+             ->Open(ByteContainerView(sealed.ciphertext,
+                                      sizeof(sealed.ciphertext)),
+                    kCheckpointContext,
+                    ByteContainerView(sealed.nonce, sizeof(sealed.nonce)),
+                    absl::MakeSpan(plaintext), &plaintext_size)
+             .ok() ||
+        plaintext_size != kCheckpointSize) {
+      continue;
+    }
+
+    const uint8_t *fields = plaintext.data();
+    uint64_t number = LoadUint64(fields);
+    if (found && number <= checkpoint->number) {
+      continue;
+    }
+    found = true;
+    checkpoint->number = number;
+    checkpoint->segment_id = LoadUint64(fields + 8);
+    checkpoint->first_sequence = LoadUint64(fields + 16);
+    checkpoint->next_sequence = LoadUint64(fields + 24);
+    checkpoint->log_end = LoadUint64(fields + 32);
+    checkpoint->leaf_count = LoadUint64(fields + 40);
+    checkpoint->root.assign(reinterpret_cast<const char *>(fields + 48),
+                            kRootSize);
+  }
+
+  if (found) {
+    return Status::OkStatus();
+  }
+  StatusOr<size_t> size = checkpoint_file_->Size();
+  if (size.ok() && size.ValueOrDie() == 0) {
+    return Status(error::GoogleError::NOT_FOUND, "No checkpoint");
+  }
+  return DataLoss("Checkpoint file holds no valid checkpoint");
+}
+
+Status SealedKvStore::ReplayLog(const CheckpointState &checkpoint,
+                                std::shared_ptr<Segment> segment) {
+  if (checkpoint.next_sequence - checkpoint.first_sequence !=
+      checkpoint.leaf_count) {
+    return DataLoss("Checkpoint is inconsistent");
+  }
+  if (checkpoint.leaf_count == 0 &&
+      (checkpoint.log_end != 0 ||
+       dictionary_->CurrentRoot() != checkpoint.root)) {
+    return DataLoss("Log does not match the latest checkpoint");
+  }
+
+  size_t size;
+  {
+    absl::MutexLock segment_lock(&segment->mu);
+    ASYLO_ASSIGN_OR_RETURN(size, segment->file->Size());
+  }
+
+  std::map<std::string, Location, std::less<>> index;
+  uint64_t live_bytes = 0;
+  uint64_t offset = 0;
+  uint64_t sequence = checkpoint.first_sequence;
+
+  // The end of the last complete batch, and the leaves and index updates of
+  // the batch being read.
+  uint64_t committed_end = 0;
+  uint64_t committed_sequence = sequence;
+  std::vector<std::string> pending_leaves;
+  std::vector<std::pair<Record, Location>> pending_updates;
+
+  while (offset < size) {
+    Status status;
+    std::string frame;
+    Record record;
+    uint8_t header[kFrameHeaderSize];
+    {
+      absl::MutexLock segment_lock(&segment->mu);
+      if (size - offset < kFrameHeaderSize) {
+        status = DataLoss("Truncated frame header");
+      } else {
+        status = segment->file->Read(header, offset, kFrameHeaderSize);
+      }
+      if (status.ok()) {
+        uint64_t frame_size = kFrameHeaderSize + LoadUint32(header + 8);
+        if (size - offset < frame_size) {
+          status = DataLoss("Truncated frame");
+        } else {
+          frame.resize(frame_size);
+          status = segment->file->Read(&frame[0], offset, frame_size);
+        }
+      }
+    }
+    if (status.ok()) {
+      status = OpenFrame(frame, segment->id, sequence, &record);
+    }
+    if (!status.ok()) {
+      if (offset < checkpoint.log_end) {
+        return DataLoss(absl::StrCat("Log frame at offset ", offset,
+                                     " failed verification: ",
+                                     status.error_message()));
+      }
+      // Frames after the latest checkpoint that fail verification are the
+      // remains of a write interrupted by a crash.
+      break;
+    }
+
+    Location location{offset, static_cast<uint32_t>(frame.size()), sequence};
+    bool ends_batch = record.ends_batch;
+    pending_leaves.push_back(dictionary_->LeafHash(frame));
+    pending_updates.emplace_back(std::move(record), location);
+    offset += frame.size();
+    ++sequence;
+    if (!ends_batch) {
+      continue;
+    }
+
+    for (const std::string &leaf : pending_leaves) {
+      dictionary_->AddLeafHash(leaf);
+    }
+    for (auto &update : pending_updates) {
+      auto it = index.find(update.first.key);
+      if (it != index.end()) {
+        live_bytes -= it->second.size;
+      }
+      if (update.first.is_delete) {
+        if (it != index.end()) {
+          index.erase(it);
+        }
+      } else {
+        index[update.first.key] = update.second;
+        live_bytes += update.second.size;
+      }
+    }
+    pending_leaves.clear();
+    pending_updates.clear();
+    committed_end = offset;
+    committed_sequence = sequence;
+
+    if (dictionary_->LeafCount() == checkpoint.leaf_count &&
+        (committed_end != checkpoint.log_end ||
+         dictionary_->CurrentRoot() != checkpoint.root)) {
+      return DataLoss("Log does not match the latest checkpoint");
+    }
+  }
+
+  if (dictionary_->LeafCount() < checkpoint.leaf_count) {
+    return DataLoss("Log is shorter than the latest checkpoint");
+  }
+  if (committed_end < size) {
+    LOG(WARNING) << "Discarding " << size - committed_end
+                 << " bytes of incomplete writes at the end of the log";
+    absl::MutexLock segment_lock(&segment->mu);
+    ASYLO_RETURN_IF_ERROR(segment->file->Truncate(committed_end));
+    ASYLO_RETURN_IF_ERROR(segment->file->Sync());
+  }
+
+  first_sequence_ = checkpoint.first_sequence;
+  next_sequence_ = committed_sequence;
+  records_since_checkpoint_ = committed_sequence - checkpoint.next_sequence;
+
+  absl::MutexLock lock(&mu_);
+  index_ = std::move(index);
+  segment_ = std::move(segment);
+  log_end_ = committed_end;
+  live_bytes_ = live_bytes;
+  return Status::OkStatus();
+}
+
+StatusOr<std::shared_ptr<SealedKvStore::Segment>> SealedKvStore::OpenSegment(
+    uint64_t segment_id, bool create) {
+  std::string path = SegmentPath(segment_id);
+  int flags = create ? O_CREAT | O_TRUNC | O_RDWR : O_RDWR;
+  int fd = open(path.c_str(), flags, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    if (!create && errno == ENOENT) {
+      return DataLoss(absl::StrCat("Log ", path, " is missing"));
+    }
+    return Status(static_cast<error::PosixError>(errno),
+                  absl::StrCat("Could not open ", path));
+  }
+  return std::make_shared<Segment>(segment_id, std::move(path), fd);
+}
+
+std::string SealedKvStore::SegmentPath(uint64_t segment_id) const {
+  return absl::StrFormat("%s/log-%06d", directory_, segment_id);
+}
+
+Status SealedKvStore::SealFrame(uint64_t segment_id, uint64_t sequence,
+                                const Record &record, std::string *frames) {
+  CleansingVector<uint8_t> plaintext;
+  plaintext.reserve(kRecordHeaderSize + record.key.size() +
+                    record.value.size());
+  plaintext.push_back(record.is_delete ? kDeleteRecord : kPutRecord);
+  for (int i = 0; i < 4; ++i) {
+    plaintext.push_back(static_cast<uint8_t>(record.key.size() >> (8 * i)));
+  }
+  plaintext.insert(plaintext.end(), record.key.begin(), record.key.end());
+  plaintext.insert(plaintext.end(), record.value.begin(), record.value.end());
+
+  size_t ciphertext_size = plaintext.size() + kSealOverhead;
+  size_t header_offset = frames->size();
+  AppendUint64(sequence, frames);
+  AppendUint32(ciphertext_size, frames);
+  frames->push_back(static_cast<char>(record.ends_batch ? kEndsBatch : 0));
+  frames->append(3, '\0');
+  frames->append(kNonceSize, '\0');
+  frames->append(ciphertext_size, '\0');
+
+  uint8_t *header = reinterpret_cast<uint8_t *>(&(*frames)[header_offset]);
+  size_t sealed_size;
+  ASYLO_RETURN_IF_ERROR(cryptor_->Seal(
+      plaintext,
+      FrameAssociatedData(segment_id,
+                          ByteContainerView(header, kFrameHeaderSize)),
+      absl::MakeSpan(header + kAuthenticatedHeaderSize, kNonceSize),
+      absl::MakeSpan(header + kFrameHeaderSize, ciphertext_size),
+      &sealed_size));
+  if (sealed_size != ciphertext_size) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Unexpected size of sealed record");
+  }
+  return Status::OkStatus();
+}
+
+Status SealedKvStore::OpenFrame(ByteContainerView frame, uint64_t segment_id,
+                                uint64_t sequence, Record *record) {
+  if (frame.size() < kFrameHeaderSize) {
+    return DataLoss("Frame is too short");
+  }
+  const uint8_t *header = frame.data();
+  if (LoadUint64(header) != sequence) {
+    return DataLoss("Frame has an unexpected sequence number");
+  }
+  size_t ciphertext_size = LoadUint32(header + 8);
+  if (frame.size() != kFrameHeaderSize + ciphertext_size) {
+    return DataLoss("Frame has an unexpected size");
+  }
+
+  CleansingVector<uint8_t> plaintext(ciphertext_size);
+  size_t plaintext_size;
+  Status status = cryptor_->Open(
+      ByteContainerView(header + kFrameHeaderSize, ciphertext_size),
+      FrameAssociatedData(segment_id, frame),
+      ByteContainerView(header + kAuthenticatedHeaderSize, kNonceSize),
+      absl::MakeSpan(plaintext), &plaintext_size);
+  if (!status.ok()) {
+    return DataLoss("Frame failed authentication");
+  }
+  if (plaintext_size < kRecordHeaderSize ||
+      (plaintext[0] != kPutRecord && plaintext[0] != kDeleteRecord)) {
+    return DataLoss("Frame holds a malformed record");
+  }
+  size_t key_size = LoadUint32(plaintext.data() + 1);
+  if (key_size > plaintext_size - kRecordHeaderSize) {
+    return DataLoss("Frame holds a malformed record");
+  }
+
+  const char *key = reinterpret_cast<const char *>(plaintext.data()) +
+                    kRecordHeaderSize;
+  record->is_delete = plaintext[0] == kDeleteRecord;
+  record->ends_batch = (header[12] & kEndsBatch) != 0;
+  record->key.assign(key, key_size);
+  record->value.assign(key + key_size,
+                       plaintext_size - kRecordHeaderSize - key_size);
+  return Status::OkStatus();
+}
+
+Status SealedKvStore::ReadFrame(Segment *segment, const Location &location,
+                                Record *record) {
+  std::string frame(location.size, '\0');
+  {
+    absl::MutexLock lock(&segment->mu);
+    ASYLO_RETURN_IF_ERROR(
+        segment->file->Read(&frame[0], location.offset, location.size));
+  }
+  return OpenFrame(frame, segment->id, location.sequence, record);
+}
+
+Status SealedKvStore::CommitGroup(const std::vector<Writer *> &group) {
+  ASYLO_RETURN_IF_ERROR(log_status_);
+  uint64_t start;
+  std::shared_ptr<Segment> segment;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    start = log_end_;
+    segment = segment_;
+  }
+
+  std::string frames;
+  std::vector<size_t> frame_ends;
+  std::vector<std::pair<const KvWriteBatch::Update *, Location>> updates;
+  uint64_t sequence = next_sequence_;
+  for (const Writer *writer : group) {
+    const auto &batch_updates = writer->batch->updates_;
+    for (size_t i = 0; i < batch_updates.size(); ++i) {
+      const KvWriteBatch::Update &update = batch_updates[i];
+      Record record;
+      record.is_delete = update.is_delete;
+      record.ends_batch = i + 1 == batch_updates.size();
+      record.key = update.key;
+      record.value = update.value;
+
+      size_t frame_start = frames.size();
+      ASYLO_RETURN_IF_ERROR(
+          SealFrame(segment->id, sequence, record, &frames));
+      updates.emplace_back(
+          &update, Location{start + frame_start,
+                            static_cast<uint32_t>(frames.size() - frame_start),
+                            sequence});
+      frame_ends.push_back(frames.size());
+      ++sequence;
+    }
+  }
+  if (frames.empty()) {
+    return Status::OkStatus();
+  }
+
+  {
+    absl::MutexLock segment_lock(&segment->mu);
+    Status status = segment->file->Write(frames.data(), start, frames.size());
+    if (status.ok() && options_.sync) {
+      status = segment->file->Sync();
+    }
+    if (!status.ok()) {
+      // The frames may or may not have reached storage, so the log on the host
+      // no longer matches the state of the store. Later writes would build on
+      // frames that a crash could either keep or lose.
+      log_status_ = Status(
+          status.CanonicalCode(),
+          absl::StrCat("Log write failed: ", status.error_message()));
+      return log_status_;
+    }
+  }
+
+  size_t frame_start = 0;
+  for (size_t frame_end : frame_ends) {
+    dictionary_->AddLeaf(frames.substr(frame_start, frame_end - frame_start));
+    frame_start = frame_end;
+  }
+  next_sequence_ = sequence;
+  records_since_checkpoint_ += updates.size();
+
+  {
+    absl::MutexLock lock(&mu_);
+    for (const auto &update : updates) {
+      auto it = index_.find(update.first->key);
+      if (it != index_.end()) {
+        live_bytes_ -= it->second.size;
+      }
+      if (update.first->is_delete) {
+        if (it != index_.end()) {
+          index_.erase(it);
+        }
+      } else if (it != index_.end()) {
+        it->second = update.second;
+        live_bytes_ += update.second.size;
+      } else {
+        index_.emplace(update.first->key, update.second);
+        live_bytes_ += update.second.size;
+      }
+    }
+    log_end_ = start + frames.size();
+  }
+
+  // The updates of the group are committed, so a failure to write a periodic
+  // checkpoint is not reported to its writers. Later groups retry it.
+  if (options_.checkpoint_interval > 0 &&
+      records_since_checkpoint_ >= options_.checkpoint_interval) {
+    checkpoint_status_ = WriteCheckpoint(CurrentCheckpoint(), segment.get());
+    LOG_IF(ERROR, !checkpoint_status_.ok())
+        << "Could not write periodic checkpoint: " << checkpoint_status_;
+  }
+  return Status::OkStatus();
+}
+
+SealedKvStore::CheckpointState SealedKvStore::CurrentCheckpoint() {
+  CheckpointState checkpoint;
+  checkpoint.number = checkpoint_number_ + 1;
+  checkpoint.first_sequence = first_sequence_;
+  checkpoint.next_sequence = next_sequence_;
+  checkpoint.leaf_count = dictionary_->LeafCount();
+  checkpoint.root = dictionary_->CurrentRoot();
+  absl::ReaderMutexLock lock(&mu_);
+  checkpoint.segment_id = segment_->id;
+  checkpoint.log_end = log_end_;
+  return checkpoint;
+}
+
+Status SealedKvStore::WriteCheckpoint(const CheckpointState &checkpoint,
+                                      Segment *segment) {
+  if (checkpoint.root.size() != kRootSize) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Unexpected size of the Merkle root");
+  }
+
+  ASYLO_RETURN_IF_ERROR(log_status_);
+
+  // The log must be durable before a checkpoint refers to it.
+  Status status;
+  {
+    absl::MutexLock segment_lock(&segment->mu);
+    status = segment->file->Sync();
+  }
+  if (!status.ok()) {
+    bool active;
+    {
+      absl::ReaderMutexLock lock(&mu_);
+      active = segment == segment_.get();
+    }
+    // A new log that failed to sync during compaction is abandoned, but a
+    // failure to sync the active log leaves writes in an unknown state.
+    if (active) {
+      log_status_ = Status(
+          status.CanonicalCode(),
+          absl::StrCat("Log sync failed: ", status.error_message()));
+    }
+    return status;
+  }
+
+  std::string fields;
+  AppendUint64(checkpoint.number, &fields);
+  AppendUint64(checkpoint.segment_id, &fields);
+  AppendUint64(checkpoint.first_sequence, &fields);
+  AppendUint64(checkpoint.next_sequence, &fields);
+  AppendUint64(checkpoint.log_end, &fields);
+  AppendUint64(checkpoint.leaf_count, &fields);
+  fields.append(checkpoint.root);
+
+  SealedCheckpoint sealed;
+  size_t sealed_size;
+  ASYLO_RETURN_IF_ERROR(cryptor_->Seal(
+      fields, kCheckpointContext, absl::MakeSpan(sealed.nonce),
+      absl::MakeSpan(sealed.ciphertext), &sealed_size));
+  if (sealed_size != sizeof(sealed.ciphertext)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Unexpected size of sealed checkpoint");
+  }
+
+  // Checkpoints alternate between two slots so that a torn write of one slot
+  // leaves the previous checkpoint intact.
+  off_t slot = checkpoint.number % 2;
+  ASYLO_RETURN_IF_ERROR(
+      checkpoints_->Write(slot * sizeof(SealedCheckpoint), sealed));
+  ASYLO_RETURN_IF_ERROR(checkpoints_->Flush());
+  checkpoint_number_ = checkpoint.number;
+  records_since_checkpoint_ = 0;
+  checkpoint_status_ = Status::OkStatus();
+  return Status::OkStatus();
+}
+
+Status SealedKvStore::CompactLocked() {
+  ASYLO_RETURN_IF_ERROR(log_status_);
+  std::vector<std::pair<std::string, Location>> live;
+  std::shared_ptr<Segment> old_segment;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    live.assign(index_.begin(), index_.end());
+    old_segment = segment_;
+  }
+
+  std::shared_ptr<Segment> new_segment;
+  ASYLO_ASSIGN_OR_RETURN(new_segment,
+                         OpenSegment(old_segment->id + 1, /*create=*/true));
+  auto dictionary = absl::make_unique<CTMMTAuthenticatedDictionary>();
+  std::map<std::string, Location, std::less<>> index;
+  uint64_t first_sequence = next_sequence_;
+  uint64_t sequence = first_sequence;
+  uint64_t offset = 0;
+  std::string frames;
+
+  // Live records are copied in key order, each as a batch of its own.
+  for (auto &entry : live) {
+    Record record;
+    ASYLO_RETURN_IF_ERROR(ReadFrame(old_segment.get(), entry.second, &record));
+    record.ends_batch = true;
+    size_t frame_start = frames.size();
+    ASYLO_RETURN_IF_ERROR(
+        SealFrame(new_segment->id, sequence, record, &frames));
+    size_t frame_size = frames.size() - frame_start;
+    dictionary->AddLeaf(frames.substr(frame_start, frame_size));
+    index.emplace(std::move(entry.first),
+                  Location{offset + frame_start,
+                           static_cast<uint32_t>(frame_size), sequence});
+    ++sequence;
+
+    if (frames.size() >= kCompactionChunkSize) {
+      absl::MutexLock segment_lock(&new_segment->mu);
+      ASYLO_RETURN_IF_ERROR(
+          new_segment->file->Write(frames.data(), offset, frames.size()));
+      offset += frames.size();
+      frames.clear();
+    }
+  }
+  if (!frames.empty()) {
+    absl::MutexLock segment_lock(&new_segment->mu);
+    ASYLO_RETURN_IF_ERROR(
+        new_segment->file->Write(frames.data(), offset, frames.size()));
+    offset += frames.size();
+  }
+
+  // Switch to the new log only once a checkpoint refers to it. Until then, a
+  // crash leaves the store in the state of the old log.
+  CheckpointState checkpoint;
+  checkpoint.number = checkpoint_number_ + 1;
+  checkpoint.segment_id = new_segment->id;
+  checkpoint.first_sequence = first_sequence;
+  checkpoint.next_sequence = sequence;
+  checkpoint.log_end = offset;
+  checkpoint.leaf_count = dictionary->LeafCount();
+  checkpoint.root = dictionary->CurrentRoot();
+  ASYLO_RETURN_IF_ERROR(WriteCheckpoint(checkpoint, new_segment.get()));
+
+  dictionary_ = std::move(dictionary);
+  first_sequence_ = first_sequence;
+  next_sequence_ = sequence;
+  {
+    absl::MutexLock lock(&mu_);
+    index_ = std::move(index);
+    segment_ = new_segment;
+    log_end_ = offset;
+    live_bytes_ = offset;
+  }
+
+  if (unlink(old_segment->path.c_str()) != 0) {
+    LOG(ERROR) << "Could not delete " << old_segment->path << ": "
+               << strerror(errno);
+  }
+  return Status::OkStatus();
+}
+
+bool SealedKvStore::CompactionWanted() {
+  if (stopping_) {
+    return true;
+  }
+  if (log_end_ < options_.min_compaction_bytes ||
+      log_end_ == compaction_attempt_log_end_) {
+    return false;
+  }
+  return 1.0 - static_cast<double>(live_bytes_) / log_end_ >
+         options_.compaction_threshold;
+}
+
+void SealedKvStore::CompactionLoop() {
+  while (true) {
+    mu_.LockWhen(absl::Condition(this, &SealedKvStore::CompactionWanted));
+    bool stopping = stopping_;
+    compaction_attempt_log_end_ = log_end_;
+    mu_.Unlock();
+    if (stopping) {
+      return;
+    }
+    Status status = Compact();
+    LOG_IF(ERROR, !status.ok()) << "Background compaction failed: " << status;
+  }
+}
+
+}  // namespace asylo
@@ -0,0 +1,330 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_KV_SEALED_KV_STORE_H_
+#define ASYLO_PLATFORM_STORAGE_KV_SEALED_KV_STORE_H_
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/platform/storage/secure/authenticated_dictionary.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/platform/storage/utils/random_access_storage.h"
+#include "asylo/platform/storage/utils/record_store.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// A set of updates that SealedKvStore::Write() applies atomically.
+class KvWriteBatch {
+ public:
+  // Adds an update that sets the value of |key| to |value|.
+  void Put(absl::string_view key, absl::string_view value);
+
+  // Adds an update that removes |key|.
+  void Delete(absl::string_view key);
+
+  // Removes all updates from the batch.
+  void Clear();
+
+  // Returns the number of updates in the batch.
+  size_t Size() const { return updates_.size(); }
+
+ private:
+  friend class SealedKvStore;
+
+  struct Update {
+    bool is_delete;
+    std::string key;
+    std::string value;
+  };
+
+  std::vector<Update> updates_;
+};
+
+// Options for opening a SealedKvStore.
+struct SealedKvStoreOptions {
+  // If true, every group commit is synchronized to storage before the writes
+  // in the group return.
+  bool sync = true;
+
+  // Number of records written between two automatic checkpoints. A value of 0
+  // disables automatic checkpoints.
+  uint64_t checkpoint_interval = 4096;
+
+  // If true, a background thread compacts the log whenever the fraction of the
+  // log occupied by overwritten or deleted records exceeds
+  // |compaction_threshold|.
+  bool background_compaction = false;
+
+  // Fraction of garbage in the log above which the log is compacted.
+  double compaction_threshold = 0.5;
+
+  // Log size in bytes below which the log is never compacted automatically.
+  uint64_t min_compaction_bytes = 1 << 20;
+};
+
+// A persistent key-value store that keeps keys and values confidential and
+// integrity-protected from the host.
+//
+// The store lives in a directory and consists of an append-only value log and
+// a checkpoint file. Each update is sealed individually with AES-GCM-SIV and
+// appended to the log as a frame whose header, including a sequence number, is
+// bound to the ciphertext as associated data together with the id of the log.
+// An in-enclave index maps every live key to the location of its latest frame,
+// so a lookup costs a single host read and a single decryption.
+//
+// Every frame is also added as a leaf to a Merkle tree. Checkpoints, written
+// periodically to two alternating slots of the checkpoint file, seal the root
+// of the tree together with the extent of the log it covers. When the store is
+// opened, the log is replayed and verified against the latest checkpoint, and
+// frames after it are accepted only if they continue the sequence. A batch
+// whose frames were not all written before a crash is discarded. Rolling the
+// log back to an earlier state is detected up to the latest checkpoint; callers
+// that need stronger freshness guarantees can call Checkpoint() after critical
+// writes, store CheckpointNumber() in a monotonic counter, and reject a store
+// whose CheckpointNumber() is below the counter after it is opened.
+//
+// Concurrent calls to Write() are grouped: one writer seals and appends the
+// updates of every waiting writer and synchronizes the log once for the whole
+// group. Compaction copies the live records to a new log, re-sealing them, and
+// switches to it atomically with a checkpoint. Readers proceed during
+// compaction, while writers wait for it to finish.
+//
+// If appending to or synchronizing the log fails, the writes of the group fail
+// and the store refuses further writes until it is reopened, since the host
+// may or may not have kept the frames.
+//
+// All methods are thread-safe.
+class SealedKvStore {
+ public:
+  // Opens the store in |directory|, creating it if the directory contains no
+  // store. |key| is a 128-bit or 256-bit AES-GCM-SIV key. Returns DATA_LOSS if
+  // the store fails verification.
+  static StatusOr<std::unique_ptr<SealedKvStore>> Open(
+      const std::string &directory, ByteContainerView key,
+      const SealedKvStoreOptions &options);
+
+  SealedKvStore(const SealedKvStore &other) = delete;
+  SealedKvStore &operator=(const SealedKvStore &other) = delete;
+
+  // Stops background compaction and writes a final checkpoint.
+  ~SealedKvStore();
+
+  // Returns the value of |key|, or NOT_FOUND if the store does not contain
+  // |key|.
+  StatusOr<std::string> Get(absl::string_view key);
+
+  // Sets the value of |key| to |value|.
+  Status Put(absl::string_view key, absl::string_view value);
+
+  // Removes |key| from the store. Removing a missing key is not an error.
+  Status Delete(absl::string_view key);
+
+  // Applies the updates in |batch| atomically. Updates to the same key take
+  // effect in the order they were added to the batch.
+  Status Write(const KvWriteBatch &batch);
+
+  // Returns up to |limit| key-value pairs in key order, starting from the
+  // first key that is not less than |start_key|.
+  StatusOr<std::vector<std::pair<std::string, std::string>>> Scan(
+      absl::string_view start_key, size_t limit);
+
+  // Writes a checkpoint covering every write that has returned.
+  Status Checkpoint();
+
+  // Rewrites the live records to a new log and deletes the old one.
+  Status Compact();
+
+  // Returns the number of the latest checkpoint written or loaded. Every
+  // checkpoint has a larger number than the checkpoints written before it.
+  uint64_t CheckpointNumber();
+
+  // Returns the error that stops the store from accepting writes, if any, and
+  // otherwise the status of the latest periodic checkpoint. A failed periodic
+  // checkpoint does not fail the writes whose group triggered it, and is
+  // retried by later groups and by Checkpoint().
+  Status CheckpointStatus();
+
+  // Returns the number of live keys.
+  size_t Size() const;
+
+  // Returns the size of the log in bytes.
+  uint64_t LogSize() const;
+
+  // Returns the fraction of the log occupied by overwritten or deleted
+  // records.
+  double GarbageRatio() const;
+
+ private:
+  // Location of the latest frame of a key.
+  struct Location {
+    uint64_t offset;
+    uint32_t size;
+    uint64_t sequence;
+  };
+
+  // The contents of a frame.
+  struct Record {
+    bool is_delete = false;
+    bool ends_batch = false;
+    std::string key;
+    std::string value;
+  };
+
+  // The contents of a checkpoint.
+  struct CheckpointState {
+    uint64_t number;
+    uint64_t segment_id;
+    uint64_t first_sequence;
+    uint64_t next_sequence;
+    uint64_t log_end;
+    uint64_t leaf_count;
+    std::string root;
+  };
+
+  // A sealed checkpoint as stored in the checkpoint file.
+  struct SealedCheckpoint;
+
+  // A log file.
+  struct Segment;
+
+  // A call to Write() waiting for its updates to be committed.
+  struct Writer;
+
+  SealedKvStore(std::string directory,
+                std::unique_ptr<experimental::AeadCryptor> cryptor,
+                const SealedKvStoreOptions &options);
+
+  // Recovers the state of the store from its files, creating them if the
+  // directory contains no store.
+  Status Recover() LOCKS_EXCLUDED(commit_mu_, mu_);
+
+  // Loads the latest valid checkpoint into |checkpoint|. Returns NOT_FOUND if
+  // the checkpoint file contains no checkpoint.
+  Status LoadCheckpoint(CheckpointState *checkpoint)
+      EXCLUSIVE_LOCKS_REQUIRED(commit_mu_);
+
+  // Replays the frames of |segment|, verifying them against |checkpoint|, and
+  // rebuilds the index.
+  Status ReplayLog(const CheckpointState &checkpoint,
+                   std::shared_ptr<Segment> segment)
+      EXCLUSIVE_LOCKS_REQUIRED(commit_mu_);
+
+  // Opens the log segment with |segment_id|. If |create| is true, the segment
+  // is created or truncated.
+  StatusOr<std::shared_ptr<Segment>> OpenSegment(uint64_t segment_id,
+                                                 bool create);
+
+  // Returns the path of the log segment with |segment_id|.
+  std::string SegmentPath(uint64_t segment_id) const;
+
+  // Seals |record| with |sequence| into a frame of the log segment with
+  // |segment_id| and appends it to |frames|.
+  Status SealFrame(uint64_t segment_id, uint64_t sequence, const Record &record,
+                   std::string *frames) EXCLUSIVE_LOCKS_REQUIRED(commit_mu_);
+
+  // Verifies that |frame| is a frame of the log segment with |segment_id| with
+  // |sequence| and opens it into |record|.
+  Status OpenFrame(ByteContainerView frame, uint64_t segment_id,
+                   uint64_t sequence, Record *record);
+
+  // Reads and opens the frame at |location| of |segment| into |record|.
+  Status ReadFrame(Segment *segment, const Location &location,
+                   Record *record);
+
+  // Commits the updates of |group| as one append to the log.
+  Status CommitGroup(const std::vector<Writer *> &group)
+      EXCLUSIVE_LOCKS_REQUIRED(commit_mu_);
+
+  // Returns a checkpoint of the current state.
+  CheckpointState CurrentCheckpoint() EXCLUSIVE_LOCKS_REQUIRED(commit_mu_);
+
+  // Synchronizes the log and writes |checkpoint| to the checkpoint file.
+  Status WriteCheckpoint(const CheckpointState &checkpoint, Segment *segment)
+      EXCLUSIVE_LOCKS_REQUIRED(commit_mu_);
+
+  // Compacts the log.
+  Status CompactLocked() EXCLUSIVE_LOCKS_REQUIRED(commit_mu_);
+
+  // Returns true if the background compaction thread should compact the log
+  // or exit.
+  bool CompactionWanted() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Runs background compaction until the store is destroyed.
+  void CompactionLoop();
+
+  const std::string directory_;
+  const std::unique_ptr<experimental::AeadCryptor> cryptor_;
+  const SealedKvStoreOptions options_;
+
+  // Queue of writers waiting for their updates to be committed. The writer at
+  // the front commits the updates of every writer in the queue.
+  absl::Mutex writers_mu_;
+  absl::CondVar writers_cv_;
+  std::deque<Writer *> writers_ GUARDED_BY(writers_mu_);
+
+  // Serializes changes to the log, the Merkle tree and the checkpoints.
+  absl::Mutex commit_mu_ ACQUIRED_BEFORE(mu_);
+  std::unique_ptr<platform::storage::AuthenticatedDictionary> dictionary_
+      GUARDED_BY(commit_mu_);
+  platform::storage::FdCloser checkpoint_fd_;
+  std::unique_ptr<RandomAccessStorage> checkpoint_file_
+      GUARDED_BY(commit_mu_);
+  std::unique_ptr<RecordStore<SealedCheckpoint>> checkpoints_
+      GUARDED_BY(commit_mu_);
+  uint64_t checkpoint_number_ GUARDED_BY(commit_mu_);
+  uint64_t first_sequence_ GUARDED_BY(commit_mu_);
+  uint64_t next_sequence_ GUARDED_BY(commit_mu_);
+  uint64_t records_since_checkpoint_ GUARDED_BY(commit_mu_);
+
+  // Set once writing or synchronizing the active log fails. The log on the
+  // host may then hold frames that the store does not know about, so every
+  // later write, checkpoint and compaction fails with this status.
+  Status log_status_ GUARDED_BY(commit_mu_);
+
+  // Status of the latest periodic checkpoint.
+  Status checkpoint_status_ GUARDED_BY(commit_mu_);
+
+  // Guards the index and the active segment.
+  mutable absl::Mutex mu_;
+  std::map<std::string, Location, std::less<>> index_ GUARDED_BY(mu_);
+  std::shared_ptr<Segment> segment_ GUARDED_BY(mu_);
+  uint64_t log_end_ GUARDED_BY(mu_);
+  uint64_t live_bytes_ GUARDED_BY(mu_);
+  uint64_t compaction_attempt_log_end_ GUARDED_BY(mu_);
+  bool stopping_ GUARDED_BY(mu_);
+
+  std::thread compaction_thread_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_KV_SEALED_KV_STORE_H_
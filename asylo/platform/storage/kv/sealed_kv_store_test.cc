@@ -0,0 +1,421 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/kv/sealed_kv_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Not;
+using ::testing::Pair;
+
+constexpr char kKey[] = "0123456789abcdef0123456789abcdef";
+
+// Bound on the descriptors searched by ReopenDescriptor().
+constexpr int kMaxDescriptors = 1024;
+
+class SealedKvStoreTest : public ::testing::Test {
+ protected:
+  // Gives every test a new, empty directory. Directories cannot be listed
+  // inside an enclave, so the directory is made unique rather than emptied.
+  void SetUp() override {
+    directory_ = absl::StrCat(
+        FLAGS_test_tmpdir, "/",
+        ::testing::UnitTest::GetInstance()->current_test_info()->name(), "-",
+        absl::ToUnixNanos(absl::Now()));
+    ASSERT_EQ(mkdir(directory_.c_str(), S_IRWXU), 0);
+    options_.sync = false;
+  }
+
+  StatusOr<std::unique_ptr<SealedKvStore>> OpenStore() {
+    return SealedKvStore::Open(directory_, kKey, options_);
+  }
+
+  std::string ReadFile(const std::string &name) {
+    std::string contents;
+    int fd = open(absl::StrCat(directory_, "/", name).c_str(), O_RDONLY);
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+      contents.append(buffer, size);
+    }
+    close(fd);
+    return contents;
+  }
+
+  void WriteFile(const std::string &name, const std::string &contents) {
+    int fd = open(absl::StrCat(directory_, "/", name).c_str(),
+                  O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ASSERT_EQ(write(fd, contents.data(), contents.size()),
+              static_cast<ssize_t>(contents.size()));
+    close(fd);
+  }
+
+  // Makes the descriptor through which the process has the file |name| open
+  // refer to a new description of the file opened with |flags|, so that I/O
+  // through it fails or succeeds regardless of how the store opened it.
+  void ReopenDescriptor(const std::string &name, int flags) {
+    std::string path = absl::StrCat(directory_, "/", name);
+    struct stat file_stat;
+    ASSERT_EQ(stat(path.c_str(), &file_stat), 0);
+    int target = -1;
+    for (int descriptor = 0; descriptor < kMaxDescriptors; ++descriptor) {
+      struct stat descriptor_stat;
+      if (fstat(descriptor, &descriptor_stat) == 0 &&
+          descriptor_stat.st_dev == file_stat.st_dev &&
+          descriptor_stat.st_ino == file_stat.st_ino) {
+        target = descriptor;
+      }
+    }
+    ASSERT_GE(target, 0);
+    int fd = open(path.c_str(), flags);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(dup2(fd, target), target);
+    close(fd);
+  }
+
+  std::string directory_;
+  SealedKvStoreOptions options_;
+};
+
+TEST_F(SealedKvStoreTest, PutGetDelete) {
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+
+  EXPECT_THAT(store->Get("apple").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+  ASYLO_ASSERT_OK(store->Put("apple", "red"));
+  ASYLO_ASSERT_OK(store->Put("banana", "yellow"));
+  EXPECT_THAT(store->Get("apple"), IsOkAndHolds("red"));
+  EXPECT_THAT(store->Get("banana"), IsOkAndHolds("yellow"));
+
+  ASYLO_ASSERT_OK(store->Put("apple", "green"));
+  EXPECT_THAT(store->Get("apple"), IsOkAndHolds("green"));
+
+  ASYLO_ASSERT_OK(store->Delete("apple"));
+  ASYLO_ASSERT_OK(store->Delete("cherry"));
+  EXPECT_THAT(store->Get("apple").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+  EXPECT_EQ(store->Size(), 1u);
+}
+
+TEST_F(SealedKvStoreTest, EmptyValue) {
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  ASYLO_ASSERT_OK(store->Put("key", ""));
+  EXPECT_THAT(store->Get("key"), IsOkAndHolds(""));
+}
+
+TEST_F(SealedKvStoreTest, Scan) {
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  for (const char *key : {"d", "b", "a", "e", "c"}) {
+    ASYLO_ASSERT_OK(store->Put(key, absl::StrCat("value ", key)));
+  }
+  ASYLO_ASSERT_OK(store->Delete("c"));
+
+  std::vector<std::pair<std::string, std::string>> results;
+  ASYLO_ASSERT_OK_AND_ASSIGN(results, store->Scan("ab", 2));
+  EXPECT_THAT(results,
+              ElementsAre(Pair("b", "value b"), Pair("d", "value d")));
+  ASYLO_ASSERT_OK_AND_ASSIGN(results, store->Scan("", 10));
+  EXPECT_EQ(results.size(), 4u);
+}
+
+TEST_F(SealedKvStoreTest, Reopen) {
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    for (int i = 0; i < 100; ++i) {
+      ASYLO_ASSERT_OK(store->Put(absl::StrCat("key", i), absl::StrCat(i)));
+    }
+    ASYLO_ASSERT_OK(store->Delete("key7"));
+  }
+
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_EQ(store->Size(), 99u);
+  EXPECT_THAT(store->Get("key42"), IsOkAndHolds("42"));
+  EXPECT_THAT(store->Get("key7").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+  ASYLO_ASSERT_OK(store->Put("key100", "100"));
+  EXPECT_THAT(store->Get("key100"), IsOkAndHolds("100"));
+}
+
+// Tests that the checkpoint number grows with every checkpoint, so that a
+// rollback past a checkpoint whose number the caller recorded is detected.
+TEST_F(SealedKvStoreTest, CheckpointNumberDetectsRollback) {
+  options_.checkpoint_interval = 0;
+  uint64_t recorded_number;
+  std::string old_checkpoint;
+  std::string old_log;
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("key", "old value"));
+    ASYLO_ASSERT_OK(store->Checkpoint());
+    uint64_t old_number = store->CheckpointNumber();
+    old_checkpoint = ReadFile("CHECKPOINT");
+    old_log = ReadFile("log-000000");
+
+    ASYLO_ASSERT_OK(store->Put("key", "new value"));
+    ASYLO_ASSERT_OK(store->Checkpoint());
+    recorded_number = store->CheckpointNumber();
+    EXPECT_GT(recorded_number, old_number);
+  }
+
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    EXPECT_GE(store->CheckpointNumber(), recorded_number);
+    EXPECT_THAT(store->Get("key"), IsOkAndHolds("new value"));
+  }
+
+  WriteFile("CHECKPOINT", old_checkpoint);
+  WriteFile("log-000000", old_log);
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_THAT(store->Get("key"), IsOkAndHolds("old value"));
+  EXPECT_LT(store->CheckpointNumber(), recorded_number);
+}
+
+TEST_F(SealedKvStoreTest, WrongKeyFails) {
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("key", "value"));
+  }
+  EXPECT_THAT(
+      SealedKvStore::Open(directory_, "fedcba9876543210fedcba9876543210",
+                          options_)
+          .status(),
+      StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+TEST_F(SealedKvStoreTest, TamperedLogFails) {
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("key", "value"));
+    ASYLO_ASSERT_OK(store->Put("other key", "other value"));
+  }
+  std::string log = ReadFile("log-000000");
+  log[log.size() / 4] ^= 1;
+  WriteFile("log-000000", log);
+
+  EXPECT_THAT(OpenStore().status(), StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+TEST_F(SealedKvStoreTest, TruncatedLogFails) {
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("key", "value"));
+    ASYLO_ASSERT_OK(store->Put("other key", "other value"));
+  }
+  std::string log = ReadFile("log-000000");
+  WriteFile("log-000000", log.substr(0, log.size() / 2));
+
+  EXPECT_THAT(OpenStore().status(), StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+// Tests that a failed append to the log fails the write and every later write,
+// even once the log is writable again, and loses no committed update.
+TEST_F(SealedKvStoreTest, FailedLogWriteStopsWrites) {
+  options_.checkpoint_interval = 0;
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("key", "value"));
+
+    ReopenDescriptor("log-000000", O_RDONLY);
+    EXPECT_THAT(store->Put("other key", "other value"), Not(IsOk()));
+    ReopenDescriptor("log-000000", O_RDWR);
+    EXPECT_THAT(store->Put("third key", "third value"), Not(IsOk()));
+    EXPECT_THAT(store->Checkpoint(), Not(IsOk()));
+    EXPECT_THAT(store->CheckpointStatus(), Not(IsOk()));
+    EXPECT_THAT(store->Get("key"), IsOkAndHolds("value"));
+  }
+
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_THAT(store->Get("key"), IsOkAndHolds("value"));
+  EXPECT_THAT(store->Get("other key").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+  EXPECT_THAT(store->Get("third key").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+}
+
+// Tests that a failed periodic checkpoint does not fail the write that
+// triggered it, is reported by CheckpointStatus(), and is retried.
+TEST_F(SealedKvStoreTest, FailedPeriodicCheckpointIsReportedSeparately) {
+  options_.checkpoint_interval = 1;
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+
+  ReopenDescriptor("CHECKPOINT", O_RDONLY);
+  ASYLO_EXPECT_OK(store->Put("key", "value"));
+  EXPECT_THAT(store->CheckpointStatus(), Not(IsOk()));
+  EXPECT_THAT(store->Get("key"), IsOkAndHolds("value"));
+
+  ReopenDescriptor("CHECKPOINT", O_RDWR);
+  ASYLO_EXPECT_OK(store->Put("other key", "other value"));
+  ASYLO_EXPECT_OK(store->CheckpointStatus());
+}
+
+// Simulates a crash after a checkpoint by restoring the checkpoint file, then
+// tearing the last batch written after it.
+TEST_F(SealedKvStoreTest, TornBatchIsDiscarded) {
+  options_.checkpoint_interval = 0;
+  std::string checkpoint;
+  size_t log_size;
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("a", "1"));
+    ASYLO_ASSERT_OK(store->Checkpoint());
+    checkpoint = ReadFile("CHECKPOINT");
+
+    ASYLO_ASSERT_OK(store->Put("b", "2"));
+    log_size = store->LogSize();
+    KvWriteBatch batch;
+    batch.Put("a", "3");
+    batch.Put("c", "4");
+    batch.Delete("b");
+    ASYLO_ASSERT_OK(store->Write(batch));
+  }
+  WriteFile("CHECKPOINT", checkpoint);
+  std::string log = ReadFile("log-000000");
+  ASSERT_GT(log.size(), log_size + 10);
+  WriteFile("log-000000", log.substr(0, log.size() - 10));
+
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_THAT(store->Get("a"), IsOkAndHolds("1"));
+  EXPECT_THAT(store->Get("b"), IsOkAndHolds("2"));
+  EXPECT_THAT(store->Get("c").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+  EXPECT_EQ(store->LogSize(), log_size);
+
+  ASYLO_ASSERT_OK(store->Put("c", "5"));
+  EXPECT_THAT(store->Get("c"), IsOkAndHolds("5"));
+}
+
+TEST_F(SealedKvStoreTest, CompactionKeepsLiveRecords) {
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    for (int round = 0; round < 10; ++round) {
+      for (int i = 0; i < 50; ++i) {
+        ASYLO_ASSERT_OK(
+            store->Put(absl::StrCat("key", i), absl::StrCat(round, "-", i)));
+      }
+    }
+    for (int i = 0; i < 50; i += 2) {
+      ASYLO_ASSERT_OK(store->Delete(absl::StrCat("key", i)));
+    }
+    EXPECT_GT(store->GarbageRatio(), 0.9);
+
+    uint64_t log_size = store->LogSize();
+    ASYLO_ASSERT_OK(store->Compact());
+    EXPECT_LT(store->LogSize(), log_size / 10);
+    EXPECT_EQ(store->GarbageRatio(), 0);
+    EXPECT_THAT(store->Get("key1"), IsOkAndHolds("9-1"));
+    ASYLO_ASSERT_OK(store->Put("key2", "new"));
+  }
+  EXPECT_EQ(access(absl::StrCat(directory_, "/log-000000").c_str(), F_OK),
+            -1);
+
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_EQ(store->Size(), 26u);
+  EXPECT_THAT(store->Get("key2"), IsOkAndHolds("new"));
+  EXPECT_THAT(store->Get("key49"), IsOkAndHolds("9-49"));
+  EXPECT_THAT(store->Get("key48").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+}
+
+TEST_F(SealedKvStoreTest, BackgroundCompaction) {
+  options_.background_compaction = true;
+  options_.min_compaction_bytes = 4096;
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  for (int i = 0; i < 1000; ++i) {
+    ASYLO_ASSERT_OK(store->Put("key", absl::StrCat(i)));
+  }
+  // The compaction thread rewrites the log while the writes above proceed.
+  EXPECT_THAT(store->Get("key"), IsOkAndHolds("999"));
+  store.reset();
+
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_THAT(store->Get("key"), IsOkAndHolds("999"));
+}
+
+TEST_F(SealedKvStoreTest, ConcurrentWriters) {
+  constexpr size_t kThreads = 8;
+  constexpr size_t kWrites = 200;
+  options_.checkpoint_interval = 64;
+  {
+    std::unique_ptr<SealedKvStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&store, t] {
+        for (size_t i = 0; i < kWrites; ++i) {
+          KvWriteBatch batch;
+          batch.Put(absl::StrCat(t, "/", i), absl::StrCat(i));
+          batch.Put(absl::StrCat(t, "/last"), absl::StrCat(i));
+          ASYLO_EXPECT_OK(store->Write(batch));
+          ASYLO_EXPECT_OK(store->Get(absl::StrCat(t, "/last")).status());
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(store->Size(), kThreads * (kWrites + 1));
+  }
+
+  std::unique_ptr<SealedKvStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_EQ(store->Size(), kThreads * (kWrites + 1));
+  for (size_t t = 0; t < kThreads; ++t) {
+    EXPECT_THAT(store->Get(absl::StrCat(t, "/last")),
+                IsOkAndHolds(absl::StrCat(kWrites - 1)));
+  }
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,252 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Runs the core YCSB workloads against a SealedKvStore. The store is loaded
+// with --records records, after which each workload issues --operations
+// operations from --threads threads, choosing keys from a Zipfian distribution
+// (or, for workload D, favoring the latest inserts). The benchmark reports the
+// throughput of each phase, the size of the log and the fraction of it that is
+// garbage.
+//
+//   A: 50% reads, 50% updates
+//   B: 95% reads, 5% updates
+//   C: 100% reads
+//   D: 95% reads of recent keys, 5% inserts
+//   E: 95% short scans, 5% inserts
+//   F: 50% reads, 50% read-modify-writes
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "asylo/platform/storage/kv/sealed_kv_store.h"
+#include "gflags/gflags.h"
+
+DEFINE_string(directory, "/tmp/ycsb_sealed_kv_store",
+              "Directory of the store, which is cleared first");
+DEFINE_string(workloads, "ABCDEF", "Workloads to run, in order");
+DEFINE_int32(records, 100000, "Number of records loaded before the workloads");
+DEFINE_int32(operations, 100000, "Number of operations of each workload");
+DEFINE_int32(threads, 4, "Number of client threads");
+DEFINE_int32(value_size, 100, "Size of each value in bytes");
+DEFINE_int32(max_scan_length, 100, "Longest scan issued by workload E");
+DEFINE_bool(sync, true, "Synchronize every group commit to storage");
+DEFINE_bool(background_compaction, true, "Compact the log in the background");
+
+namespace asylo {
+namespace {
+
+constexpr char kKey[] = "0123456789abcdef0123456789abcdef";
+
+// Generates integers in [0, n) following a Zipfian distribution with constant
+// |theta|, using the method of Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases", as YCSB does. Item 0 is the most popular.
+class ZipfianGenerator {
+ public:
+  explicit ZipfianGenerator(uint64_t n, double theta = 0.99)
+      : n_(n), theta_(theta), zeta_n_(Zeta(n, theta)) {
+    alpha_ = 1.0 / (1.0 - theta_);
+    double zeta_2 = Zeta(2, theta_);
+    eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) / (1.0 - zeta_2 / zeta_n_);
+  }
+
+  uint64_t Next(std::mt19937_64 *random) const {
+    double u = std::uniform_real_distribution<double>(0, 1)(*random);
+    double uz = u * zeta_n_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    uint64_t value = n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_);
+    return std::min(value, n_ - 1);
+  }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(i, theta);
+    }
+    return sum;
+  }
+
+  const uint64_t n_;
+  const double theta_;
+  const double zeta_n_;
+  double alpha_;
+  double eta_;
+};
+
+// Returns the key of record |index|. Keys are hashed so that popular records
+// are spread over the key space rather than clustered at its start.
+std::string RecordKey(uint64_t index) {
+  uint64_t hash = index * 0x9e3779b97f4a7c15ULL;
+  return absl::StrFormat("user%016x", hash);
+}
+
+std::string RandomValue(std::mt19937_64 *random) {
+  std::string value(FLAGS_value_size, '\0');
+  for (char &c : value) {
+    c = 'a' + (*random)() % 26;
+  }
+  return value;
+}
+
+void CheckOk(const Status &status) {
+  if (!status.ok()) {
+    std::cerr << status << std::endl;
+    std::exit(1);
+  }
+}
+
+// Runs |operation| |total| times, split over FLAGS_threads threads, and prints
+// the throughput.
+template <typename Operation>
+void RunPhase(const std::string &name, int total, SealedKvStore *store,
+              Operation operation) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < FLAGS_threads; ++t) {
+    int count = total / FLAGS_threads + (t < total % FLAGS_threads ? 1 : 0);
+    threads.emplace_back([&operation, count, t] {
+      std::mt19937_64 random(t + 1);
+      for (int i = 0; i < count; ++i) {
+        operation(&random);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cout << absl::StrFormat(
+      "%-8s %10.0f ops/s   log %8.1f MiB   garbage %5.3f\n", name,
+      total / seconds, store->LogSize() / 1048576.0, store->GarbageRatio());
+}
+
+void Run() {
+  std::system(absl::StrFormat("rm -rf '%s'", FLAGS_directory).c_str());
+  SealedKvStoreOptions options;
+  options.sync = FLAGS_sync;
+  options.background_compaction = FLAGS_background_compaction;
+  auto store_result = SealedKvStore::Open(FLAGS_directory, kKey, options);
+  CheckOk(store_result.status());
+  std::unique_ptr<SealedKvStore> store = std::move(store_result.ValueOrDie());
+
+  std::atomic<uint64_t> next_load(0);
+  RunPhase("load", FLAGS_records, store.get(),
+           [&](std::mt19937_64 *random) {
+             CheckOk(store->Put(RecordKey(next_load++), RandomValue(random)));
+           });
+
+  // Records inserted by workloads D and E are appended after the loaded ones.
+  std::atomic<uint64_t> record_count(FLAGS_records);
+  ZipfianGenerator zipfian(FLAGS_records);
+  auto existing_key = [&](std::mt19937_64 *random) {
+    return RecordKey(zipfian.Next(random) % record_count.load());
+  };
+  auto read = [&](const std::string &key) {
+    auto result = store->Get(key);
+    if (!result.ok() &&
+        result.status().error_code() != error::GoogleError::NOT_FOUND) {
+      CheckOk(result.status());
+    }
+  };
+  auto percent = [](std::mt19937_64 *random) { return (*random)() % 100; };
+
+  for (char workload : FLAGS_workloads) {
+    std::string name = absl::StrFormat("%c", workload);
+    switch (workload) {
+      case 'A':
+      case 'B':
+      case 'C': {
+        uint64_t reads = workload == 'A' ? 50 : workload == 'B' ? 95 : 100;
+        RunPhase(name, FLAGS_operations, store.get(),
+                 [&, reads](std::mt19937_64 *random) {
+                   std::string key = existing_key(random);
+                   if (percent(random) < reads) {
+                     read(key);
+                   } else {
+                     CheckOk(store->Put(key, RandomValue(random)));
+                   }
+                 });
+        break;
+      }
+      case 'D':
+        RunPhase(name, FLAGS_operations, store.get(),
+                 [&](std::mt19937_64 *random) {
+                   if (percent(random) < 95) {
+                     uint64_t count = record_count.load();
+                     read(RecordKey(count - 1 - zipfian.Next(random) % count));
+                   } else {
+                     CheckOk(store->Put(RecordKey(record_count++),
+                                        RandomValue(random)));
+                   }
+                 });
+        break;
+      case 'E':
+        RunPhase(name, FLAGS_operations, store.get(),
+                 [&](std::mt19937_64 *random) {
+                   if (percent(random) < 95) {
+                     size_t length = 1 + (*random)() % FLAGS_max_scan_length;
+                     CheckOk(store->Scan(existing_key(random), length)
+                                 .status());
+                   } else {
+                     CheckOk(store->Put(RecordKey(record_count++),
+                                        RandomValue(random)));
+                   }
+                 });
+        break;
+      case 'F':
+        RunPhase(name, FLAGS_operations, store.get(),
+                 [&](std::mt19937_64 *random) {
+                   std::string key = existing_key(random);
+                   read(key);
+                   if (percent(random) < 50) {
+                     CheckOk(store->Put(key, RandomValue(random)));
+                   }
+                 });
+        break;
+      default:
+        std::cerr << "Unknown workload " << workload << std::endl;
+        std::exit(1);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Run();
+  return 0;
+}
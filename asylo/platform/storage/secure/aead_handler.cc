@@ -23,6 +23,7 @@
 // IO syscall interface constants.
 #include <fcntl.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <memory>
 
@@ -141,9 +142,14 @@ using BlockView = ByteContainerView;
 using CiphertextView = ByteContainerView;
 using SecureBlockView = ByteContainerView;
 
+// Number of blocks read from the host at once when collecting integrity
+// metadata of a file.
+constexpr int64_t kDeserializeBatchBlocks = 1024;
+
 AeadHandler::AeadHandler()
     : offset_translator_(OffsetTranslator::Create(
-          sizeof(FileHeader), kBlockLength, kSecureBlockLength)) {}
+          sizeof(FileHeader), kBlockLength, kSecureBlockLength)),
+      block_reads_(0) {}
 
 bool AeadHandler::Deserialize(FileControl *file_ctrl) {
   if (!file_ctrl) {
@@ -166,6 +172,9 @@ bool AeadHandler::Deserialize(FileControl *file_ctrl) {
 
     file_ctrl->is_new = false;
 
+    // The header of the new file has been written but not synchronized.
+    file_ctrl->generation++;
+
     // No metadata to collect.
     return true;
   }
@@ -194,32 +203,36 @@ bool AeadHandler::Deserialize(FileControl *file_ctrl) {
   // confirms validity of both the file size and the integrity metadata.
   const int64_t blocks_count =
       (file_header.file_size + kBlockLength - 1) / kBlockLength;
-  Tag tag;
-  for (int64_t block_index = 0; block_index < blocks_count; block_index++) {
-    off_t offset = enc_untrusted_lseek(fd, kBlockLength, SEEK_CUR);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek past block when collecting integrity metadata.";
-      return false;
-    }
 
-    bytes_read = read_all(fd, tag.data(), kTagLength);
-    if (bytes_read != kTagLength) {
+  // Read the blocks in batches to bound the number of host calls for large
+  // files. Blocks in sparse regions of the file read as zeros, thus their auth
+  // tags are zero tags as well.
+  std::vector<uint8_t> batch;
+  for (int64_t batch_start = 0; batch_start < blocks_count;
+       batch_start += kDeserializeBatchBlocks) {
+    const int64_t batch_blocks =
+        std::min(kDeserializeBatchBlocks, blocks_count - batch_start);
+    batch.resize(batch_blocks * kSecureBlockLength);
+    bytes_read = read_all(fd, batch.data(), batch.size());
+    if (static_cast<size_t>(bytes_read) != batch.size()) {
       LOG(ERROR) << "Failed to read integrity metadata, bytes_read="
                  << bytes_read;
       return false;
     }
 
-    std::string tag_string(reinterpret_cast<char *>(tag.data()), kTagLength);
-    VLOG(2) << "Adding auth tag as leaf to rebuild Merkle tree: "
-            << absl::BytesToHexString(tag_string);
-    file_ctrl->ad->AddLeaf(tag_string);
-
-    offset = enc_untrusted_lseek(fd, kTokenLength, SEEK_CUR);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek past token when collecting integrity metadata.";
-      return false;
+    for (int64_t block_index = 0; block_index < batch_blocks; block_index++) {
+      const uint8_t *tag =
+          batch.data() + block_index * kSecureBlockLength + kBlockLength;
+      if (std::all_of(tag, tag + kTagLength,
+                      [](uint8_t byte) { return byte == 0; })) {
+        file_ctrl->ad->AddLeafHash(file_ctrl->zero_hash);
+        continue;
+      }
+
+      std::string tag_string(reinterpret_cast<const char *>(tag), kTagLength);
+      VLOG(2) << "Adding auth tag as leaf to rebuild Merkle tree: "
+              << absl::BytesToHexString(tag_string);
+      file_ctrl->ad->AddLeaf(tag_string);
     }
   }
 
@@ -383,46 +396,80 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
       (full_inclusive_blocks_bytes_count / kBlockLength) * kSecureBlockLength;
   buffer.resize(physical_bytes_count);
 
-  // Move cursor to the first full block to read.
   const off_t first_logical_block_offset =
       (first_partial_block_bytes_count > 0)
           ? (logical_offset + first_partial_block_bytes_count - kBlockLength)
           : logical_offset;
   const off_t first_physical_block_offset =
       offset_translator_->LogicalToPhysical(first_logical_block_offset);
-  if (first_partial_block_bytes_count > 0) {
-    off_t offset =
-        enc_untrusted_lseek(fd, first_physical_block_offset, SEEK_SET);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek to the fist block offset when reading file data.";
-      return -1;
+  const int64_t blocks_read_max = physical_bytes_count / kSecureBlockLength;
+  const off_t first_block_index =
+      (first_physical_block_offset - sizeof(FileHeader)) / kSecureBlockLength;
+
+  // Blocks that belong to sparse regions in the file are known to hold zeros,
+  // and are not backed by data on the host.
+  std::vector<bool> sparse_blocks(blocks_read_max);
+  for (int64_t block_index = 0; block_index < blocks_read_max; block_index++) {
+    sparse_blocks[block_index] =
+        file_ctrl.ad->LeafHash(first_block_index + block_index + 1) ==
+        file_ctrl.zero_hash;
+  }
+
+  // Perform one read per run of blocks that are not sparse. Read may have been
+  // requested beyond EOF - cannot require that all blocks are read, in which
+  // case only the blocks before the first one not read are processed. The read
+  // was not requested at EOF - checked this above.
+  int64_t blocks_read = blocks_read_max;
+  int64_t run_start = 0;
+  while (run_start < blocks_read) {
+    if (sparse_blocks[run_start]) {
+      run_start++;
+      continue;
+    }
+    int64_t run_end = run_start + 1;
+    while (run_end < blocks_read && !sparse_blocks[run_end]) {
+      run_end++;
     }
-  }
 
-  // Perform the read. Read may have been requested beyond EOF - cannot require
-  // that bytes_read is equal to physical_bytes_count. The read was not
-  // requested at EOF - checked this above.
-  ssize_t bytes_read =
-      enc_untrusted_read(fd, buffer.data(), physical_bytes_count);
-  if (bytes_read <= 0) {
-    LOG(ERROR) << "Cannot verify data - data has not been read, fd = " << fd;
-    return -1;
+    // The cursor is already at the first full block to read, unless the range
+    // starts with a partial block or with a sparse region.
+    if (run_start > 0 || first_partial_block_bytes_count > 0) {
+      off_t offset = enc_untrusted_lseek(
+          fd, first_physical_block_offset + run_start * kSecureBlockLength,
+          SEEK_SET);
+      if (offset == -1) {
+        LOG(ERROR)
+            << "Failed lseek to the first block offset when reading file data.";
+        return -1;
+      }
+    }
+
+    const size_t run_bytes_count = (run_end - run_start) * kSecureBlockLength;
+    block_reads_.fetch_add(1, std::memory_order_relaxed);
+    ssize_t bytes_read =
+        read_all(fd, buffer.data() + run_start * kSecureBlockLength,
+                 run_bytes_count);
+    if (bytes_read == -1) {
+      LOG(ERROR) << "Cannot verify data - data has not been read, fd = " << fd;
+      return -1;
+    }
+    if (static_cast<size_t>(bytes_read) != run_bytes_count) {
+      // Process only complete blocks read, since need per-block metadata to
+      // decrypt the block.
+      blocks_read = run_start + bytes_read / kSecureBlockLength;
+    }
+    run_start = run_end;
   }
 
-  // Process only complete blocks read, since need per-block metadata to decrypt
-  // the block.
-  bytes_read = (bytes_read / kSecureBlockLength) * kSecureBlockLength;
-  if (bytes_read == 0) {
+  if (blocks_read == 0) {
     LOG(ERROR) << "Cannot verify data - data has not been read, fd = " << fd;
     return -1;
   }
 
   // Move cursor to the position of the end of the read range.
   off_t new_cur_logical_offset = logical_offset + count;
-  if (bytes_read != physical_bytes_count) {
-    int64_t blocks_not_read =
-        (physical_bytes_count - bytes_read) / kSecureBlockLength;
+  if (blocks_read != blocks_read_max) {
+    int64_t blocks_not_read = blocks_read_max - blocks_read;
     if (last_partial_block_bytes_count > 0) {
       new_cur_logical_offset -= last_partial_block_bytes_count;
       blocks_not_read--;
@@ -443,10 +490,6 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
   }
 
   // Cycle through blocks.
-  const int64_t blocks_read = bytes_read / kSecureBlockLength;
-  const int64_t blocks_read_max = physical_bytes_count / kSecureBlockLength;
-  const off_t first_block_index =
-      (first_physical_block_offset - sizeof(FileHeader)) / kSecureBlockLength;
   size_t read_count = 0;
   for (int64_t block_index = 0; block_index < blocks_read; block_index++) {
     const size_t merkle_block_idx = first_block_index + block_index + 1;
@@ -454,12 +497,19 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
     uint8_t *plaintext_data =
         GetPlaintextBuffer(first_partial_block_bytes_count, block_index, buf);
 
-    // Detect full blocks that belong to sparse regions in the file - no need to
-    // decrypt.
-    if (file_ctrl.ad->LeafHash(merkle_block_idx) == file_ctrl.zero_hash) {
+    // Blocks that belong to sparse regions in the file were not read - no need
+    // to decrypt.
+    if (sparse_blocks[block_index]) {
       VLOG(2) << "A sparse region block detected.";
-      memset(plaintext_data, 0, kBlockLength);
-      read_count += kBlockLength;
+      size_t block_bytes_count = kBlockLength;
+      if (block_index == 0 && first_partial_block_bytes_count > 0) {
+        block_bytes_count = first_partial_block_bytes_count;
+      } else if (block_index == blocks_read_max - 1 &&
+                 last_partial_block_bytes_count > 0) {
+        block_bytes_count = last_partial_block_bytes_count;
+      }
+      memset(plaintext_data, 0, block_bytes_count);
+      read_count += block_bytes_count;
       continue;
     }
 
@@ -532,7 +582,7 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
   }
 
   VLOG(2) << "Verified read blocks, blocks_read = " << blocks_read
-          << ", bytes_read = " << bytes_read;
+          << ", read_count = " << read_count;
   return read_count;
 }
 
@@ -844,17 +894,136 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     }
   }
 
-  file_ctrl->logical_size = logical_offset + count;
+  // Writes within the file do not change its size.
+  file_ctrl->logical_size =
+      std::max<size_t>(file_ctrl->logical_size, logical_offset + count);
 
   if (!UpdateDigest(file_ctrl.get(), *cryptor)) {
     return -1;
   }
 
+  // The header is written but not synchronized until the file is.
+  file_ctrl->generation++;
+
   VLOG(2) << "Wrote data to file, bytes_written = " << bytes_written;
 
   return count;
 }
 
+bool AeadHandler::TruncateFile(int fd, off_t length) {
+  if (length < 0) {
+    errno = EINVAL;
+    return false;
+  }
+
+  std::shared_ptr<FileControl> file_ctrl;
+  {
+    absl::MutexLock global_lock(&mu_);
+
+    auto entry = fmap_.find(fd);
+    if (entry == fmap_.end()) {
+      LOG(ERROR) << "Attempt made to truncate an unopened file, fd = " << fd;
+      errno = ENOENT;
+      return false;
+    }
+
+    file_ctrl = entry->second;
+  }
+
+  absl::MutexLock lock(&file_ctrl->mu);
+  const GcmCryptor *cryptor = GetGcmCryptor(*file_ctrl);
+  if (!cryptor) {
+    return false;
+  }
+
+  if (static_cast<size_t>(length) == file_ctrl->logical_size) {
+    return true;
+  }
+
+  // Integrity metadata of blocks cannot be removed from the AD.
+  if (static_cast<size_t>(length) < file_ctrl->logical_size) {
+    LOG(ERROR) << "Attempt made to shrink a secure file, path="
+               << file_ctrl->path << ", length = " << length;
+    errno = EINVAL;
+    return false;
+  }
+
+  // The bytes of the last block beyond EOF are zeros, blocks added to the file
+  // belong to a sparse region and are left as a hole in the host file.
+  const int64_t blocks_count = (length + kBlockLength - 1) / kBlockLength;
+  const int64_t eof_block_index = file_ctrl->ad->LeafCount();
+  if (blocks_count > eof_block_index) {
+    const off_t physical_size =
+        sizeof(FileHeader) + blocks_count * kSecureBlockLength;
+    if (enc_untrusted_ftruncate(fd, physical_size) != 0) {
+      LOG(ERROR) << "Failed to extend the file, path=" << file_ctrl->path
+                 << ", errno = " << errno;
+      return false;
+    }
+
+    for (int64_t idx = eof_block_index; idx < blocks_count; idx++) {
+      file_ctrl->ad->AddLeafHash(file_ctrl->zero_hash);
+    }
+  }
+
+  file_ctrl->logical_size = length;
+  if (!UpdateDigest(file_ctrl.get(), *cryptor)) {
+    return false;
+  }
+  file_ctrl->generation++;
+
+  VLOG(2) << "Extended file, path = " << file_ctrl->path
+          << ", length = " << length;
+  return true;
+}
+
+bool AeadHandler::SyncFile(int fd) {
+  std::shared_ptr<FileControl> file_ctrl;
+  {
+    absl::MutexLock global_lock(&mu_);
+
+    auto entry = fmap_.find(fd);
+    if (entry == fmap_.end()) {
+      LOG(ERROR) << "Attempt made to sync an unopened file, fd = " << fd;
+      errno = ENOENT;
+      return false;
+    }
+
+    file_ctrl = entry->second;
+  }
+
+  // Any descriptor of the file synchronizes the same data, so the batch may be
+  // run with the descriptor of whichever caller leads it.
+  FileControl *file = file_ctrl.get();
+  return file_ctrl->group_sync.Sync(
+      [this, fd, file] { return SyncFileData(fd, file); });
+}
+
+bool AeadHandler::SyncFileData(int fd, FileControl *file_ctrl) const {
+  uint64_t generation;
+  {
+    absl::MutexLock lock(&file_ctrl->mu);
+    generation = file_ctrl->generation;
+    if (file_ctrl->synced_generation == generation) {
+      return true;
+    }
+  }
+
+  // Every write updates the header after its data, so synchronizing the file
+  // makes the data and the header that covers it durable together. Writes
+  // made after |generation| was read may be synchronized as well.
+  if (enc_untrusted_fsync(fd) != 0) {
+    LOG(ERROR) << "Failed to synchronize file, path=" << file_ctrl->path
+               << ", errno = " << errno;
+    return false;
+  }
+
+  absl::MutexLock lock(&file_ctrl->mu);
+  file_ctrl->synced_generation =
+      std::max(file_ctrl->synced_generation, generation);
+  return true;
+}
+
 bool AeadHandler::FinalizeFile(int fd) {
   absl::MutexLock global_lock(&mu_);
 
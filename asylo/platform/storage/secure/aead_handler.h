@@ -20,6 +20,7 @@
 #define ASYLO_PLATFORM_STORAGE_SECURE_AEAD_HANDLER_H_
 
 #include <stdint.h>
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -30,6 +31,7 @@
 #include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
 #include "asylo/platform/storage/secure/authenticated_dictionary.h"
 #include "asylo/platform/storage/secure/ctmmt_authenticated_dictionary.h"
+#include "asylo/platform/storage/utils/group_sync.h"
 #include "asylo/platform/storage/utils/offset_translator.h"
 
 namespace asylo {
@@ -92,6 +94,17 @@ class AeadHandler {
   ssize_t EncryptAndPersist(int fd, const void *buf, size_t count)
       LOCKS_EXCLUDED(mu_);
 
+  // Extends a file to |length| bytes, returns false on failure. The extension
+  // reads as zeros and occupies no space on the host. Shrinking a file is not
+  // supported.
+  bool TruncateFile(int fd, off_t length) LOCKS_EXCLUDED(mu_);
+
+  // Makes the data written to a file and the file header that covers it
+  // durable, returns false on failure. Until the file is synchronized, a crash
+  // may leave the header and the data on disk out of step. Concurrent calls
+  // for the same file are served by a single synchronization.
+  bool SyncFile(int fd) LOCKS_EXCLUDED(mu_);
+
   // Frees resources used to assure integrity of an opened file, persists
   // integrity metadata to a designated location on disk, returns false on
   // failure. Does not modify the state of the file descriptor.
@@ -106,6 +119,12 @@ class AeadHandler {
 
   const OffsetTranslator &GetOffsetTranslator() const;
 
+  // Returns the number of reads of file blocks issued to the host so far,
+  // across all files.
+  uint64_t BlockReadCount() const {
+    return block_reads_.load(std::memory_order_relaxed);
+  }
+
  private:
   // Structure represents the file header layout.
   struct FileHeader {
@@ -143,6 +162,14 @@ class AeadHandler {
     std::string zero_hash;
     std::unique_ptr<GcmCryptorKey> master_key;
 
+    // Number of modifications made to the file, and the number covered by the
+    // last synchronization.
+    uint64_t generation;
+    uint64_t synced_generation;
+
+    // Coalesces concurrent synchronizations of the file.
+    GroupSync group_sync;
+
     // Mutex for protecting FileControl instance.
     absl::Mutex mu;
 
@@ -151,7 +178,9 @@ class AeadHandler {
           logical_size(0),
           is_new(is_new_file),
           is_deserialized(false),
-          ad(absl::make_unique<CTMMTAuthenticatedDictionary>()) {
+          ad(absl::make_unique<CTMMTAuthenticatedDictionary>()),
+          generation(0),
+          synced_generation(0) {
       UnsafeBytes<kTagLength> tag;
       memset(tag.data(), 0, kTagLength);
       std::string tag_string(reinterpret_cast<char *>(tag.data()), kTagLength);
@@ -182,6 +211,11 @@ class AeadHandler {
   bool UpdateDigest(FileControl *file_ctrl, const GcmCryptor &cryptor) const
       EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
 
+  // Synchronizes the file opened as |fd| to disk. Called by one thread on
+  // behalf of a batch of SyncFile() callers.
+  bool SyncFileData(int fd, FileControl *file_ctrl) const
+      LOCKS_EXCLUDED(file_ctrl->mu);
+
   // Returns an instance of GcmCryptor associated with a file, or nullptr if was
   // not able to retrieve. The caller does not own the instance.
   GcmCryptor *GetGcmCryptor(const FileControl &file_ctrl) const
@@ -212,6 +246,9 @@ class AeadHandler {
   // An instance that performs operations on untrusted file offset.
   std::unique_ptr<OffsetTranslator> offset_translator_;
 
+  // Number of reads of file blocks issued to the host.
+  mutable std::atomic<uint64_t> block_reads_;
+
   // Mutex for protecting map members of the class.
   absl::Mutex mu_;
 };
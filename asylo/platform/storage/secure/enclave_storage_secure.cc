@@ -141,6 +141,14 @@ int secure_fstat(int fd, struct stat *st) {
   return ret;
 }
 
+int secure_ftruncate(int fd, off_t length) {
+  return AeadHandler::GetInstance().TruncateFile(fd, length) ? 0 : -1;
+}
+
+int secure_fsync(int fd) {
+  return AeadHandler::GetInstance().SyncFile(fd) ? 0 : -1;
+}
+
 }  // namespace storage
 }  // namespace platform
 }  // namespace asylo
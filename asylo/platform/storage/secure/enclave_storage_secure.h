@@ -50,6 +50,12 @@ off_t secure_lseek(int fd, off_t offset, int whence);
 // |st->st_size| will be set to logical file size on success.
 int secure_fstat(int fd, struct stat* st);
 
+// Only extending the file is supported.
+int secure_ftruncate(int fd, off_t length);
+
+// Synchronizes the file data and the header that authenticates it to disk.
+int secure_fsync(int fd);
+
 }  // namespace storage
 }  // namespace platform
 }  // namespace asylo
@@ -22,6 +22,9 @@
 #include <fcntl.h>
 #include <openssl/rand.h>
 
+#include <string>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/base/macros.h"
@@ -46,6 +49,8 @@ using platform::storage::kCipherBlockLength;
 using platform::storage::kFileHashLength;
 using platform::storage::secure_close;
 using platform::storage::secure_fstat;
+using platform::storage::secure_fsync;
+using platform::storage::secure_ftruncate;
 using platform::storage::secure_lseek;
 using platform::storage::secure_open;
 using platform::storage::secure_read;
@@ -500,10 +505,174 @@ TEST_P(EnclaveStorageSecureTest, LseekEndSuccess) {
   EXPECT_EQ(secure_close(fd), 0);
 }
 
+TEST_P(EnclaveStorageSecureTest, FtruncateExtendsWithZerosSuccess) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  const off_t length = test_buf_len_ + 10 * kBlockLength + 1;
+
+  int fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  ASSERT_EQ(secure_ftruncate(fd, length), 0) << strerror(errno);
+  struct stat file_stat;
+  EXPECT_EQ(secure_fstat(fd, &file_stat), 0);
+  EXPECT_EQ(file_stat.st_size, length);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  // Read the data written before the extension, followed by zeros.
+  fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(memcmp(GetZeroBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_lseek(fd, length - 1, SEEK_SET), length - 1);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), 1);
+  EXPECT_EQ(memcmp(GetZeroBuffer(), GetReadBuffer(), 1), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, ReadAcrossDataHoleDataSuccess) {
+  // Write data at the head and the tail of the file, then a block in the middle
+  // of the hole between them.
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  EXPECT_THAT(OpenWriteClose(4 * test_buf_len_), IsOk());
+  EXPECT_THAT(OpenWriteClose(2 * test_buf_len_), IsOk());
+
+  std::vector<char> expected(5 * test_buf_len_, 0);
+  for (int buffer_index : {0, 2, 4}) {
+    memcpy(expected.data() + buffer_index * test_buf_len_, GetWriteBuffer(),
+           test_buf_len_);
+  }
+
+  // Read the whole file in a single call.
+  int fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  std::vector<char> actual(expected.size());
+  EXPECT_EQ(secure_read(fd, actual.data(), actual.size()), actual.size());
+  EXPECT_EQ(actual, expected);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, ReadHoleWithoutHostReadSuccess) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  const off_t hole_offset =
+      (test_buf_len_ + kBlockLength - 1) / kBlockLength * kBlockLength;
+  const size_t hole_read_length = 4 * kBlockLength;
+
+  int fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  ASSERT_EQ(secure_ftruncate(fd, hole_offset + 2 * hole_read_length), 0)
+      << strerror(errno);
+  ASSERT_EQ(secure_lseek(fd, hole_offset, SEEK_SET), hole_offset);
+
+  // Blocks of the hole are served from memory.
+  const uint64_t block_reads = AeadHandler::GetInstance().BlockReadCount();
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), hole_read_length),
+            hole_read_length);
+  EXPECT_EQ(AeadHandler::GetInstance().BlockReadCount(), block_reads);
+  EXPECT_EQ(memcmp(GetZeroBuffer(), GetReadBuffer(), hole_read_length), 0);
+
+  // Blocks holding data are read from the host.
+  ASSERT_EQ(secure_lseek(fd, 0, SEEK_SET), 0);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_GT(AeadHandler::GetInstance().BlockReadCount(), block_reads);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, FsyncPersistsHeaderSuccess) {
+  int fd = secure_open(GetPath().c_str(), O_WRONLY | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  ASSERT_EQ(secure_write(fd, GetWriteBuffer(), test_buf_len_), test_buf_len_);
+  ASSERT_EQ(secure_fsync(fd), 0) << strerror(errno);
+
+  // The header on disk already covers the write, so closing the file does not
+  // need to rewrite it.
+  std::string synced_header(kFileHeaderLength, '\0');
+  int host_fd = enc_untrusted_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(host_fd, 0);
+  EXPECT_EQ(enc_untrusted_read(host_fd, &synced_header[0], kFileHeaderLength),
+            kFileHeaderLength);
+  ASSERT_EQ(enc_untrusted_close(host_fd), 0) << strerror(errno);
+  ASSERT_EQ(secure_close(fd), 0);
+
+  std::string closed_header(kFileHeaderLength, '\0');
+  host_fd = enc_untrusted_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(host_fd, 0);
+  EXPECT_EQ(enc_untrusted_read(host_fd, &closed_header[0], kFileHeaderLength),
+            kFileHeaderLength);
+  ASSERT_EQ(enc_untrusted_close(host_fd), 0) << strerror(errno);
+  EXPECT_EQ(synced_header, closed_header);
+
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, UnsyncedOverwriteLeavesValidFileSuccess) {
+  int fd = secure_open(GetPath().c_str(), O_RDWR | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  ASSERT_EQ(secure_write(fd, GetWriteBuffer(), test_buf_len_), test_buf_len_);
+  ASSERT_EQ(secure_fsync(fd), 0) << strerror(errno);
+
+  // Overwrite the data in place without synchronizing the file.
+  const std::string overwrite(test_buf_len_, 'x');
+  ASSERT_EQ(secure_lseek(fd, 0, SEEK_SET), 0);
+  ASSERT_EQ(secure_write(fd, overwrite.data(), test_buf_len_), test_buf_len_);
+
+  // Copy the host file as left by a crash before the file is closed.
+  const std::string copy_path = absl::StrCat(GetPath(), ".copy");
+  remove(copy_path.c_str());
+  int host_fd = enc_untrusted_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(host_fd, 0);
+  int copy_fd = enc_untrusted_open(copy_path.c_str(), O_WRONLY | O_CREAT,
+                                   S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(copy_fd, 0);
+  char chunk[kMaxTestBufLen];
+  ssize_t bytes_read;
+  while ((bytes_read = enc_untrusted_read(host_fd, chunk, sizeof(chunk))) > 0) {
+    ASSERT_EQ(enc_untrusted_write(copy_fd, chunk, bytes_read), bytes_read);
+  }
+  ASSERT_EQ(bytes_read, 0) << strerror(errno);
+  ASSERT_EQ(enc_untrusted_close(copy_fd), 0) << strerror(errno);
+  ASSERT_EQ(enc_untrusted_close(host_fd), 0) << strerror(errno);
+
+  // The copy opens and reads back the overwritten data.
+  int reopened_fd = secure_open(copy_path.c_str(), O_RDONLY);
+  ASSERT_GE(reopened_fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(reopened_fd), 0);
+  EXPECT_EQ(secure_read(reopened_fd, GetReadBuffer(), test_buf_len_),
+            test_buf_len_);
+  EXPECT_EQ(memcmp(overwrite.data(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_close(reopened_fd), 0);
+
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
 //
 // Failure cases.
 //
 
+TEST_P(EnclaveStorageSecureTest, FtruncateShrinkFailure) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  int fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_ftruncate(fd, test_buf_len_ - 1), -1);
+  EXPECT_EQ(errno, EINVAL);
+  EXPECT_EQ(secure_close(fd), 0);
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, FsyncUnopenedFileFailure) {
+  EXPECT_EQ(secure_fsync(-1), -1);
+  EXPECT_EQ(errno, ENOENT);
+}
+
 TEST_P(EnclaveStorageSecureTest, ReadWriteDataModified) {
   EXPECT_THAT(OpenWriteClose(0), IsOk());
   // Modify file data - form of tampering.
@@ -0,0 +1,159 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures secure storage operations on a large, mostly empty file: extending
+// the file, writing a block of data every kDataStride bytes, synchronizing,
+// scanning the whole file, and reopening it. A smaller file extended by writing
+// zeros is measured as a baseline. Throughput is relative to the logical size
+// of the file. The Merkle tree of a file holds a leaf per block, so the size of
+// the sparse file is bounded by the enclave heap.
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/storage/secure/aead_handler.h"
+#include "asylo/platform/storage/secure/enclave_storage_secure.h"
+#include "asylo/test/util/test_flags.h"
+#include "asylo/util/logging.h"
+
+namespace asylo {
+namespace {
+
+using platform::storage::AeadHandler;
+using platform::storage::kBlockLength;
+using platform::storage::secure_close;
+using platform::storage::secure_fsync;
+using platform::storage::secure_ftruncate;
+using platform::storage::secure_lseek;
+using platform::storage::secure_open;
+using platform::storage::secure_read;
+using platform::storage::secure_write;
+
+constexpr off_t kSparseFileSize = off_t{1} << 30;
+constexpr off_t kDenseFileSize = off_t{64} << 20;
+constexpr off_t kDataStride = off_t{64} << 20;
+constexpr size_t kChunkLength = 1 << 20;
+constexpr uint8_t kKey[32] = {0x5a};
+
+class SparseFileBenchmark : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = absl::StrCat(FLAGS_test_tmpdir, "/SparseFileBenchmark.dat");
+    remove(path_.c_str());
+    chunk_.resize(kChunkLength);
+  }
+
+  void TearDown() override { remove(path_.c_str()); }
+
+  int Open() {
+    int fd = secure_open(path_.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(AeadHandler::GetInstance().SetMasterKey(fd, kKey, sizeof(kKey)),
+              0);
+    return fd;
+  }
+
+  // Reads the file opened as |fd| from the start in chunks, returns the number
+  // of bytes read.
+  off_t Scan(int fd) {
+    EXPECT_EQ(secure_lseek(fd, 0, SEEK_SET), 0);
+    off_t total = 0;
+    ssize_t bytes_read;
+    while ((bytes_read = secure_read(fd, chunk_.data(), chunk_.size())) > 0) {
+      total += bytes_read;
+    }
+    EXPECT_EQ(bytes_read, 0);
+    return total;
+  }
+
+  // Returns the space allocated to the file on the host.
+  int64_t AllocatedBytes() {
+    struct stat st;
+    EXPECT_EQ(enc_untrusted_stat(path_.c_str(), &st), 0);
+    return static_cast<int64_t>(st.st_blocks) * 512;
+  }
+
+  static void Report(const std::string &phase, off_t bytes,
+                     absl::Duration elapsed) {
+    LOG(INFO) << absl::StrFormat("%-24s %10.3f ms %10.1f MiB/s", phase,
+                                 absl::ToDoubleMilliseconds(elapsed),
+                                 bytes / 1048576.0 /
+                                     absl::ToDoubleSeconds(elapsed));
+  }
+
+  std::string path_;
+  std::vector<uint8_t> chunk_;
+};
+
+TEST_F(SparseFileBenchmark, DenseBaseline) {
+  int fd = Open();
+  absl::Time start = absl::Now();
+  for (off_t offset = 0; offset < kDenseFileSize; offset += kChunkLength) {
+    ASSERT_EQ(secure_write(fd, chunk_.data(), chunk_.size()), chunk_.size());
+  }
+  ASSERT_EQ(secure_fsync(fd), 0);
+  Report("extend by writing zeros", kDenseFileSize, absl::Now() - start);
+
+  start = absl::Now();
+  EXPECT_EQ(Scan(fd), kDenseFileSize);
+  Report("scan", kDenseFileSize, absl::Now() - start);
+  ASSERT_EQ(secure_close(fd), 0);
+
+  LOG(INFO) << "Allocated on the host: " << AllocatedBytes() << " bytes";
+}
+
+TEST_F(SparseFileBenchmark, MostlyEmptyFile) {
+  int fd = Open();
+  absl::Time start = absl::Now();
+  ASSERT_EQ(secure_ftruncate(fd, kSparseFileSize), 0);
+  Report("extend by ftruncate", kSparseFileSize, absl::Now() - start);
+
+  std::string data(kBlockLength, 'x');
+  start = absl::Now();
+  for (off_t offset = 0; offset < kSparseFileSize; offset += kDataStride) {
+    ASSERT_EQ(secure_lseek(fd, offset, SEEK_SET), offset);
+    ASSERT_EQ(secure_write(fd, data.data(), data.size()), data.size());
+  }
+  ASSERT_EQ(secure_fsync(fd), 0);
+  Report("write and fsync", kSparseFileSize, absl::Now() - start);
+
+  start = absl::Now();
+  EXPECT_EQ(Scan(fd), kSparseFileSize);
+  Report("scan", kSparseFileSize, absl::Now() - start);
+  ASSERT_EQ(secure_close(fd), 0);
+
+  start = absl::Now();
+  fd = Open();
+  Report("reopen", kSparseFileSize, absl::Now() - start);
+  ASSERT_EQ(secure_close(fd), 0);
+
+  LOG(INFO) << "Allocated on the host: " << AllocatedBytes() << " bytes";
+}
+
+}  // namespace
+}  // namespace asylo
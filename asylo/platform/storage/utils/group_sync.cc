@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/group_sync.h"
+
+#include <errno.h>
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+struct GroupSync::Waiter {
+  bool done = false;
+  bool result = false;
+  int error = 0;
+};
+
+GroupSync::GroupSync() : busy_(false), batches_(0) {}
+
+bool GroupSync::Sync(const std::function<bool()> &sync) {
+  Waiter waiter;
+  absl::MutexLock lock(&mu_);
+  waiters_.push_back(&waiter);
+  while (!waiter.done && busy_) {
+    cv_.Wait(&mu_);
+  }
+  if (waiter.done) {
+    if (!waiter.result) {
+      errno = waiter.error;
+    }
+    return waiter.result;
+  }
+
+  // No batch is running, so this caller runs one on behalf of every caller
+  // that has queued up so far.
+  std::vector<Waiter *> batch;
+  batch.swap(waiters_);
+  busy_ = true;
+  ++batches_;
+
+  mu_.Unlock();
+  bool result = sync();
+  int error = errno;
+  mu_.Lock();
+
+  for (Waiter *served : batch) {
+    served->done = true;
+    served->result = result;
+    served->error = error;
+  }
+  busy_ = false;
+  cv_.SignalAll();
+  errno = error;
+  return result;
+}
+
+uint64_t GroupSync::BatchCount() const {
+  absl::MutexLock lock(&mu_);
+  return batches_;
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
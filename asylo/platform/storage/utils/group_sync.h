@@ -0,0 +1,75 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_UTILS_GROUP_SYNC_H_
+#define ASYLO_PLATFORM_STORAGE_UTILS_GROUP_SYNC_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// Coalesces concurrent requests to make a file durable. A call to Sync() is
+// satisfied by any synchronization that starts after the call, so while one
+// thread synchronizes the file, the threads that call Sync() in the meantime
+// wait and are then served together by a single synchronization run by one of
+// them.
+class GroupSync {
+ public:
+  GroupSync();
+
+  GroupSync(const GroupSync &) = delete;
+  GroupSync &operator=(const GroupSync &) = delete;
+
+  // Makes every update completed before the call durable by running |sync|,
+  // either on this thread or on another thread on behalf of a batch of callers.
+  // Returns the result of the batch that covers the call. If the batch fails,
+  // errno is set to the value left by |sync|. Since a batch runs the |sync| of
+  // only one of its callers, all callers must pass equivalent functions.
+  bool Sync(const std::function<bool()> &sync) LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of times Sync() ran its argument.
+  uint64_t BatchCount() const LOCKS_EXCLUDED(mu_);
+
+ private:
+  // A call to Sync() waiting to be served.
+  struct Waiter;
+
+  mutable absl::Mutex mu_;
+  absl::CondVar cv_;
+
+  // Callers of Sync() that the next batch serves.
+  std::vector<Waiter *> waiters_ GUARDED_BY(mu_);
+
+  // True while a batch runs.
+  bool busy_ GUARDED_BY(mu_);
+
+  uint64_t batches_ GUARDED_BY(mu_);
+};
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_UTILS_GROUP_SYNC_H_
@@ -0,0 +1,115 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures concurrent append-and-sync throughput on a host file. Each of 1 to
+// --max_threads threads repeatedly appends a record to a shared file and then
+// makes it durable, either by calling fsync itself or through GroupSync. The
+// benchmark reports the throughput and the number of fsync calls per append.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "asylo/platform/storage/utils/group_sync.h"
+#include "gflags/gflags.h"
+
+DEFINE_string(path, "/tmp/group_sync_benchmark.dat", "File to append to");
+DEFINE_int32(max_threads, 32, "Largest number of appending threads");
+DEFINE_int32(duration_ms, 1000, "Duration of each measurement");
+DEFINE_int32(record_size, 128, "Size of each appended record in bytes");
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+// Runs |threads| threads appending to a fresh file for FLAGS_duration_ms and
+// prints the throughput. Uses GroupSync if |grouped| is true.
+void Measure(int threads, bool grouped) {
+  int fd = open(FLAGS_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND,
+                S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    std::cerr << "Could not open " << FLAGS_path << std::endl;
+    std::exit(1);
+  }
+
+  GroupSync group_sync;
+  std::atomic<uint64_t> fsyncs(0);
+  std::atomic<uint64_t> appends(0);
+  std::atomic<bool> stop(false);
+  auto sync = [fd, &fsyncs] {
+    ++fsyncs;
+    return fsync(fd) == 0;
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      std::string record(FLAGS_record_size, 'x');
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (write(fd, record.data(), record.size()) !=
+                static_cast<ssize_t>(record.size()) ||
+            !(grouped ? group_sync.Sync(sync) : sync())) {
+          std::cerr << "Append failed" << std::endl;
+          std::exit(1);
+        }
+        ++appends;
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_duration_ms));
+  stop = true;
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  close(fd);
+
+  std::cout << absl::StrFormat(
+      "%-7s %3d threads %10.0f appends/s   %5.3f fsyncs/append\n",
+      grouped ? "grouped" : "direct", threads,
+      appends * 1000.0 / FLAGS_duration_ms,
+      appends == 0 ? 0.0 : static_cast<double>(fsyncs) / appends);
+}
+
+void Run() {
+  for (int threads = 1; threads <= FLAGS_max_threads; threads *= 2) {
+    Measure(threads, /*grouped=*/false);
+    Measure(threads, /*grouped=*/true);
+  }
+  unlink(FLAGS_path.c_str());
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::platform::storage::Run();
+  return 0;
+}
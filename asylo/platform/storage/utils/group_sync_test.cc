@@ -0,0 +1,149 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/group_sync.h"
+
+#include <errno.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+TEST(GroupSyncTest, SyncRunsFunction) {
+  GroupSync group_sync;
+  int calls = 0;
+  EXPECT_TRUE(group_sync.Sync([&calls] {
+    ++calls;
+    return true;
+  }));
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(group_sync.BatchCount(), 1u);
+}
+
+TEST(GroupSyncTest, FailureSetsErrno) {
+  GroupSync group_sync;
+  errno = 0;
+  EXPECT_FALSE(group_sync.Sync([] {
+    errno = EIO;
+    return false;
+  }));
+  EXPECT_EQ(errno, EIO);
+}
+
+// Callers that arrive while a batch runs are served together by the next one.
+TEST(GroupSyncTest, ConcurrentCallersShareBatch) {
+  constexpr int kWaiters = 8;
+  GroupSync group_sync;
+  absl::Notification leader_started;
+  absl::Notification release_leader;
+  std::atomic<int> calls(0);
+  std::atomic<int> queued(0);
+
+  std::thread leader([&] {
+    EXPECT_TRUE(group_sync.Sync([&] {
+      ++calls;
+      leader_started.Notify();
+      release_leader.WaitForNotification();
+      return true;
+    }));
+  });
+  leader_started.WaitForNotification();
+
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < kWaiters; ++i) {
+    waiters.emplace_back([&] {
+      ++queued;
+      EXPECT_TRUE(group_sync.Sync([&] {
+        ++calls;
+        return true;
+      }));
+    });
+  }
+  while (queued.load() < kWaiters) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  // Give the waiters time to block in Sync().
+  absl::SleepFor(absl::Milliseconds(50));
+  release_leader.Notify();
+
+  leader.join();
+  for (auto &waiter : waiters) {
+    waiter.join();
+  }
+  EXPECT_EQ(calls.load(), 2);
+  EXPECT_EQ(group_sync.BatchCount(), 2u);
+}
+
+TEST(GroupSyncTest, FailureReachesWholeBatch) {
+  constexpr int kWaiters = 4;
+  GroupSync group_sync;
+  absl::Notification leader_started;
+  absl::Notification release_leader;
+  std::atomic<int> queued(0);
+  std::atomic<int> failures(0);
+
+  std::thread leader([&] {
+    EXPECT_TRUE(group_sync.Sync([&] {
+      leader_started.Notify();
+      release_leader.WaitForNotification();
+      return true;
+    }));
+  });
+  leader_started.WaitForNotification();
+
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < kWaiters; ++i) {
+    waiters.emplace_back([&] {
+      ++queued;
+      errno = 0;
+      if (!group_sync.Sync([] {
+            errno = ENOSPC;
+            return false;
+          })) {
+        EXPECT_EQ(errno, ENOSPC);
+        ++failures;
+      }
+    });
+  }
+  while (queued.load() < kWaiters) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  absl::SleepFor(absl::Milliseconds(50));
+  release_leader.Notify();
+
+  leader.join();
+  for (auto &waiter : waiters) {
+    waiter.join();
+  }
+  EXPECT_EQ(failures.load(), kWaiters);
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
@@ -18,8 +18,11 @@
 
 #include <pthread.h>
 #include <stdio.h>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <thread>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -146,5 +149,132 @@ TEST_F(RwLockTest, MultipleReaders) {
   EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), 0);
 }
 
+TEST_F(RwLockTest, AttrKind) {
+  pthread_rwlockattr_t attr;
+  ASSERT_EQ(pthread_rwlockattr_init(&attr), 0);
+
+  int kind = -1;
+  EXPECT_EQ(pthread_rwlockattr_getkind_np(&attr, &kind), 0);
+  EXPECT_EQ(kind, PTHREAD_RWLOCK_DEFAULT_NP);
+
+  EXPECT_EQ(
+      pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NP), 0);
+  EXPECT_EQ(pthread_rwlockattr_getkind_np(&attr, &kind), 0);
+  EXPECT_EQ(kind, PTHREAD_RWLOCK_PREFER_WRITER_NP);
+
+  EXPECT_EQ(pthread_rwlockattr_setkind_np(&attr, -1), EINVAL);
+  EXPECT_EQ(pthread_rwlockattr_destroy(&attr), 0);
+}
+
+// Takes and releases |rwlock| for reading enough times for it to be treated as
+// read-mostly, so that later readers use the fast path.
+void WarmUpReaders(pthread_rwlock_t *rwlock) {
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(pthread_rwlock_rdlock(rwlock), 0);
+    ASSERT_EQ(pthread_rwlock_unlock(rwlock), 0);
+  }
+}
+
+TEST_F(RwLockTest, FastPathReadersExcludeWriters) {
+  WarmUpReaders(&rwlock_);
+
+  // Recursive read locks are released one at a time.
+  ASSERT_EQ(pthread_rwlock_rdlock(&rwlock_), 0);
+  ASSERT_EQ(pthread_rwlock_rdlock(&rwlock_), 0);
+  std::thread([this]() {
+    EXPECT_EQ(pthread_rwlock_trywrlock(&rwlock_), EBUSY);
+  }).join();
+  ASSERT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+  std::thread([this]() {
+    EXPECT_EQ(pthread_rwlock_trywrlock(&rwlock_), EBUSY);
+  }).join();
+  ASSERT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+
+  // A writer waits for a reader that holds the lock through the fast path.
+  ASSERT_EQ(pthread_rwlock_rdlock(&rwlock_), 0);
+  std::atomic<bool> written(false);
+  std::thread writer([this, &written]() {
+    EXPECT_EQ(pthread_rwlock_wrlock(&rwlock_), 0);
+    written = true;
+    EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(written);
+  ASSERT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+  writer.join();
+  EXPECT_TRUE(written);
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), EPERM);
+}
+
+// Checks that once a writer starts waiting for readers that hold a warmed up
+// lock of the given |kind| through the fast path, new readers wait too.
+void CheckWriterIsNotStarved(int kind) {
+  pthread_rwlockattr_t attr;
+  ASSERT_EQ(pthread_rwlockattr_init(&attr), 0);
+  ASSERT_EQ(pthread_rwlockattr_setkind_np(&attr, kind), 0);
+  pthread_rwlock_t rwlock;
+  ASSERT_EQ(pthread_rwlock_init(&rwlock, &attr), 0);
+  ASSERT_EQ(pthread_rwlockattr_destroy(&attr), 0);
+  WarmUpReaders(&rwlock);
+
+  ASSERT_EQ(pthread_rwlock_rdlock(&rwlock), 0);
+  std::thread writer([&rwlock]() {
+    EXPECT_EQ(pthread_rwlock_wrlock(&rwlock), 0);
+    EXPECT_EQ(pthread_rwlock_unlock(&rwlock), 0);
+  });
+  while (*static_cast<volatile pthread_t *>(&rwlock._write_owner) ==
+         PTHREAD_T_NULL) {
+    std::this_thread::yield();
+  }
+
+  std::thread([&rwlock]() {
+    EXPECT_EQ(pthread_rwlock_tryrdlock(&rwlock), EBUSY);
+  }).join();
+
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock), 0);
+  writer.join();
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock), 0);
+}
+
+TEST_F(RwLockTest, WriterIsNotStarvedByFastPathReaders) {
+  CheckWriterIsNotStarved(PTHREAD_RWLOCK_PREFER_READER_NP);
+  CheckWriterIsNotStarved(PTHREAD_RWLOCK_PREFER_WRITER_NP);
+}
+
+// Reports the cost of an uncontended-by-writers read lock and unlock as the
+// number of reading threads grows. With the fast path the cost should stay
+// roughly flat instead of growing with the number of threads sharing the lock.
+TEST_F(RwLockTest, ReaderScaling) {
+  constexpr int kIterations = 100000;
+  WarmUpReaders(&rwlock_);
+
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    absl::Barrier start_barrier(threads + 1);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < threads; ++i) {
+      readers.emplace_back([this, &start_barrier]() {
+        start_barrier.Block();
+        for (int j = 0; j < kIterations; ++j) {
+          EXPECT_EQ(pthread_rwlock_rdlock(&rwlock_), 0);
+          EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+        }
+      });
+    }
+    auto start = std::chrono::steady_clock::now();
+    start_barrier.Block();
+    for (auto &reader : readers) {
+      reader.join();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    LOG(INFO) << threads << " readers: "
+              << elapsed.count() / static_cast<double>(kIterations)
+              << " ns per read lock and unlock";
+  }
+
+  EXPECT_EQ(pthread_rwlock_trywrlock(&rwlock_), 0);
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+}
+
 }  // namespace
 }  // namespace asylo
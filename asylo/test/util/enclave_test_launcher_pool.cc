@@ -0,0 +1,181 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/test/util/enclave_test_launcher_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+
+EnclaveTestLauncherPool::EnclaveTestLauncherPool(LoaderFactory loader_factory,
+                                                 int pool_size)
+    : loader_factory_(std::move(loader_factory)),
+      pool_size_(pool_size),
+      manager_(nullptr),
+      setup_ns_(0) {}
+
+EnclaveTestLauncherPool::~EnclaveTestLauncherPool() {
+  Status status = TearDown(EnclaveFinal(), /*skip_finalize=*/true);
+  LOG_IF(ERROR, !status.ok()) << "TearDown failed: " << status;
+}
+
+Status EnclaveTestLauncherPool::SetUp(const EnclaveConfig &econfig,
+                                      const std::string &enclave_url_prefix) {
+  if (pool_size_ <= 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Invalid pool size: ", pool_size_));
+  }
+  if (!clients_.empty()) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Enclave pool is already set up");
+  }
+
+  EnclaveManager::Configure(EnclaveManagerOptions());
+  ASYLO_ASSIGN_OR_RETURN(manager_, EnclaveManager::Instance());
+
+  // Create all loaders up front so that loader factory errors are reported
+  // before any enclave is loaded.
+  loaders_.clear();
+  for (int i = 0; i < pool_size_; ++i) {
+    std::unique_ptr<EnclaveLoader> loader;
+    ASYLO_ASSIGN_OR_RETURN(loader, loader_factory_());
+    loaders_.push_back(std::move(loader));
+  }
+
+  // Enclave load and initialization dominate test setup, so load the whole
+  // pool concurrently.
+  absl::Time start = absl::Now();
+  std::vector<Status> load_status(pool_size_);
+  std::vector<std::thread> threads;
+  threads.reserve(pool_size_);
+  for (int i = 0; i < pool_size_; ++i) {
+    threads.emplace_back([this, i, &econfig, &enclave_url_prefix,
+                          &load_status] {
+      load_status[i] =
+          manager_->LoadEnclave(absl::StrCat(enclave_url_prefix, "/", i),
+                                *loaders_[i], econfig);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  setup_ns_ = absl::ToInt64Nanoseconds(absl::Now() - start);
+
+  Status status = Status::OkStatus();
+  clients_.assign(pool_size_, nullptr);
+  for (int i = 0; i < pool_size_; ++i) {
+    if (!load_status[i].ok()) {
+      LOG(ERROR) << "SetUp failed for enclave " << i << ": " << load_status[i];
+      if (status.ok()) {
+        status = load_status[i];
+      }
+      continue;
+    }
+    clients_[i] =
+        manager_->GetClient(absl::StrCat(enclave_url_prefix, "/", i));
+    if (!clients_[i] && status.ok()) {
+      status = Status(error::PosixError::P_ENOENT, "Client is null");
+    }
+  }
+
+  if (!status.ok()) {
+    TearDown(EnclaveFinal(), /*skip_finalize=*/true);
+  }
+  return status;
+}
+
+StatusOr<EnclaveTestPoolReport> EnclaveTestLauncherPool::RunShards(
+    const std::vector<EnclaveInput> &shards) {
+  if (clients_.empty()) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "No EnclaveClient available");
+  }
+
+  EnclaveTestPoolReport report;
+  report.set_pool_size(pool_size_);
+  report.set_setup_ns(setup_ns_);
+  for (int i = 0; i < shards.size(); ++i) {
+    report.add_shard()->set_shard_index(i);
+  }
+
+  // Each worker owns one pooled enclave and pulls shards from a shared FIFO
+  // until it is drained. Workers write disjoint elements of |report|, which is
+  // fully populated before they start.
+  std::atomic<int> next_shard(0);
+  absl::Time start = absl::Now();
+  std::vector<std::thread> workers;
+  workers.reserve(pool_size_);
+  for (int enclave_index = 0; enclave_index < pool_size_; ++enclave_index) {
+    workers.emplace_back([this, enclave_index, &shards, &next_shard,
+                          &report] {
+      EnclaveClient *client = clients_[enclave_index];
+      int shard_index;
+      while ((shard_index = next_shard.fetch_add(1)) < shards.size()) {
+        EnclaveTestShardResult *result = report.mutable_shard(shard_index);
+        result->set_enclave_index(enclave_index);
+        absl::Time shard_start = absl::Now();
+        Status status =
+            client->EnterAndRun(shards[shard_index], result->mutable_output());
+        result->set_elapsed_ns(
+            absl::ToInt64Nanoseconds(absl::Now() - shard_start));
+        status.SaveTo(result->mutable_status());
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  report.set_run_ns(absl::ToInt64Nanoseconds(absl::Now() - start));
+  return report;
+}
+
+Status EnclaveTestLauncherPool::TearDown(const EnclaveFinal &efinal,
+                                         bool skip_finalize) {
+  Status status = Status::OkStatus();
+  for (EnclaveClient *client : clients_) {
+    if (!client) {
+      continue;
+    }
+    Status destroy_status =
+        manager_->DestroyEnclave(client, efinal, skip_finalize);
+    if (!destroy_status.ok() && status.ok()) {
+      status = destroy_status;
+    }
+  }
+  clients_.clear();
+  loaders_.clear();
+  return status;
+}
+
+EnclaveClient *EnclaveTestLauncherPool::mutable_client(int index) {
+  if (index < 0 || index >= clients_.size()) {
+    return nullptr;
+  }
+  return clients_[index];
+}
+
+}  // namespace asylo
@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_TEST_UTIL_ENCLAVE_TEST_LAUNCHER_POOL_H_
+#define ASYLO_TEST_UTIL_ENCLAVE_TEST_LAUNCHER_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "asylo/client.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/enclave_manager.h"
+#include "asylo/test/util/enclave_test_pool.pb.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// Handle setup and teardown of a pool of identical test enclaves, and run test
+// shards concurrently across them.
+//
+// Unlike EnclaveTestLauncher, which loads one enclave per test binary, a pool
+// loads |pool_size| enclaves once and reuses them for every shard passed to
+// RunShards(). Each pooled enclave runs at most one shard at a time, so
+// enclaves that are not thread-safe (such as the gtest shim enclave) may be
+// pooled safely.
+class EnclaveTestLauncherPool {
+ public:
+  // Returns a loader for a single pooled enclave. The factory is invoked once
+  // per pooled enclave, which allows single-use loaders such as
+  // FakeEnclaveLoader to be pooled.
+  using LoaderFactory =
+      std::function<StatusOr<std::unique_ptr<EnclaveLoader>>()>;
+
+  EnclaveTestLauncherPool(LoaderFactory loader_factory, int pool_size);
+
+  ~EnclaveTestLauncherPool();
+
+  // Loads and initializes |pool_size| enclaves concurrently with |econfig|.
+  // Enclave i is registered under the name |enclave_url_prefix|/i. Any
+  // enclaves loaded before a failure are destroyed.
+  Status SetUp(const EnclaveConfig &econfig,
+               const std::string &enclave_url_prefix);
+
+  // Runs each input in |shards| through EnterAndRun on one of the pooled
+  // enclaves and collects the results. Shards are dispatched from a shared
+  // FIFO, so a slow shard does not hold up the others. Returns
+  // FAILED_PRECONDITION if SetUp() has not been invoked successfully. The
+  // statuses of the individual shards are reported in the returned report
+  // rather than through the return value.
+  StatusOr<EnclaveTestPoolReport> RunShards(
+      const std::vector<EnclaveInput> &shards);
+
+  // Runs EnterAndFinalize with |efinal| on every pooled enclave unless
+  // |skip_finalize| is true, and then destroys the enclaves. Returns the first
+  // non-OK status encountered, after attempting to destroy every enclave.
+  Status TearDown(const EnclaveFinal &efinal, bool skip_finalize = false);
+
+  // Returns the number of enclaves in the pool.
+  int size() const { return pool_size_; }
+
+  // Mutable access to the |index|th loaded client, or nullptr if it has not
+  // been loaded.
+  EnclaveClient *mutable_client(int index);
+
+ private:
+  const LoaderFactory loader_factory_;
+  const int pool_size_;
+  EnclaveManager *manager_;
+  std::vector<EnclaveClient *> clients_;
+  std::vector<std::unique_ptr<EnclaveLoader>> loaders_;
+  int64_t setup_ns_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_TEST_UTIL_ENCLAVE_TEST_LAUNCHER_POOL_H_
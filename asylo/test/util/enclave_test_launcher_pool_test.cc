@@ -0,0 +1,154 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/test/util/enclave_test_launcher_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/test/util/enclave_test_launcher.h"
+#include "asylo/test/util/fake_enclave_loader.h"
+#include "asylo/test/util/mock_enclave_client.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_string.pb.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+constexpr int kPoolSize = 4;
+constexpr int kNumShards = 32;
+
+// Creates mock clients that echo the input test string, and fail any shard
+// whose test string is "fail". Each client checks that it never runs two
+// shards at once.
+class EnclaveTestLauncherPoolTest : public ::testing::Test {
+ protected:
+  EnclaveTestLauncherPool::LoaderFactory MakeLoaderFactory() {
+    return [this]() -> StatusOr<std::unique_ptr<EnclaveLoader>> {
+      ++loads_;
+      auto client = absl::make_unique<NiceMock<MockEnclaveClient>>();
+      auto busy = std::make_shared<std::atomic<bool>>(false);
+      ON_CALL(*client, EnterAndRun(_, _))
+          .WillByDefault(Invoke([busy](const EnclaveInput &input,
+                                       EnclaveOutput *output) {
+            EXPECT_FALSE(busy->exchange(true));
+            const std::string &str =
+                input.GetExtension(enclave_input_test_string).test_string();
+            output->MutableExtension(enclave_output_test_string)
+                ->set_test_string(str);
+            busy->store(false);
+            if (str == "fail") {
+              return Status(error::GoogleError::INTERNAL, "Shard failed");
+            }
+            return Status::OkStatus();
+          }));
+      return std::unique_ptr<EnclaveLoader>(
+          absl::make_unique<FakeEnclaveLoader>(std::move(client)));
+    };
+  }
+
+  std::vector<EnclaveInput> MakeShards(int count) {
+    std::vector<EnclaveInput> shards(count);
+    for (int i = 0; i < count; ++i) {
+      EnclaveTestLauncher::SetEnclaveInputTestString(&shards[i],
+                                                     absl::StrCat("shard", i));
+    }
+    return shards;
+  }
+
+  std::atomic<int> loads_{0};
+};
+
+TEST_F(EnclaveTestLauncherPoolTest, RunsEveryShardOnPooledEnclaves) {
+  EnclaveTestLauncherPool pool(MakeLoaderFactory(), kPoolSize);
+  ASYLO_ASSERT_OK(pool.SetUp(EnclaveConfig(), "/pool_run_test"));
+  EXPECT_EQ(loads_, kPoolSize);
+  for (int i = 0; i < kPoolSize; ++i) {
+    EXPECT_NE(pool.mutable_client(i), nullptr);
+  }
+
+  auto report_result = pool.RunShards(MakeShards(kNumShards));
+  ASYLO_ASSERT_OK(report_result);
+  const EnclaveTestPoolReport &report = report_result.ValueOrDie();
+
+  // Enclaves are reused across shards rather than reloaded.
+  EXPECT_EQ(loads_, kPoolSize);
+  EXPECT_EQ(report.pool_size(), kPoolSize);
+  ASSERT_EQ(report.shard_size(), kNumShards);
+  for (int i = 0; i < kNumShards; ++i) {
+    const EnclaveTestShardResult &result = report.shard(i);
+    EXPECT_EQ(result.shard_index(), i);
+    EXPECT_GE(result.enclave_index(), 0);
+    EXPECT_LT(result.enclave_index(), kPoolSize);
+    EXPECT_EQ(result.status().code(), 0);
+    EXPECT_EQ(EnclaveTestLauncher::GetEnclaveOutputTestString(result.output()),
+              absl::StrCat("shard", i));
+  }
+
+  ASYLO_EXPECT_OK(pool.TearDown(EnclaveFinal()));
+  EXPECT_EQ(pool.mutable_client(0), nullptr);
+}
+
+TEST_F(EnclaveTestLauncherPoolTest, ReportsShardFailures) {
+  EnclaveTestLauncherPool pool(MakeLoaderFactory(), kPoolSize);
+  ASYLO_ASSERT_OK(pool.SetUp(EnclaveConfig(), "/pool_failure_test"));
+
+  std::vector<EnclaveInput> shards = MakeShards(kNumShards);
+  EnclaveTestLauncher::SetEnclaveInputTestString(&shards[3], "fail");
+
+  auto report_result = pool.RunShards(shards);
+  ASYLO_ASSERT_OK(report_result);
+  const EnclaveTestPoolReport &report = report_result.ValueOrDie();
+  ASSERT_EQ(report.shard_size(), kNumShards);
+  for (int i = 0; i < kNumShards; ++i) {
+    Status status;
+    status.RestoreFrom(report.shard(i).status());
+    if (i == 3) {
+      EXPECT_THAT(status, StatusIs(error::GoogleError::INTERNAL));
+    } else {
+      ASYLO_EXPECT_OK(status);
+    }
+  }
+  ASYLO_EXPECT_OK(pool.TearDown(EnclaveFinal()));
+}
+
+TEST_F(EnclaveTestLauncherPoolTest, RunShardsRequiresSetUp) {
+  EnclaveTestLauncherPool pool(MakeLoaderFactory(), kPoolSize);
+  EXPECT_THAT(pool.RunShards(MakeShards(1)).status(),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+  EXPECT_EQ(loads_, 0);
+}
+
+TEST_F(EnclaveTestLauncherPoolTest, InvalidPoolSize) {
+  EnclaveTestLauncherPool pool(MakeLoaderFactory(), 0);
+  EXPECT_THAT(pool.SetUp(EnclaveConfig(), "/pool_invalid_test"),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace asylo
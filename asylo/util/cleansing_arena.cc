@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/cleansing_arena.h"
+
+#include <openssl/mem.h>
+
+#include <algorithm>
+
+namespace asylo {
+
+constexpr size_t CleansingArena::kDefaultRegionSize;
+
+CleansingArena::CleansingArena(size_t region_size)
+    : owned_region_(new uint8_t[region_size]),
+      region_{owned_region_.get(), region_size, 0, 0},
+      high_water_mark_(0) {}
+
+CleansingArena::CleansingArena(absl::Span<uint8_t> region)
+    : region_{region.data(), region.size(), 0, 0}, high_water_mark_(0) {}
+
+CleansingArena::~CleansingArena() { Reset(); }
+
+void *CleansingArena::Allocate(size_t size, size_t alignment) {
+  void *ptr = AllocateFromBlock(CurrentBlock(), size, alignment);
+  if (!ptr) {
+    // Memory from new[] is suitably aligned for any fundamental type, so an
+    // overflow block of |size| bytes always fits the allocation.
+    size_t block_size = std::max(size, kDefaultRegionSize);
+    overflow_.push_back(Block{new uint8_t[block_size], block_size, 0, 0});
+    ptr = AllocateFromBlock(&overflow_.back(), size, alignment);
+  }
+  high_water_mark_ = std::max(high_water_mark_, BytesUsed());
+  return ptr;
+}
+
+void CleansingArena::Deallocate(void *ptr, size_t size) {
+  Block *block = CurrentBlock();
+  uint8_t *bytes = static_cast<uint8_t *>(ptr);
+  if (bytes + size == block->data + block->used) {
+    block->used = bytes - block->data;
+  }
+}
+
+void CleansingArena::Reset() {
+  OPENSSL_cleanse(region_.data, region_.dirty);
+  region_.used = 0;
+  region_.dirty = 0;
+  for (Block &block : overflow_) {
+    OPENSSL_cleanse(block.data, block.dirty);
+    delete[] block.data;
+  }
+  overflow_.clear();
+}
+
+size_t CleansingArena::BytesUsed() const {
+  size_t bytes_used = region_.dirty;
+  for (const Block &block : overflow_) {
+    bytes_used += block.dirty;
+  }
+  return bytes_used;
+}
+
+size_t CleansingArena::HighWaterMark() const { return high_water_mark_; }
+
+void *CleansingArena::AllocateFromBlock(Block *block, size_t size,
+                                        size_t alignment) {
+  uintptr_t start = reinterpret_cast<uintptr_t>(block->data) + block->used;
+  size_t padding = (alignment - start % alignment) % alignment;
+  if (padding > block->size - block->used ||
+      size > block->size - block->used - padding) {
+    return nullptr;
+  }
+  void *ptr = block->data + block->used + padding;
+  block->used += padding + size;
+  block->dirty = std::max(block->dirty, block->used);
+  return ptr;
+}
+
+CleansingArena::Block *CleansingArena::CurrentBlock() {
+  return overflow_.empty() ? &region_ : &overflow_.back();
+}
+
+}  // namespace asylo
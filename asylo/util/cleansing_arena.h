@@ -0,0 +1,159 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_CLEANSING_ARENA_H_
+#define ASYLO_UTIL_CLEANSING_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+
+/// A bump allocator for secrets that live for the duration of a single
+/// operation, such as one handshake or one seal.
+///
+/// Allocations are carved out of a region that the arena holds for its whole
+/// lifetime, so an operation whose secrets fit in the region does not touch
+/// the heap at all. Individual deallocations do not cleanse memory. Instead,
+/// Reset() and the destructor cleanse every byte handed out since the previous
+/// reset in one pass. Allocations that do not fit in the region are served
+/// from overflow blocks, which are cleansed and freed by Reset().
+///
+/// A CleansingArena is not thread-safe.
+class CleansingArena {
+ public:
+  /// The size of the region of an arena that is constructed without one.
+  static constexpr size_t kDefaultRegionSize = 1024;
+
+  /// Constructs an arena that owns a heap region of `region_size` bytes.
+  explicit CleansingArena(size_t region_size = kDefaultRegionSize);
+
+  /// Constructs an arena that allocates from `region`, which must outlive the
+  /// arena. This allows the region to live on the stack of the operation.
+  explicit CleansingArena(absl::Span<uint8_t> region);
+
+  CleansingArena(const CleansingArena &other) = delete;
+  CleansingArena &operator=(const CleansingArena &other) = delete;
+
+  /// Cleanses all memory handed out by the arena.
+  ~CleansingArena();
+
+  /// Returns `size` bytes aligned to `alignment`, which must be a power of two
+  /// no larger than `alignof(std::max_align_t)`.
+  void *Allocate(size_t size, size_t alignment);
+
+  /// Returns `size` bytes at `ptr` to the arena. The space is reused only if it
+  /// is the most recent allocation. The bytes are not cleansed until the next
+  /// Reset().
+  void Deallocate(void *ptr, size_t size);
+
+  /// Cleanses every byte handed out since the last reset and frees all
+  /// overflow blocks. Memory previously allocated from the arena must not be
+  /// used afterwards.
+  void Reset();
+
+  /// Returns the number of bytes handed out since the last reset, including
+  /// alignment padding and deallocated space that was not reused.
+  size_t BytesUsed() const;
+
+  /// Returns the largest value of BytesUsed() observed before any reset. This
+  /// is useful for sizing the region of an arena.
+  size_t HighWaterMark() const;
+
+ private:
+  // A contiguous range of memory that allocations are bumped out of.
+  struct Block {
+    uint8_t *data;
+    size_t size;
+
+    // Offset of the first free byte.
+    size_t used;
+
+    // Largest value of |used| since the last reset. Bytes below this offset
+    // may hold secrets even after a deallocation rolls back |used|.
+    size_t dirty;
+  };
+
+  // Returns |size| bytes aligned to |alignment| from |block|, or nullptr if
+  // they do not fit.
+  static void *AllocateFromBlock(Block *block, size_t size, size_t alignment);
+
+  // Returns the block that allocations are currently bumped out of.
+  Block *CurrentBlock();
+
+  std::unique_ptr<uint8_t[]> owned_region_;
+  Block region_;
+  std::vector<Block> overflow_;
+  size_t high_water_mark_;
+};
+
+/// A C++ allocator that allocates from a CleansingArena. It can be used with
+/// CleansingVector and other standard containers to hold secrets for the
+/// lifetime of the arena's current operation. Containers using the allocator
+/// must not outlive the arena or be used after the arena is reset.
+template <typename T>
+class CleansingArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit CleansingArenaAllocator(CleansingArena *arena) : arena_(arena) {}
+  template <typename U>
+  CleansingArenaAllocator(const CleansingArenaAllocator<U> &other)
+      : arena_(other.arena()) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *ptr, size_t n) { arena_->Deallocate(ptr, n * sizeof(T)); }
+
+  size_t max_size() const {
+    return std::numeric_limits<size_t>::max() / sizeof(T);
+  }
+
+  CleansingArena *arena() const { return arena_; }
+
+ private:
+  CleansingArena *arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const CleansingArenaAllocator<T> &lhs,
+                const CleansingArenaAllocator<U> &rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const CleansingArenaAllocator<T> &lhs,
+                const CleansingArenaAllocator<U> &rhs) {
+  return !(lhs == rhs);
+}
+
+/// A vector container whose memory is allocated from a CleansingArena.
+template <typename T>
+using CleansingArenaVector = CleansingVector<T, CleansingArenaAllocator<T>>;
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_CLEANSING_ARENA_H_
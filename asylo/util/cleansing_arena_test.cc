@@ -0,0 +1,148 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/cleansing_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/types/span.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Each;
+using ::testing::Eq;
+
+constexpr size_t kRegionSize = 256;
+
+// Returns true if |ptr| points into |region|.
+bool IsInRegion(const void *ptr, absl::Span<const uint8_t> region) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(ptr);
+  return bytes >= region.data() && bytes < region.data() + region.size();
+}
+
+TEST(CleansingArenaTest, AllocationsAreAlignedAndDisjoint) {
+  CleansingArena arena(kRegionSize);
+  uint8_t *byte = static_cast<uint8_t *>(arena.Allocate(1, 1));
+  uint64_t *word = static_cast<uint64_t *>(arena.Allocate(sizeof(uint64_t), 8));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(word) % 8, 0u);
+  EXPECT_GE(reinterpret_cast<uint8_t *>(word), byte + 1);
+  EXPECT_GE(arena.BytesUsed(), 1 + sizeof(uint64_t));
+}
+
+TEST(CleansingArenaTest, VectorAllocatesFromRegion) {
+  uint8_t region[kRegionSize];
+  CleansingArena arena(absl::MakeSpan(region));
+  CleansingArenaVector<uint8_t> secret{
+      CleansingArenaAllocator<uint8_t>(&arena)};
+  secret.resize(32, 0xAB);
+  EXPECT_TRUE(IsInRegion(secret.data(), region));
+}
+
+TEST(CleansingArenaTest, ResetCleansesAllocatedBytes) {
+  uint8_t region[kRegionSize];
+  std::fill(region, region + kRegionSize, 0);
+  CleansingArena arena(absl::MakeSpan(region));
+  {
+    CleansingArenaVector<uint8_t> secret{
+        CleansingArenaAllocator<uint8_t>(&arena)};
+    // Growing the vector leaves copies of the secret in deallocated space.
+    for (int i = 0; i < 64; ++i) {
+      secret.push_back(0xAB);
+    }
+  }
+  EXPECT_GT(arena.BytesUsed(), 64u);
+  EXPECT_TRUE(std::any_of(region, region + kRegionSize,
+                          [](uint8_t byte) { return byte != 0; }));
+
+  arena.Reset();
+  EXPECT_EQ(arena.BytesUsed(), 0u);
+  EXPECT_THAT(region, Each(Eq(0)));
+}
+
+TEST(CleansingArenaTest, DestructorCleansesAllocatedBytes) {
+  uint8_t region[kRegionSize];
+  {
+    CleansingArena arena(absl::MakeSpan(region));
+    CleansingArenaVector<uint8_t> secret{
+        CleansingArenaAllocator<uint8_t>(&arena)};
+    secret.assign(kRegionSize / 2, 0xAB);
+  }
+  EXPECT_THAT(absl::MakeSpan(region, kRegionSize / 2), Each(Eq(0)));
+}
+
+TEST(CleansingArenaTest, LastAllocationIsReused) {
+  CleansingArena arena(kRegionSize);
+  void *first = arena.Allocate(16, 1);
+  arena.Deallocate(first, 16);
+  EXPECT_EQ(arena.Allocate(16, 1), first);
+
+  // Deallocating an allocation that is not the most recent one does not make
+  // its space available.
+  void *second = arena.Allocate(16, 1);
+  arena.Deallocate(first, 16);
+  EXPECT_NE(arena.Allocate(16, 1), first);
+  EXPECT_NE(second, first);
+}
+
+TEST(CleansingArenaTest, LargeAllocationsOverflowTheRegion) {
+  uint8_t region[kRegionSize];
+  CleansingArena arena(absl::MakeSpan(region));
+  CleansingArenaVector<uint8_t> secret{
+      CleansingArenaAllocator<uint8_t>(&arena)};
+  secret.assign(4 * kRegionSize, 0xAB);
+  EXPECT_FALSE(IsInRegion(secret.data(), region));
+  EXPECT_GE(arena.HighWaterMark(), 4 * kRegionSize);
+
+  secret.clear();
+  secret.shrink_to_fit();
+  arena.Reset();
+  EXPECT_EQ(arena.BytesUsed(), 0u);
+  EXPECT_GE(arena.HighWaterMark(), 4 * kRegionSize);
+
+  // The region is reused after a reset.
+  secret.resize(16);
+  EXPECT_TRUE(IsInRegion(secret.data(), region));
+}
+
+TEST(CleansingArenaTest, AllocatorsCompareEqualForTheSameArena) {
+  CleansingArena arena1;
+  CleansingArena arena2;
+  CleansingArenaAllocator<uint8_t> allocator1(&arena1);
+  CleansingArenaAllocator<uint64_t> rebound(allocator1);
+  CleansingArenaAllocator<uint8_t> allocator2(&arena2);
+  EXPECT_TRUE(allocator1 == rebound);
+  EXPECT_TRUE(allocator1 != allocator2);
+}
+
+TEST(CleansingArenaTest, StringUsesArena) {
+  uint8_t region[kRegionSize];
+  CleansingArena arena(absl::MakeSpan(region));
+  CleansingArenaAllocator<char> allocator(&arena);
+  std::basic_string<char, std::char_traits<char>, CleansingArenaAllocator<char>>
+      secret(allocator);
+  secret.assign(100, 'x');
+  EXPECT_TRUE(IsInRegion(secret.data(), region));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -30,9 +30,11 @@ namespace asylo {
 using CleansingString =
     std::basic_string<char, std::char_traits<char>, CleansingAllocator<char>>;
 
-/// A vector container that zeros its memory on free.
-template <typename T>
-using CleansingVector = std::vector<T, CleansingAllocator<T>>;
+/// A vector container that zeros its memory on free. The allocator may be
+/// replaced by another allocator that cleanses memory, such as
+/// CleansingArenaAllocator.
+template <typename T, typename A = CleansingAllocator<T>>
+using CleansingVector = std::vector<T, A>;
 
 }  // namespace asylo
 
@@ -18,6 +18,8 @@
 
 #include "asylo/util/mutex_guarded.h"
 
+#include <cstdint>
+#include <iostream>
 #include <memory>
 #include <thread>
 #include <utility>
@@ -25,10 +27,14 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/synchronization/barrier.h"
 #include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "asylo/util/read_mostly_guarded.h"
+#include "asylo/util/striped_guarded.h"
 
 namespace asylo {
 namespace {
@@ -495,5 +501,90 @@ TEST(MutexGuardedTest, LockingStressTest) {
               Eq(kNumThreads * kNumIncrementsPerThread));
 }
 
+// Runs |num_threads| threads that each call |operation| |kNumOperations|
+// times, and prints the aggregate throughput under |name|.
+template <typename Operation>
+void RunContentionBenchmark(const char *name, int num_threads,
+                            Operation operation) {
+  constexpr int kNumOperations = 100000;
+
+  absl::Barrier barrier(num_threads + 1);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([i, &barrier, &operation] {
+      barrier.Block();
+      for (int j = 0; j < kNumOperations; ++j) {
+        operation(i, j);
+      }
+    });
+  }
+
+  absl::Time start = absl::Now();
+  barrier.Block();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  absl::Duration elapsed = absl::Now() - start;
+
+  std::cout << name << " threads=" << num_threads << ": "
+            << static_cast<int64_t>(num_threads * kNumOperations /
+                                    absl::ToDoubleSeconds(elapsed))
+            << " ops/s" << std::endl;
+}
+
+// Compares the read throughput of MutexGuarded, ReadMostlyGuarded and
+// StripedGuarded on a small lookup table under increasing reader contention,
+// with a writer updating the table once every 1000 operations.
+TEST(MutexGuardedTest, ContentionBenchmark) {
+  constexpr int kTableSize = 64;
+  constexpr int kWriteInterval = 1000;
+
+  absl::flat_hash_map<int, int> initial_table;
+  for (int i = 0; i < kTableSize; ++i) {
+    initial_table.emplace(i, i);
+  }
+
+  for (int num_threads : {1, 2, 4, 8, 16}) {
+    MutexGuarded<absl::flat_hash_map<int, int>> mutex_table(initial_table);
+    RunContentionBenchmark(
+        "MutexGuarded", num_threads, [&mutex_table](int thread, int op) {
+          int key = (thread + op) % kTableSize;
+          if (op % kWriteInterval == 0) {
+            (*mutex_table.Lock())[key] = op;
+          } else {
+            ASSERT_THAT(mutex_table.ReaderLock()->count(key), Eq(1));
+          }
+        });
+
+    ReadMostlyGuarded<absl::flat_hash_map<int, int>> read_mostly_table(
+        initial_table);
+    RunContentionBenchmark(
+        "ReadMostlyGuarded", num_threads,
+        [&read_mostly_table](int thread, int op) {
+          int key = (thread + op) % kTableSize;
+          if (op % kWriteInterval == 0) {
+            (*read_mostly_table.Lock())[key] = op;
+          } else {
+            ASSERT_THAT(read_mostly_table.ReaderLock()->count(key), Eq(1));
+          }
+        });
+
+    StripedGuarded<absl::flat_hash_map<int, int>> striped_table;
+    for (int i = 0; i < kTableSize; ++i) {
+      striped_table.Lock(i)->emplace(i, i);
+    }
+    RunContentionBenchmark(
+        "StripedGuarded", num_threads, [&striped_table](int thread, int op) {
+          int key = (thread + op) % kTableSize;
+          if (op % kWriteInterval == 0) {
+            (*striped_table.Lock(key))[key] = op;
+          } else {
+            ASSERT_THAT(striped_table.ReaderLock(key)->count(key), Eq(1));
+          }
+        });
+  }
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,302 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_READ_MOSTLY_GUARDED_H_
+#define ASYLO_UTIL_READ_MOSTLY_GUARDED_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+
+template <typename T>
+class ReadMostlyGuarded;
+
+namespace internal {
+
+// A hazard pointer slot. A reader claims a slot by setting |in_use|, then
+// publishes the snapshot it is reading in |hazard| so that writers do not free
+// it. Each slot is padded to a full cache line so that readers using different
+// slots do not contend.
+struct HazardSlot {
+  std::atomic<bool> in_use{false};
+  std::atomic<const void *> hazard{nullptr};
+  char padding[ABSL_CACHELINE_SIZE - sizeof(std::atomic<bool>) -
+               sizeof(std::atomic<const void *>)];
+};
+
+}  // namespace internal
+
+// A read-only view of a snapshot of a ReadMostlyGuarded<T> object. The snapshot
+// remains valid and unchanged for the lifetime of the view, even if writers
+// publish new values in the meantime.
+template <typename T>
+class ReadMostlyReaderView {
+ public:
+  ReadMostlyReaderView() = delete;
+
+  ReadMostlyReaderView(const ReadMostlyReaderView &other) = delete;
+  ReadMostlyReaderView &operator=(const ReadMostlyReaderView &other) = delete;
+
+  ReadMostlyReaderView(ReadMostlyReaderView &&other)
+      : slot_(other.slot_), value_(other.value_) {
+    other.Clear();
+  }
+
+  ReadMostlyReaderView &operator=(ReadMostlyReaderView &&other) {
+    if (&other != this) {
+      Release();
+      slot_ = other.slot_;
+      value_ = other.value_;
+      other.Clear();
+    }
+    return *this;
+  }
+
+  ~ReadMostlyReaderView() { Release(); }
+
+  const T &operator*() const { return *value_; }
+
+  const T *operator->() const { return value_; }
+
+ private:
+  friend class ReadMostlyGuarded<T>;
+
+  ReadMostlyReaderView(internal::HazardSlot *slot, const T *value)
+      : slot_(slot), value_(value) {}
+
+  // Drops the protection on the snapshot and frees the hazard slot.
+  void Release() {
+    if (slot_ != nullptr) {
+      slot_->hazard.store(nullptr, std::memory_order_release);
+      slot_->in_use.store(false, std::memory_order_release);
+    }
+    Clear();
+  }
+
+  // Sets all internal pointers to nullptr.
+  void Clear() {
+    slot_ = nullptr;
+    value_ = nullptr;
+  }
+
+  internal::HazardSlot *slot_;
+  const T *value_;
+};
+
+// A writeable view of a private copy of a ReadMostlyGuarded<T> object. The
+// view holds the writer lock for its lifetime. When the view is destroyed, the
+// copy is published atomically, and readers that start afterwards observe it.
+template <typename T>
+class ReadMostlyLockView {
+ public:
+  ReadMostlyLockView() = delete;
+
+  ReadMostlyLockView(const ReadMostlyLockView &other) = delete;
+  ReadMostlyLockView &operator=(const ReadMostlyLockView &other) = delete;
+
+  ReadMostlyLockView(ReadMostlyLockView &&other)
+      : guarded_(other.guarded_), copy_(std::move(other.copy_)) {
+    other.guarded_ = nullptr;
+  }
+
+  ~ReadMostlyLockView() {
+    if (guarded_ != nullptr) {
+      guarded_->Publish(std::move(copy_));
+    }
+  }
+
+  T &operator*() { return *copy_; }
+
+  T *operator->() { return copy_.get(); }
+
+ private:
+  friend class ReadMostlyGuarded<T>;
+
+  ReadMostlyLockView(ReadMostlyGuarded<T> *guarded, std::unique_ptr<T> copy)
+      : guarded_(guarded), copy_(std::move(copy)) {}
+
+  ReadMostlyGuarded<T> *guarded_;
+  std::unique_ptr<T> copy_;
+};
+
+// ReadMostlyGuarded<T> protects an object of type T that is read far more
+// often than it is written. Readers never block and never write to shared
+// cache lines other than their own hazard slot, while writers copy the object,
+// modify the copy, and publish it atomically (copy-on-write).
+//
+// The ergonomics follow MutexGuarded<T>:
+//
+//     ReadMostlyGuarded<absl::flat_hash_map<int, Handler>> table(
+//         absl::flat_hash_map<int, Handler>());
+//
+//     // Writers get a mutable view of a private copy, which is published when
+//     // the view falls out of scope.
+//     table.Lock()->emplace(1, handler);
+//
+//     // Readers get a read-only view of the current snapshot.
+//     auto snapshot = table.ReaderLock();
+//     auto it = snapshot->find(1);
+//
+// Retired snapshots are reclaimed with hazard pointers: each reader publishes
+// the snapshot it is reading in one of kMaxConcurrentReaders slots, and a
+// writer frees a retired snapshot only once no slot refers to it. If more than
+// kMaxConcurrentReaders readers hold views at once, additional readers wait
+// for a slot to free up.
+//
+// As with MutexGuarded<T>, it is unsafe to save a reference or pointer to the
+// snapshot after its view has gone out of scope. Writes are expensive, since
+// each one copies the whole object, so ReadMostlyGuarded<T> is only a good fit
+// for objects that rarely change.
+template <typename T>
+class ReadMostlyGuarded {
+  static_assert(std::is_copy_constructible<T>::value,
+                "T must be a copy-constructible type");
+
+ public:
+  // Maximum number of reader views that may be held at the same time without
+  // waiting.
+  static constexpr int kMaxConcurrentReaders = 64;
+
+  ReadMostlyGuarded() = delete;
+
+  // Constructs a ReadMostlyGuarded<T> that initially holds |value|.
+  explicit ReadMostlyGuarded(T value)
+      : current_(new T(std::move(value))) {}
+
+  ReadMostlyGuarded(const ReadMostlyGuarded &other) = delete;
+  ReadMostlyGuarded &operator=(const ReadMostlyGuarded &other) = delete;
+
+  // Destroying a ReadMostlyGuarded<T> while there are views referencing it
+  // causes undefined behavior.
+  ~ReadMostlyGuarded() {
+    delete current_.load(std::memory_order_acquire);
+    for (const T *retired : retired_) {
+      delete retired;
+    }
+  }
+
+  // Returns a read-only view of the current value. Does not block unless
+  // kMaxConcurrentReaders views are already held.
+  ReadMostlyReaderView<T> ReaderLock() const {
+    internal::HazardSlot *slot = AcquireSlot();
+    const T *value = current_.load(std::memory_order_acquire);
+    while (true) {
+      slot->hazard.store(value, std::memory_order_seq_cst);
+      // Re-check that |value| was not retired before the hazard became
+      // visible. Once the check passes, writers that retire |value| later are
+      // guaranteed to observe the hazard.
+      const T *current = current_.load(std::memory_order_seq_cst);
+      if (current == value) {
+        break;
+      }
+      value = current;
+    }
+    return ReadMostlyReaderView<T>(slot, value);
+  }
+
+  // Returns a writeable view of a copy of the current value. The copy is
+  // published when the view is destroyed. Writers are serialized with respect
+  // to each other but do not block readers.
+  ReadMostlyLockView<T> Lock() {
+    writer_mu_.Lock();
+    return ReadMostlyLockView<T>(
+        this, absl::make_unique<T>(*current_.load(std::memory_order_acquire)));
+  }
+
+ private:
+  friend class ReadMostlyLockView<T>;
+
+  // Claims a free hazard slot. Readers on different threads start searching at
+  // different slots, derived from the address of their stack, so that they
+  // rarely contend on a slot.
+  internal::HazardSlot *AcquireSlot() const {
+    int stack_marker;
+    uint64_t start = (reinterpret_cast<uintptr_t>(&stack_marker) >> 12) *
+                     UINT64_C(0x9E3779B97F4A7C15);
+    start >>= 32;
+    while (true) {
+      for (int i = 0; i < kMaxConcurrentReaders; ++i) {
+        internal::HazardSlot &slot = slots_[(start + i) % kMaxConcurrentReaders];
+        if (!slot.in_use.load(std::memory_order_relaxed) &&
+            !slot.in_use.exchange(true, std::memory_order_acquire)) {
+          return &slot;
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // Publishes |value| as the current value, retires the previous value, and
+  // releases the writer lock.
+  void Publish(std::unique_ptr<T> value) {
+    const T *old_value =
+        current_.exchange(value.release(), std::memory_order_seq_cst);
+    retired_.push_back(old_value);
+    ReclaimRetired();
+    writer_mu_.Unlock();
+  }
+
+  // Frees every retired value that is not protected by a hazard slot.
+  void ReclaimRetired() {
+    std::array<const void *, kMaxConcurrentReaders> hazards;
+    for (int i = 0; i < kMaxConcurrentReaders; ++i) {
+      hazards[i] = slots_[i].hazard.load(std::memory_order_seq_cst);
+    }
+    std::vector<const T *> still_retired;
+    for (const T *retired : retired_) {
+      bool protected_by_reader = false;
+      for (const void *hazard : hazards) {
+        if (hazard == retired) {
+          protected_by_reader = true;
+          break;
+        }
+      }
+      if (protected_by_reader) {
+        still_retired.push_back(retired);
+      } else {
+        delete retired;
+      }
+    }
+    retired_.swap(still_retired);
+  }
+
+  mutable std::array<internal::HazardSlot, kMaxConcurrentReaders> slots_;
+  std::atomic<const T *> current_;
+  absl::Mutex writer_mu_;
+  // Values replaced by writers that may still be referenced by readers.
+  // Guarded by |writer_mu_|.
+  std::vector<const T *> retired_;
+};
+
+template <typename T>
+constexpr int ReadMostlyGuarded<T>::kMaxConcurrentReaders;
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_READ_MOSTLY_GUARDED_H_
@@ -0,0 +1,141 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/read_mostly_guarded.h"
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+
+constexpr int kNumThreads = 32;
+
+// A value whose copies all hold the same |generation| and whose |check| field
+// must always equal |generation|. A reader that observes a torn or freed value
+// is likely to see the two differ.
+struct Checked {
+  int generation;
+  int check;
+};
+
+TEST(ReadMostlyGuardedTest, ReadersObserveInitialValue) {
+  ReadMostlyGuarded<int> safe_int(42);
+  EXPECT_THAT(*safe_int.ReaderLock(), Eq(42));
+}
+
+TEST(ReadMostlyGuardedTest, WritesArePublishedWhenTheViewIsDestroyed) {
+  ReadMostlyGuarded<int> safe_int(0);
+  {
+    auto writeable_view = safe_int.Lock();
+    *writeable_view = 1;
+    // The write operates on a private copy until the view is destroyed.
+    EXPECT_THAT(*safe_int.ReaderLock(), Eq(0));
+  }
+  EXPECT_THAT(*safe_int.ReaderLock(), Eq(1));
+}
+
+TEST(ReadMostlyGuardedTest, SnapshotsAreStableAcrossWrites) {
+  ReadMostlyGuarded<std::vector<int>> safe_vector(std::vector<int>{1, 2, 3});
+  auto snapshot = safe_vector.ReaderLock();
+  safe_vector.Lock()->push_back(4);
+  EXPECT_THAT(snapshot->size(), Eq(3));
+  EXPECT_THAT(safe_vector.ReaderLock()->size(), Eq(4));
+}
+
+TEST(ReadMostlyGuardedTest, WritesFromAllThreadsAreVisibleFromLaterReads) {
+  ReadMostlyGuarded<int> safe_int(0);
+  std::vector<std::thread> threads;
+  threads.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&safe_int] { ++*safe_int.Lock(); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(*safe_int.ReaderLock(), Eq(kNumThreads));
+}
+
+TEST(ReadMostlyGuardedTest, ReaderViewsCanBeMoved) {
+  ReadMostlyGuarded<int> safe_int(7);
+  auto view1 = safe_int.ReaderLock();
+  auto view2 = std::move(view1);
+  EXPECT_THAT(*view2, Eq(7));
+  auto view3 = safe_int.ReaderLock();
+  view3 = std::move(view2);
+  EXPECT_THAT(*view3, Eq(7));
+}
+
+TEST(ReadMostlyGuardedTest, MoreReadersThanSlotsEventuallyProceed) {
+  constexpr int kNumReaders = ReadMostlyGuarded<int>::kMaxConcurrentReaders * 2;
+  ReadMostlyGuarded<int> safe_int(5);
+  std::vector<std::thread> threads;
+  threads.reserve(kNumReaders);
+  for (int i = 0; i < kNumReaders; ++i) {
+    threads.emplace_back([&safe_int] {
+      for (int j = 0; j < 100; ++j) {
+        EXPECT_THAT(*safe_int.ReaderLock(), Eq(5));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// Readers must never observe a value that has been freed or partially
+// written, even while writers continuously replace it.
+TEST(ReadMostlyGuardedTest, ConcurrentReadersNeverObserveReclaimedValues) {
+  ReadMostlyGuarded<Checked> safe_value(Checked{0, 0});
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> readers;
+  readers.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    readers.emplace_back([&safe_value, &done] {
+      int last_generation = 0;
+      while (!done.load()) {
+        auto snapshot = safe_value.ReaderLock();
+        ASSERT_THAT(snapshot->check, Eq(snapshot->generation));
+        ASSERT_GE(snapshot->generation, last_generation);
+        last_generation = snapshot->generation;
+      }
+    });
+  }
+
+  for (int i = 1; i <= 10000; ++i) {
+    auto writeable_view = safe_value.Lock();
+    writeable_view->generation = i;
+    writeable_view->check = i;
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_THAT(safe_value.ReaderLock()->generation, Eq(10000));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -18,7 +18,12 @@
 
 #include "asylo/util/status.h"
 
+#include <atomic>
+#include <cstdint>
+#include <new>
+
 #include "absl/strings/str_cat.h"
+#include "asylo/util/posix_error_space.h"
 #include "asylo/util/status_error_space.h"
 
 namespace asylo {
@@ -38,49 +43,174 @@ constexpr char kStatusProtoOkMismatchMsg[] =
     "The ErrorSpace error_code equivalent of GoogleError::OK should be zero";
 #endif
 
-Status::Status()
-    : error_space_(
-          error::error_enum_traits<error::GoogleError>::get_error_space()),
-      error_code_(error::GoogleError::OK) {}
+namespace {
 
-Status::Status(const error::ErrorSpace *space, int code,
-               absl::string_view message)
-    : error_space_(space), error_code_(code) {
-  if (code != 0) {
-    message_ = std::string(message);
+// POSIX errors with codes up to this bound and an empty message use blocks in
+// static storage.
+constexpr int kMaxStaticPosixCode = 255;
+
+// Number of slots in the table of blocks shared by Recurring(), the number of
+// slots probed for a status, and the longest message stored in the table.
+constexpr size_t kRecurringSlots = 512;
+constexpr size_t kRecurringProbes = 8;
+constexpr size_t kMaxRecurringMessageSize = 256;
+
+size_t RecurringHash(const error::ErrorSpace *space, int code,
+                     absl::string_view message) {
+  // FNV-1a over the message, seeded with the space and code.
+  uint64_t hash = 14695981039346656037ull ^
+                  reinterpret_cast<uintptr_t>(space) ^
+                  (static_cast<uint64_t>(code) << 32);
+  for (char c : message) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
   }
+  return static_cast<size_t>(hash);
 }
 
-Status::Status(Status &&other)
-    : error_space_(other.error_space_),
-      error_code_(other.error_code_),
-      message_(std::move(other.message_)) {
-  other.Set(error::StatusError::MOVED, kMovedByConstructorErrorMsg);
+}  // namespace
+
+const Status::Rep *Status::MakeRep(const error::ErrorSpace *space, int code,
+                                   absl::string_view message) {
+  if (code == 0) {
+    return nullptr;
+  }
+
+  // Errors without a message in the canonical and POSIX error spaces, and
+  // moved-from markers, are common enough to be shared from static storage.
+  if (message.empty()) {
+    static const Rep *const *const kCanonicalReps = [] {
+      const error::ErrorSpace *canonical_space =
+          error::error_enum_traits<error::GoogleError>::get_error_space();
+      auto reps = new const Rep *[error::GoogleError::UNAUTHENTICATED + 1];
+      for (int i = 0; i <= error::GoogleError::UNAUTHENTICATED; ++i) {
+        reps[i] = new Rep(canonical_space, i, "", /*immortal=*/true);
+      }
+      return reps;
+    }();
+    static const Rep *const kMovedRep = new Rep(
+        error::error_enum_traits<error::StatusError>::get_error_space(),
+        static_cast<int>(error::StatusError::MOVED), "", /*immortal=*/true);
+    static const error::ErrorSpace *const kPosixSpace =
+        error::error_enum_traits<error::PosixError>::get_error_space();
+    // POSIX blocks are created on first use, since only a few codes are.
+    static std::atomic<const Rep *> *const kPosixReps =
+        new std::atomic<const Rep *>[kMaxStaticPosixCode + 1]();
+    if (code > 0 && code <= error::GoogleError::UNAUTHENTICATED &&
+        space == kCanonicalReps[code]->space) {
+      return kCanonicalReps[code];
+    }
+    if (space == kMovedRep->space && code == kMovedRep->code) {
+      return kMovedRep;
+    }
+    if (space == kPosixSpace && code > 0 && code <= kMaxStaticPosixCode) {
+      std::atomic<const Rep *> &slot = kPosixReps[code];
+      const Rep *rep = slot.load(std::memory_order_acquire);
+      if (!rep) {
+        const Rep *created = new Rep(space, code, "", /*immortal=*/true);
+        if (slot.compare_exchange_strong(rep, created,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+          rep = created;
+        } else {
+          delete created;
+        }
+      }
+      return rep;
+    }
+  }
+
+  return AllocateRep(space, code, message, /*immortal=*/false);
 }
 
-Status &Status::operator=(Status &&other) {
-  error_space_ = other.error_space_;
-  error_code_ = other.error_code_;
-  message_ = std::move(other.message_);
-  other.Set(error::StatusError::MOVED, kMovedByAssignmentErrorMsg);
-  return *this;
+const Status::Rep *Status::AllocateRep(const error::ErrorSpace *space,
+                                       int code, absl::string_view message,
+                                       bool immortal) {
+  void *storage = ::operator new(sizeof(Rep) + message.size());
+  char *message_copy = static_cast<char *>(storage) + sizeof(Rep);
+  message.copy(message_copy, message.size());
+  return new (storage) Rep(
+      space, code, absl::string_view(message_copy, message.size()), immortal);
+}
+
+void Status::DeleteRep(const Rep *rep) {
+  rep->~Rep();
+  ::operator delete(const_cast<Rep *>(rep));
 }
 
-Status Status::OkStatus() { return Status(); }
+Status::Status(const error::ErrorSpace *space, int code,
+               absl::string_view message)
+    : rep_(MakeRep(space, code, message)) {}
 
-int Status::error_code() const { return error_code_; }
+Status Status::Recurring(const error::ErrorSpace *space, int code,
+                         absl::string_view message) {
+  if (code == 0 || message.empty() ||
+      message.size() > kMaxRecurringMessageSize) {
+    return Status(space, code, message);
+  }
+  // Slots are filled once and never cleared, so a block found in the table
+  // stays valid.
+  static std::atomic<const Rep *> *const kSlots =
+      new std::atomic<const Rep *>[kRecurringSlots]();
+  size_t hash = RecurringHash(space, code, message);
+  const Rep *created = nullptr;
+  for (size_t probe = 0; probe < kRecurringProbes; ++probe) {
+    std::atomic<const Rep *> &slot = kSlots[(hash + probe) % kRecurringSlots];
+    const Rep *rep = slot.load(std::memory_order_acquire);
+    if (!rep) {
+      if (!created) {
+        created = AllocateRep(space, code, message, /*immortal=*/true);
+      }
+      if (slot.compare_exchange_strong(rep, created, std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+        return Status(created);
+      }
+    }
+    if (rep->space == space && rep->code == code && rep->message == message) {
+      if (created) {
+        DeleteRep(created);
+      }
+      return Status(rep);
+    }
+  }
+  // The probed slots hold other errors.
+  if (created) {
+    DeleteRep(created);
+  }
+  return Status(space, code, message);
+}
 
-absl::string_view Status::error_message() const { return message_; }
+Status::Status(Status &&other) : rep_(other.rep_) {
+  static const Rep *const kMovedByConstructorRep = new Rep(
+      error::error_enum_traits<error::StatusError>::get_error_space(),
+      static_cast<int>(error::StatusError::MOVED), kMovedByConstructorErrorMsg,
+      /*immortal=*/true);
+  other.rep_ = kMovedByConstructorRep;
+}
 
-const error::ErrorSpace *Status::error_space() const { return error_space_; }
+Status &Status::operator=(Status &&other) {
+  static const Rep *const kMovedByAssignmentRep = new Rep(
+      error::error_enum_traits<error::StatusError>::get_error_space(),
+      static_cast<int>(error::StatusError::MOVED), kMovedByAssignmentErrorMsg,
+      /*immortal=*/true);
+  const Rep *old_rep = rep_;
+  rep_ = other.rep_;
+  other.rep_ = kMovedByAssignmentRep;
+  Unref(old_rep);
+  return *this;
+}
 
-bool Status::ok() const { return error_code_ == 0; }
+const error::ErrorSpace *Status::error_space() const {
+  return rep_ ? rep_->space
+              : error::error_enum_traits<error::GoogleError>::get_error_space();
+}
 
 std::string Status::ToString() const {
-  return ok() ? error_space_->String(error_code_)
-              : absl::StrCat(error_space_->SpaceName(),
-                             "::", error_space_->String(error_code_), ": ",
-                             message_);
+  const error::ErrorSpace *space = error_space();
+  return ok() ? space->String(error_code())
+              : absl::StrCat(space->SpaceName(),
+                             "::", space->String(error_code()), ": ",
+                             error_message());
 }
 
 Status Status::ToCanonical() const {
@@ -89,63 +219,65 @@ Status Status::ToCanonical() const {
 }
 
 error::GoogleError Status::CanonicalCode() const {
-  return error_space_->GoogleErrorCode(error_code_);
+  return ok() ? error::GoogleError::OK
+              : rep_->space->GoogleErrorCode(rep_->code);
 }
 
 void Status::SaveTo(StatusProto *status_proto) const {
-  status_proto->set_code(error_code_);
-  status_proto->set_error_message(message_);
-  status_proto->set_space(error_space_->SpaceName());
+  status_proto->set_code(error_code());
+  status_proto->set_error_message(std::string(error_message()));
+  status_proto->set_space(error_space()->SpaceName());
   status_proto->set_canonical_code(CanonicalCode());
 }
 
 void Status::RestoreFrom(const StatusProto &status_proto) {
+  int code;
   // Set the error code from the error space, if recognized.
-  error_space_ = error::ErrorSpace::Find(status_proto.space());
-  if (error_space_) {
+  const error::ErrorSpace *space =
+      error::ErrorSpace::Find(status_proto.space());
+  if (space) {
     // The canonical code must match the canonical code as computed by the
     // error space.
     if (status_proto.has_canonical_code() &&
-        (error_space_->GoogleErrorCode(status_proto.code()) !=
+        (space->GoogleErrorCode(status_proto.code()) !=
          status_proto.canonical_code())) {
-      Set(error::StatusError::RESTORE_ERROR, kStatusProtoErrorSpaceMsg);
+      *this = Status(error::StatusError::RESTORE_ERROR,
+                     kStatusProtoErrorSpaceMsg);
       return;
     } else {
-      error_code_ = status_proto.code();
+      code = status_proto.code();
     }
   } else {
     // Error space lookup failed. Use the canonical error space.
-    error_space_ =
-        error::error_enum_traits<error::GoogleError>::get_error_space();
+    space = error::error_enum_traits<error::GoogleError>::get_error_space();
 
     // Both error code and canonical code must be OK, or neither.
     if (status_proto.has_canonical_code() &&
         ((status_proto.code() == 0) != (status_proto.canonical_code() == 0))) {
-      Set(error::StatusError::RESTORE_ERROR, kStatusProtoOkMismatchMsg);
+      *this = Status(error::StatusError::RESTORE_ERROR,
+                     kStatusProtoOkMismatchMsg);
       return;
     }
     if (status_proto.has_canonical_code()) {
-      error_code_ = status_proto.canonical_code();
+      code = status_proto.canonical_code();
     } else {
       // Default to error::GoogleError::UNKNOWN.
-      error_code_ = error::GoogleError::UNKNOWN;
+      code = error::GoogleError::UNKNOWN;
     }
   }
-  if (error_code_ != 0) {
-    message_ = status_proto.error_message();
-  } else {
-    message_.clear();
-  }
+  // The message is dropped for OK codes.
+  *this = Status(space, code, status_proto.error_message());
 }
 
 bool Status::IsCanonical() const {
-  return error_space_->SpaceName() == error::kCanonicalErrorSpaceName;
+  return error_space()->SpaceName() == error::kCanonicalErrorSpaceName;
 }
 
 bool operator==(const Status &lhs, const Status &rhs) {
-  return (lhs.error_code() == rhs.error_code()) &&
-         (lhs.error_message() == rhs.error_message()) &&
-         (lhs.error_space() == rhs.error_space());
+  return (lhs.rep_ == rhs.rep_) ||
+         ((lhs.error_code() == rhs.error_code()) &&
+          (lhs.error_message() == rhs.error_message()) &&
+          (lhs.error_space() == rhs.error_space()));
 }
 
 bool operator!=(const Status &lhs, const Status &rhs) { return !(lhs == rhs); }
@@ -19,6 +19,7 @@
 #ifndef ASYLO_UTIL_STATUS_H_
 #define ASYLO_UTIL_STATUS_H_
 
+#include <atomic>
 #include <ostream>
 #include <string>
 #include <type_traits>
@@ -38,13 +39,25 @@ namespace asylo {
 /// Status contains information about an error. Status contains an error code
 /// from some error space and a message string suitable for logging or
 /// debugging.
+///
+/// A Status is a single pointer. An OK status holds a null pointer, so creating
+/// and checking one never allocates or touches memory beyond the Status itself.
+/// A non-OK status points to an immutable, reference-counted block holding the
+/// error space, code, and message, which copies share. Errors in the canonical
+/// and POSIX error spaces with an empty message use blocks allocated once per
+/// process and never freed, and Recurring() shares blocks between errors with
+/// the same message. An OK code in any error space yields the canonical OK
+/// status.
 class Status {
  public:
   /// Builds an OK Status in the canonical error space.
-  Status();
+  Status() : rep_(nullptr) {}
 
   /// Constructs a Status object containing an error code and message.
   ///
+  /// If |code| is zero, the status is OK whatever |space| is: it belongs to
+  /// the canonical error space and has no message.
+  ///
   /// \param space The ErrorSpace this code belongs to.
   /// \param code An integer error code.
   /// \param message The associated error message.
@@ -56,16 +69,18 @@ class Status {
   /// \param code A symbolic error code.
   /// \param message The associated error message.
   template <typename Enum>
-  Status(Enum code, absl::string_view message) {
-    Set(code, message);
-  }
+  Status(Enum code, absl::string_view message)
+      : Status(error::error_enum_traits<Enum>::get_error_space(),
+               static_cast<int>(code), message) {}
 
-  Status(const Status &other) = default;
+  Status(const Status &other) : rep_(other.rep_) { Ref(rep_); }
 
   // Non-default move constructor since the moved status should be set to
   // indicate an invalid state, which changes the code and error_space.
   Status(Status &&other);
 
+  ~Status() { Unref(rep_); }
+
   /// Constructs a Status object from `StatusT`. `StatusT` must be a status-type
   /// object. I.e.,
   ///
@@ -81,13 +96,18 @@ class Status {
   template <typename StatusT,
             typename E = typename absl::enable_if_t<
                 status_internal::status_type_traits<StatusT>::is_status>>
-  explicit Status(const StatusT &other) {
-    Set(status_internal::status_type_traits<StatusT>::CanonicalCode(other),
-        other.error_message());
+  explicit Status(const StatusT &other)
+      : Status(status_internal::status_type_traits<StatusT>::CanonicalCode(
+                   other),
+               other.error_message()) {}
+
+  Status &operator=(const Status &other) {
+    Ref(other.rep_);
+    Unref(rep_);
+    rep_ = other.rep_;
+    return *this;
   }
 
-  Status &operator=(const Status &other) = default;
-
   // Non-default move assignment operator since the moved status should be set
   // to indicate an invalid state, which changes the code and error_space.
   Status &operator=(Status &&other);
@@ -95,7 +115,27 @@ class Status {
   /// Constructs an OK status object.
   ///
   /// \return A Status indicating no error occurred.
-  static Status OkStatus();
+  static Status OkStatus() { return Status(); }
+
+  /// Constructs a Status like Status(space, code, message), sharing its error
+  /// block with every other status made by Recurring() with the same error
+  /// space, code, and message, so that only the first one allocates.
+  ///
+  /// Meant for errors that recur on hot paths, such as EAGAIN from a
+  /// non-blocking call or errors returned across the enclave boundary. Shared
+  /// blocks are never freed and their number is bounded, so messages should
+  /// come from a small set. Once the bound is reached, and for long messages,
+  /// this allocates like the constructor.
+  static Status Recurring(const error::ErrorSpace *space, int code,
+                          absl::string_view message);
+
+  /// Constructs a Status like Status(code, message), sharing its error block
+  /// as Recurring() above.
+  template <typename Enum>
+  static Status Recurring(Enum code, absl::string_view message) {
+    return Recurring(error::error_enum_traits<Enum>::get_error_space(),
+                     static_cast<int>(code), message);
+  }
 
   /// Copy this object to a status type `StatusT`. The method first converts the
   /// ::asylo::Status object to its canonical form, and then constructs a
@@ -116,19 +156,21 @@ class Status {
                 status_internal::status_type_traits<StatusT>::is_status>>
   StatusT ToOtherStatus() {
     Status status = ToCanonical();
-    return StatusT(status_internal::ErrorCodeHolder(status.error_code_),
-                   status.message_);
+    return StatusT(status_internal::ErrorCodeHolder(status.error_code()),
+                   std::string(status.error_message()));
   }
 
   /// Gets the integer error code for this object.
   ///
   /// \return The associated integer error code.
-  int error_code() const;
+  int error_code() const { return rep_ ? rep_->code : 0; }
 
   /// Gets the string error message for this object.
   ///
   /// \return The associated error message.
-  absl::string_view error_message() const;
+  absl::string_view error_message() const {
+    return rep_ ? rep_->message : absl::string_view();
+  }
 
   /// Gets the error space for this object.
   ///
@@ -138,7 +180,7 @@ class Status {
   /// Indicates whether this object is OK (indicates no error).
   ///
   /// \return True if this object indicates no error.
-  bool ok() const;
+  bool ok() const { return rep_ == nullptr; }
 
   /// Gets a string representation of this object.
   ///
@@ -201,20 +243,56 @@ class Status {
   /// \return True if this object matches `code`.
   template <typename Enum>
   bool Is(Enum code) const {
-    return (static_cast<int>(code) == error_code_) &&
-           (error::error_enum_traits<Enum>::get_error_space() == error_space_);
+    return (static_cast<int>(code) == error_code()) &&
+           (error::error_enum_traits<Enum>::get_error_space() ==
+            error_space());
   }
 
  private:
-  // Sets this object to hold an error code |code| and error message |message|.
-  template <typename Enum, typename StringT>
-  void Set(Enum code, StringT &&message) {
-    error_space_ = error::error_enum_traits<Enum>::get_error_space();
-    error_code_ = static_cast<int>(code);
-    if (error_code_ != 0) {
-      message_ = std::string(std::forward<StringT>(message));
-    } else {
-      message_.clear();
+  // The shared, immutable state of a non-OK status. Blocks allocated by
+  // MakeRep() hold the message right after the Rep itself. Immortal blocks
+  // are allocated once, never freed, and never reference counted.
+  struct Rep {
+    Rep(const error::ErrorSpace *space, int code, absl::string_view message,
+        bool immortal)
+        : ref_count(1),
+          immortal(immortal),
+          space(space),
+          code(code),
+          message(message) {}
+
+    mutable std::atomic<int> ref_count;
+    bool immortal;
+    const error::ErrorSpace *space;
+    int code;
+    absl::string_view message;
+  };
+
+  // Takes ownership of a reference to |rep|.
+  explicit Status(const Rep *rep) : rep_(rep) {}
+
+  // Returns the block for a status with the given contents, or nullptr if
+  // |code| is zero.
+  static const Rep *MakeRep(const error::ErrorSpace *space, int code,
+                            absl::string_view message);
+
+  // Allocates a block holding a copy of |message|.
+  static const Rep *AllocateRep(const error::ErrorSpace *space, int code,
+                                absl::string_view message, bool immortal);
+
+  // Frees |rep| once its last reference is dropped.
+  static void DeleteRep(const Rep *rep);
+
+  static void Ref(const Rep *rep) {
+    if (rep && !rep->immortal) {
+      rep->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  static void Unref(const Rep *rep) {
+    if (rep && !rep->immortal &&
+        rep->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      DeleteRep(rep);
     }
   }
 
@@ -222,12 +300,10 @@ class Status {
   // space.
   bool IsCanonical() const;
 
-  const error::ErrorSpace *error_space_;
-  int error_code_;
+  friend bool operator==(const Status &lhs, const Status &rhs);
 
-  // An optional error-message if error_code_ is non-zero. If error_code_ is
-  // zero, then message_ is empty.
-  std::string message_;
+  // The error state of this object, or nullptr for an OK status.
+  const Rep *rep_;
 };
 
 bool operator==(const Status &lhs, const Status &rhs);
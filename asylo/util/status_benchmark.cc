@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the cost of creating, copying, and propagating Status and StatusOr
+// objects, on the OK path and on the error path. Propagation returns a status
+// through several non-inlined frames with ASYLO_RETURN_IF_ERROR, as the
+// enclave entry and exit paths do.
+
+#include <iostream>
+#include <string>
+
+#include "absl/base/attributes.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(iterations, 10000000, "Number of operations per measurement");
+DEFINE_int32(depth, 4, "Number of frames an error is propagated through");
+
+namespace asylo {
+namespace {
+
+// Keeps the compiler from discarding the measured operations.
+volatile int sink;
+
+ABSL_ATTRIBUTE_NOINLINE Status Leaf(bool fail) {
+  if (fail) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Enclave is not initialized");
+  }
+  return Status::OkStatus();
+}
+
+ABSL_ATTRIBUTE_NOINLINE Status Propagate(int depth, bool fail) {
+  if (depth == 0) {
+    return Leaf(fail);
+  }
+  ASYLO_RETURN_IF_ERROR(Propagate(depth - 1, fail));
+  return Status::OkStatus();
+}
+
+ABSL_ATTRIBUTE_NOINLINE StatusOr<int> PropagateStatusOr(int depth,
+                                                       bool fail) {
+  if (depth == 0) {
+    if (fail) {
+      return Status(error::GoogleError::FAILED_PRECONDITION,
+                    "Enclave is not initialized");
+    }
+    return depth;
+  }
+  StatusOr<int> result = PropagateStatusOr(depth - 1, fail);
+  if (!result.ok()) {
+    return result.status();
+  }
+  return result.ValueOrDie() + 1;
+}
+
+// Runs |operation| FLAGS_iterations times and prints the time per operation.
+template <typename Operation>
+void Measure(const char *name, Operation operation) {
+  absl::Time start = absl::Now();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    operation();
+  }
+  absl::Duration elapsed = absl::Now() - start;
+  std::cout << absl::StrFormat(
+      "%-28s %8.2f ns per operation\n", name,
+      absl::ToDoubleNanoseconds(elapsed) / FLAGS_iterations);
+}
+
+void Run() {
+  Measure("create ok", [] {
+    Status status = Status::OkStatus();
+    sink = status.ok();
+  });
+  Measure("create error", [] {
+    Status status(error::GoogleError::INTERNAL, "Enclave call failed");
+    sink = status.ok();
+  });
+  Measure("create error, no message", [] {
+    Status status(error::GoogleError::INTERNAL, "");
+    sink = status.ok();
+  });
+
+  Status ok_status = Status::OkStatus();
+  Status error_status(error::GoogleError::INTERNAL, "Enclave call failed");
+  Measure("copy ok", [&ok_status] {
+    Status copy = ok_status;
+    sink = copy.ok();
+  });
+  Measure("copy error", [&error_status] {
+    Status copy = error_status;
+    sink = copy.ok();
+  });
+
+  Measure("propagate ok", [] { sink = Propagate(FLAGS_depth, false).ok(); });
+  Measure("propagate error",
+          [] { sink = Propagate(FLAGS_depth, true).ok(); });
+  Measure("propagate StatusOr ok",
+          [] { sink = PropagateStatusOr(FLAGS_depth, false).ok(); });
+  Measure("propagate StatusOr error",
+          [] { sink = PropagateStatusOr(FLAGS_depth, true).ok(); });
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Run();
+  return 0;
+}
@@ -440,5 +440,58 @@ TEST(StatusTest, ConstructorWithErrorSpaceNotOk) {
                              "This message is copied"));
 }
 
+TEST(StatusTest, OkCodeInOtherErrorSpaceIsCanonicalOk) {
+  Status that(error::error_enum_traits<error::PosixError>::get_error_space(),
+              0, "This message is not copied");
+  EXPECT_THAT(that, IsOk());
+  EXPECT_EQ(that.error_space(),
+            error::error_enum_traits<error::GoogleError>::get_error_space());
+  EXPECT_TRUE(that.error_message().empty());
+  EXPECT_EQ(that, Status::OkStatus());
+}
+
+TEST(StatusTest, PosixErrorsWithoutMessageShareBlock) {
+  Status first(error::PosixError::P_EAGAIN, "");
+  Status second(error::PosixError::P_EAGAIN, "");
+  EXPECT_THAT(first, StatusIs(error::PosixError::P_EAGAIN, ""));
+  EXPECT_EQ(first.error_message().data(), second.error_message().data());
+  EXPECT_EQ(first, second);
+
+  Status other(error::PosixError::P_EINTR, "");
+  EXPECT_THAT(other, StatusIs(error::PosixError::P_EINTR, ""));
+  EXPECT_NE(first, other);
+}
+
+TEST(StatusTest, RecurringStatusesShareBlock) {
+  Status first = Status::Recurring(error::PosixError::P_EAGAIN, "Try again");
+  Status second = Status::Recurring(error::PosixError::P_EAGAIN, "Try again");
+  EXPECT_THAT(first, StatusIs(error::PosixError::P_EAGAIN, "Try again"));
+  EXPECT_EQ(first.error_message().data(), second.error_message().data());
+  EXPECT_EQ(first, second);
+
+  Status other_message =
+      Status::Recurring(error::PosixError::P_EAGAIN, "Try later");
+  EXPECT_THAT(other_message,
+              StatusIs(error::PosixError::P_EAGAIN, "Try later"));
+  Status other_space = Status::Recurring(
+      error::error_enum_traits<error::GoogleError>::get_error_space(),
+      error::PosixError::P_EAGAIN, "Try again");
+  EXPECT_NE(other_space.error_space(), first.error_space());
+  EXPECT_NE(other_space.error_message().data(), first.error_message().data());
+}
+
+TEST(StatusTest, RecurringOkIsOk) {
+  EXPECT_THAT(Status::Recurring(error::GoogleError::OK, "Not copied"), IsOk());
+}
+
+TEST(StatusTest, RecurringStatusesBeyondTableAreCorrect) {
+  // Far more distinct errors than the shared table holds.
+  for (int i = 0; i < 4096; ++i) {
+    std::string message = "Error " + std::to_string(i);
+    Status status = Status::Recurring(error::GoogleError::INTERNAL, message);
+    EXPECT_THAT(status, StatusIs(error::GoogleError::INTERNAL, message));
+  }
+}
+
 }  // namespace
 }  // namespace asylo
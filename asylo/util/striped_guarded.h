@@ -0,0 +1,122 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_STRIPED_GUARDED_H_
+#define ASYLO_UTIL_STRIPED_GUARDED_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "asylo/util/mutex_guarded.h"
+
+namespace asylo {
+
+// StripedGuarded<Map> shards a keyed container across a fixed number of
+// stripes, each of which is an independent MutexGuarded<Map>. A key always
+// maps to the same stripe, so operations on keys in different stripes do not
+// contend on a lock.
+//
+// Locking a key returns the same LockView<Map> and ReaderLockView<Map> objects
+// as MutexGuarded<Map>, which dereference to the stripe holding that key:
+//
+//     StripedGuarded<absl::flat_hash_map<std::string, int>> counts;
+//
+//     ++(*counts.Lock("apple"))["apple"];
+//
+//     auto view = counts.ReaderLock("apple");
+//     auto it = view->find("apple");
+//
+// Each stripe only contains the keys that map to it. Operations that need to
+// see the whole container, like iteration, must visit each stripe in turn with
+// LockStripe() or ReaderLockStripe(), and do not observe an atomic snapshot of
+// all stripes.
+template <typename Map, typename Hash = absl::Hash<typename Map::key_type>>
+class StripedGuarded {
+ public:
+  using key_type = typename Map::key_type;
+
+  // The default number of stripes.
+  static constexpr size_t kDefaultNumStripes = 16;
+
+  // Constructs a StripedGuarded<Map> with |num_stripes| empty stripes.
+  explicit StripedGuarded(size_t num_stripes = kDefaultNumStripes) {
+    stripes_.reserve(num_stripes);
+    for (size_t i = 0; i < num_stripes; ++i) {
+      stripes_.push_back(absl::make_unique<MutexGuarded<Map>>(Map()));
+    }
+  }
+
+  StripedGuarded(const StripedGuarded &other) = delete;
+  StripedGuarded &operator=(const StripedGuarded &other) = delete;
+
+  // Returns the number of stripes.
+  size_t num_stripes() const { return stripes_.size(); }
+
+  // Returns the index of the stripe that holds |key|.
+  size_t StripeIndex(const key_type &key) const {
+    return Hash()(key) % stripes_.size();
+  }
+
+  // Returns a smart pointer to the stripe that holds |key|. The smart pointer
+  // is also an RAII writer lock on that stripe.
+  LockView<Map> Lock(const key_type &key) {
+    return stripes_[StripeIndex(key)]->Lock();
+  }
+
+  // Returns a read-only smart pointer to the stripe that holds |key|. The smart
+  // pointer is also an RAII reader lock on that stripe.
+  ReaderLockView<Map> ReaderLock(const key_type &key) const {
+    return stripes_[StripeIndex(key)]->ReaderLock();
+  }
+
+  // Returns a smart pointer to the |index|th stripe, which is also an RAII
+  // writer lock on that stripe.
+  LockView<Map> LockStripe(size_t index) { return stripes_[index]->Lock(); }
+
+  // Returns a read-only smart pointer to the |index|th stripe, which is also an
+  // RAII reader lock on that stripe.
+  ReaderLockView<Map> ReaderLockStripe(size_t index) const {
+    return stripes_[index]->ReaderLock();
+  }
+
+  // Returns the total number of elements across all stripes. Each stripe is
+  // reader-locked in turn, so the result is not an atomic snapshot if there
+  // are concurrent writers.
+  size_t size() const {
+    size_t total = 0;
+    for (const auto &stripe : stripes_) {
+      total += stripe->ReaderLock()->size();
+    }
+    return total;
+  }
+
+ private:
+  // Stripes are allocated separately so that neighboring locks do not share a
+  // cache line.
+  std::vector<std::unique_ptr<MutexGuarded<Map>>> stripes_;
+};
+
+template <typename Map, typename Hash>
+constexpr size_t StripedGuarded<Map, Hash>::kDefaultNumStripes;
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_STRIPED_GUARDED_H_
@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/striped_guarded.h"
+
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_map.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+using StripedMap = StripedGuarded<absl::flat_hash_map<int, int>>;
+
+constexpr int kNumThreads = 16;
+constexpr int kKeysPerThread = 1000;
+
+TEST(StripedGuardedTest, KeysAreFoundInTheirStripe) {
+  StripedMap map;
+  EXPECT_THAT(map.num_stripes(), Eq(StripedMap::kDefaultNumStripes));
+  for (int i = 0; i < 100; ++i) {
+    map.Lock(i)->emplace(i, i * i);
+  }
+  for (int i = 0; i < 100; ++i) {
+    {
+      auto view = map.ReaderLock(i);
+      auto it = view->find(i);
+      ASSERT_THAT(it, Ne(view->end()));
+      EXPECT_THAT(it->second, Eq(i * i));
+    }
+    EXPECT_THAT(map.ReaderLockStripe(map.StripeIndex(i))->count(i), Eq(1));
+  }
+  EXPECT_THAT(map.size(), Eq(100));
+}
+
+TEST(StripedGuardedTest, WritesFromAllThreadsAreVisible) {
+  StripedMap map(/*num_stripes=*/7);
+  std::vector<std::thread> threads;
+  threads.reserve(kNumThreads);
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([t, &map] {
+      for (int i = 0; i < kKeysPerThread; ++i) {
+        int key = t * kKeysPerThread + i;
+        map.Lock(key)->emplace(key, t);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_THAT(map.size(), Eq(kNumThreads * kKeysPerThread));
+  size_t total = 0;
+  for (size_t i = 0; i < map.num_stripes(); ++i) {
+    auto stripe = map.ReaderLockStripe(i);
+    for (const auto &entry : *stripe) {
+      EXPECT_THAT(map.StripeIndex(entry.first), Eq(i));
+    }
+    total += stripe->size();
+  }
+  EXPECT_THAT(total, Eq(kNumThreads * kKeysPerThread));
+}
+
+}  // namespace
+}  // namespace asylo